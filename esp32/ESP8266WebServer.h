@@ -0,0 +1,18 @@
+#ifndef ESP32_ESP8266WEBSERVER_H
+#define ESP32_ESP8266WEBSERVER_H
+
+#include <WebServer.h>
+#include "esp8266_compat.h"
+
+// The ESP32 WebServer with the ESP8266 overloads that take a length
+class ESP8266WebServer : public WebServer {
+public:
+  explicit ESP8266WebServer(int port = 80) : WebServer(port) {}
+
+  using WebServer::send;
+  void send(int code, const char* contentType, const char* content, size_t contentLength) {
+    send_P(code, contentType, content, contentLength);
+  }
+};
+
+#endif
@@ -0,0 +1,17 @@
+#ifndef ESP32_ESP8266WIFI_H
+#define ESP32_ESP8266WIFI_H
+
+#include <WiFi.h>
+#include "esp8266_compat.h"
+
+// Sleep types of the ESP8266 API; PowerManager maps them to esp_wifi modes
+enum WiFiSleepType_t {
+  WIFI_NONE_SLEEP,
+  WIFI_LIGHT_SLEEP,
+  WIFI_MODEM_SLEEP
+};
+
+// The ESP32 reports a wrong password as a failed connection
+#define WL_WRONG_PASSWORD WL_CONNECT_FAILED
+
+#endif
@@ -0,0 +1,7 @@
+#ifndef ESP32_SERVO_SHIM_H
+#define ESP32_SERVO_SHIM_H
+
+// Same Servo class, driven by the LEDC peripheral
+#include <ESP32Servo.h>
+
+#endif
@@ -0,0 +1,21 @@
+#ifndef ESP32_SOFTWARESERIAL_H
+#define ESP32_SOFTWARESERIAL_H
+
+#include <HardwareSerial.h>
+#include "esp8266_compat.h"
+
+// The ESP32 has a spare hardware UART, routed to the given pins
+class SoftwareSerial : public HardwareSerial {
+private:
+  int8_t rxPin;
+  int8_t txPin;
+
+public:
+  SoftwareSerial(int8_t rx, int8_t tx) : HardwareSerial(2), rxPin(rx), txPin(tx) {}
+
+  void begin(unsigned long baud) {
+    HardwareSerial::begin(baud, SERIAL_8N1, rxPin, txPin);
+  }
+};
+
+#endif
@@ -0,0 +1,7 @@
+#ifndef ESP32_UPDATER_H
+#define ESP32_UPDATER_H
+
+// Same Update object and calls as the ESP8266 core
+#include <Update.h>
+
+#endif
@@ -0,0 +1,29 @@
+#ifndef ESP32_BEARSSL_HASH_H
+#define ESP32_BEARSSL_HASH_H
+
+#include <mbedtls/sha256.h>
+
+// The BearSSL SHA-256 calls FirmwareUpdater uses, on mbedTLS
+struct br_sha256_context {
+  mbedtls_sha256_context mbed;
+};
+
+inline void br_sha256_init(br_sha256_context* ctx) {
+  mbedtls_sha256_init(&ctx->mbed);
+  mbedtls_sha256_starts_ret(&ctx->mbed, 0);
+}
+
+inline void br_sha256_update(br_sha256_context* ctx, const void* data, size_t len) {
+  mbedtls_sha256_update_ret(&ctx->mbed, (const unsigned char*)data, len);
+}
+
+// Like BearSSL, leaves the context usable for more data
+inline void br_sha256_out(const br_sha256_context* ctx, void* out) {
+  mbedtls_sha256_context copy;
+  mbedtls_sha256_init(&copy);
+  mbedtls_sha256_clone(&copy, &ctx->mbed);
+  mbedtls_sha256_finish_ret(&copy, (unsigned char*)out);
+  mbedtls_sha256_free(&copy);
+}
+
+#endif
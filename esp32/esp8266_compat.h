@@ -0,0 +1,60 @@
+#ifndef ESP8266_COMPAT_H
+#define ESP8266_COMPAT_H
+
+#include <Arduino.h>
+#include <esp_timer.h>
+
+// ESP8266 core names the firmware uses, on the ESP32 core. Only the esp32dev
+// build puts this directory on the include path.
+
+// NodeMCU pin labels, mapped to ESP32 DevKit pins on the same roles:
+// D1/D2 are the OLED's I2C pins, D3/D4 the PMS5003 UART
+#define D0 2
+#define D1 22
+#define D2 21
+#define D3 16
+#define D4 17
+#define D5 18
+#define D6 19
+#define D7 23
+#define D8 25
+
+inline uint64_t micros64() {
+  return esp_timer_get_time();
+}
+
+enum rst_reason {
+  REASON_DEFAULT_RST = 0,
+  REASON_WDT_RST = 1,
+  REASON_EXCEPTION_RST = 2,
+  REASON_SOFT_WDT_RST = 3,
+  REASON_SOFT_RESTART = 4,
+  REASON_DEEP_SLEEP_AWAKE = 5,
+  REASON_EXT_SYS_RST = 6
+};
+
+struct rst_info {
+  uint32_t reason;
+  uint32_t exccause;
+  uint32_t epc1;
+  uint32_t epc2;
+  uint32_t epc3;
+  uint32_t excvaddr;
+  uint32_t depc;
+};
+
+class EspCompat : public EspClass {
+public:
+  uint32_t getChipId();                 // Low 24 bits of the MAC, as on the ESP8266
+  uint32_t getMaxFreeBlockSize();
+  uint8_t getHeapFragmentation();       // Percent
+  bool rtcUserMemoryRead(uint32_t offset, uint32_t* data, size_t size);
+  bool rtcUserMemoryWrite(uint32_t offset, uint32_t* data, size_t size);
+  rst_info* getResetInfoPtr();
+  String getResetReason();
+};
+
+extern EspCompat espCompat;
+#define ESP espCompat
+
+#endif
@@ -0,0 +1,878 @@
+// Fleet simulator: hundreds of virtual hubs in one host process, each with
+// the firmware's own sensor pipeline, web server, peers and CoAP, serving
+// HTTP on its own loopback port while load threads poll them.
+//
+//   pio run -e fleet && .pio/build/fleet/program --hubs 200 --seconds 10
+//
+// Options: --hubs N, --seconds S, --port P (first hub's port), --clients N
+// (load threads), --sources N (client addresses, 127.1.x.y), --path URI,
+// --seed N (first hub's simulator seed, the others count up), --per-hub,
+// --compare N (instead of the load, N readings from hub 0 by HTTP polling
+// and by CoAP, one at a time: round trip and bytes per reading; then N
+// clicks on the LED and the door, by request and page reload and over the
+// WebSocket: time to the actuator and bytes per click).
+//
+// The firmware keeps some state in process-wide globals (see main.cpp).
+// Those the fleet can give each hub are swapped in for its turn; the rest
+// are shared by every hub and listed in the report.
+
+#include <Arduino.h>
+#include <LittleFS.h>
+#include "pms_sensor.h"
+#include "air_quality_display.h"
+#include "air_quality_webserver.h"
+#include "heap_monitor.h"
+#include "sensor_history.h"
+#include "history_archive.h"
+#include "rules_engine.h"
+#include "house_peers.h"
+#include "time_sync.h"
+#include "black_box.h"
+#include "power_manager.h"
+#include "coap_server.h"
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <new>
+#include <thread>
+#include <vector>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+// As in main.cpp
+#define SENSOR_READ_INTERVAL 30000
+
+#define FLEET_MAX_HUBS 1024
+#define FLEET_WARMUP_MS 1000           // Sensors read and peers heard before load starts
+#define FLEET_COMPARE_TIMEOUT_MS 5000  // A reading not back by then counts as failed
+#define FLEET_OBSERVED_READINGS 8      // Notifications --compare waits for; one per sensor read
+
+// Host heap attributed to the hub whose turn it is. Each block carries its
+// owner, so a block freed later or on another thread is still charged to
+// the hub that allocated it. The figures include host-only containers
+// (std::function, the route list), so they bound the chip's heap from above,
+// and a house-peer multicast is charged to its sender until every other hub
+// has read it, which is most of the peak in a large fleet.
+struct alignas(16) HeapTag {
+  int32_t owner;
+  size_t size;
+};
+
+static thread_local int32_t heapOwner = -1;
+static std::atomic<int64_t> heapLive[FLEET_MAX_HUBS];
+static std::atomic<int64_t> heapPeak[FLEET_MAX_HUBS];
+
+static void* trackedAlloc(size_t size) {
+  HeapTag* tag = (HeapTag*)malloc(sizeof(HeapTag) + size);
+  if (!tag) {
+    return nullptr;
+  }
+  tag->owner = heapOwner;
+  tag->size = size;
+  if (tag->owner >= 0) {
+    int64_t live = heapLive[tag->owner].fetch_add(size, std::memory_order_relaxed) + size;
+    int64_t peak = heapPeak[tag->owner].load(std::memory_order_relaxed);
+    while (live > peak && !heapPeak[tag->owner].compare_exchange_weak(peak, live, std::memory_order_relaxed)) {
+    }
+  }
+  return tag + 1;
+}
+
+static void trackedFree(void* block) {
+  if (!block) {
+    return;
+  }
+  HeapTag* tag = (HeapTag*)block - 1;
+  if (tag->owner >= 0) {
+    heapLive[tag->owner].fetch_sub(tag->size, std::memory_order_relaxed);
+  }
+  free(tag);
+}
+
+void* operator new(size_t size) {
+  void* block = trackedAlloc(size);
+  if (!block) {
+    throw std::bad_alloc();
+  }
+  return block;
+}
+void* operator new[](size_t size) { return operator new(size); }
+void* operator new(size_t size, const std::nothrow_t&) noexcept { return trackedAlloc(size); }
+void* operator new[](size_t size, const std::nothrow_t&) noexcept { return trackedAlloc(size); }
+void operator delete(void* block) noexcept { trackedFree(block); }
+void operator delete[](void* block) noexcept { trackedFree(block); }
+void operator delete(void* block, size_t) noexcept { trackedFree(block); }
+void operator delete[](void* block, size_t) noexcept { trackedFree(block); }
+void operator delete(void* block, const std::nothrow_t&) noexcept { trackedFree(block); }
+void operator delete[](void* block, const std::nothrow_t&) noexcept { trackedFree(block); }
+
+// One hub: the objects main.cpp creates, wired the same way, plus what the
+// host core keeps globally and each hub needs its own copy of
+struct Hub {
+  uint16_t index;
+  PMSSensor sensor;
+  HousePeers peers;
+  AirQualityDisplay display;
+  HeapMonitor heapMonitor;
+  SensorHistory history;
+  HistoryArchive archive;
+  RulesEngine rules;
+  TimeSync timeSync;
+  AirQualityWebServer webServer;
+
+  EspClass chip;
+  ESP8266WiFiClass station;
+  BlackBox box;
+  fs::Volume flash;
+
+  bool ledState = false;
+  int servoPosition = 0;
+  WebSocketsServer* liveSocket = nullptr;    // The dashboard socket, for --compare to inject into
+  unsigned long lastSensorRead = 0;
+  unsigned long lastDisplayUpdate = 0;
+  uint32_t unhealthyReadings = 0;
+
+  Hub(uint16_t hubIndex)
+      : index(hubIndex), peers(&sensor), display(&sensor, &peers),
+        webServer(&sensor, &display, &heapMonitor, &history, &timeSync, &archive, &rules, &peers) {}
+
+  void setup();
+  void loop();
+  void serviceSensorAndDisplay();
+  void storeReadings();
+};
+
+static std::vector<std::unique_ptr<Hub>> hubs;
+static Hub* current = nullptr;
+static uint64_t startMicros = 0;
+
+static uint64_t wallMicros() {
+  return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Puts the hub's chip, station, black box and flash in place of the globals
+// for its turn, and back afterwards. The host clock follows real time.
+static void enter(Hub& hub) {
+  hostMicros = std::max(hostMicros, wallMicros() - startMicros);
+  std::swap(ESP, hub.chip);
+  std::swap(WiFi, hub.station);
+  std::swap(blackBox, hub.box);
+  LittleFS.useVolume(&hub.flash);
+  current = &hub;
+  heapOwner = hub.index;
+}
+
+static void leave(Hub& hub) {
+  std::swap(ESP, hub.chip);
+  std::swap(WiFi, hub.station);
+  std::swap(blackBox, hub.box);
+  LittleFS.useVolume(nullptr);
+  current = nullptr;
+  heapOwner = -1;
+}
+
+// Actuators, reached by the web server, CoAP, WebSocket and rules through
+// these functions; main.cpp keeps one LED and servo, the fleet one per hub
+void setLED(bool state) {
+  current->ledState = state;
+}
+
+bool getLEDState() {
+  return current->ledState;
+}
+
+void setServoPosition(int angle) {
+  current->servoPosition = angle;
+}
+
+int getServoPosition() {
+  return current->servoPosition;
+}
+
+// setup() without the peripheral start-up delays
+void Hub::setup() {
+  blackBox.begin();
+  LittleFS.begin();
+  archive.begin();
+  rules.begin();
+  webServer.begin("fleet", "fleet");
+  liveSocket = hostLastSocket;
+  webServer.setBackgroundTask([this]() {
+    serviceSensorAndDisplay();
+    heapMonitor.update();
+  });
+  display.begin();
+  sensor.begin();
+  heapMonitor.begin();
+  lastSensorRead = TimeSync::monotonicMillis();
+  lastDisplayUpdate = millis();
+}
+
+// loop() without the idle wait; the fleet sleeps once per round instead
+void Hub::loop() {
+  uint32_t loopStart = micros();
+  webServer.handleClient();
+  timeSync.update();
+  peers.loop();
+  serviceSensorAndDisplay();
+  storeReadings();
+  heapMonitor.update();
+  blackBox.loopDone(micros() - loopStart);
+}
+
+void Hub::serviceSensorAndDisplay() {
+  if ((unsigned long)TimeSync::monotonicMillis() - lastSensorRead >= SENSOR_READ_INTERVAL) {
+    if (sensor.readData()) {
+      sensor.updateTrend(timeSync.hourOf(sensor.getSnapshot().time));
+      sensor.updateForecast();
+    }
+    lastSensorRead = TimeSync::monotonicMillis();
+  }
+  if (millis() - lastDisplayUpdate >= powerManager.getDisplayInterval()) {
+    display.update();
+    lastDisplayUpdate = millis();
+  }
+}
+
+// As in main.cpp, except that an unhealthy reading is counted instead of
+// blinking the LED: the blink waits 2 s in delay(), which here would move
+// the clock every hub shares
+void Hub::storeReadings() {
+  PMSSensor::ReadingSnapshot reading;
+  while (sensor.nextReading(reading)) {
+    blackBox.noteReading(reading.sequence, reading.data.pm2_5_atm, reading.data.isValid);
+    if (reading.data.isValid && reading.level == AIR_UNHEALTHY) {
+      unhealthyReadings++;
+    }
+    rules.evaluate(reading);
+    if (!reading.data.isValid) {
+      continue;
+    }
+    history.add(reading);
+    if (timeSync.isSynced()) {
+      HistorySample sample = history.at(history.size() - 1);
+      sample.time = timeSync.toEpoch(sample.time);
+      archive.add(sample);
+    }
+  }
+}
+
+struct FleetOptions {
+  uint16_t hubs = 200;
+  uint32_t seconds = 10;
+  uint16_t port = 18000;
+  uint16_t clients = 8;
+  uint16_t sources = 256;
+  const char* path = "/api/data";
+  uint32_t seed = SIM_SEED;
+  bool perHub = false;
+  uint32_t compare = 0;
+};
+
+// Results of one load thread
+struct ClientStats {
+  uint64_t requests = 0;
+  uint64_t bytes = 0;
+  uint64_t ok = 0;
+  uint64_t notModified = 0;
+  uint64_t limited = 0;
+  uint64_t shed = 0;
+  uint64_t other = 0;
+  uint64_t failed = 0;
+  std::vector<uint32_t> latencies;     // µs
+};
+
+static std::atomic<bool> loadRunning(true);
+static std::atomic<uint16_t> clientsRunning(0);
+
+// Connects from its own loopback addresses so that admission control sees
+// many clients, sends one GET per connection and reads to the close
+static void runClient(uint16_t number, const FleetOptions& options, ClientStats& stats) {
+  char request[160];
+  uint32_t turn = 0;
+  while (loadRunning.load(std::memory_order_relaxed)) {
+    uint16_t hub = (number + turn * options.clients) % options.hubs;
+    uint16_t source = (number + turn * options.clients) % options.sources;
+    turn++;
+
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    int flag = 1;
+    setsockopt(fd, IPPROTO_IP, IP_BIND_ADDRESS_NO_PORT, &flag, sizeof(flag));
+    timeval timeout = { 5, 0 };
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    sockaddr_in local = {};
+    local.sin_family = AF_INET;
+    local.sin_addr.s_addr = htonl(0x7F010000 | (source + 1));
+    sockaddr_in remote = {};
+    remote.sin_family = AF_INET;
+    remote.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    remote.sin_port = htons(options.port + hub);
+
+    uint64_t start = wallMicros();
+    int length = snprintf(request, sizeof(request), "GET %s HTTP/1.1\r\nHost: hub%u\r\n\r\n", options.path, hub);
+    if (bind(fd, (sockaddr*)&local, sizeof(local)) != 0 || connect(fd, (sockaddr*)&remote, sizeof(remote)) != 0 ||
+        send(fd, request, length, MSG_NOSIGNAL) != length) {
+      close(fd);
+      stats.failed++;
+      continue;
+    }
+    char buffer[4096];
+    char status[16] = {};
+    size_t received = 0;
+    ssize_t n;
+    while ((n = recv(fd, buffer, sizeof(buffer), 0)) > 0) {
+      if (received < sizeof(status) - 1) {
+        memcpy(status + received, buffer, std::min((size_t)n, sizeof(status) - 1 - received));
+      }
+      received += n;
+    }
+    close(fd);
+    uint32_t elapsed = wallMicros() - start;
+
+    int code = 0;
+    if (n < 0 || sscanf(status, "HTTP/1.1 %d", &code) != 1) {
+      stats.failed++;
+      continue;
+    }
+    stats.requests++;
+    stats.bytes += received;
+    stats.latencies.push_back(elapsed);
+    if (code == 200) {
+      stats.ok++;
+    } else if (code == 304) {
+      stats.notModified++;
+    } else if (code == 429) {
+      stats.limited++;
+    } else if (code == 503) {
+      stats.shed++;
+    } else {
+      stats.other++;
+    }
+  }
+  clientsRunning--;
+}
+
+// Runs every hub once per round while keepRunning() holds; sleeps briefly
+// when a round found nothing waiting, so the load threads get the CPU
+static void runHubs(std::function<bool()> keepRunning) {
+  while (keepRunning()) {
+    bool busy = false;
+    for (auto& hub : hubs) {
+      enter(*hub);
+      busy |= hub->webServer.hasPendingRequest();
+      hub->loop();
+      leave(*hub);
+    }
+    if (!busy) {
+      usleep(200);
+    }
+  }
+}
+
+static uint32_t percentile(const std::vector<uint32_t>& sorted, uint8_t percent) {
+  return sorted.empty() ? 0 : sorted[std::min(sorted.size() - 1, sorted.size() * percent / 100)];
+}
+
+// Runs every hub once
+static void runRound() {
+  for (auto& hub : hubs) {
+    enter(*hub);
+    hub->loop();
+    leave(*hub);
+  }
+}
+
+// Results of one protocol in --compare
+struct CompareStats {
+  uint32_t readings = 0;
+  uint32_t failed = 0;
+  uint64_t bytesOut = 0;               // Client to hub, application bytes: no TCP, UDP or IP headers
+  uint64_t bytesIn = 0;
+  std::vector<uint32_t> latencies;     // µs
+};
+
+static int actuators(const Hub& hub) {
+  return hub.ledState * 256 + hub.servoPosition;
+}
+
+// One GET per connection, as a polling client does, from the given source
+// address; the hubs are run while the answer is awaited. With actuatedAt,
+// also notes when hub 0 first wrote the LED or servo.
+static bool pollHttp(const FleetOptions& options, const char* path, uint16_t source, CompareStats& stats,
+                     uint64_t* actuatedAt = nullptr) {
+  int fd = socket(AF_INET, SOCK_STREAM, 0);
+  sockaddr_in local = {};
+  local.sin_family = AF_INET;
+  local.sin_addr.s_addr = htonl(0x7F010000 | (source + 1));
+  sockaddr_in remote = {};
+  remote.sin_family = AF_INET;
+  remote.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  remote.sin_port = htons(options.port);
+  char request[160];
+  int length = snprintf(request, sizeof(request), "GET %s HTTP/1.1\r\nHost: hub0\r\n\r\n", path);
+
+  int before = actuators(*hubs[0]);
+  uint64_t start = wallMicros();
+  if (bind(fd, (sockaddr*)&local, sizeof(local)) != 0 || connect(fd, (sockaddr*)&remote, sizeof(remote)) != 0 ||
+      send(fd, request, length, MSG_NOSIGNAL) != length) {
+    close(fd);
+    return false;
+  }
+  char buffer[4096];
+  char status[16] = {};
+  size_t received = 0;
+  ssize_t n = -1;
+  while (wallMicros() - start < FLEET_COMPARE_TIMEOUT_MS * 1000ULL) {
+    runRound();
+    if (actuatedAt && *actuatedAt == 0 && actuators(*hubs[0]) != before) {
+      *actuatedAt = wallMicros();
+    }
+    while ((n = recv(fd, buffer, sizeof(buffer), MSG_DONTWAIT)) > 0) {
+      if (received < sizeof(status) - 1) {
+        memcpy(status + received, buffer, std::min((size_t)n, sizeof(status) - 1 - received));
+      }
+      received += n;
+    }
+    if (n == 0 || (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK)) {
+      break;
+    }
+  }
+  close(fd);
+  uint32_t elapsed = wallMicros() - start;
+  int code = 0;
+  if (n != 0 || sscanf(status, "HTTP/1.1 %d", &code) != 1 || code != 200) {
+    return false;
+  }
+  stats.readings++;
+  stats.bytesOut += length;
+  stats.bytesIn += received;
+  stats.latencies.push_back(elapsed);
+  return true;
+}
+
+// Runs the hubs until a datagram reaches the panel; its size, or 0
+static int awaitDatagram(WiFiUDP& panel, uint64_t start) {
+  while (wallMicros() - start < FLEET_COMPARE_TIMEOUT_MS * 1000ULL) {
+    runRound();
+    int size = panel.parsePacket();
+    if (size > 0) {
+      return size;
+    }
+  }
+  return 0;
+}
+
+// A panel socket on the in-process network, from the given source address
+static void bindPanel(WiFiUDP& panel, uint16_t source) {
+  ESP8266WiFiClass idle = WiFi;
+  WiFi.linkStatus = WL_CONNECTED;
+  WiFi.address = IPAddress(10, 1, source >> 8, (source & 0xFF) + 1);
+  panel.begin(COAP_PORT + 1);
+  WiFi = idle;
+}
+
+// CON GET /reading, answered by a piggybacked ACK carrying the reading
+static bool pollCoap(uint16_t source, uint16_t messageId, CompareStats& stats) {
+  WiFiUDP panel;
+  bindPanel(panel, source);
+  const uint8_t request[] = { 0x42, COAP_GET, (uint8_t)(messageId >> 8), (uint8_t)messageId, 0x01, 0x02,
+                              0xB7, 'r', 'e', 'a', 'd', 'i', 'n', 'g' };
+  uint64_t start = wallMicros();
+  panel.beginPacket(hubs[0]->station.address, COAP_PORT);
+  panel.write(request, sizeof(request));
+  panel.endPacket();
+  int size = awaitDatagram(panel, start);
+  uint32_t elapsed = wallMicros() - start;
+  uint8_t response[4];
+  if (size < 4 || panel.read(response, 4) != 4 || ((response[0] >> 4) & 0x03) != COAP_ACK ||
+      response[1] != COAP_CONTENT || ((response[2] << 8) | response[3]) != messageId) {
+    return false;
+  }
+  stats.readings++;
+  stats.bytesOut += sizeof(request);
+  stats.bytesIn += size;
+  stats.latencies.push_back(elapsed);
+  return true;
+}
+
+// Registers for /reading and counts what each new reading costs: one
+// notification, and an empty ACK for those sent confirmable. The latency is
+// from the round that took the reading to its notification.
+static void observeCoap(uint16_t source, uint16_t messageId, CompareStats& stats) {
+  WiFiUDP panel;
+  bindPanel(panel, source);
+  const uint8_t request[] = { 0x42, COAP_GET, (uint8_t)(messageId >> 8), (uint8_t)messageId, 0x01, 0x02,
+                              0x60, 0x57, 'r', 'e', 'a', 'd', 'i', 'n', 'g' };
+  panel.beginPacket(hubs[0]->station.address, COAP_PORT);
+  panel.write(request, sizeof(request));
+  panel.endPacket();
+  if (awaitDatagram(panel, wallMicros()) == 0) {
+    stats.failed++;
+    return;
+  }
+
+  uint32_t sequence = hubs[0]->sensor.readSnapshot().sequence;
+  uint64_t readAt = 0;
+  uint64_t waitStart = wallMicros();
+  while (stats.readings < FLEET_OBSERVED_READINGS) {
+    if (wallMicros() - waitStart >= FLEET_COMPARE_TIMEOUT_MS * 1000ULL) {
+      stats.failed++;
+      return;
+    }
+    runRound();
+    uint32_t latest = hubs[0]->sensor.readSnapshot().sequence;
+    if (latest != sequence) {
+      sequence = latest;
+      readAt = wallMicros();
+    }
+    int size = panel.parsePacket();
+    if (size < 4) {
+      continue;
+    }
+    uint8_t header[4];
+    panel.read(header, sizeof(header));
+    if (((header[0] >> 4) & 0x03) == COAP_CON) {
+      const uint8_t ack[] = { 0x60, COAP_EMPTY, header[2], header[3] };
+      panel.beginPacket(hubs[0]->station.address, COAP_PORT);
+      panel.write(ack, sizeof(ack));
+      panel.endPacket();
+      stats.bytesOut += sizeof(ack);
+    }
+    if (readAt != 0) {
+      stats.latencies.push_back(wallMicros() - readAt);
+      readAt = 0;
+    }
+    stats.readings++;
+    stats.bytesIn += size;
+    waitStart = wallMicros();
+  }
+}
+
+// Results of one way of clicking in --compare
+struct ClickStats {
+  uint32_t clicks = 0;
+  uint32_t failed = 0;
+  uint64_t bytes = 0;                  // Both directions, application bytes and WebSocket framing
+  std::vector<uint32_t> actuated;      // µs from the click to the LED or servo written
+  std::vector<uint32_t> shown;         // µs from the click to the page showing the new state
+};
+
+// The dashboard's old flow: GET the action, then reload the whole root page
+static bool clickByReload(const FleetOptions& options, const char* path, uint16_t source, ClickStats& stats) {
+  CompareStats action, page;
+  uint64_t actuatedAt = 0;
+  uint64_t start = wallMicros();
+  if (!pollHttp(options, path, source, action, &actuatedAt) || actuatedAt == 0 ||
+      !pollHttp(options, "/", source, page)) {
+    return false;
+  }
+  stats.clicks++;
+  stats.bytes += action.bytesOut + action.bytesIn + page.bytesOut + page.bytesIn;
+  stats.actuated.push_back(actuatedAt - start);
+  stats.shown.push_back(wallMicros() - start);
+  return true;
+}
+
+// A command on an open dashboard socket. The host socket has no network,
+// so the frame is handed over at hub 0's next turn, as the chip reads it
+// from the connection on its next pass; the acknowledgement goes out from
+// the same pass and updates the page in place.
+static bool clickBySocket(uint8_t op, uint8_t value, uint16_t id, ClickStats& stats) {
+  Hub& hub = *hubs[0];
+  uint8_t command[4] = { op, value, (uint8_t)id, (uint8_t)(id >> 8) };
+  uint64_t start = wallMicros();
+  runRound();
+  enter(hub);
+  int before = actuators(hub);
+  uint32_t framesBefore = hub.liveSocket->framesSent;
+  uint32_t bytesBefore = hub.liveSocket->bytesSent;
+  hub.liveSocket->inject(0, WStype_BIN, command, sizeof(command));
+  uint32_t frames = hub.liveSocket->framesSent - framesBefore;
+  uint32_t bytes = hub.liveSocket->bytesSent - bytesBefore;
+  bool actuated = actuators(hub) != before;
+  leave(hub);
+  uint32_t elapsed = wallMicros() - start;
+  if (!actuated || frames == 0) {
+    return false;
+  }
+  // Client frames carry a 6-byte header (masked), hub frames a 2-byte one
+  stats.clicks++;
+  stats.bytes += sizeof(command) + 6 + bytes + frames * 2;
+  stats.actuated.push_back(elapsed);
+  stats.shown.push_back(elapsed);
+  return true;
+}
+
+static void printClicks(const char* name, ClickStats& stats) {
+  std::sort(stats.actuated.begin(), stats.actuated.end());
+  std::sort(stats.shown.begin(), stats.shown.end());
+  printf("  %-16s %5u clicks, %u failed; bytes per click %7.1f; to actuator p50 %.2f ms, p99 %.2f ms; "
+         "to page p50 %.2f ms, p99 %.2f ms\n",
+         name, stats.clicks, stats.failed, stats.bytes / (double)std::max(stats.clicks, (uint32_t)1),
+         percentile(stats.actuated, 50) / 1000.0, percentile(stats.actuated, 99) / 1000.0,
+         percentile(stats.shown, 50) / 1000.0, percentile(stats.shown, 99) / 1000.0);
+}
+
+// Each click alternates the door, or toggles the LED, on hub 0 with one
+// dashboard connected
+static void runClickCompare(const FleetOptions& options) {
+  ClickStats ledReload, ledSocket, doorReload, doorSocket;
+  enter(*hubs[0]);
+  hubs[0]->liveSocket->inject(0, WStype_CONNECTED, nullptr, 0);
+  leave(*hubs[0]);
+  for (uint32_t i = 0; i < options.compare; i++) {
+    uint16_t source = i % options.sources;
+    if (!clickByReload(options, "/led/toggle", source, ledReload)) {
+      ledReload.failed++;
+    }
+    if (!clickBySocket(LIVE_CMD_LED, 2, i * 2 + 1, ledSocket)) {
+      ledSocket.failed++;
+    }
+    if (!clickByReload(options, hubs[0]->servoPosition == 90 ? "/servo/close" : "/servo/open", source, doorReload)) {
+      doorReload.failed++;
+    }
+    if (!clickBySocket(LIVE_CMD_SERVO, hubs[0]->servoPosition == 90 ? 0 : 90, i * 2 + 2, doorSocket)) {
+      doorSocket.failed++;
+    }
+  }
+  enter(*hubs[0]);
+  hubs[0]->liveSocket->inject(0, WStype_DISCONNECTED, nullptr, 0);
+  leave(*hubs[0]);
+
+  printf("Clicks: hub 0, the action request plus a reload of / against a command on the dashboard socket, %u each\n",
+         options.compare);
+  printClicks("LED reload", ledReload);
+  printClicks("LED socket", ledSocket);
+  printClicks("Door reload", doorReload);
+  printClicks("Door socket", doorSocket);
+  printf("  (reload: headers included, two TCP connections besides; the page also waits 300 ms before\n");
+  printf("   reloading, not counted here. Socket: frames on a connection already open, no TCP per click)\n");
+}
+
+static void printCompare(const char* name, CompareStats& stats) {
+  std::sort(stats.latencies.begin(), stats.latencies.end());
+  double readings = std::max(stats.readings, (uint32_t)1);
+  printf("  %-16s %5u readings, %u failed; bytes per reading %6.1f out, %6.1f in; round trip p50 %.2f ms, p99 %.2f ms\n",
+         name, stats.readings, stats.failed, stats.bytesOut / readings, stats.bytesIn / readings,
+         percentile(stats.latencies, 50) / 1000.0,
+         percentile(stats.latencies, 99) / 1000.0);
+}
+
+// Hub 0 alone serves one client at a time, so the round trip is the
+// protocol and the firmware's handling, not queueing behind other clients.
+// Sources rotate so that admission control does not limit the poller.
+static void runCompare(const FleetOptions& options) {
+  CompareStats http, coap, observe;
+  for (uint32_t i = 0; i < options.compare; i++) {
+    if (!pollHttp(options, options.path, i % options.sources, http)) {
+      http.failed++;
+    }
+    if (!pollCoap(i % options.sources, i, coap)) {
+      coap.failed++;
+    }
+  }
+  observeCoap(options.sources, options.compare, observe);
+
+  printf("Compare: hub 0, GET %s over HTTP against CON GET /reading over CoAP, %u each\n", options.path,
+         options.compare);
+  printCompare("HTTP poll", http);
+  printCompare("CoAP poll", coap);
+  printf("  (payload sizes differ: /api/data is the full JSON document, /reading the compact binary reading)\n");
+  printCompare("CoAP observe", observe);
+  printf("  (observe: latency from the sensor read to the notification; no request per reading)\n");
+  printf("Per reading on the wire besides the bytes above: HTTP a TCP connection, three packets to open,\n");
+  printf("  two or more to send and acknowledge, four to close; CoAP one datagram each way, observe one.\n");
+  runClickCompare(options);
+}
+
+static bool parseOptions(int argc, char** argv, FleetOptions& options) {
+  for (int i = 1; i < argc; i++) {
+    const char* name = argv[i];
+    const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+    if (strcmp(name, "--per-hub") == 0) {
+      options.perHub = true;
+      continue;
+    }
+    if (!value) {
+      return false;
+    }
+    i++;
+    if (strcmp(name, "--hubs") == 0) {
+      options.hubs = constrain(atoi(value), 1, FLEET_MAX_HUBS);
+    } else if (strcmp(name, "--seconds") == 0) {
+      options.seconds = std::max(atoi(value), 1);
+    } else if (strcmp(name, "--port") == 0) {
+      options.port = atoi(value);
+    } else if (strcmp(name, "--clients") == 0) {
+      options.clients = std::max(atoi(value), 1);
+    } else if (strcmp(name, "--sources") == 0) {
+      options.sources = constrain(atoi(value), 1, 65000);
+    } else if (strcmp(name, "--path") == 0) {
+      options.path = value;
+    } else if (strcmp(name, "--seed") == 0) {
+      options.seed = strtoul(value, nullptr, 0);
+    } else if (strcmp(name, "--compare") == 0) {
+      options.compare = std::max(atoi(value), 1);
+    } else {
+      return false;
+    }
+  }
+  return true;
+}
+
+static size_t flashUsed(const fs::Volume& volume) {
+  size_t bytes = 0;
+  for (const auto& file : volume.files) {
+    bytes += file.second->size();
+  }
+  return bytes;
+}
+
+// Load threads poll every hub for --seconds while the main thread runs them
+static void runLoad(const FleetOptions& options) {
+  printf("Fleet: %u hubs on 127.0.0.1:%u-%u, %u clients from %u addresses, GET %s for %u s\n",
+         options.hubs, options.port, options.port + options.hubs - 1, options.clients, options.sources, options.path, options.seconds);
+  std::vector<ClientStats> stats(options.clients);
+  std::vector<std::thread> clients;
+  uint64_t loadStart = wallMicros();
+  clientsRunning = options.clients;
+  for (uint16_t i = 0; i < options.clients; i++) {
+    clients.emplace_back(runClient, i, std::cref(options), std::ref(stats[i]));
+  }
+  uint64_t loadEnd = loadStart + options.seconds * 1000000ULL;
+  runHubs([loadEnd]() { return wallMicros() < loadEnd; });
+  loadRunning = false;
+  // Requests in flight are answered before the clients are counted
+  runHubs([]() { return clientsRunning > 0; });
+  for (std::thread& client : clients) {
+    client.join();
+  }
+  double elapsed = (wallMicros() - loadStart) / 1e6;
+
+  ClientStats total;
+  for (ClientStats& s : stats) {
+    total.requests += s.requests;
+    total.bytes += s.bytes;
+    total.ok += s.ok;
+    total.notModified += s.notModified;
+    total.limited += s.limited;
+    total.shed += s.shed;
+    total.other += s.other;
+    total.failed += s.failed;
+    total.latencies.insert(total.latencies.end(), s.latencies.begin(), s.latencies.end());
+  }
+  std::sort(total.latencies.begin(), total.latencies.end());
+  printf("Requests: %llu in %.1f s, %.0f/s; 200: %llu, 304: %llu, 429: %llu, 503: %llu, other: %llu, failed: %llu\n",
+         (unsigned long long)total.requests, elapsed, total.requests / elapsed, (unsigned long long)total.ok,
+         (unsigned long long)total.notModified, (unsigned long long)total.limited, (unsigned long long)total.shed,
+         (unsigned long long)total.other, (unsigned long long)total.failed);
+  printf("Response: %llu bytes mean, headers included; latency p50 %.2f ms, p99 %.2f ms, max %.2f ms\n",
+         (unsigned long long)(total.requests ? total.bytes / total.requests : 0), percentile(total.latencies, 50) / 1000.0,
+         percentile(total.latencies, 99) / 1000.0, (total.latencies.empty() ? 0 : total.latencies.back()) / 1000.0);
+}
+
+int main(int argc, char** argv) {
+  FleetOptions options;
+  if (!parseOptions(argc, argv, options)) {
+    fprintf(stderr, "usage: %s [--hubs N] [--seconds S] [--port P] [--clients N] [--sources N] [--path URI] [--seed N] [--per-hub] [--compare N]\n", argv[0]);
+    return 2;
+  }
+  if (options.port + options.hubs > 65535) {
+    fprintf(stderr, "ports %u-%u out of range\n", options.port, options.port + options.hubs - 1);
+    return 2;
+  }
+
+  // Every hub needs its port; a hub that cannot listen would only show up as failed requests
+  for (uint16_t i = 0; i < options.hubs; i++) {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    int reuse = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+    sockaddr_in address = {};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    address.sin_port = htons(options.port + i);
+    bool free = bind(fd, (sockaddr*)&address, sizeof(address)) == 0;
+    close(fd);
+    if (!free) {
+      fprintf(stderr, "port %u is in use; pick another --port\n", options.port + i);
+      return 1;
+    }
+  }
+
+  startMicros = wallMicros();
+  powerManager.begin();
+  hubs.reserve(options.hubs);
+  for (uint16_t i = 0; i < options.hubs; i++) {
+    heapOwner = i;
+    hubs.emplace_back(new Hub(i));
+    Hub& hub = *hubs.back();
+    hub.chip.chipId = 0x00F10000 + i;
+    hub.station.address = IPAddress(10, 0, i >> 8, (i & 0xFF) + 1);
+    hub.sensor.getSimulator().setSeed(options.seed + i);
+    enter(hub);
+    hostListenPort = options.port + i;
+    hub.setup();
+    leave(hub);
+  }
+  hostListenPort = 0;
+
+  runHubs([]() { return wallMicros() - startMicros < FLEET_WARMUP_MS * 1000ULL; });
+
+  uint32_t requestsBefore = powerManager.getRequestCount();
+  if (options.compare) {
+    runCompare(options);
+  } else {
+    runLoad(options);
+  }
+
+  // Static layout is the same for every hub
+  printf("\nPer hub, objects (host sizes: pointers are 8 bytes here, 4 on the chip):\n");
+  printf("  PMSSensor %u, HousePeers %u, AirQualityDisplay %u, HeapMonitor %u\n", (unsigned)sizeof(PMSSensor),
+         (unsigned)sizeof(HousePeers), (unsigned)sizeof(AirQualityDisplay), (unsigned)sizeof(HeapMonitor));
+  printf("  SensorHistory %u, HistoryArchive %u, RulesEngine %u, TimeSync %u, AirQualityWebServer %u\n",
+         (unsigned)sizeof(SensorHistory), (unsigned)sizeof(HistoryArchive), (unsigned)sizeof(RulesEngine),
+         (unsigned)sizeof(TimeSync), (unsigned)sizeof(AirQualityWebServer));
+  size_t firmware = sizeof(PMSSensor) + sizeof(HousePeers) + sizeof(AirQualityDisplay) + sizeof(HeapMonitor) +
+                    sizeof(SensorHistory) + sizeof(HistoryArchive) + sizeof(RulesEngine) + sizeof(TimeSync) +
+                    sizeof(AirQualityWebServer) + sizeof(BlackBox);
+  printf("  firmware objects %u bytes; host core per hub (chip, station, flash map) %u bytes\n", (unsigned)firmware,
+         (unsigned)(sizeof(EspClass) + sizeof(ESP8266WiFiClass) + sizeof(fs::Volume)));
+
+  int64_t liveMin = INT64_MAX, liveMax = 0, liveSum = 0, peakMax = 0;
+  size_t flashSum = 0;
+  uint64_t readings = 0, unhealthy = 0;
+  for (auto& hub : hubs) {
+    int64_t live = heapLive[hub->index].load() - (int64_t)sizeof(Hub);
+    liveMin = std::min(liveMin, live);
+    liveMax = std::max(liveMax, live);
+    liveSum += live;
+    peakMax = std::max(peakMax, heapPeak[hub->index].load() - (int64_t)sizeof(Hub));
+    flashSum += flashUsed(hub->flash);
+    readings += hub->history.size();
+    unhealthy += hub->unhealthyReadings;
+    if (options.perHub) {
+      printf("  hub %3u port %u seed %08X: heap %lld live, %lld peak; flash %u; readings %u, LED %s, servo %d\n",
+             hub->index, options.port + hub->index, hub->sensor.getSimulator().getSeed(), (long long)live,
+             (long long)(heapPeak[hub->index].load() - (int64_t)sizeof(Hub)), (unsigned)flashUsed(hub->flash),
+             (unsigned)hub->history.size(), hub->ledState ? "on" : "off", hub->servoPosition);
+    }
+  }
+  printf("Per hub, host heap beyond the objects: %lld-%lld bytes live (mean %lld), %lld peak\n", (long long)liveMin,
+         (long long)liveMax, (long long)(liveSum / options.hubs), (long long)peakMax);
+  printf("Per hub, flash: %u bytes mean; readings stored: %llu in all, %llu unhealthy\n",
+         (unsigned)(flashSum / options.hubs), (unsigned long long)readings, (unsigned long long)unhealthy);
+
+  printf("\nSwapped in for each hub's turn: ESP (RTC memory, chip id), WiFi station, blackBox,\n");
+  printf("LittleFS volume, LED and servo state. Shared by every hub in this process:\n");
+  printf("  powerManager: one profile and idle history for all; it noted %u requests, the whole fleet's\n",
+         powerManager.getRequestCount() - requestsBefore);
+  printf("    (admission control's load shedding reads its last idle time, so every hub sees the same)\n");
+  printf("  TimeSync::monotonicMillis(): one uptime, %u s simulated, for every hub\n", TimeSync::monotonicSeconds());
+  printf("  random(): one generator state (CoAP message ids)\n");
+  printf("  Serial: one port, muted\n");
+  printf("  loopProfiler, in ENABLE_PROFILER builds\n");
+
+  fflush(stdout);
+  _exit(0);
+}
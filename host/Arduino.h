@@ -0,0 +1,366 @@
+#ifndef HOST_ARDUINO_H
+#define HOST_ARDUINO_H
+
+// Stand-in for the ESP8266 Arduino core on the host, for the native test
+// and fleet builds. It provides what the firmware modules call, backed by a
+// clock that only moves when the test or simulation advances it.
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <math.h>
+#include <time.h>
+#include <algorithm>
+#include <functional>
+#include <string>
+
+using std::min;
+using std::max;
+
+#define PROGMEM
+#define PGM_P const char*
+#define PSTR(s) (s)
+#define F(s) (s)
+#define FPSTR(p) (p)
+typedef char __FlashStringHelper;
+#define memcpy_P memcpy
+#define strlen_P strlen
+#define strncmp_P strncmp
+#define snprintf_P snprintf
+#define ICACHE_RAM_ATTR
+#define IRAM_ATTR
+
+#define HIGH 1
+#define LOW 0
+#define INPUT 0
+#define OUTPUT 1
+#define INPUT_PULLUP 2
+#define PI 3.14159265358979
+#define D0 16
+#define D1 5
+#define D2 4
+#define D3 0
+#define D4 2
+#define D5 14
+#define D6 12
+#define D7 13
+#define D8 15
+#define constrain(x, low, high) ((x) < (low) ? (low) : ((x) > (high) ? (high) : (x)))
+typedef uint8_t byte;
+
+// Host time in microseconds since "boot"
+inline uint64_t hostMicros = 0;
+
+inline void hostAdvanceMillis(uint32_t ms) {
+  hostMicros += (uint64_t)ms * 1000;
+}
+
+inline unsigned long millis() {
+  return hostMicros / 1000;
+}
+
+inline unsigned long micros() {
+  return hostMicros;
+}
+
+inline uint64_t micros64() {
+  return hostMicros;
+}
+
+inline void delay(unsigned long ms) {
+  hostAdvanceMillis(ms);
+}
+
+inline void delayMicroseconds(unsigned int us) {
+  hostMicros += us;
+}
+
+inline void yield() {}
+
+// SNTP is not run; time() is the host's clock
+inline void configTime(const char*, const char*, const char* = nullptr, const char* = nullptr) {}
+
+inline uint8_t hostPins[17];
+
+inline void pinMode(uint8_t, uint8_t) {}
+inline void digitalWrite(uint8_t pin, uint8_t value) {
+  if (pin < sizeof(hostPins)) {
+    hostPins[pin] = value;
+  }
+}
+inline int digitalRead(uint8_t pin) {
+  return pin < sizeof(hostPins) ? hostPins[pin] : LOW;
+}
+
+inline uint32_t hostRandomState = 1;
+
+inline void randomSeed(unsigned long seed) {
+  hostRandomState = seed ? seed : 1;
+}
+
+inline long random(long howBig) {
+  if (howBig <= 0) {
+    return 0;
+  }
+  // xorshift32: deterministic across hosts, unlike rand()
+  hostRandomState ^= hostRandomState << 13;
+  hostRandomState ^= hostRandomState >> 17;
+  hostRandomState ^= hostRandomState << 5;
+  return hostRandomState % howBig;
+}
+
+inline long random(long howSmall, long howBig) {
+  return howSmall >= howBig ? howSmall : howSmall + random(howBig - howSmall);
+}
+
+inline long map(long x, long inMin, long inMax, long outMin, long outMax) {
+  return (x - inMin) * (outMax - outMin) / (inMax - inMin) + outMin;
+}
+
+class String {
+private:
+  std::string text;
+
+public:
+  String(const char* s = "") : text(s ? s : "") {}
+  String(const std::string& s) : text(s) {}
+  String(char c) : text(1, c) {}
+  String(int value, unsigned char base = 10) : text(base == 16 ? hex(value) : std::to_string(value)) {}
+  String(unsigned int value, unsigned char base = 10) : text(base == 16 ? hex(value) : std::to_string(value)) {}
+  String(long value) : text(std::to_string(value)) {}
+  String(unsigned long value) : text(std::to_string(value)) {}
+  String(double value, unsigned char decimals = 2) {
+    char buffer[32];
+    snprintf(buffer, sizeof(buffer), "%.*f", decimals, value);
+    text = buffer;
+  }
+
+  static std::string hex(unsigned long value) {
+    char buffer[20];
+    snprintf(buffer, sizeof(buffer), "%lx", value);
+    return buffer;
+  }
+
+  const char* c_str() const { return text.c_str(); }
+  unsigned int length() const { return text.size(); }
+  bool reserve(unsigned int size) { text.reserve(size); return true; }
+  bool isEmpty() const { return text.empty(); }
+  long toInt() const { return atol(text.c_str()); }
+  float toFloat() const { return atof(text.c_str()); }
+  char operator[](unsigned int index) const { return index < text.size() ? text[index] : 0; }
+  char charAt(unsigned int index) const { return (*this)[index]; }
+
+  String& operator+=(const String& other) { text += other.text; return *this; }
+  String& operator+=(const char* other) { text += other; return *this; }
+  String& operator+=(char c) { text += c; return *this; }
+  bool concat(const String& other) { text += other.text; return true; }
+  bool operator==(const String& other) const { return text == other.text; }
+  bool operator==(const char* other) const { return text == other; }
+  bool operator!=(const String& other) const { return text != other.text; }
+  bool operator!=(const char* other) const { return text != other; }
+  bool equals(const String& other) const { return text == other.text; }
+  bool equalsIgnoreCase(const String& other) const { return strcasecmp(text.c_str(), other.c_str()) == 0; }
+  bool startsWith(const String& prefix) const { return text.compare(0, prefix.text.size(), prefix.text) == 0; }
+  bool endsWith(const String& suffix) const {
+    return text.size() >= suffix.text.size() && text.compare(text.size() - suffix.text.size(), suffix.text.size(), suffix.text) == 0;
+  }
+  int indexOf(char c, unsigned int from = 0) const {
+    size_t at = text.find(c, from);
+    return at == std::string::npos ? -1 : (int)at;
+  }
+  int indexOf(const String& s, unsigned int from = 0) const {
+    size_t at = text.find(s.text, from);
+    return at == std::string::npos ? -1 : (int)at;
+  }
+  String substring(unsigned int from) const { return from < text.size() ? String(text.substr(from)) : String(); }
+  String substring(unsigned int from, unsigned int to) const {
+    return from < to && from < text.size() ? String(text.substr(from, to - from)) : String();
+  }
+  void toLowerCase() { for (char& c : text) c = tolower(c); }
+  void toUpperCase() { for (char& c : text) c = toupper(c); }
+  void trim() {
+    size_t first = text.find_first_not_of(" \t\r\n");
+    size_t last = text.find_last_not_of(" \t\r\n");
+    text = first == std::string::npos ? std::string() : text.substr(first, last - first + 1);
+  }
+};
+
+inline String operator+(const String& a, const String& b) { String s(a); s += b; return s; }
+inline String operator+(const String& a, const char* b) { String s(a); s += b; return s; }
+inline String operator+(const char* a, const String& b) { String s(a); s += b; return s; }
+
+class Print {
+public:
+  virtual ~Print() {}
+  virtual size_t write(uint8_t c) = 0;
+  virtual size_t write(const uint8_t* data, size_t len) {
+    size_t n = 0;
+    while (len--) {
+      n += write(*data++);
+    }
+    return n;
+  }
+  size_t write(const char* data, size_t len) { return write((const uint8_t*)data, len); }
+  size_t write(const char* s) { return write((const uint8_t*)s, strlen(s)); }
+
+  size_t printf(const char* format, ...) __attribute__((format(printf, 2, 3))) {
+    char buffer[512];
+    va_list args;
+    va_start(args, format);
+    int n = vsnprintf(buffer, sizeof(buffer), format, args);
+    va_end(args);
+    return write((const uint8_t*)buffer, std::min((size_t)std::max(n, 0), sizeof(buffer) - 1));
+  }
+  size_t print(const char* s) { return write(s); }
+  size_t print(const String& s) { return write(s.c_str()); }
+  size_t print(char c) { return write((uint8_t)c); }
+  size_t print(int v) { return printf("%d", v); }
+  size_t print(unsigned int v) { return printf("%u", v); }
+  size_t print(long v) { return printf("%ld", v); }
+  size_t print(unsigned long v) { return printf("%lu", v); }
+  size_t print(double v, int digits = 2) { return printf("%.*f", digits, v); }
+  size_t println() { return write("\r\n"); }
+  template <typename T> size_t println(const T& v) { return print(v) + println(); }
+  size_t println(double v, int digits) { return print(v, digits) + println(); }
+  virtual void flush() {}
+};
+
+class Stream : public Print {
+public:
+  virtual int available() { return 0; }
+  virtual int read() { return -1; }
+  virtual int peek() { return -1; }
+  size_t readBytes(uint8_t* buffer, size_t len) {
+    size_t n = 0;
+    while (n < len && available() > 0) {
+      buffer[n++] = read();
+    }
+    return n;
+  }
+  void setTimeout(unsigned long) {}
+};
+
+// Serial output is dropped unless echo is set, so that hundreds of
+// simulated hubs or a test run stay quiet
+class HardwareSerial : public Stream {
+public:
+  bool echo = false;
+  void begin(unsigned long) {}
+  size_t write(uint8_t c) override {
+    if (echo) {
+      fputc(c, stdout);
+    }
+    return 1;
+  }
+  size_t write(const uint8_t* data, size_t len) override {
+    if (echo) {
+      fwrite(data, 1, len, stdout);
+    }
+    return len;
+  }
+  using Print::write;
+  operator bool() { return true; }
+};
+
+inline HardwareSerial Serial;
+
+class IPAddress : public Print {
+private:
+  uint32_t address;
+
+public:
+  IPAddress() : address(0) {}
+  IPAddress(uint32_t value) : address(value) {}
+  IPAddress(uint8_t a, uint8_t b, uint8_t c, uint8_t d) : address(a | (b << 8) | (c << 16) | ((uint32_t)d << 24)) {}
+  operator uint32_t() const { return address; }
+  uint8_t operator[](int index) const { return address >> (index * 8); }
+  bool isSet() const { return address != 0; }
+  bool operator==(const IPAddress& other) const { return address == other.address; }
+  bool operator!=(const IPAddress& other) const { return address != other.address; }
+  String toString() const {
+    char buffer[16];
+    snprintf(buffer, sizeof(buffer), "%u.%u.%u.%u", (*this)[0], (*this)[1], (*this)[2], (*this)[3]);
+    return String(buffer);
+  }
+  bool fromString(const char* text) {
+    unsigned int a, b, c, d;
+    if (sscanf(text, "%u.%u.%u.%u", &a, &b, &c, &d) != 4 || a > 255 || b > 255 || c > 255 || d > 255) {
+      return false;
+    }
+    *this = IPAddress(a, b, c, d);
+    return true;
+  }
+  size_t write(uint8_t) override { return 0; }
+};
+
+enum rst_reason {
+  REASON_DEFAULT_RST = 0,
+  REASON_WDT_RST = 1,
+  REASON_EXCEPTION_RST = 2,
+  REASON_SOFT_WDT_RST = 3,
+  REASON_SOFT_RESTART = 4,
+  REASON_DEEP_SLEEP_AWAKE = 5,
+  REASON_EXT_SYS_RST = 6
+};
+
+struct rst_info {
+  uint32_t reason;
+  uint32_t exccause;
+  uint32_t epc1;
+  uint32_t epc2;
+  uint32_t epc3;
+  uint32_t excvaddr;
+  uint32_t depc;
+};
+
+// Chip services. Heap figures are fixed; RTC user memory is a plain array
+// that survives restart() the way it survives a soft reset on the chip.
+class EspClass {
+public:
+  uint32_t rtcMemory[128] = {};
+  rst_info resetInfo = {};
+  uint32_t freeHeap = 40000;
+  uint32_t restartCount = 0;
+  uint32_t chipId = 0x00C0FFEE;       // Set per hub when several run in one process
+
+  uint32_t getFreeHeap() { return freeHeap; }
+  uint32_t getMaxFreeBlockSize() { return freeHeap; }
+  uint8_t getHeapFragmentation() { return 0; }
+  void getHeapStats(uint32_t* free, uint16_t* maxBlock, uint8_t* fragmentation) {
+    *free = freeHeap;
+    *maxBlock = std::min(freeHeap, (uint32_t)0xFFFF);
+    *fragmentation = 0;
+  }
+  uint32_t getFreeContStack() { return 4096; }
+  uint32_t getCpuFreqMHz() { return 80; }
+  uint32_t getCycleCount() { return (uint32_t)(hostMicros * 80); }
+  uint32_t getChipId() { return chipId; }
+  uint32_t getFreeSketchSpace() { return 1 << 20; }
+  void restart() { restartCount++; }
+  void reset() { restartCount++; }
+  void deepSleep(uint64_t) {}
+  rst_info* getResetInfoPtr() { return &resetInfo; }
+  String getResetReason() { return String("Software/System restart"); }
+
+  bool rtcUserMemoryRead(uint32_t offset, uint32_t* data, size_t size) {
+    if (offset * 4 + size > sizeof(rtcMemory)) {
+      return false;
+    }
+    memcpy(data, (const uint8_t*)rtcMemory + offset * 4, size);
+    return true;
+  }
+  bool rtcUserMemoryWrite(uint32_t offset, uint32_t* data, size_t size) {
+    if (offset * 4 + size > sizeof(rtcMemory)) {
+      return false;
+    }
+    memcpy((uint8_t*)rtcMemory + offset * 4, data, size);
+    return true;
+  }
+};
+
+inline EspClass ESP;
+
+#endif
@@ -0,0 +1,470 @@
+#ifndef HOST_ESP8266WEBSERVER_H
+#define HOST_ESP8266WEBSERVER_H
+
+#include <ESP8266WiFi.h>
+#include "WiFiServer.h"
+#include <vector>
+
+// HTTP/1.1 server on host sockets with the core's interface and request
+// handling: one connection at a time, read without blocking across
+// handleClient() calls, query, form and multipart arguments, collected
+// headers, chunked responses for CONTENT_LENGTH_UNKNOWN. Each connection is
+// closed after its response. authenticate() checks Basic credentials only;
+// Digest is not implemented, so a Digest-only client is refused.
+
+enum HTTPMethod { HTTP_ANY, HTTP_GET, HTTP_HEAD, HTTP_POST, HTTP_PUT, HTTP_PATCH, HTTP_DELETE, HTTP_OPTIONS };
+enum HTTPUploadStatus { UPLOAD_FILE_START, UPLOAD_FILE_WRITE, UPLOAD_FILE_END, UPLOAD_FILE_ABORTED };
+enum HTTPAuthMethod { BASIC_AUTH, DIGEST_AUTH };
+
+#define CONTENT_LENGTH_UNKNOWN ((size_t)-1)
+#define CONTENT_LENGTH_NOT_SET ((size_t)-2)
+#define HTTP_UPLOAD_BUFLEN 2048
+#define HTTP_MAX_DATA_WAIT 5000       // ms for a request to arrive in full
+#define HTTP_MAX_REQUEST 65536
+
+struct HTTPUpload {
+  HTTPUploadStatus status;
+  String filename;
+  String name;
+  String type;
+  size_t totalSize;
+  size_t currentSize;
+  uint8_t buf[HTTP_UPLOAD_BUFLEN];
+};
+
+class ESP8266WebServer {
+public:
+  typedef std::function<void()> THandlerFunction;
+
+private:
+  struct Route {
+    String uri;
+    HTTPMethod method;
+    THandlerFunction handler;
+    THandlerFunction upload;
+  };
+  struct Field {
+    String name;
+    String value;
+  };
+
+  std::vector<Route> routes;
+  THandlerFunction notFound;
+  std::vector<String> headerKeys;
+  std::vector<Field> headers;
+  std::vector<Field> arguments;
+  std::vector<Field> responseHeaders;
+  std::string request;
+  unsigned long requestStart = 0;
+  HTTPMethod currentMethod = HTTP_GET;
+  String currentUri;
+  HTTPUpload currentUpload;
+  size_t contentLength = CONTENT_LENGTH_NOT_SET;
+  bool chunked = false;
+  bool headersSent = false;
+
+  static const char* reason(int code) {
+    switch (code) {
+      case 200: return "OK";
+      case 204: return "No Content";
+      case 206: return "Partial Content";
+      case 304: return "Not Modified";
+      case 400: return "Bad Request";
+      case 401: return "Unauthorized";
+      case 404: return "Not Found";
+      case 413: return "Payload Too Large";
+      case 416: return "Range Not Satisfiable";
+      case 429: return "Too Many Requests";
+      case 500: return "Internal Server Error";
+      case 503: return "Service Unavailable";
+      default: return "";
+    }
+  }
+
+  static String urlDecode(const std::string& text) {
+    std::string out;
+    for (size_t i = 0; i < text.size(); i++) {
+      if (text[i] == '+') {
+        out += ' ';
+      } else if (text[i] == '%' && i + 2 < text.size()) {
+        out += (char)strtol(text.substr(i + 1, 2).c_str(), nullptr, 16);
+        i += 2;
+      } else {
+        out += text[i];
+      }
+    }
+    return String(out);
+  }
+
+  void parseArguments(const std::string& query) {
+    size_t at = 0;
+    while (at < query.size()) {
+      size_t end = query.find('&', at);
+      if (end == std::string::npos) {
+        end = query.size();
+      }
+      std::string pair = query.substr(at, end - at);
+      size_t equals = pair.find('=');
+      if (!pair.empty()) {
+        arguments.push_back({ urlDecode(pair.substr(0, equals)), equals == std::string::npos ? String() : urlDecode(pair.substr(equals + 1)) });
+      }
+      at = end + 1;
+    }
+  }
+
+  // Hands each file part to the route's upload handler in buffer-sized pieces
+  void parseMultipart(const std::string& body, const std::string& boundary, const Route* route) {
+    const std::string delimiter = "--" + boundary;
+    size_t at = body.find(delimiter);
+    while (at != std::string::npos) {
+      at += delimiter.size();
+      if (body.compare(at, 2, "--") == 0) {
+        break;
+      }
+      size_t headerEnd = body.find("\r\n\r\n", at);
+      size_t next = body.find("\r\n" + delimiter, headerEnd);
+      if (headerEnd == std::string::npos || next == std::string::npos) {
+        break;
+      }
+      std::string partHeaders = body.substr(at, headerEnd - at);
+      std::string content = body.substr(headerEnd + 4, next - headerEnd - 4);
+      String name = quotedValue(partHeaders, "name=\"");
+      size_t filenameAt = partHeaders.find("filename=\"");
+      if (filenameAt == std::string::npos) {
+        arguments.push_back({ name, String(content) });
+      } else if (route && route->upload) {
+        currentUpload.status = UPLOAD_FILE_START;
+        currentUpload.name = name;
+        currentUpload.filename = quotedValue(partHeaders, "filename=\"");
+        currentUpload.type = "application/octet-stream";
+        currentUpload.totalSize = 0;
+        currentUpload.currentSize = 0;
+        route->upload();
+        for (size_t sent = 0; sent < content.size(); sent += HTTP_UPLOAD_BUFLEN) {
+          currentUpload.status = UPLOAD_FILE_WRITE;
+          currentUpload.currentSize = std::min(content.size() - sent, (size_t)HTTP_UPLOAD_BUFLEN);
+          memcpy(currentUpload.buf, content.data() + sent, currentUpload.currentSize);
+          currentUpload.totalSize += currentUpload.currentSize;
+          route->upload();
+        }
+        currentUpload.status = UPLOAD_FILE_END;
+        currentUpload.currentSize = 0;
+        route->upload();
+      }
+      at = body.find(delimiter, next);
+    }
+  }
+
+  static String quotedValue(const std::string& text, const char* key) {
+    size_t at = text.find(key);
+    if (at == std::string::npos) {
+      return String();
+    }
+    at += strlen(key);
+    return String(text.substr(at, text.find('"', at) - at));
+  }
+
+  // True once the request line, headers and body have all arrived
+  bool requestComplete(size_t& bodyStart, size_t& bodyLength) {
+    size_t end = request.find("\r\n\r\n");
+    if (end == std::string::npos) {
+      return false;
+    }
+    bodyStart = end + 4;
+    bodyLength = 0;
+    std::string lower = request.substr(0, end);
+    for (char& c : lower) c = tolower(c);
+    size_t at = lower.find("\r\ncontent-length:");
+    if (at != std::string::npos) {
+      bodyLength = strtoul(lower.c_str() + at + 17, nullptr, 10);
+    }
+    return request.size() >= bodyStart + bodyLength;
+  }
+
+  void dispatch(size_t bodyStart, size_t bodyLength) {
+    headers.clear();
+    arguments.clear();
+    responseHeaders.clear();
+    contentLength = CONTENT_LENGTH_NOT_SET;
+    chunked = false;
+    headersSent = false;
+
+    size_t lineEnd = request.find("\r\n");
+    std::string line = request.substr(0, lineEnd);
+    size_t space = line.find(' ');
+    std::string methodName = line.substr(0, space);
+    std::string target = line.substr(space + 1, line.rfind(' ') - space - 1);
+    static const char* const names[] = { "", "GET", "HEAD", "POST", "PUT", "PATCH", "DELETE", "OPTIONS" };
+    currentMethod = HTTP_GET;
+    for (uint8_t i = 1; i < sizeof(names) / sizeof(names[0]); i++) {
+      if (methodName == names[i]) {
+        currentMethod = (HTTPMethod)i;
+      }
+    }
+    size_t query = target.find('?');
+    currentUri = urlDecode(target.substr(0, query));
+    if (query != std::string::npos) {
+      parseArguments(target.substr(query + 1));
+    }
+
+    String contentType;
+    size_t at = lineEnd + 2;
+    while (at < bodyStart - 2) {
+      size_t end = request.find("\r\n", at);
+      std::string header = request.substr(at, end - at);
+      size_t colon = header.find(':');
+      if (colon != std::string::npos) {
+        String name(header.substr(0, colon));
+        String value(header.substr(colon + 1));
+        value.trim();
+        if (name.equalsIgnoreCase("Content-Type")) {
+          contentType = value;
+        }
+        for (const String& key : headerKeys) {
+          if (name.equalsIgnoreCase(key)) {
+            headers.push_back({ key, value });
+            break;
+          }
+        }
+        if (name.equalsIgnoreCase("Authorization")) {
+          headers.push_back({ "Authorization", value });
+        }
+      }
+      at = end + 2;
+    }
+
+    const Route* route = nullptr;
+    for (const Route& candidate : routes) {
+      if (candidate.uri == currentUri && (candidate.method == HTTP_ANY || candidate.method == currentMethod)) {
+        route = &candidate;
+        break;
+      }
+    }
+
+    std::string body = request.substr(bodyStart, bodyLength);
+    if (contentType.startsWith("multipart/form-data")) {
+      int boundary = contentType.indexOf("boundary=");
+      if (boundary >= 0) {
+        parseMultipart(body, contentType.substring(boundary + 9).c_str(), route);
+      }
+    } else if (bodyLength > 0) {
+      if (contentType.startsWith("application/x-www-form-urlencoded")) {
+        parseArguments(body);
+      }
+      arguments.push_back({ "plain", String(body) });
+    }
+
+    if (route) {
+      route->handler();
+    } else if (notFound) {
+      notFound();
+    } else {
+      send(404, "text/plain", String("Not found: ") + currentUri);
+    }
+    if (chunked) {
+      sendContent("");
+    }
+    _currentClient.stop();
+    request.clear();
+  }
+
+  void sendHeaders(int code, const char* contentType, size_t length) {
+    std::string head = "HTTP/1.1 " + std::to_string(code) + " " + reason(code) + "\r\n";
+    if (contentType && *contentType) {
+      head += std::string("Content-Type: ") + contentType + "\r\n";
+    }
+    if (contentLength == CONTENT_LENGTH_NOT_SET) {
+      contentLength = length;
+    }
+    if (contentLength == CONTENT_LENGTH_UNKNOWN) {
+      head += "Transfer-Encoding: chunked\r\n";
+      chunked = true;
+    } else {
+      head += "Content-Length: " + std::to_string(contentLength) + "\r\n";
+    }
+    for (const Field& header : responseHeaders) {
+      head += std::string(header.name.c_str()) + ": " + header.value.c_str() + "\r\n";
+    }
+    head += "Connection: close\r\n\r\n";
+    _currentClient.write((const uint8_t*)head.data(), head.size());
+    responseHeaders.clear();
+    headersSent = true;
+  }
+
+protected:
+  WiFiServer _server;
+  WiFiClient _currentClient;
+
+public:
+  ESP8266WebServer(int port = 80) : _server(port) {}
+  virtual ~ESP8266WebServer() {}
+
+  void begin() { _server.begin(); }
+  void close() { _server.close(); }
+  void stop() { close(); }
+
+  void handleClient() {
+    if (!_currentClient) {
+      if (!_server.hasClient()) {
+        return;
+      }
+      _currentClient = _server.accept();
+      request.clear();
+      requestStart = millis();
+    }
+    uint8_t chunk[1460];
+    while (_currentClient.available() > 0 && request.size() < HTTP_MAX_REQUEST) {
+      int n = _currentClient.read(chunk, sizeof(chunk));
+      if (n <= 0) {
+        break;
+      }
+      request.append((const char*)chunk, n);
+    }
+    size_t bodyStart, bodyLength;
+    if (requestComplete(bodyStart, bodyLength)) {
+      dispatch(bodyStart, bodyLength);
+    } else if (!_currentClient.connected() || request.size() >= HTTP_MAX_REQUEST || millis() - requestStart > HTTP_MAX_DATA_WAIT) {
+      _currentClient.stop();
+      request.clear();
+    }
+  }
+
+  void on(const String& uri, THandlerFunction handler) { on(uri, HTTP_ANY, handler); }
+  void on(const String& uri, HTTPMethod method, THandlerFunction handler) { on(uri, method, handler, nullptr); }
+  void on(const String& uri, HTTPMethod method, THandlerFunction handler, THandlerFunction upload) {
+    routes.push_back({ uri, method, handler, upload });
+  }
+  void onNotFound(THandlerFunction handler) { notFound = handler; }
+
+  void collectHeaders(const char* keys[], size_t count) {
+    headerKeys.assign(keys, keys + count);
+  }
+  String header(const String& name) const {
+    for (const Field& field : headers) {
+      if (field.name.equalsIgnoreCase(name)) {
+        return field.value;
+      }
+    }
+    return String();
+  }
+  bool hasHeader(const String& name) const {
+    for (const Field& field : headers) {
+      if (field.name.equalsIgnoreCase(name)) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  const String& arg(const String& name) const {
+    static const String empty;
+    for (const Field& field : arguments) {
+      if (field.name == name) {
+        return field.value;
+      }
+    }
+    return empty;
+  }
+  const String& arg(int index) const {
+    static const String empty;
+    return index >= 0 && index < (int)arguments.size() ? arguments[index].value : empty;
+  }
+  const String& argName(int index) const {
+    static const String empty;
+    return index >= 0 && index < (int)arguments.size() ? arguments[index].name : empty;
+  }
+  int args() const { return arguments.size(); }
+  bool hasArg(const String& name) const {
+    for (const Field& field : arguments) {
+      if (field.name == name) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  const String& uri() const { return currentUri; }
+  HTTPMethod method() const { return currentMethod; }
+  WiFiClient& client() { return _currentClient; }
+  HTTPUpload& upload() { return currentUpload; }
+
+  bool authenticate(const char* username, const char* password) {
+    String authorization = header("Authorization");
+    if (!authorization.startsWith("Basic ")) {
+      return false;
+    }
+    String expected = String(username) + ":" + password;
+    return decodeBase64(authorization.substring(6).c_str()) == expected.c_str();
+  }
+  void requestAuthentication(HTTPAuthMethod = BASIC_AUTH, const char* realm = nullptr, const String& failMessage = String()) {
+    sendHeader("WWW-Authenticate", String("Basic realm=\"") + (realm ? realm : "Login Required") + "\"");
+    send(401, "text/html", failMessage);
+  }
+
+  static std::string decodeBase64(const char* text) {
+    static const char alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    std::string out;
+    uint32_t bits = 0;
+    int count = 0;
+    for (; *text && *text != '='; text++) {
+      const char* at = strchr(alphabet, *text);
+      if (!at) {
+        continue;
+      }
+      bits = (bits << 6) | (at - alphabet);
+      count += 6;
+      if (count >= 8) {
+        count -= 8;
+        out += (char)((bits >> count) & 0xFF);
+      }
+    }
+    return out;
+  }
+
+  void sendHeader(const String& name, const String& value, bool first = false) {
+    if (first) {
+      responseHeaders.insert(responseHeaders.begin(), { name, value });
+    } else {
+      responseHeaders.push_back({ name, value });
+    }
+  }
+  void setContentLength(size_t length) { contentLength = length; }
+
+  void send(int code, const char* contentType = nullptr, const String& content = String()) {
+    send(code, contentType, content.c_str(), content.length());
+  }
+  void send(int code, const String& contentType, const String& content) {
+    send(code, contentType.c_str(), content.c_str(), content.length());
+  }
+  void send(int code, const char* contentType, const char* content, size_t length) {
+    sendHeaders(code, contentType, length);
+    if (length > 0 && !chunked) {
+      _currentClient.write((const uint8_t*)content, length);
+    } else if (length > 0) {
+      sendContent(content, length);
+    }
+  }
+  void send_P(int code, PGM_P contentType, PGM_P content) { send(code, contentType, content, strlen(content)); }
+  void send_P(int code, PGM_P contentType, PGM_P content, size_t length) { send(code, contentType, content, length); }
+
+  // An empty piece ends a chunked response
+  void sendContent(const char* content, size_t length) {
+    if (!chunked) {
+      _currentClient.write((const uint8_t*)content, length);
+      return;
+    }
+    char size[12];
+    int n = snprintf(size, sizeof(size), "%zx\r\n", length);
+    _currentClient.write((const uint8_t*)size, n);
+    _currentClient.write((const uint8_t*)content, length);
+    _currentClient.write((const uint8_t*)"\r\n", 2);
+    if (length == 0) {
+      chunked = false;
+    }
+  }
+  void sendContent(const String& content) { sendContent(content.c_str(), content.length()); }
+  void sendContent_P(PGM_P content) { sendContent(content, strlen(content)); }
+  void sendContent_P(PGM_P content, size_t length) { sendContent(content, length); }
+};
+
+#endif
@@ -0,0 +1,66 @@
+#ifndef HOST_ESP8266WIFI_H
+#define HOST_ESP8266WIFI_H
+
+#include <Arduino.h>
+
+enum wl_status_t {
+  WL_IDLE_STATUS = 0,
+  WL_NO_SSID_AVAIL = 1,
+  WL_CONNECTED = 3,
+  WL_CONNECT_FAILED = 4,
+  WL_CONNECTION_LOST = 5,
+  WL_WRONG_PASSWORD = 6,
+  WL_DISCONNECTED = 7
+};
+
+enum WiFiMode_t { WIFI_OFF, WIFI_STA, WIFI_AP, WIFI_AP_STA };
+enum WiFiSleepType_t { WIFI_NONE_SLEEP, WIFI_LIGHT_SLEEP, WIFI_MODEM_SLEEP };
+
+// Station interface. begin() connects at once; a test takes the link down
+// by setting linkStatus. address is the hub being run, so a test or the
+// fleet with several hubs in one process sets it before running each one.
+class ESP8266WiFiClass {
+public:
+  wl_status_t linkStatus = WL_DISCONNECTED;
+  IPAddress address = IPAddress(192, 168, 1, 2);
+  IPAddress gateway = IPAddress(192, 168, 1, 1);
+  uint8_t bssid[6] = { 0x02, 0x00, 0x00, 0x00, 0x00, 0x01 };
+  int32_t channelNumber = 6;
+  int32_t rssi = -55;
+  WiFiSleepType_t sleepType = WIFI_NONE_SLEEP;
+
+  wl_status_t begin(const char*, const char*, int32_t = 0, const uint8_t* = nullptr, bool = true) {
+    linkStatus = WL_CONNECTED;
+    return linkStatus;
+  }
+  bool disconnect(bool = false) {
+    linkStatus = WL_DISCONNECTED;
+    return true;
+  }
+  wl_status_t status() { return linkStatus; }
+  bool isConnected() { return linkStatus == WL_CONNECTED; }
+  IPAddress localIP() { return linkStatus == WL_CONNECTED ? address : IPAddress(); }
+  IPAddress gatewayIP() { return gateway; }
+  IPAddress subnetMask() { return IPAddress(255, 255, 255, 0); }
+  IPAddress dnsIP(uint8_t = 0) { return gateway; }
+  int32_t RSSI() { return rssi; }
+  uint8_t* BSSID() { return bssid; }
+  int32_t channel() { return channelNumber; }
+  String macAddress() { return String("02:00:00:00:00:02"); }
+  bool config(IPAddress, IPAddress, IPAddress, IPAddress = IPAddress(), IPAddress = IPAddress()) { return true; }
+  bool mode(WiFiMode_t) { return true; }
+  bool persistent(bool) { return true; }
+  bool setAutoReconnect(bool) { return true; }
+  bool setAutoConnect(bool) { return true; }
+  bool setSleepMode(WiFiSleepType_t type, uint8_t = 0) {
+    sleepType = type;
+    return true;
+  }
+  WiFiSleepType_t getSleepMode() { return sleepType; }
+  bool forceSleepBegin(uint32_t = 0) { return true; }
+  bool forceSleepWake() { return true; }
+};
+
+inline ESP8266WiFiClass WiFi;
+
+#endif
@@ -0,0 +1,160 @@
+#ifndef HOST_FS_H
+#define HOST_FS_H
+
+#include <Arduino.h>
+#include <map>
+#include <memory>
+#include <vector>
+
+// In-memory filesystem with the ESP8266 FS API. Files live in a Volume;
+// the fleet simulator gives each virtual hub its own and switches them.
+namespace fs {
+
+enum SeekMode {
+  SeekSet = 0,
+  SeekCur = 1,
+  SeekEnd = 2
+};
+
+typedef std::shared_ptr<std::vector<uint8_t>> FileData;
+
+struct Volume {
+  std::map<std::string, FileData> files;
+  size_t totalBytes = 1 << 20;
+};
+
+class File : public Stream {
+private:
+  FileData data;
+  std::string path;
+  size_t at = 0;
+  bool writable = false;
+
+public:
+  File() {}
+  File(FileData fileData, const std::string& filePath, bool canWrite, bool append)
+      : data(fileData), path(filePath), at(append ? fileData->size() : 0), writable(canWrite) {}
+
+  size_t write(uint8_t c) override { return write(&c, 1); }
+  size_t write(const uint8_t* buffer, size_t len) override {
+    if (!data || !writable) {
+      return 0;
+    }
+    if (data->size() < at + len) {
+      data->resize(at + len);
+    }
+    memcpy(data->data() + at, buffer, len);
+    at += len;
+    return len;
+  }
+  using Print::write;
+  int read() override {
+    uint8_t c;
+    return read(&c, 1) == 1 ? c : -1;
+  }
+  size_t read(uint8_t* buffer, size_t len) {
+    if (!data || at >= data->size()) {
+      return 0;
+    }
+    len = std::min(len, data->size() - at);
+    memcpy(buffer, data->data() + at, len);
+    at += len;
+    return len;
+  }
+  size_t readBytes(char* buffer, size_t len) { return read((uint8_t*)buffer, len); }
+  int peek() override { return data && at < data->size() ? (*data)[at] : -1; }
+  int available() override { return data ? data->size() - at : 0; }
+  size_t size() const { return data ? data->size() : 0; }
+  size_t position() const { return at; }
+  bool seek(uint32_t pos, SeekMode mode = SeekSet) {
+    if (!data) {
+      return false;
+    }
+    size_t base = mode == SeekSet ? 0 : mode == SeekCur ? at : data->size();
+    if (base + pos > data->size()) {
+      return false;
+    }
+    at = base + pos;
+    return true;
+  }
+  void flush() override {}
+  void close() { data.reset(); }
+  operator bool() const { return (bool)data; }
+  const char* name() const { return path.c_str(); }
+  bool isDirectory() const { return false; }
+};
+
+struct FSInfo {
+  size_t totalBytes;
+  size_t usedBytes;
+  size_t blockSize;
+  size_t pageSize;
+  size_t maxOpenFiles;
+  size_t maxPathLength;
+};
+
+class FS {
+private:
+  Volume own;
+  Volume* volume = &own;
+
+public:
+  // Host only: the volume later calls act on, nullptr for the built-in one
+  void useVolume(Volume* other) { volume = other ? other : &own; }
+
+  bool begin() { return true; }
+  void end() {}
+  bool format() {
+    volume->files.clear();
+    return true;
+  }
+  File open(const char* path, const char* mode) {
+    auto found = volume->files.find(path);
+    bool append = mode[0] == 'a';
+    if (mode[0] == 'r') {
+      if (found == volume->files.end()) {
+        return File();
+      }
+      return File(found->second, path, mode[1] == '+', false);
+    }
+    if (found == volume->files.end() || mode[0] == 'w') {
+      // Open handles keep the old contents, as on LittleFS
+      volume->files[path] = std::make_shared<std::vector<uint8_t>>();
+    }
+    return File(volume->files[path], path, true, append);
+  }
+  File open(const String& path, const char* mode) { return open(path.c_str(), mode); }
+  bool exists(const char* path) { return volume->files.count(path) > 0; }
+  bool exists(const String& path) { return exists(path.c_str()); }
+  bool remove(const char* path) { return volume->files.erase(path) > 0; }
+  bool remove(const String& path) { return remove(path.c_str()); }
+  bool rename(const char* from, const char* to) {
+    auto found = volume->files.find(from);
+    if (found == volume->files.end()) {
+      return false;
+    }
+    FileData data = found->second;
+    volume->files.erase(found);
+    volume->files[to] = data;
+    return true;
+  }
+  bool info(FSInfo& info) {
+    size_t used = 0;
+    for (auto& file : volume->files) {
+      used += (file.second->size() + 4095) / 4096 * 4096;
+    }
+    info = { volume->totalBytes, used, 4096, 256, 5, 32 };
+    return true;
+  }
+};
+
+}  // namespace fs
+
+using fs::File;
+using fs::FSInfo;
+using fs::SeekMode;
+using fs::SeekSet;
+using fs::SeekCur;
+using fs::SeekEnd;
+
+#endif
@@ -0,0 +1,24 @@
+#ifndef HOST_PMS_H
+#define HOST_PMS_H
+
+#include <Arduino.h>
+
+// Command side of the PMS library; the firmware parses replies itself
+class PMS {
+public:
+  struct DATA {
+    uint16_t PM_SP_UG_1_0, PM_SP_UG_2_5, PM_SP_UG_10_0;
+    uint16_t PM_AE_UG_1_0, PM_AE_UG_2_5, PM_AE_UG_10_0;
+  };
+
+  PMS(Stream& stream) {}
+  void sleep() {}
+  void wakeUp() {}
+  void activeMode() {}
+  void passiveMode() {}
+  void requestRead() {}
+  bool read(DATA& data) { return false; }
+  bool readUntil(DATA& data, uint16_t timeout = 1000) { return false; }
+};
+
+#endif
@@ -0,0 +1,31 @@
+#ifndef HOST_SOFTWARESERIAL_H
+#define HOST_SOFTWARESERIAL_H
+
+#include <Arduino.h>
+#include <deque>
+
+// Received bytes are whatever was queued with inject(); writes are dropped
+class SoftwareSerial : public Stream {
+private:
+  std::deque<uint8_t> received;
+
+public:
+  SoftwareSerial(int rxPin, int txPin) {}
+  void begin(unsigned long baud) {}
+  void end() {}
+  void inject(const uint8_t* data, size_t len) { received.insert(received.end(), data, data + len); }
+  size_t write(uint8_t c) override { return 1; }
+  using Print::write;
+  int available() override { return received.size(); }
+  int read() override {
+    if (received.empty()) {
+      return -1;
+    }
+    uint8_t c = received.front();
+    received.pop_front();
+    return c;
+  }
+  int peek() override { return received.empty() ? -1 : received.front(); }
+};
+
+#endif
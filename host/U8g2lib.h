@@ -0,0 +1,100 @@
+#ifndef HOST_U8G2LIB_H
+#define HOST_U8G2LIB_H
+
+#include <Arduino.h>
+
+// SH1106 128x64 panel on the host: the frame buffer has the controller's
+// layout (tile rows of 8 pixel rows, one byte per column, top pixel in bit
+// 0) and nothing is sent anywhere. Text is drawn as one block per glyph cell
+// with the character code in its columns, so that a change of value still
+// changes the frame and its checksum.
+
+// Glyph cell width and height, all a font needs here
+typedef uint8_t HostFont[2];
+inline const HostFont u8g2_font_4x6_tf = { 4, 6 };
+inline const HostFont u8g2_font_5x7_tf = { 5, 7 };
+inline const HostFont u8g2_font_helvR08_tf = { 5, 8 };
+inline const HostFont u8g2_font_helvR10_tf = { 6, 10 };
+inline const HostFont u8g2_font_helvR12_tf = { 7, 12 };
+inline const HostFont u8g2_font_helvB12_tf = { 8, 12 };
+inline const HostFont u8g2_font_helvB14_tf = { 9, 14 };
+
+#define U8X8_PIN_NONE 255
+
+enum HostRotation { U8G2_R0, U8G2_R1, U8G2_R2, U8G2_R3 };
+
+template <uint8_t BAND_TILE_ROWS>
+class HostSH1106 {
+private:
+  static const uint8_t WIDTH = 128;
+  static const uint8_t TILE_ROWS = 8;
+  uint8_t buffer[WIDTH * BAND_TILE_ROWS];
+  uint8_t currentTileRow = 0;
+  const uint8_t* font = u8g2_font_5x7_tf;
+
+  void setPixel(int x, int y) {
+    int row = y - currentTileRow * 8;
+    if (x < 0 || x >= WIDTH || row < 0 || row >= BAND_TILE_ROWS * 8) {
+      return;
+    }
+    buffer[(row / 8) * WIDTH + x] |= 1 << (row % 8);
+  }
+
+public:
+  HostSH1106(HostRotation, uint8_t = U8X8_PIN_NONE, uint8_t = U8X8_PIN_NONE, uint8_t = U8X8_PIN_NONE) {
+    clearBuffer();
+  }
+
+  bool begin() { return true; }
+  void setBusClock(uint32_t) {}
+  void setDisplayRotation(HostRotation) {}
+  void setBitmapMode(uint8_t) {}
+  void clearBuffer() { memset(buffer, 0, sizeof(buffer)); }
+  void clearDisplay() { clearBuffer(); }
+  void sendBuffer() {}
+  void setFont(const uint8_t* glyphs) { font = glyphs; }
+
+  uint16_t drawStr(int x, int y, const char* s) {
+    uint16_t start = x;
+    for (; *s; s++, x += font[0]) {
+      for (uint8_t column = 0; column + 1 < font[0]; column++) {
+        for (uint8_t line = 0; line < font[1]; line++) {
+          if ((*s >> ((column + line) % 7)) & 1) {
+            setPixel(x + column, y - line);
+          }
+        }
+      }
+    }
+    return x - start;
+  }
+  void drawVLine(int x, int y, int height) {
+    for (int i = 0; i < height; i++) {
+      setPixel(x, y + i);
+    }
+  }
+
+  uint8_t* getBufferPtr() { return buffer; }
+  uint8_t getBufferTileHeight() const { return BAND_TILE_ROWS; }
+  void setBufferCurrTileRow(uint8_t row) { currentTileRow = row; }
+
+  // Picture loop for the page-buffer variants
+  void firstPage() {
+    currentTileRow = 0;
+    clearBuffer();
+  }
+  bool nextPage() {
+    currentTileRow += BAND_TILE_ROWS;
+    if (currentTileRow >= TILE_ROWS) {
+      currentTileRow = 0;
+      return false;
+    }
+    clearBuffer();
+    return true;
+  }
+};
+
+typedef HostSH1106<1> U8G2_SH1106_128X64_NONAME_1_HW_I2C;
+typedef HostSH1106<2> U8G2_SH1106_128X64_NONAME_2_HW_I2C;
+typedef HostSH1106<8> U8G2_SH1106_128X64_NONAME_F_HW_I2C;
+
+#endif
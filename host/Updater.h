@@ -0,0 +1,40 @@
+#ifndef HOST_UPDATER_H
+#define HOST_UPDATER_H
+
+#include <Arduino.h>
+#include <vector>
+
+// OTA partition as a byte vector; end(true) marks the image for the next boot
+class UpdaterClass {
+public:
+  std::vector<uint8_t> image;
+  size_t capacity = 0;
+  bool running = false;
+  bool armed = false;
+
+  bool begin(size_t maxSize) {
+    image.clear();
+    capacity = maxSize;
+    running = maxSize > 0;
+    armed = false;
+    return running;
+  }
+  size_t write(uint8_t* data, size_t len) {
+    if (!running || image.size() + len > capacity) {
+      return 0;
+    }
+    image.insert(image.end(), data, data + len);
+    return len;
+  }
+  bool end(bool evenIfRemaining = false) {
+    bool ok = running && evenIfRemaining;
+    running = false;
+    armed = ok;
+    return ok;
+  }
+  bool isRunning() { return running; }
+};
+
+inline UpdaterClass Update;
+
+#endif
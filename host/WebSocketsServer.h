@@ -0,0 +1,87 @@
+#ifndef HOST_WEBSOCKETSSERVER_H
+#define HOST_WEBSOCKETSSERVER_H
+
+#include <Arduino.h>
+
+// WebSocket server without a network: nothing connects on its own, and a
+// test or the fleet delivers connections and frames with inject(). Sent
+// frames are counted and otherwise dropped.
+
+class WebSocketsServer;
+
+// The server begun last; the fleet takes each hub's from here after setup
+inline WebSocketsServer* hostLastSocket = nullptr;
+
+#ifndef WEBSOCKETS_SERVER_CLIENT_MAX
+#define WEBSOCKETS_SERVER_CLIENT_MAX 5
+#endif
+
+enum WStype_t {
+  WStype_ERROR,
+  WStype_DISCONNECTED,
+  WStype_CONNECTED,
+  WStype_TEXT,
+  WStype_BIN,
+  WStype_FRAGMENT_TEXT_START,
+  WStype_FRAGMENT_BIN_START,
+  WStype_FRAGMENT,
+  WStype_FRAGMENT_FIN,
+  WStype_PING,
+  WStype_PONG
+};
+
+class WebSocketsServer {
+public:
+  typedef std::function<void(uint8_t num, WStype_t type, uint8_t* payload, size_t length)> WebSocketServerEvent;
+
+private:
+  WebSocketServerEvent handler;
+  bool connected[WEBSOCKETS_SERVER_CLIENT_MAX] = {};
+
+public:
+  uint32_t framesSent = 0;
+  uint32_t bytesSent = 0;
+
+  WebSocketsServer(uint16_t, const String& = "", const String& = "arduino") {}
+
+  void onEvent(WebSocketServerEvent event) { handler = event; }
+  void begin() { hostLastSocket = this; }
+  void loop() {}
+
+  bool sendBIN(uint8_t num, const uint8_t*, size_t length) {
+    if (num >= WEBSOCKETS_SERVER_CLIENT_MAX || !connected[num]) {
+      return false;
+    }
+    framesSent++;
+    bytesSent += length;
+    return true;
+  }
+  void disconnect(uint8_t num) { inject(num, WStype_DISCONNECTED, nullptr, 0); }
+  int connectedClients(bool = false) {
+    int count = 0;
+    for (bool c : connected) {
+      count += c;
+    }
+    return count;
+  }
+  IPAddress remoteIP(uint8_t num) { return IPAddress(127, 0, 0, num + 1); }
+
+  void inject(uint8_t num, WStype_t type, uint8_t* payload, size_t length) {
+    if (num >= WEBSOCKETS_SERVER_CLIENT_MAX) {
+      return;
+    }
+    if (type == WStype_CONNECTED) {
+      connected[num] = true;
+    } else if (type == WStype_DISCONNECTED) {
+      if (!connected[num]) {
+        return;
+      }
+      connected[num] = false;
+    }
+    if (handler) {
+      handler(num, type, payload, length);
+    }
+  }
+};
+
+#endif
@@ -0,0 +1,170 @@
+#ifndef HOST_WIFISERVER_H
+#define HOST_WIFISERVER_H
+
+#include <ESP8266WiFi.h>
+#include <memory>
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+// TCP on the host's loopback interface. Ports below 1024 need root, so a
+// server listens on hostListenPort when it is set; the fleet sets it before
+// starting each hub, giving every hub its own local port.
+inline uint16_t hostListenPort = 0;
+
+// One accepted connection; copies share the socket, as on the chip
+class WiFiClient : public Stream {
+private:
+  std::shared_ptr<int> socket;
+  uint32_t peer = 0;
+
+  int fd() const { return socket ? *socket : -1; }
+
+public:
+  WiFiClient() {}
+  WiFiClient(int acceptedFd, uint32_t peerAddress)
+      : socket(new int(acceptedFd), [](int* s) { if (*s >= 0) ::close(*s); delete s; }), peer(peerAddress) {}
+
+  size_t write(uint8_t c) override { return write(&c, 1); }
+  size_t write(const uint8_t* data, size_t len) override {
+    size_t sent = 0;
+    while (sent < len && fd() >= 0) {
+      ssize_t n = ::send(fd(), data + sent, len - sent, MSG_NOSIGNAL);
+      if (n <= 0) {
+        stop();
+        break;
+      }
+      sent += n;
+    }
+    return sent;
+  }
+  using Print::write;
+  size_t write_P(PGM_P data, size_t len) { return write((const uint8_t*)data, len); }
+
+  // Waits up to timeoutMs for data; false once the peer has closed
+  bool wait(uint32_t timeoutMs) {
+    if (fd() < 0) {
+      return false;
+    }
+    pollfd p = { fd(), POLLIN, 0 };
+    return ::poll(&p, 1, timeoutMs) > 0;
+  }
+  int available() override {
+    if (fd() < 0) {
+      return 0;
+    }
+    int pending = 0;
+    pollfd p = { fd(), POLLIN, 0 };
+    if (::poll(&p, 1, 0) > 0) {
+      char probe[512];
+      pending = ::recv(fd(), probe, sizeof(probe), MSG_PEEK | MSG_DONTWAIT);
+    }
+    return std::max(pending, 0);
+  }
+  int read() override {
+    uint8_t c;
+    return read(&c, 1) == 1 ? c : -1;
+  }
+  int read(uint8_t* buffer, size_t len) {
+    if (fd() < 0) {
+      return -1;
+    }
+    ssize_t n = ::recv(fd(), buffer, len, 0);
+    if (n <= 0) {
+      stop();
+      return -1;
+    }
+    return n;
+  }
+  bool connected() { return fd() >= 0; }
+  void stop() {
+    if (socket && *socket >= 0) {
+      ::close(*socket);
+      *socket = -1;
+    }
+  }
+  void setNoDelay(bool noDelay) {
+    int flag = noDelay;
+    ::setsockopt(fd(), IPPROTO_TCP, TCP_NODELAY, &flag, sizeof(flag));
+  }
+  IPAddress remoteIP() const { return peer; }
+  operator bool() const { return fd() >= 0; }
+};
+
+class WiFiServer {
+private:
+  uint16_t port;
+  int listener = -1;
+  int pending = -1;
+  uint32_t pendingPeer = 0;
+
+public:
+  WiFiServer(uint16_t localPort) : port(localPort) {}
+  ~WiFiServer() { close(); }
+  WiFiServer(const WiFiServer&) = delete;
+  WiFiServer& operator=(const WiFiServer&) = delete;
+
+  void begin() {
+    close();
+    listener = ::socket(AF_INET, SOCK_STREAM, 0);
+    int reuse = 1;
+    ::setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+    sockaddr_in address = {};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    address.sin_port = htons(hostListenPort ? hostListenPort : port);
+    if (::bind(listener, (sockaddr*)&address, sizeof(address)) != 0 || ::listen(listener, 64) != 0) {
+      ::close(listener);
+      listener = -1;
+      return;
+    }
+    ::fcntl(listener, F_SETFL, O_NONBLOCK);
+  }
+  bool isListening() const { return listener >= 0; }
+  uint16_t localPort() const {
+    sockaddr_in address = {};
+    socklen_t length = sizeof(address);
+    if (listener < 0 || ::getsockname(listener, (sockaddr*)&address, &length) != 0) {
+      return 0;
+    }
+    return ntohs(address.sin_port);
+  }
+
+  // Accepts without blocking and holds the connection for accept()
+  bool hasClient() {
+    if (pending < 0 && listener >= 0) {
+      sockaddr_in peer = {};
+      socklen_t length = sizeof(peer);
+      pending = ::accept(listener, (sockaddr*)&peer, &length);
+      // Peer addresses are kept in the chip's byte order, first octet lowest
+      pendingPeer = peer.sin_addr.s_addr;
+    }
+    return pending >= 0;
+  }
+  WiFiClient accept() {
+    if (!hasClient()) {
+      return WiFiClient();
+    }
+    WiFiClient client(pending, pendingPeer);
+    pending = -1;
+    return client;
+  }
+  WiFiClient available() { return accept(); }
+  void close() {
+    if (pending >= 0) {
+      ::close(pending);
+      pending = -1;
+    }
+    if (listener >= 0) {
+      ::close(listener);
+      listener = -1;
+    }
+  }
+  void stop() { close(); }
+};
+
+#endif
@@ -0,0 +1,120 @@
+#ifndef HOST_WIFIUDP_H
+#define HOST_WIFIUDP_H
+
+#include <ESP8266WiFi.h>
+#include <deque>
+#include <vector>
+
+struct HostDatagram {
+  uint32_t source;
+  uint16_t sourcePort;
+  uint32_t destination;
+  uint16_t destinationPort;
+  std::vector<uint8_t> data;
+};
+
+class WiFiUDP;
+
+// Every open socket in the process. A datagram is delivered in endPacket()
+// to each socket bound to its port and to its destination, either the
+// socket's address or a group it joined; like the chip, a group member
+// also receives its own multicasts.
+inline std::vector<WiFiUDP*> hostSockets;
+
+class WiFiUDP : public Stream {
+private:
+  uint32_t address = 0;
+  uint32_t group = 0;
+  uint16_t port = 0;
+  std::deque<HostDatagram> inbox;
+  HostDatagram current = {};
+  size_t position = 0;
+  HostDatagram outgoing = {};
+  bool sending = false;
+
+  bool bind(uint32_t ip, uint32_t multicast, uint16_t localPort) {
+    stop();
+    address = ip;
+    group = multicast;
+    port = localPort;
+    hostSockets.push_back(this);
+    return true;
+  }
+
+public:
+  WiFiUDP() {}
+  WiFiUDP(const WiFiUDP&) = delete;
+  WiFiUDP& operator=(const WiFiUDP&) = delete;
+  ~WiFiUDP() { stop(); }
+
+  uint8_t begin(uint16_t localPort) { return bind(WiFi.localIP(), 0, localPort); }
+  uint8_t beginMulticast(IPAddress interfaceAddress, IPAddress multicast, uint16_t localPort) {
+    return bind(interfaceAddress, multicast, localPort);
+  }
+  void stop() {
+    hostSockets.erase(std::remove(hostSockets.begin(), hostSockets.end(), this), hostSockets.end());
+    port = 0;
+    inbox.clear();
+  }
+
+  int beginPacket(IPAddress ip, uint16_t destinationPort) {
+    outgoing = { address ? address : (uint32_t)WiFi.localIP(), port, ip, destinationPort, {} };
+    sending = true;
+    return 1;
+  }
+  int beginPacketMulticast(IPAddress multicast, uint16_t destinationPort, IPAddress interfaceAddress, int = 1) {
+    outgoing = { interfaceAddress, port, multicast, destinationPort, {} };
+    sending = true;
+    return 1;
+  }
+  size_t write(uint8_t c) override { return write(&c, 1); }
+  size_t write(const uint8_t* data, size_t len) override {
+    if (!sending) {
+      return 0;
+    }
+    outgoing.data.insert(outgoing.data.end(), data, data + len);
+    return len;
+  }
+  using Print::write;
+  int endPacket() {
+    if (!sending) {
+      return 0;
+    }
+    sending = false;
+    for (WiFiUDP* socket : hostSockets) {
+      if (socket->port == outgoing.destinationPort &&
+          (socket->address == outgoing.destination || (socket->group != 0 && socket->group == outgoing.destination))) {
+        socket->inbox.push_back(outgoing);
+      }
+    }
+    return 1;
+  }
+
+  int parsePacket() {
+    if (inbox.empty()) {
+      return 0;
+    }
+    current = std::move(inbox.front());
+    inbox.pop_front();
+    position = 0;
+    return current.data.size();
+  }
+  int available() override { return current.data.size() - position; }
+  int read() override { return position < current.data.size() ? current.data[position++] : -1; }
+  int read(uint8_t* buffer, size_t len) {
+    size_t n = std::min(len, current.data.size() - position);
+    if (n == 0) {
+      return 0;
+    }
+    memcpy(buffer, current.data.data() + position, n);
+    position += n;
+    return n;
+  }
+  int read(char* buffer, size_t len) { return read((uint8_t*)buffer, len); }
+  int peek() override { return position < current.data.size() ? current.data[position] : -1; }
+  IPAddress remoteIP() { return current.source; }
+  uint16_t remotePort() { return current.sourcePort; }
+  IPAddress destinationIP() { return current.destination; }
+};
+
+#endif
@@ -0,0 +1,102 @@
+#ifndef HOST_BEARSSL_HASH_H
+#define HOST_BEARSSL_HASH_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+// SHA-256 (FIPS 180-4) behind the subset of the BearSSL API the firmware uses
+
+typedef struct {
+  uint32_t state[8];
+  uint64_t count;
+  uint8_t buffer[64];
+} br_sha256_context;
+
+#define br_sha256_SIZE 32
+
+static inline uint32_t br_sha256_rotr(uint32_t x, int n) {
+  return (x >> n) | (x << (32 - n));
+}
+
+static inline void br_sha256_block(uint32_t* state, const uint8_t* block) {
+  static const uint32_t K[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+  };
+  uint32_t w[64];
+  for (int i = 0; i < 16; i++) {
+    w[i] = ((uint32_t)block[i * 4] << 24) | ((uint32_t)block[i * 4 + 1] << 16) |
+           ((uint32_t)block[i * 4 + 2] << 8) | block[i * 4 + 3];
+  }
+  for (int i = 16; i < 64; i++) {
+    uint32_t s0 = br_sha256_rotr(w[i - 15], 7) ^ br_sha256_rotr(w[i - 15], 18) ^ (w[i - 15] >> 3);
+    uint32_t s1 = br_sha256_rotr(w[i - 2], 17) ^ br_sha256_rotr(w[i - 2], 19) ^ (w[i - 2] >> 10);
+    w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+  }
+  uint32_t a = state[0], b = state[1], c = state[2], d = state[3];
+  uint32_t e = state[4], f = state[5], g = state[6], h = state[7];
+  for (int i = 0; i < 64; i++) {
+    uint32_t t1 = h + (br_sha256_rotr(e, 6) ^ br_sha256_rotr(e, 11) ^ br_sha256_rotr(e, 25)) + ((e & f) ^ (~e & g)) + K[i] + w[i];
+    uint32_t t2 = (br_sha256_rotr(a, 2) ^ br_sha256_rotr(a, 13) ^ br_sha256_rotr(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+    h = g; g = f; f = e; e = d + t1;
+    d = c; c = b; b = a; a = t1 + t2;
+  }
+  state[0] += a; state[1] += b; state[2] += c; state[3] += d;
+  state[4] += e; state[5] += f; state[6] += g; state[7] += h;
+}
+
+static inline void br_sha256_init(br_sha256_context* ctx) {
+  static const uint32_t IV[8] = {
+    0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+  };
+  memcpy(ctx->state, IV, sizeof(IV));
+  ctx->count = 0;
+}
+
+static inline void br_sha256_update(br_sha256_context* ctx, const void* data, size_t len) {
+  const uint8_t* bytes = (const uint8_t*)data;
+  while (len > 0) {
+    size_t used = ctx->count % 64;
+    size_t take = len < 64 - used ? len : 64 - used;
+    memcpy(ctx->buffer + used, bytes, take);
+    ctx->count += take;
+    bytes += take;
+    len -= take;
+    if (ctx->count % 64 == 0) {
+      br_sha256_block(ctx->state, ctx->buffer);
+    }
+  }
+}
+
+// Like BearSSL, leaves the context usable for further updates
+static inline void br_sha256_out(const br_sha256_context* ctx, void* out) {
+  br_sha256_context tail = *ctx;
+  uint64_t bits = tail.count * 8;
+  const uint8_t pad = 0x80;
+  const uint8_t zero = 0;
+  br_sha256_update(&tail, &pad, 1);
+  while (tail.count % 64 != 56) {
+    br_sha256_update(&tail, &zero, 1);
+  }
+  uint8_t length[8];
+  for (int i = 0; i < 8; i++) {
+    length[i] = bits >> (56 - i * 8);
+  }
+  br_sha256_update(&tail, length, 8);
+  uint8_t* digest = (uint8_t*)out;
+  for (int i = 0; i < 8; i++) {
+    digest[i * 4] = tail.state[i] >> 24;
+    digest[i * 4 + 1] = tail.state[i] >> 16;
+    digest[i * 4 + 2] = tail.state[i] >> 8;
+    digest[i * 4 + 3] = tail.state[i];
+  }
+}
+
+#endif
@@ -0,0 +1,64 @@
+#ifndef ADMISSION_CONTROL_H
+#define ADMISSION_CONTROL_H
+
+#include <Arduino.h>
+
+// Per-client token bucket: sustained requests per second and burst size
+#define ADMISSION_RATE 5
+#define ADMISSION_BURST 10
+#define ADMISSION_CLIENTS 8        // Least recently seen client is evicted
+
+// Requests served per loop() iteration, and the time they may take
+#define WEB_REQUESTS_PER_LOOP 4
+#define WEB_LOOP_BUDGET_MS 20
+
+// Smoothed busy time per loop iteration, idle waits excluded, above which
+// requests are shed with 503. An idle iteration is busy for a few ms, and
+// the sensor is read every 30 s.
+#define LOAD_SHED_PERIOD_MS 250
+
+enum AdmissionResult {
+  ADMISSION_ACCEPTED,
+  ADMISSION_RATE_LIMITED,          // Client over its rate: 429
+  ADMISSION_SHED                   // Loop lagging: 503
+};
+
+// Decides whether a request is served. Everything runs on the single loop()
+// thread, so time spent in handlers is time the sensor and display are not
+// serviced; this keeps any one client, and HTTP as a whole, from taking more
+// than its share.
+class AdmissionControl {
+private:
+  struct ClientBucket {
+    uint32_t ip;                   // 0 = unused
+    uint32_t milliTokens;
+    uint32_t lastRefill;           // millis(), which is 32 bits on the chip
+  };
+
+  ClientBucket clients[ADMISSION_CLIENTS];
+  uint32_t lastLoop;
+  uint32_t loopPeriod;             // Smoothed busy time, ms
+  uint32_t acceptedCount;
+  uint32_t rateLimitedCount;
+  uint32_t shedCount;
+  uint32_t budgetExhaustedCount;
+
+  ClientBucket& findClient(uint32_t ip);
+
+public:
+  AdmissionControl();
+  void loopTick(uint32_t idleMillis);  // Once per loop() iteration, with the idle wait before it
+  AdmissionResult admit(uint32_t ip, uint32_t& retryAfter);
+  void noteBudgetExhausted();
+  bool isOverloaded() const;
+
+  uint32_t getLoopPeriod() const;
+  uint32_t getAcceptedCount() const;
+  uint32_t getRateLimitedCount() const;
+  uint32_t getShedCount() const;
+  uint32_t getBudgetExhaustedCount() const;
+  uint32_t getClientIP(uint8_t index) const;     // 0 for an unused slot
+  uint32_t getClientTokens(uint8_t index) const;  // Whole tokens
+};
+
+#endif
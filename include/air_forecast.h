@@ -0,0 +1,79 @@
+#ifndef AIR_FORECAST_H
+#define AIR_FORECAST_H
+
+#include <Arduino.h>
+#include "alert_state.h"
+
+// Holt (level + trend) smoothing factors, per sample
+#define FORECAST_ALPHA 0.3f
+#define FORECAST_BETA 0.05f
+
+// Forecast horizon in samples: 30 minutes at the 30 s read period. Steps are
+// counted in samples rather than seconds so that captures replayed at full
+// speed forecast the same as they did live.
+#define FORECAST_HORIZON 60
+#define FORECAST_SAMPLE_PERIOD 30
+#define FORECAST_LIMIT ALERT_PM25_UNHEALTHY  // PM2.5 warned about before it is reached
+
+// Anomaly detectors run on the one-step forecast error, standardized by its
+// running mean and deviation
+#define ANOMALY_RESIDUAL_ALPHA 0.05f
+#define ANOMALY_ZSCORE 4.0f          // Single-sample spike
+#define ANOMALY_CUSUM_K 0.5f         // CUSUM allowance, in deviations
+#define ANOMALY_CUSUM_H 5.0f         // CUSUM decision threshold
+#define ANOMALY_WARMUP 20            // Samples before the detectors report
+
+enum AnomalyKind {
+  ANOMALY_NONE,
+  ANOMALY_SPIKE,                     // One reading far from the forecast
+  ANOMALY_SHIFT_UP,                  // Sustained readings above the forecast
+  ANOMALY_SHIFT_DOWN
+};
+
+// Streaming PM2.5 forecast and anomaly detection in constant memory and
+// constant time per sample. Accuracy is scored online: the one-step error
+// on every sample, and one horizon forecast at a time once its target
+// sample arrives.
+class AirForecast {
+private:
+  float level;
+  float trend;                       // Per sample
+  float residualMean;
+  float residualVariance;
+  float cusumHigh;
+  float cusumLow;
+  uint32_t samples;
+
+  float pendingForecast;             // Horizon forecast awaiting its sample
+  uint32_t pendingDue;
+  bool pending;
+  float oneStepError;                // Mean absolute errors
+  float horizonError;
+  uint32_t horizonScored;
+
+  AnomalyKind anomaly;               // Verdict on the latest sample
+  uint32_t anomalyCount;
+  uint32_t updateCycles;
+  uint32_t maxUpdateCycles;
+
+public:
+  AirForecast();
+  void reset();
+  void update(float value);
+
+  float getForecast(uint16_t steps) const;
+  float getLevel() const;
+  float getTrend() const;
+  int32_t getSecondsToLimit() const; // -1 unless rising to the limit within the horizon
+  AnomalyKind getAnomaly() const;
+  uint32_t getAnomalyCount() const;
+  uint32_t getSampleCount() const;
+  float getOneStepError() const;
+  float getHorizonError() const;
+  uint32_t getHorizonScored() const;
+  uint32_t getUpdateCycles() const;
+  uint32_t getMaxUpdateCycles() const;
+  static const char* anomalyName(AnomalyKind kind);
+};
+
+#endif
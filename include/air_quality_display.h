@@ -4,11 +4,45 @@
 #include <Arduino.h>
 #include <U8g2lib.h>
 #include "pms_sensor.h"
+#include "house_peers.h"
 
 // Pin definitions
 // Pin definitions
 #define BUZZER_PIN D8  // Buzzer positive to D8
 
+// Frame buffer mode, chosen at build time with -D DISPLAY_PAGE_BUFFER=n:
+// 0 keeps the full 1 KB frame in RAM; 1 or 2 keep only 8 or 16 rows
+// (128/256 bytes) and redraw each screen once per band.
+#ifndef DISPLAY_PAGE_BUFFER
+#define DISPLAY_PAGE_BUFFER 0
+#endif
+
+#if DISPLAY_PAGE_BUFFER == 1
+typedef U8G2_SH1106_128X64_NONAME_1_HW_I2C DisplayDriver;
+#define DISPLAY_BUFFER_SIZE 128
+#elif DISPLAY_PAGE_BUFFER == 2
+typedef U8G2_SH1106_128X64_NONAME_2_HW_I2C DisplayDriver;
+#define DISPLAY_BUFFER_SIZE 256
+#else
+typedef U8G2_SH1106_128X64_NONAME_F_HW_I2C DisplayDriver;
+#define DISPLAY_BUFFER_SIZE 1024
+#endif
+
+#define DISPLAY_WIDTH 128
+#define DISPLAY_HEIGHT 64
+
+// Mirror image: binary PBM, one bit per pixel with lit pixels white
+#define DISPLAY_PBM_HEADER "P4\n128 64\n"
+#define DISPLAY_PBM_SIZE (sizeof(DISPLAY_PBM_HEADER) - 1 + DISPLAY_WIDTH * DISPLAY_HEIGHT / 8)
+
+// Receives the mirror image a piece at a time
+typedef std::function<void(const uint8_t* data, size_t length)> FrameSink;
+
+// SH1106 I2C clock; fast mode instead of the 100 kHz default
+#ifndef DISPLAY_BUS_CLOCK
+#define DISPLAY_BUS_CLOCK 400000
+#endif
+
 // Screen modes for OLED
 enum ScreenMode { 
   MAIN, 
@@ -19,30 +53,58 @@ enum ScreenMode {
   PARTICLES
 };
 
+// Render statistics slots beyond the rotating screens
+#define SCREEN_NO_DATA (PARTICLES + 1)
+#define SCREEN_BOOT (PARTICLES + 2)
+#define SCREEN_STATS_COUNT (PARTICLES + 3)
+
+struct RenderStats {
+  uint32_t lastMicros;      // Drawing plus transfer to the panel
+  uint32_t maxMicros;
+  uint64_t totalMicros;
+  uint32_t count;
+};
+
 class AirQualityDisplay {
 private:
-  U8G2_SH1106_128X64_NONAME_F_HW_I2C* u8g2;
+  typedef void (AirQualityDisplay::*DrawFunction)();
+  
+  DisplayDriver u8g2;
   PMSSensor* sensor;
+  HousePeers* house;
   ScreenMode currentScreen;
   unsigned long lastScreenChange;
-  bool alertActive;
+  uint32_t seenTransitions;   // AlertState transitions already acted on
+  RenderStats renderStats[SCREEN_STATS_COUNT];
+  RenderStats mirrorStats;
+  DrawFunction lastDraw;      // Screen on the panel, redrawn by page-buffer mirrors
+  uint32_t frameCrc;
+  bool frameCrcStale;         // Full-buffer builds checksum on demand
+  
+  void render(DrawFunction draw, uint8_t screen);
+  void drawBootScreen();
+  void drawNoDataScreen();
+  void drawMainScreen();
+  void drawHealthRiskScreen();
+  void drawAlertScreen();
+  void drawTrendScreen();
+  void drawComparisonScreen();
+  void drawParticlesScreen();
   
 public:
-  AirQualityDisplay(PMSSensor* pmsSensor);
-  ~AirQualityDisplay();
+  AirQualityDisplay(PMSSensor* pmsSensor, HousePeers* housePeers);
   void begin();
   void update();
-  void displayMainScreen();
-  void displayHealthRiskScreen();
-  void displayAlertScreen();
-  void displayTrendScreen();
-  void displayComparisonScreen();
-  void displayParticlesScreen();
   void checkAlerts();
   void rotateScreen();
   ScreenMode getCurrentScreen();
   void setScreen(ScreenMode screen);
   void showBootScreen();
+  const RenderStats& getRenderStats(uint8_t screen);
+  void writeFrame(FrameSink sink);  // Panel contents as a PBM image
+  uint32_t getFrameCrc();           // Changes whenever the panel contents do
+  const RenderStats& getMirrorStats();
+  static const char* screenName(uint8_t screen);
 };
 
 #endif
\ No newline at end of file
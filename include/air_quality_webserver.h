@@ -5,22 +5,149 @@
 #include <ESP8266WebServer.h>
 #include "pms_sensor.h"
 #include "air_quality_display.h"
+#include "heap_monitor.h"
+#include "sensor_history.h"
+#include "history_archive.h"
+#include "history_export.h"
+#include "rules_engine.h"
+#include "house_peers.h"
+#include "time_sync.h"
+#include "request_arena.h"
+#include "wifi_connection_manager.h"
+#include "firmware_updater.h"
+#include "admission_control.h"
+#include "live_socket.h"
+#include "coap_server.h"
+#include "power_manager.h"
+
+// Per-stage totals of a maximum-speed capture replay, and the accuracy of
+// the forecast over the capture
+struct ReplayBenchmark {
+    uint32_t reads;
+    uint32_t bytes;
+    uint32_t frames;
+    uint32_t parseMicros;       // Parsing and snapshot publication
+    uint32_t trendMicros;
+    uint32_t forecastMicros;
+    uint32_t historyMicros;
+    uint32_t serializeMicros;   // /api/data body
+    float oneStepError;         // Mean absolute errors, µg/m³
+    float horizonError;
+    uint32_t horizonScored;
+    uint32_t anomalies;
+    uint32_t maxForecastCycles;
+};
+
+// Last /api/export response, network time included
+struct ExportStats {
+    uint32_t records;
+    uint32_t bytes;
+    uint32_t micros;
+};
+
+// Lets the power manager see a waiting connection without accepting it
+class PollableWebServer : public ESP8266WebServer {
+public:
+    using ESP8266WebServer::ESP8266WebServer;
+    bool hasPendingRequest() { return _server.hasClient() || _currentClient.available() > 0; }
+};
+
+// Largest /api/data body kept in the response cache
+#define API_CACHE_SIZE 2048
+
+// HTTP Digest credentials for /update. Set a password per installation,
+// e.g. -D OTA_PASSWORD='"..."'; while it is empty every upload is refused.
+#ifndef OTA_USERNAME
+#define OTA_USERNAME "admin"
+#endif
+#ifndef OTA_PASSWORD
+#define OTA_PASSWORD ""
+#endif
 
 class AirQualityWebServer {
 public:
-    AirQualityWebServer(PMSSensor* pmsSensor, AirQualityDisplay* airDisplay);
+    AirQualityWebServer(PMSSensor* pmsSensor, AirQualityDisplay* airDisplay, HeapMonitor* monitor, SensorHistory* sensorHistory, TimeSync* clock, HistoryArchive* historyArchive, RulesEngine* rulesEngine, HousePeers* housePeers);
     void begin(const char* ssid, const char* password);
     void handleClient();
+    bool hasPendingRequest();
+    void setBackgroundTask(std::function<void()> task);
     bool isWiFiConnected();
     String getIPAddress();
 
 private:
+    void on(const char* uri, std::function<void()> handler);
+    void on(const char* uri, HTTPMethod method, std::function<void()> handler, std::function<void()> uploadHandler);
+    bool admitRequest();
+    void finishRequest();
     void handleRoot();
     void handleAirQuality();
     void handleAPIData();
-    ESP8266WebServer server;
+    void buildAPIData(const PMSSensor* source, const PMSSensor::ReadingSnapshot& reading);
+    void handleHistory();
+    void handleHistoryCompressed();
+    void handleExport();
+    void handleDebugExport();
+    void handleRules();
+    void handleHouse();
+    void handleAlerts();
+    void updateRules();
+    void sendRules();
+    void flushChunk(bool force);
+    void handleDebugHeap();
+    void handleDebugDisplay();
+    void handleDisplayImage();
+    void handleDebugAdmission();
+    void handleDebugLive();
+    void handleDebugCoap();
+    void handleDebugLastCrash();
+    void handleDebugPower();
+    void handleDebugWiFi();
+    void handleDebugPMS();
+    void handleDebugCodec();
+    bool runReplayBenchmark(PMSReplay& capture, ReplayBenchmark& result);
+#ifdef ENABLE_PROFILER
+    void handleDebugProfile();
+#endif
+#ifdef SENSOR_SIMULATOR
+    void handleDebugSim();
+#endif
+    bool isUpdateAuthorized();
+    void handleUpdateUpload();
+    void handleUpdateFinished();
+    void appendTrend(const char* name, const float* trend);
+    void appendForecast(const PMSSensor* source);
+    void appendParticles(const PMSSensor* source, const PMSSensor::AirQualityData& data);
+    PollableWebServer server;
+    RequestArena arena;
+    AdmissionControl admission;
+    LiveSocket live;
+    CoapServer coap;
+    uint32_t requestCount;      // Requests dispatched, including rejected ones
+    unsigned long lastEmptyPoll;  // Last time no request was waiting
+    WiFiConnectionManager wifi;
+    UpdaterFlashBackend flashBackend;
+    FirmwareUpdater updater;
+    bool updateUploadSeen;      // The current /update request carried a file
+    std::function<void()> backgroundTask;
+    
+    // /api/data body for the state identified by its ETag
+    struct {
+        char body[API_CACHE_SIZE];
+        size_t length;
+        char etag[40];
+    } apiCache;
+    uint32_t apiCacheOverflows;
+    ExportStats lastExport;
     PMSSensor* sensor;
     AirQualityDisplay* display;
+    HeapMonitor* heapMonitor;
+    SensorHistory* history;
+    TimeSync* timeSync;
+    HistoryArchive* archive;
+    RulesEngine* rules;
+    HousePeers* house;
+    unsigned long firstRequestTime;
+    unsigned long restartRequestTime;
 };
 
 #endif // AIR_QUALITY_WEBSERVER_H
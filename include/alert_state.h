@@ -0,0 +1,96 @@
+#ifndef ALERT_STATE_H
+#define ALERT_STATE_H
+
+#include <Arduino.h>
+
+// Level thresholds: a level is reached when PM2.5 (µg/m³) or the VOC index
+// exceeds its value
+#ifndef ALERT_PM25_MODERATE
+#define ALERT_PM25_MODERATE 12
+#endif
+#ifndef ALERT_PM25_SENSITIVE
+#define ALERT_PM25_SENSITIVE 35
+#endif
+#ifndef ALERT_PM25_UNHEALTHY
+#define ALERT_PM25_UNHEALTHY 55
+#endif
+#ifndef ALERT_VOC_MODERATE
+#define ALERT_VOC_MODERATE 30
+#endif
+#ifndef ALERT_VOC_SENSITIVE
+#define ALERT_VOC_SENSITIVE 60
+#endif
+#ifndef ALERT_VOC_UNHEALTHY
+#define ALERT_VOC_UNHEALTHY 80
+#endif
+
+// A level is left only once both values are this far below its thresholds
+#ifndef ALERT_PM25_HYSTERESIS
+#define ALERT_PM25_HYSTERESIS 5
+#endif
+#ifndef ALERT_VOC_HYSTERESIS
+#define ALERT_VOC_HYSTERESIS 5
+#endif
+
+// Seconds a higher or lower level must persist before it is taken. Raising
+// is immediate so an alert is never late; lowering waits out brief dips.
+#ifndef ALERT_RAISE_HOLD
+#define ALERT_RAISE_HOLD 0
+#endif
+#ifndef ALERT_CLEAR_HOLD
+#define ALERT_CLEAR_HOLD 300
+#endif
+
+// Recent transitions kept for /api/alerts
+#define ALERT_EVENT_HISTORY 8
+
+enum AirLevel : uint8_t {
+  AIR_NO_DATA,
+  AIR_GOOD,
+  AIR_MODERATE,
+  AIR_SENSITIVE,                   // Unhealthy for sensitive groups
+  AIR_UNHEALTHY,                   // The alert level: buzzer, LED and alert screen
+  AIR_LEVEL_COUNT
+};
+
+struct AlertEvent {
+  uint32_t time;                   // Monotonic seconds
+  AirLevel from;
+  AirLevel to;
+  uint8_t vocIndex;
+  uint16_t pm25;
+};
+
+// The one place air quality is classified. Updated once per published
+// reading; the display, LED, buzzer and web handlers read the cached level,
+// and react to transitions by comparing getTransitionCount() with the
+// count they last handled.
+class AlertState {
+private:
+  AirLevel level;
+  uint32_t raiseSince;             // 0 = no higher level pending
+  uint32_t lowerSince;             // 0 = no lower level pending
+  uint32_t transitionCount;
+  AlertEvent events[ALERT_EVENT_HISTORY];
+  uint8_t eventHead;
+  uint8_t eventCount;
+
+  static AirLevel classify(uint16_t pm25, uint8_t vocIndex);
+
+public:
+  AlertState();
+  void reset();
+  bool update(bool valid, uint16_t pm25, uint8_t vocIndex, uint32_t time);  // True on a transition
+
+  AirLevel getLevel() const { return level; }
+  bool isAlert() const { return level == AIR_UNHEALTHY; }
+  uint32_t getTransitionCount() const;
+  uint8_t getEventCount() const;
+  const AlertEvent& getEvent(uint8_t age) const;  // 0 = most recent
+
+  static const char* levelName(AirLevel level);
+  static const char* healthStatus(AirLevel level);  // OLED and dashboard wording
+  static const char* riskLevel(AirLevel level);     // LOW, MODERATE or HIGH
+};
+
+#endif
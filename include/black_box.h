@@ -0,0 +1,93 @@
+#ifndef BLACK_BOX_H
+#define BLACK_BOX_H
+
+#include "platform.h"
+
+// RTC user memory word offset of the black box, after the WiFi link cache
+// (words 32-34) and room for it to grow. The record below takes 76 of the
+// remaining words.
+#define BLACKBOX_RTC_OFFSET 40
+#define BLACKBOX_MAGIC 0x31424B4AUL        // "JKB1"
+#define BLACKBOX_EVENTS 32
+
+// Thresholds for recording an event
+#define BLACKBOX_SLOW_LOOP_MS 500
+#define BLACKBOX_SLOW_REQUEST_MS 200
+#define BLACKBOX_HEAP_STEP 1024            // Drop in the heap minimum
+
+enum BlackBoxEventKind {
+  BLACKBOX_BOOT,                           // Detail: reset reason
+  BLACKBOX_SLOW_LOOP,                      // Value: ms
+  BLACKBOX_SLOW_REQUEST,                   // Value: ms
+  BLACKBOX_HEAP_LOW,                       // Value: free heap, bytes
+  BLACKBOX_READ_FAILED,
+  BLACKBOX_EVENT_KINDS
+};
+
+struct BlackBoxEvent {
+  uint32_t uptime;                         // ms
+  uint8_t kind;
+  uint8_t detail;
+  uint16_t value;
+};
+
+// Latest values, overwritten in place
+struct BlackBoxState {
+  uint32_t uptime;                         // s, updated once a second
+  uint32_t maxLoopMicros;
+  uint16_t minFreeHeap;
+  uint8_t requestOpen;                     // A handler was running at reset
+  uint8_t sensorValid;
+  uint32_t sensorSequence;
+  uint16_t pm25;
+  uint16_t reserved;
+  char lastRoute[12];                      // Truncated URI
+};
+
+struct BlackBoxHeader {
+  uint32_t magic;
+  uint32_t bootCount;                      // Soft resets since power-on
+  uint32_t head;                           // Next event slot
+  uint32_t count;
+  BlackBoxState state;
+};
+
+struct BlackBoxRecord {
+  BlackBoxHeader header;
+  BlackBoxEvent events[BLACKBOX_EVENTS];
+};
+
+// Flight recorder for the last moments before a reset. RTC memory survives
+// watchdog, exception and software resets, but not power loss. Every update
+// writes only the words that changed straight to RTC memory, so nothing is
+// lost to a reset and no buffer has to be flushed. At boot the previous
+// record is copied out for /debug/lastcrash before a new one is started.
+class BlackBox {
+private:
+  BlackBoxHeader current;                  // Events are kept only in RTC memory
+  BlackBoxRecord previous;
+  bool previousValid;
+  rst_info resetInfo;
+  uint32_t requestStart;
+
+  void writeField(const void* field, size_t size);
+  void record(BlackBoxEventKind kind, uint8_t detail, uint32_t value);
+
+public:
+  BlackBox();
+  void begin();
+  void loopDone(uint32_t loopMicros);
+  void beginRequest(const char* route);
+  void endRequest();
+  void noteReading(uint32_t sequence, uint16_t pm25, bool valid);
+
+  bool hasPrevious() const;
+  const BlackBoxRecord& getPrevious() const;
+  const rst_info& getResetInfo() const;
+  uint32_t getBootCount() const;
+  static const char* eventName(uint8_t kind);
+};
+
+extern BlackBox blackBox;
+
+#endif
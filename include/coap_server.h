@@ -0,0 +1,196 @@
+#ifndef COAP_SERVER_H
+#define COAP_SERVER_H
+
+#include <Arduino.h>
+#include <ESP8266WiFi.h>
+#include <WiFiUdp.h>
+#include "pms_sensor.h"
+#include "admission_control.h"
+
+#define COAP_PORT 5683
+#define COAP_PACKETS_PER_LOOP 4
+#define COAP_MESSAGE_MAX 128          // Larger datagrams are rejected
+#define COAP_PATH_MAX 24
+
+// Observations held at once; a registration beyond this is answered
+// without the Observe option, which tells the client it is not registered
+#ifndef COAP_MAX_OBSERVERS
+#define COAP_MAX_OBSERVERS 4
+#endif
+
+// Every Nth notification is confirmable. An observer that has not
+// acknowledged the previous confirmable one by then has gone and is dropped.
+#define COAP_CON_EVERY 8
+
+// Answers to recent confirmable PUT/POST requests, resent when a request
+// is retransmitted so that a toggle is not applied twice
+#define COAP_DEDUP_ENTRIES 4
+#define COAP_DEDUP_RESPONSE_MAX 24
+
+// RFC 7252 message types, and the codes used here (class << 5 | detail)
+enum CoapType : uint8_t {
+  COAP_CON,
+  COAP_NON,
+  COAP_ACK,
+  COAP_RST
+};
+
+enum CoapCode : uint8_t {
+  COAP_EMPTY = 0x00,
+  COAP_GET = 0x01,
+  COAP_POST = 0x02,
+  COAP_PUT = 0x03,
+  COAP_CHANGED = 0x44,                // 2.04
+  COAP_CONTENT = 0x45,                // 2.05
+  COAP_BAD_REQUEST = 0x80,            // 4.00
+  COAP_BAD_OPTION = 0x82,             // 4.02
+  COAP_NOT_FOUND = 0x84,              // 4.04
+  COAP_METHOD_NOT_ALLOWED = 0x85,     // 4.05
+  COAP_NOT_ACCEPTABLE = 0x86,         // 4.06
+  COAP_TOO_MANY_REQUESTS = 0x9D,      // 4.29, RFC 8516
+  COAP_SERVICE_UNAVAILABLE = 0xA3     // 5.03
+};
+
+enum CoapOption : uint16_t {
+  COAP_OPTION_OBSERVE = 6,
+  COAP_OPTION_URI_PATH = 11,
+  COAP_OPTION_CONTENT_FORMAT = 12,
+  COAP_OPTION_MAX_AGE = 14
+};
+
+#define COAP_FORMAT_LINK 40
+#define COAP_FORMAT_OCTETS 42
+
+// Resources, little-endian binary payloads (content format 42):
+//   /reading  sequence u32, pm1.0 u16, pm2.5 u16, pm10 u16, voc u8, level u8 (AirLevel); observable
+//   /trend    current hour u8, hourly mean PM2.5 24 x u16 (0.1 µg/m³), hourly mean VOC 24 x u8
+//   /led      state u8; PUT or POST 0 off, 1 on, 2 toggle; observable
+//   /servo    angle u8; PUT or POST 0-180; observable
+//   /.well-known/core  resource list in link format
+enum CoapResourceId : uint8_t {
+  COAP_RESOURCE_DISCOVERY,
+  COAP_RESOURCE_READING,
+  COAP_RESOURCE_TREND,
+  COAP_RESOURCE_LED,
+  COAP_RESOURCE_SERVO,
+  COAP_RESOURCE_COUNT
+};
+
+struct CoapRequest {
+  uint8_t type;
+  uint8_t code;
+  uint16_t messageId;
+  uint8_t token[8];
+  uint8_t tokenLength;
+  char path[COAP_PATH_MAX];
+  bool pathTooLong;
+  bool badOption;                     // Unrecognized critical option
+  bool hasObserve;
+  uint32_t observe;                   // 0 registers, 1 deregisters
+  int32_t accept;                     // Content format asked for; -1 = any
+  const uint8_t* payload;
+  size_t payloadLength;
+};
+
+struct CoapObserver {
+  uint32_t ip;                        // 0 = unused
+  uint16_t port;
+  uint8_t token[8];
+  uint8_t tokenLength;
+  uint8_t resource;
+  uint32_t state;                     // Resource state last sent
+  uint16_t messageId;                 // Of the last notification
+  bool awaitingAck;                   // Last confirmable notification unacknowledged
+  uint32_t notifications;
+};
+
+// Builds one message in a caller buffer of COAP_MESSAGE_MAX bytes. Options
+// must be added in increasing number order.
+class CoapWriter {
+private:
+  uint8_t* buffer;
+  size_t length;
+  uint16_t lastOption;
+  bool overflow;
+
+  void put(const uint8_t* data, size_t dataLength);
+
+public:
+  CoapWriter(uint8_t* out, uint8_t type, uint8_t code, uint16_t messageId, const uint8_t* token, uint8_t tokenLength);
+  void option(uint16_t number, const uint8_t* value, uint8_t valueLength);
+  void uintOption(uint16_t number, uint32_t value);  // Shortest encoding, as RFC 7252 requires
+  void payload(const uint8_t* data, size_t dataLength);
+  size_t size() const { return length; }
+  bool isOverflow() const { return overflow; }
+};
+
+// CoAP (RFC 7252) on UDP for battery-powered panels: one datagram per
+// exchange instead of a TCP connection and text headers per HTTP poll, and
+// Observe (RFC 7641) so a panel registers once and is sent each new
+// reading without polling. Requests share HTTP's admission control.
+class CoapServer {
+private:
+  struct DedupEntry {
+    uint32_t ip;                      // 0 = unused
+    uint16_t port;
+    uint16_t messageId;
+    uint8_t length;
+    uint8_t response[COAP_DEDUP_RESPONSE_MAX];
+  };
+
+  WiFiUDP udp;
+  PMSSensor* sensor;
+  AdmissionControl* admission;
+  bool listening;
+  int pendingSize;                    // Datagram parsed by hasPendingRequest() and not yet read
+  uint16_t nextMessageId;
+  uint32_t observeSequence;
+  CoapObserver observers[COAP_MAX_OBSERVERS];
+  DedupEntry dedup[COAP_DEDUP_ENTRIES];
+  uint8_t dedupNext;
+
+  uint32_t requestCount;
+  uint32_t notificationCount;
+  uint32_t rejectedCount;             // Malformed, oversized or refused by admission control
+  uint32_t duplicateCount;
+  uint32_t droppedObservers;          // Reset or unacknowledged
+  uint32_t bytesIn;                   // UDP payloads
+  uint32_t bytesOut;
+  uint32_t lastReadingBytes;          // Last /reading message sent
+  uint32_t lastMicros;                // Receipt to response sent
+  uint32_t maxMicros;
+
+  static bool parse(const uint8_t* data, size_t length, CoapRequest& request);
+  static int8_t findResource(const char* path);
+  void receive(int size);
+  void handleReply(uint32_t ip, uint16_t port, const CoapRequest& request);
+  void handleRequest(uint32_t ip, uint16_t port, const CoapRequest& request);
+  uint8_t applyWrite(uint8_t resource, const CoapRequest& request);
+  bool updateObservation(uint32_t ip, uint16_t port, const CoapRequest& request, uint8_t resource, uint32_t state);
+  void notifyObservers();
+  uint32_t stateOf(uint8_t resource, const PMSSensor::ReadingSnapshot& reading);
+  size_t buildPayload(uint8_t resource, const PMSSensor::ReadingSnapshot& reading, uint8_t* out);
+  void addContent(CoapWriter& writer, uint8_t resource, const PMSSensor::ReadingSnapshot& reading);
+  void send(uint32_t ip, uint16_t port, const uint8_t* message, size_t length);
+
+public:
+  CoapServer(PMSSensor* pmsSensor, AdmissionControl* admissionControl);
+  void loop();                        // Listens once the link is up
+  bool hasPendingRequest();
+
+  uint8_t getObserverCount() const;
+  const CoapObserver* getObserver(uint8_t index) const;  // nullptr for an unused slot
+  uint32_t getRequestCount() const;
+  uint32_t getNotificationCount() const;
+  uint32_t getRejectedCount() const;
+  uint32_t getDuplicateCount() const;
+  uint32_t getDroppedObservers() const;
+  uint32_t getBytesIn() const;
+  uint32_t getBytesOut() const;
+  uint32_t getLastReadingBytes() const;
+  uint32_t getLastMicros() const;
+  uint32_t getMaxMicros() const;
+  static const char* resourceName(uint8_t resource);
+};
+
+#endif
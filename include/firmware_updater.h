@@ -0,0 +1,58 @@
+#ifndef FIRMWARE_UPDATER_H
+#define FIRMWARE_UPDATER_H
+
+#include <Arduino.h>
+#include <bearssl/bearssl_hash.h>
+
+// Destination of a streamed firmware image
+class FlashBackend {
+public:
+  virtual ~FlashBackend() {}
+  virtual bool begin(size_t maxSize) = 0;
+  virtual size_t write(const uint8_t* data, size_t len) = 0;
+  virtual bool commit() = 0;
+  virtual void abort() = 0;
+};
+
+// Writes into the OTA partition through the core's Updater
+class UpdaterFlashBackend : public FlashBackend {
+public:
+  bool begin(size_t maxSize) override;
+  size_t write(const uint8_t* data, size_t len) override;
+  bool commit() override;
+  void abort() override;
+};
+
+// Streams an image to flash chunk by chunk while hashing it. Nothing is
+// committed unless the SHA-256 of everything written matches the expected
+// digest, so a truncated or corrupted upload leaves the running firmware
+// in place.
+class FirmwareUpdater {
+private:
+  FlashBackend* flash;
+  br_sha256_context sha;
+  uint8_t expectedHash[32];
+  bool running;
+  bool verified;
+  size_t bytesWritten;
+  unsigned long startTime;
+  unsigned long elapsedTime;
+  const char* error;
+
+  static bool parseHex(const char* hex, uint8_t* out, size_t len);
+
+public:
+  FirmwareUpdater(FlashBackend* backend);
+  bool begin(size_t maxSize, const char* sha256Hex);
+  bool write(const uint8_t* data, size_t len);
+  bool end();
+  void abort(const char* reason);
+  bool isRunning();
+  bool isVerified();
+  size_t getBytesWritten();
+  unsigned long getElapsedTime();
+  float getThroughputKBps();
+  const char* getError();
+};
+
+#endif
@@ -0,0 +1,41 @@
+#ifndef HEAP_MONITOR_H
+#define HEAP_MONITOR_H
+
+#include "platform.h"
+
+// One sample per hour keeps three days of history for soak runs
+#define HEAP_HISTORY_SIZE 72
+#define HEAP_SAMPLE_INTERVAL 3600000UL
+
+class HeapMonitor {
+public:
+  struct HeapSample {
+    uint32_t uptime;        // Seconds since boot
+    uint32_t freeHeap;      // Total free heap (bytes)
+    uint32_t maxFreeBlock;  // Largest allocatable block (bytes)
+    uint8_t fragmentation;  // 0-100 %
+  };
+
+private:
+  HeapSample history[HEAP_HISTORY_SIZE];
+  uint8_t historyIndex;
+  uint8_t historyCount;
+  unsigned long lastSampleTime;
+  unsigned long lastExtremesTime;
+  uint32_t minFreeHeap;
+  uint32_t minMaxFreeBlock;
+  uint8_t peakFragmentation;
+
+public:
+  HeapMonitor();
+  void begin();
+  void update();
+  HeapSample sampleNow();
+  uint8_t getSampleCount();
+  const HeapSample& getSample(uint8_t age);  // 0 = most recent
+  uint32_t getMinFreeHeap();
+  uint32_t getMinMaxFreeBlock();
+  uint8_t getPeakFragmentation();
+};
+
+#endif
@@ -0,0 +1,53 @@
+#ifndef HISTORY_ARCHIVE_H
+#define HISTORY_ARCHIVE_H
+
+#include <Arduino.h>
+#include <LittleFS.h>
+#include "sensor_history.h"
+#include "series_codec.h"
+
+// Encoded bytes per block, and blocks kept on flash. At one sample per 30 s
+// a block holds about four hours, so 48 blocks (48 KB) cover over a week.
+#define ARCHIVE_BLOCK_SIZE 1024
+#define ARCHIVE_BLOCKS 48
+#define ARCHIVE_MAGIC 0x31484B4AUL   // "JKH1"
+
+// Stored little-endian ahead of each block's encoded samples, on flash and
+// in /api/history?encoding=compressed responses
+struct ArchiveBlockHeader {
+  uint32_t magic;
+  uint32_t sequence;    // Increments with every sealed block
+  uint32_t firstTime;   // Epoch seconds of the first sample; the block's base
+  uint32_t lastTime;
+  uint16_t count;
+  uint16_t length;      // Encoded bytes following the header
+};
+
+// Long-term history on flash, in epoch seconds. Samples are encoded into an
+// open block in RAM; a full block is sealed into the file slot
+// sequence % ARCHIVE_BLOCKS, overwriting the oldest. The open block is lost
+// on a power cut but written out by flush() before a planned restart.
+class HistoryArchive {
+private:
+  uint8_t block[ARCHIVE_BLOCK_SIZE];
+  SeriesEncoder encoder;
+  uint32_t firstTime;
+  uint32_t lastTime;
+  uint32_t nextSequence;
+
+  static void slotPath(uint32_t sequence, char* path, size_t size);
+  void seal();
+
+public:
+  HistoryArchive();
+  void begin();                         // Finds where the previous run left off
+  void add(const HistorySample& sample);  // sample.time in epoch seconds
+  void flush();
+
+  uint32_t getOldestSequence() const;
+  uint32_t getNextSequence() const;     // Sequence the open block will get
+  bool openBlock(uint32_t sequence, ArchiveBlockHeader& header, File& file);
+  const uint8_t* getOpenBlock(ArchiveBlockHeader& header) const;
+};
+
+#endif
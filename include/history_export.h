@@ -0,0 +1,61 @@
+#ifndef HISTORY_EXPORT_H
+#define HISTORY_EXPORT_H
+
+#include <Arduino.h>
+#include "history_archive.h"
+
+// Bytes buffered before each write to the connection
+#define EXPORT_CHUNK_SIZE 1024
+
+enum ExportFormat {
+  EXPORT_CSV,
+  EXPORT_NDJSON
+};
+
+// Receives the export a chunk at a time
+typedef std::function<void(const char* data, size_t length)> ExportSink;
+
+// Archive samples in an epoch range as CSV or NDJSON. Every field is
+// right-aligned to a fixed width, so all records have the same length and
+// a byte offset maps straight to a record: a Range request only decodes
+// the blocks it covers, and records added while a download is interrupted
+// land after the bytes already received. Memory use is the two caller
+// buffers whatever the export size.
+class HistoryExport {
+private:
+  HistoryArchive* archive;
+  uint8_t* block;                          // ARCHIVE_BLOCK_SIZE bytes
+  char* chunk;                             // EXPORT_CHUNK_SIZE bytes
+  size_t chunkLength;
+  ExportFormat format;
+  uint32_t from;
+  uint32_t to;
+  uint32_t firstSequence;
+  uint16_t blockCounts[ARCHIVE_BLOCKS + 1];  // Samples in range, per block including the open one
+  uint8_t blockTotal;
+  uint32_t count;
+  uint32_t firstTime;
+  uint32_t lastTime;
+  ExportSink sink;
+
+  const uint8_t* loadBlock(uint32_t sequence, ArchiveBlockHeader& header);
+  void emit(uint32_t offset, const char* data, size_t length, uint32_t start, uint32_t end);
+  size_t formatRecord(const HistorySample& sample, char* record) const;
+
+public:
+  HistoryExport(HistoryArchive* historyArchive);
+  void begin(ExportFormat exportFormat, uint32_t fromTime, uint32_t toTime, uint8_t* blockBuffer, char* chunkBuffer);
+  uint32_t write(uint32_t start, uint32_t end, ExportSink output);  // Bytes [start, end]; returns records touched
+
+  uint32_t getLength() const;              // Whole export, bytes
+  uint32_t getCount() const;
+  size_t getHeaderLength() const;
+  size_t getRecordLength() const;
+  void getETag(char* etag, size_t size) const;  // Changes with the records in range
+  static bool parseRange(const char* header, uint32_t length, uint32_t& start, uint32_t& end);
+  static bool parseFormat(const char* name, ExportFormat& format);
+  static const char* formatName(ExportFormat format);
+  static const char* contentType(ExportFormat format);
+};
+
+#endif
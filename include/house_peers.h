@@ -0,0 +1,83 @@
+#ifndef HOUSE_PEERS_H
+#define HOUSE_PEERS_H
+
+#include <Arduino.h>
+#include <ESP8266WiFi.h>
+#include <WiFiUdp.h>
+#include "pms_sensor.h"
+#include "reading_channel.h"
+
+// Administratively scoped group shared by all hubs in the house
+#define HOUSE_GROUP_IP IPAddress(239, 74, 75, 1)
+#define HOUSE_PORT 4747
+
+#define HOUSE_MAGIC 0x4B4A            // "JK"
+#define HOUSE_VERSION 1
+#define HOUSE_MAX_PEERS 8             // Least recently heard peer is replaced
+#define HOUSE_PEER_TIMEOUT_MS 120000  // Four missed readings
+#define HOUSE_HEARTBEAT_MS 30000      // Resend when no new reading arrives
+#define HOUSE_PACKETS_PER_LOOP 8
+
+// One hub's latest reading, sent on every new reading. Fixed layout,
+// little-endian, 20 bytes.
+struct HouseDatagram {
+  uint16_t magic;
+  uint8_t version;
+  uint8_t flags;                      // Bit 0: reading valid
+  uint32_t hubId;                     // Chip ID
+  uint32_t sequence;
+  uint16_t pm1_0;                     // Atmospheric, µg/m³
+  uint16_t pm2_5;
+  uint16_t pm10;
+  uint8_t vocIndex;
+  uint8_t reserved;
+};
+
+struct HousePeer {
+  HouseDatagram reading;
+  uint32_t ip;
+  unsigned long lastSeen;             // 0 = unused
+};
+
+// Copy of the peer table for the sensing side, which draws it on the OLED
+struct HouseView {
+  HousePeer peers[HOUSE_MAX_PEERS];   // lastSeen 0 = unused or expired
+  uint8_t count;
+};
+
+// Whole-house view: every hub multicasts its reading and keeps a bounded
+// table of what the others sent, so any hub can show the whole house
+// without the dashboard polling each one.
+class HousePeers {
+private:
+  WiFiUDP udp;
+  PMSSensor* sensor;
+  HousePeer peers[HOUSE_MAX_PEERS];
+  Seqlock<HouseView> shared;
+  bool changed;                       // Table differs from the shared copy
+  bool joined;
+  uint32_t lastSentSequence;
+  unsigned long lastSent;
+  uint32_t sentCount;
+  uint32_t receivedCount;
+  uint32_t rejectedCount;             // Wrong size, magic or version
+
+  void send(const PMSSensor::ReadingSnapshot& reading);
+  void receive();
+  void expire();
+  void publish();
+
+public:
+  HousePeers(PMSSensor* pmsSensor);
+  void loop();                        // Joins the group once the link is up
+
+  uint8_t getPeerCount() const;       // Live peers, this hub excluded
+  const HousePeer* getPeer(uint8_t index) const;  // nullptr for an unused or expired slot
+  HouseView readView() const;         // From any side
+  static uint32_t getHubId();
+  uint32_t getSentCount() const;
+  uint32_t getReceivedCount() const;
+  uint32_t getRejectedCount() const;
+};
+
+#endif
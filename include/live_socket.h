@@ -0,0 +1,99 @@
+#ifndef LIVE_SOCKET_H
+#define LIVE_SOCKET_H
+
+#include <Arduino.h>
+#include <WebSocketsServer.h>
+#include "pms_sensor.h"
+#include "air_quality_display.h"
+
+// WebSocket port; the dashboard connects to ws://<hub>:81/ws
+#define LIVE_SOCKET_PORT 81
+
+// Simultaneous dashboards; further connections are closed on arrival
+#ifndef LIVE_SOCKET_CLIENTS
+#define LIVE_SOCKET_CLIENTS 3
+#endif
+
+// Outgoing frames held per connection while its socket is not writable.
+// When full the oldest frame is dropped; state and reading frames each
+// carry complete values, so a later frame supersedes an earlier one.
+#define LIVE_QUEUE_FRAMES 4
+#define LIVE_FRAME_MAX 12
+
+// Binary frames, little-endian.
+//   Command, client to hub: op u8, value u8, id u16
+//   State, hub to client:   LIVE_FRAME_STATE, led u8, servo u8, acked id u16 (0 if unsolicited)
+//   Reading, hub to client: LIVE_FRAME_READING, sequence u32, pm1.0 u16, pm2.5 u16, pm10 u16, voc u8
+//   Display, hub to client: LIVE_FRAME_DISPLAY, frame checksum u32, to
+//                           subscribers only; /display.pbm has the image
+enum LiveCommand {
+  LIVE_CMD_LED = 1,            // Value 0 off, 1 on, 2 toggle
+  LIVE_CMD_SERVO = 2,          // Value is the angle
+  LIVE_CMD_DISPLAY = 3         // Value 1 subscribes to display changes, 0 ends it
+};
+
+enum LiveFrameType {
+  LIVE_FRAME_STATE = 0x81,
+  LIVE_FRAME_READING = 0x82,
+  LIVE_FRAME_DISPLAY = 0x83
+};
+
+// Actuator control and live readings over one WebSocket per dashboard,
+// instead of an HTTP request and a full page reload per click. State frames
+// go out on every actuator change, whatever caused it, and reading frames
+// on every new reading.
+class LiveSocket {
+private:
+  struct Client {
+    bool connected;
+    bool displayFeed;
+    uint8_t frames[LIVE_QUEUE_FRAMES][LIVE_FRAME_MAX];
+    uint8_t lengths[LIVE_QUEUE_FRAMES];
+    uint8_t head;
+    uint8_t count;
+  };
+
+  WebSocketsServer socket;
+  PMSSensor* sensor;
+  AirQualityDisplay* display;
+  Client clients[WEBSOCKETS_SERVER_CLIENT_MAX];
+  bool lastLED;
+  int lastServo;
+  uint32_t lastSequence;
+  uint32_t lastFrameCrc;
+
+  uint32_t connectCount;
+  uint32_t rejectedCount;
+  uint32_t commandCount;
+  uint32_t bytesIn;             // Including WebSocket framing
+  uint32_t bytesOut;
+  uint32_t droppedFrames;
+  uint32_t lastCommandMicros;   // Receipt to actuator written
+  uint32_t maxCommandMicros;
+
+  void handleEvent(uint8_t num, WStype_t type, uint8_t* payload, size_t length);
+  void handleCommand(uint8_t num, const uint8_t* payload, size_t length);
+  void enqueue(uint8_t num, const uint8_t* frame, uint8_t length);
+  void broadcast(const uint8_t* frame, uint8_t length, int except);
+  uint8_t buildState(uint8_t* frame, uint16_t ack);
+  uint8_t buildReading(uint8_t* frame, const PMSSensor::ReadingSnapshot& reading);
+  uint8_t buildDisplay(uint8_t* frame);
+  void flush();
+
+public:
+  LiveSocket(PMSSensor* pmsSensor, AirQualityDisplay* airDisplay);
+  void begin();
+  void loop();
+
+  uint8_t getClientCount() const;
+  uint32_t getConnectCount() const;
+  uint32_t getRejectedCount() const;
+  uint32_t getCommandCount() const;
+  uint32_t getBytesIn() const;
+  uint32_t getBytesOut() const;
+  uint32_t getDroppedFrames() const;
+  uint32_t getLastCommandMicros() const;
+  uint32_t getMaxCommandMicros() const;
+};
+
+#endif
@@ -0,0 +1,80 @@
+#ifndef LTTB_H
+#define LTTB_H
+
+#include <stddef.h>
+
+// Largest-Triangle-Three-Buckets downsampling of points [first, first + count)
+// of a random-access source providing x(i) and y(i). Nothing is buffered: the
+// average of the following bucket is read with a second cursor, and each
+// selected point is passed to emit(index) as soon as its bucket is decided,
+// so memory use is constant and output can be streamed.
+template <typename Source, typename Emit>
+void lttbDownsample(const Source& source, size_t first, size_t count, size_t threshold, Emit emit) {
+  if (count == 0) {
+    return;
+  }
+  if (threshold >= count) {
+    for (size_t i = 0; i < count; i++) {
+      emit(first + i);
+    }
+    return;
+  }
+  if (threshold < 3) {
+    // No bucket between the ends: the ends alone, or the first point
+    if (threshold > 0) {
+      emit(first);
+    }
+    if (threshold == 2) {
+      emit(first + count - 1);
+    }
+    return;
+  }
+
+  // First and last points are always kept; the rest is split into buckets
+  float bucketSize = (float)(count - 2) / (threshold - 2);
+  size_t selected = 0;
+  emit(first);
+
+  for (size_t bucket = 0; bucket < threshold - 2; bucket++) {
+    // Average of the next bucket (the last point for the final bucket)
+    size_t nextStart = (size_t)((bucket + 1) * bucketSize) + 1;
+    size_t nextEnd = (size_t)((bucket + 2) * bucketSize) + 1;
+    if (nextEnd > count) {
+      nextEnd = count;
+    }
+    float avgX = 0;
+    float avgY = 0;
+    for (size_t i = nextStart; i < nextEnd; i++) {
+      avgX += source.x(first + i);
+      avgY += source.y(first + i);
+    }
+    size_t nextCount = nextEnd - nextStart;
+    avgX /= nextCount;
+    avgY /= nextCount;
+
+    // Point of this bucket forming the largest triangle with the previous pick
+    size_t start = (size_t)(bucket * bucketSize) + 1;
+    size_t end = (size_t)((bucket + 1) * bucketSize) + 1;
+    float ax = source.x(first + selected);
+    float ay = source.y(first + selected);
+    float maxArea = -1;
+    size_t maxIndex = start;
+    for (size_t i = start; i < end; i++) {
+      float area = (ax - avgX) * (source.y(first + i) - ay) - (ax - source.x(first + i)) * (avgY - ay);
+      if (area < 0) {
+        area = -area;
+      }
+      if (area > maxArea) {
+        maxArea = area;
+        maxIndex = i;
+      }
+    }
+
+    emit(first + maxIndex);
+    selected = maxIndex;
+  }
+
+  emit(first + count - 1);
+}
+
+#endif
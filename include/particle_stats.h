@@ -0,0 +1,38 @@
+#ifndef PARTICLE_STATS_H
+#define PARTICLE_STATS_H
+
+#include <Arduino.h>
+
+// Size bins between the PMS5003 count thresholds (0.3, 0.5, 1, 2.5, 5, 10 µm)
+#define PARTICLE_BINS 6
+
+// Effective averaging window in readings: one hour at the 30 s read period
+#define PARTICLE_STATS_WINDOW 120
+
+// Rolling size distribution. The sensor reports cumulative "larger than"
+// counts; these are split into bins, and each bin's mean and variance, and
+// the ratio of PM2.5 mass to particle count, are tracked with exponential
+// weighting. Memory and time per reading are constant, and all values are
+// ready to read between readings.
+class ParticleStats {
+private:
+  uint16_t bins[PARTICLE_BINS];     // Latest reading, per 0.1 L
+  float mean[PARTICLE_BINS];
+  float variance[PARTICLE_BINS];
+  float massRatio;                  // µg/m³ PM2.5 per 1000 particles >0.3 µm per 0.1 L
+  uint32_t count;
+
+public:
+  ParticleStats();
+  void reset();
+  void update(const uint16_t larger[PARTICLE_BINS], uint16_t pm2_5);
+
+  uint16_t getBin(uint8_t bin) const;
+  float getMean(uint8_t bin) const;
+  float getStdDev(uint8_t bin) const;
+  float getMassRatio() const;
+  uint32_t getCount() const;
+  static const char* binName(uint8_t bin);  // Size range in µm
+};
+
+#endif
@@ -0,0 +1,12 @@
+#ifndef PLATFORM_H
+#define PLATFORM_H
+
+#include <Arduino.h>
+
+// ESP8266 core names for the modules that use the chip directly (reset
+// info, RTC memory, heap figures); on the ESP32 they come from esp32/
+#ifdef ESP32
+#include "esp8266_compat.h"
+#endif
+
+#endif
@@ -0,0 +1,53 @@
+#ifndef PMS_CAPTURE_H
+#define PMS_CAPTURE_H
+
+#include <Arduino.h>
+#include <LittleFS.h>
+
+#define PMS_CAPTURE_FILE "/pms.rec"
+#define PMS_CAPTURE_MAGIC 0x31524D50UL   // "PMR1"
+
+// Stops recording at this size; one read is ~33 bytes, so about 2.5 days
+#define PMS_CAPTURE_MAX_SIZE (256UL * 1024)
+
+// Bytes kept from one read attempt; anything beyond is not recorded
+#define PMS_CAPTURE_CHUNK 64
+
+// Capture files hold the raw UART bytes of each read attempt exactly as
+// received, including corrupted and partial frames:
+//
+//   magic (4 bytes), then per read: length (1 byte), bytes (length)
+//
+// A zero-length record is a read that timed out with no data.
+class PMSRecorder {
+private:
+  File file;
+  bool recording;
+  uint32_t recordCount;
+
+public:
+  PMSRecorder();
+  bool start(const char* path);   // Truncates an existing capture
+  void stop();
+  void record(const uint8_t* bytes, uint8_t length);
+  bool isRecording() const;
+  uint32_t getRecordCount() const;
+  size_t getSize();
+};
+
+class PMSReplay {
+private:
+  File file;
+  bool open;
+  uint32_t recordCount;
+
+public:
+  PMSReplay();
+  bool start(const char* path);
+  void stop();
+  bool next(uint8_t* bytes, uint8_t& length);  // False at the end of the capture
+  bool isOpen() const;
+  uint32_t getRecordCount() const;
+};
+
+#endif
@@ -0,0 +1,66 @@
+#ifndef PMS_FRAME_H
+#define PMS_FRAME_H
+
+#include <Arduino.h>
+
+// PMS5003 data frame: 0x42 0x4D, length, 13 data words, checksum
+#define PMS_FRAME_SIZE 32
+#define PMS_FRAME_WORDS 13
+#define PMS_FRAME_LENGTH 28       // Length field of a data frame
+#define PMS_REPLY_LENGTH 4        // Length field of a command acknowledgement
+
+// Data word positions within a frame
+enum PMSFrameWord {
+  PMS_WORD_PM1_0_CF1,
+  PMS_WORD_PM2_5_CF1,
+  PMS_WORD_PM10_CF1,
+  PMS_WORD_PM1_0_ATM,
+  PMS_WORD_PM2_5_ATM,
+  PMS_WORD_PM10_ATM,
+  PMS_WORD_PARTICLES_03,
+  PMS_WORD_PARTICLES_05,
+  PMS_WORD_PARTICLES_10,
+  PMS_WORD_PARTICLES_25,
+  PMS_WORD_PARTICLES_50,
+  PMS_WORD_PARTICLES_100,
+  PMS_WORD_RESERVED
+};
+
+enum PMSFrameResult {
+  PMS_FRAME_PENDING,          // Need more bytes
+  PMS_FRAME_OK,               // getFrame() holds a new frame
+  PMS_FRAME_BAD_CHECKSUM,
+  PMS_FRAME_BAD_LENGTH
+};
+
+struct PMSFrame {
+  uint16_t words[PMS_FRAME_WORDS];
+};
+
+// Byte-at-a-time frame parser. It never blocks and keeps no more than one
+// frame, so it can be fed from the UART, a capture file or a test buffer.
+// After an error it resynchronizes on the next start sequence.
+class PMSFrameParser {
+private:
+  uint8_t buffer[PMS_FRAME_SIZE];
+  uint8_t position;
+  uint8_t expected;           // Total size of the frame being received
+  PMSFrame frame;
+  uint32_t frameCount;
+  uint32_t checksumErrors;
+  uint32_t lengthErrors;
+  uint32_t discardedBytes;
+
+  void resync();
+
+public:
+  PMSFrameParser();
+  PMSFrameResult push(uint8_t byte);
+  const PMSFrame& getFrame() const;
+  uint32_t getFrameCount() const;
+  uint32_t getChecksumErrors() const;
+  uint32_t getLengthErrors() const;
+  uint32_t getDiscardedBytes() const;
+};
+
+#endif
@@ -4,18 +4,29 @@
 #include <Arduino.h>
 #include <SoftwareSerial.h>
 #include <PMS.h>
+#include "time_sync.h"
+#include "sensor_simulator.h"
+#include "pms_frame.h"
+#include "pms_capture.h"
+#include "air_forecast.h"
+#include "particle_stats.h"
+#include "alert_state.h"
+#include "reading_channel.h"
 
 // Pin definitions for PMS5003
 #define PMS5003_RX_PIN D3  // PMS5003 TX to D3 (RX)
 #define PMS5003_TX_PIN D4  // PMS5003 RX to D4 (TX)
 
+// Longest wait for a frame after a passive-mode read request (ms)
+#define PMS_READ_TIMEOUT 1000
+
+// Readings queued for the network side; a firmware upload, which holds the
+// web server, lasts up to this many read periods without losing any
+#ifndef READING_QUEUE_LENGTH
+#define READING_QUEUE_LENGTH 8
+#endif
+
 class PMSSensor {
-private:
-  SoftwareSerial* pmsSerial;
-  PMS* pms;
-  unsigned long lastReadTime;
-  unsigned long readInterval;
-  
 public:
   // Data structure for air quality readings
   struct AirQualityData {
@@ -34,30 +45,114 @@ public:
     bool isValid;           // Data validity flag
   };
   
-  AirQualityData currentData;
-  float pm25TrendData[24];    // 24-hour PM2.5 trend
-  float vocTrendData[24];     // 24-hour VOC trend
-  float pm10TrendData[24];    // 24-hour PM10 trend
-  uint8_t trendIndex;
+  // Hourly trend as the network side sees it; see updateTrend()
+  struct TrendSnapshot {
+    uint8_t hour;             // Slot currently being filled
+    float pm25[24];
+    float voc[24];
+    float pm10[24];
+  };
+  
+  // A completed reading together with the values derived from it. A new
+  // snapshot is published once per read and never modified afterwards, so
+  // consumers can key caches on the sequence number.
+  struct ReadingSnapshot {
+    uint32_t sequence;        // Increments with every published reading; 0 = none yet
+    uint32_t time;            // Monotonic seconds at publication
+    AirQualityData data;
+    uint8_t vocIndex;
+    AirLevel level;           // Debounced, see AlertState
+    const char* healthStatus; // Wording for level
+    const char* riskLevel;
+  };
+  
+private:
+  SoftwareSerial pmsSerial;
+  PMS pms;
+  SensorSimulator simulator;    // Replaces the UART with -D SENSOR_SIMULATOR
+  PMSFrameParser parser;
+  PMSRecorder recorder;         // Raw bytes of each UART read, when enabled
+  PMSReplay replay;             // Replaces the live source while open
+  unsigned long lastReadTime;
+  unsigned long readInterval;
+  AirQualityData currentData;   // Reading being assembled by readData()
+  ReadingSnapshot snapshot;     // Last published reading, sensing side
+  Seqlock<ReadingSnapshot> shared;  // The same, for the network side
+  SpscRing<ReadingSnapshot, READING_QUEUE_LENGTH> queue;  // Every published reading, in order
+  
+  // Accumulators for the hour slot currently being filled
+  float bucketPM25Sum;
+  float bucketPM10Sum;
+  float bucketVOCSum;
+  uint16_t bucketCount;
+  uint8_t peakHour;
+  void updatePeakHour();
+  AirForecast forecast;         // PM2.5 forecast and anomalies, one update per reading
+  ParticleStats particleStats;  // Size distribution, updated at publication
+  AlertState alerts;            // Air quality level, updated at publication
+  
+  // Copies of the derived values for the network side, written wherever
+  // the sensing side updates them
+  Seqlock<TrendSnapshot> sharedTrend;
+  Seqlock<AirForecast> sharedForecast;
+  Seqlock<ParticleStats> sharedParticleStats;
+  Seqlock<AlertState> sharedAlerts;
+  void publishTrend();
+  
+  bool readLive();
+  bool readSensor();
+  bool readSimulator();
+  bool readReplay();
+  void applyFrame(const PMSFrame& frame);
+  void completeReading();
+  void publish();
+  static uint8_t computeVOCIndex(const AirQualityData& data);
+  
+public:
+  // 24-hour trends, one slot per wall-clock hour (index = hour of day)
+  float pm25TrendData[24];    // Hourly mean PM2.5
+  float vocTrendData[24];     // Hourly mean VOC
+  float pm10TrendData[24];    // Hourly mean PM10
+  uint16_t pm25TrendPeak[24]; // Hourly maximum PM2.5
+  uint8_t trendHour;          // Slot currently being filled
   bool trendInitialized;
   
   PMSSensor();
-  ~PMSSensor();
   void begin();
   bool readData();
-  void updateTrend();
-  String getHealthStatus();
-  String getRiskLevel();
+  const ReadingSnapshot& getSnapshot() const { return snapshot; }  // Sensing side only
+  ReadingSnapshot readSnapshot() const;       // Copy of the latest reading, from any side
+  bool nextReading(ReadingSnapshot& reading); // Next queued reading; one consumer only
+  uint32_t getQueuedReadings() const { return queue.size(); }
+  uint32_t getDroppedReadings() const { return queue.getDropped(); }
+  void updateTrend(uint8_t hour);
+  uint8_t getTrendPeakHour();
+  void updateForecast();
+  
+  // Derived values in place, sensing side only
+  const AirForecast& getForecast() const { return forecast; }
+  AirForecast& getForecast() { return forecast; }
+  const ParticleStats& getParticleStats() const { return particleStats; }
+  const AlertState& getAlerts() const { return alerts; }
+  AlertState& getAlerts() { return alerts; }
+  
+  // Copies of the same, from any side
+  TrendSnapshot readTrend() const;
+  AirForecast readForecast() const;
+  ParticleStats readParticleStats() const;
+  AlertState readAlerts() const;
+  uint32_t getDerivedWrites() const;  // Changes whenever any of the copies does
+  const char* getHealthStatus();
+  const char* getRiskLevel();
   uint8_t getVOCIndex();
   void printData();
   bool isDataValid();
   unsigned long getLastReadTime();
-  
-  // Demo data methods for when sensor is not available
-  float getDemoPM25();
-  float getDemoPM10();
-  String getDemoHealthStatus();
-  String getDemoRiskLevel();
+  bool ingest(uint8_t byte);    // Feeds the parser directly; true when a reading was published
+  SensorSimulator& getSimulator() { return simulator; }
+  const PMSFrameParser& getParser() const { return parser; }
+  PMSRecorder& getRecorder() { return recorder; }
+  PMSReplay& getReplay() { return replay; }
 };
 
 #endif
\ No newline at end of file
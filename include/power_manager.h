@@ -0,0 +1,106 @@
+#ifndef POWER_MANAGER_H
+#define POWER_MANAGER_H
+
+#include <Arduino.h>
+#include <ESP8266WiFi.h>
+#include <atomic>
+
+enum PowerProfile {
+  POWER_PERFORMANCE,   // Radio always on, short idle: lowest latency
+  POWER_BALANCED,      // Modem sleep between beacons
+  POWER_ECO,           // Automatic light sleep, one-second idle, slow display refresh
+  POWER_PROFILE_COUNT
+};
+
+// Profile at boot; /debug/power?profile=<name> switches it at runtime
+#ifndef POWER_PROFILE
+#define POWER_PROFILE POWER_BALANCED
+#endif
+
+// Beacon intervals between wake-ups in light sleep. Takes effect at the
+// next association.
+#ifndef POWER_LISTEN_INTERVAL
+#define POWER_LISTEN_INTERVAL 3
+#endif
+
+// Optional pin whose falling edge ends an idle wait, e.g. a push button
+// #define POWER_WAKE_PIN D6
+
+// Wake sources are checked this often while idle
+#define POWER_IDLE_SLICE_MS 5
+
+// Current estimates for the average-current figure, mA. Datasheet values
+// for the ESP8266 plus the board's regulator and OLED; measure the board
+// with a meter for absolute numbers; these are for comparing profiles.
+#define POWER_ACTIVE_MA 80
+#define POWER_IDLE_RADIO_ON_MA 70
+#define POWER_IDLE_MODEM_SLEEP_MA 20
+#define POWER_IDLE_LIGHT_SLEEP_MA 5        // Includes the beacon wake-ups
+
+// Request latency histogram: bucket i counts requests under 4 << i ms
+#define POWER_LATENCY_BUCKETS 12
+
+struct PowerProfileConfig {
+  const char* name;
+  WiFiSleepType_t sleepType;
+  uint8_t listenInterval;                  // 0 = every DTIM beacon
+  uint16_t maxIdleMs;                      // Longest wait between loop() iterations
+  uint16_t displayIntervalMs;
+  uint16_t idleMilliamps;
+};
+
+// Idles the CPU between loop() iterations for as long as nothing is due,
+// up to the profile's limit, and sets the WiFi sleep mode so the SDK can
+// power down the radio, or the CPU as well, while it waits. The wait ends
+// early when the wake check reports a pending request or the wake pin
+// fires. The PMS5003 runs in passive mode and only talks when asked, so
+// the sensor needs no UART wake-up. Time spent idle and the latency of
+// each request are recorded per profile, to weigh the saving against the
+// delay clients see.
+class PowerManager {
+private:
+  std::atomic<PowerProfile> profile;  // Switched on the network side, read by the display
+  std::function<bool()> wakeCheck;
+  unsigned long statsStart;
+  uint64_t idleMicros;
+  uint32_t lastIdleMs;
+  uint32_t idleCount;
+  uint32_t networkWakes;
+  uint32_t pinWakes;
+  uint32_t latencyHistogram[POWER_LATENCY_BUCKETS];
+  uint32_t requestCount;
+  uint32_t maxLatencyMs;
+
+  void applySleepMode();
+
+public:
+  PowerManager();
+  void begin();                            // Before WiFi is started
+  void setWakeCheck(std::function<bool()> check);
+  void idle(uint32_t windowMs);            // windowMs: time until the next timer is due
+  void noteRequest(uint32_t latencyMs);
+  void setProfile(PowerProfile newProfile);  // Also resets the statistics
+  void resetStats();
+
+  PowerProfile getProfile() const;
+  const PowerProfileConfig& getConfig() const;
+  uint32_t getDisplayInterval() const;
+  uint32_t getLastIdle() const;            // ms, the most recent wait
+  uint32_t getStatsMillis() const;         // Since the statistics were reset
+  uint32_t getIdleMillis() const;
+  uint32_t getIdleCount() const;
+  uint32_t getNetworkWakes() const;
+  uint32_t getPinWakes() const;
+  float getAverageMilliamps() const;       // Estimate, see POWER_ACTIVE_MA
+  uint32_t getRequestCount() const;
+  uint32_t getMaxLatency() const;
+  uint32_t getLatencyHistogram(uint8_t bucket) const;
+  static uint32_t getLatencyBucketLimit(uint8_t bucket);  // Exclusive upper bound in ms
+  uint32_t getLatencyPercentile(uint8_t percent) const;   // Upper bound of the bucket holding it
+  static const PowerProfileConfig& getProfileConfig(PowerProfile profile);
+  static bool parseProfile(const char* name, PowerProfile& profile);
+};
+
+extern PowerManager powerManager;
+
+#endif
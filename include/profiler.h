@@ -0,0 +1,95 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <Arduino.h>
+
+// Loop profiling is compiled in only with -D ENABLE_PROFILER; otherwise the
+// macros below expand to nothing and this module adds no code or RAM.
+#ifdef ENABLE_PROFILER
+
+// Spans are timed on one loop(); on the ESP32 the work is split across cores
+#ifdef ESP32
+#error "ENABLE_PROFILER is for the single-core ESP8266 build"
+#endif
+
+// Histogram bucket i counts iterations shorter than 512 << i µs
+#define PROFILER_BUCKETS 16
+#define PROFILER_SLOWEST 8
+
+enum ProfileSpan {
+  SPAN_WEB,          // webServer.handleClient()
+  SPAN_TIME_SYNC,
+  SPAN_SENSOR,       // Read, trend and forecast update
+  SPAN_ALERTS,       // checkAirQualityAlerts() per queued reading, with its blocking blinks
+  SPAN_HEAP,
+  SPAN_DISPLAY,
+  PROFILE_SPAN_COUNT
+};
+
+class Profiler {
+public:
+  // One loop() iteration with its time per span
+  struct Iteration {
+    uint32_t uptime;                        // ms at the end of the iteration
+    uint32_t totalMicros;
+    uint32_t spanMicros[PROFILE_SPAN_COUNT];
+  };
+
+private:
+  uint32_t loopStart;                       // Cycle count at beginLoop()
+  uint32_t spanCycles[PROFILE_SPAN_COUNT];  // Current iteration
+  uint32_t histogram[PROFILER_BUCKETS];
+  uint32_t iterations;
+  uint32_t maxMicros;
+  uint64_t spanTotalMicros[PROFILE_SPAN_COUNT];
+  uint32_t spanMaxMicros[PROFILE_SPAN_COUNT];
+  Iteration slowest[PROFILER_SLOWEST];      // Unordered; the fastest entry is replaced
+  uint8_t slowestCount;
+
+public:
+  Profiler();
+  void beginLoop();
+  void endLoop();
+  void addSpan(ProfileSpan span, uint32_t cycles) { spanCycles[span] += cycles; }
+
+  uint32_t getIterations() const;
+  uint32_t getMaxMicros() const;
+  uint32_t getHistogram(uint8_t bucket) const;
+  static uint32_t getBucketLimit(uint8_t bucket);  // Exclusive upper bound in µs
+  uint32_t getPercentile(uint8_t percent) const;   // Upper bound of the bucket holding it
+  uint64_t getSpanTotalMicros(ProfileSpan span) const;
+  uint32_t getSpanMaxMicros(ProfileSpan span) const;
+  uint8_t getSlowestCount() const;
+  const Iteration& getSlowest(uint8_t index) const;
+  static const char* spanName(ProfileSpan span);
+};
+
+extern Profiler loopProfiler;
+
+// Charges the enclosing scope to a span. Spans are inclusive, so a span
+// nested in another is counted in both.
+class ProfileScope {
+private:
+  ProfileSpan span;
+  uint32_t start;
+
+public:
+  ProfileScope(ProfileSpan profileSpan) : span(profileSpan), start(ESP.getCycleCount()) {}
+  ~ProfileScope() { loopProfiler.addSpan(span, ESP.getCycleCount() - start); }
+};
+
+#define PROFILE_CONCAT_(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_(a, b)
+#define PROFILE_SPAN(span) ProfileScope PROFILE_CONCAT(profileScope, __LINE__)(span)
+#define PROFILE_LOOP_BEGIN() loopProfiler.beginLoop()
+#define PROFILE_LOOP_END() loopProfiler.endLoop()
+
+#else
+
+#define PROFILE_SPAN(span)
+#define PROFILE_LOOP_BEGIN()
+#define PROFILE_LOOP_END()
+
+#endif
+
+#endif
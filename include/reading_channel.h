@@ -0,0 +1,114 @@
+#ifndef READING_CHANNEL_H
+#define READING_CHANNEL_H
+
+#include <stdint.h>
+#include <string.h>
+#include <atomic>
+#include <type_traits>
+
+// Handoff between the sensing side (sensor, derived values, display) and
+// the network side (web server, WebSocket, peers, history). Both classes
+// are lock-free with one writer, need no RTOS primitives and only use
+// 32-bit atomic loads and stores, so the same code runs single-core on the
+// ESP8266 and across cores or host threads.
+
+// Fixed-size queue for one producer and one consumer. Each index is written
+// by one side only; a full queue drops the new item and counts it, so the
+// producer never waits on the consumer.
+template <typename T, uint8_t N>
+class SpscRing {
+  static_assert((N & (N - 1)) == 0, "SpscRing size must be a power of two");
+
+private:
+  T slots[N];
+  std::atomic<uint32_t> head;       // Next slot written, producer only
+  std::atomic<uint32_t> tail;       // Next slot read, consumer only
+  std::atomic<uint32_t> dropped;    // Producer only
+
+public:
+  SpscRing() : head(0), tail(0), dropped(0) {}
+
+  bool push(const T& item) {
+    uint32_t h = head.load(std::memory_order_relaxed);
+    if (h - tail.load(std::memory_order_acquire) == N) {
+      dropped.store(dropped.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+      return false;
+    }
+    slots[h % N] = item;
+    head.store(h + 1, std::memory_order_release);
+    return true;
+  }
+
+  bool pop(T& item) {
+    uint32_t t = tail.load(std::memory_order_relaxed);
+    if (head.load(std::memory_order_acquire) == t) {
+      return false;
+    }
+    item = slots[t % N];
+    tail.store(t + 1, std::memory_order_release);
+    return true;
+  }
+
+  uint32_t size() const {
+    return head.load(std::memory_order_acquire) - tail.load(std::memory_order_acquire);
+  }
+  uint32_t getDropped() const { return dropped.load(std::memory_order_relaxed); }
+  static uint8_t capacity() { return N; }
+};
+
+// Latest value of T for one writer and any number of readers. The writer
+// never waits; a reader that overlaps a write copies again. The value is
+// held as atomic words, so a torn copy is discarded rather than being a
+// data race. Release stores and acquire loads on the words keep them
+// inside the sequence checks without fences.
+template <typename T>
+class Seqlock {
+  static_assert(std::is_trivially_copyable<T>::value, "Seqlock value must be trivially copyable");
+
+private:
+  static const size_t WORDS = (sizeof(T) + 3) / 4;
+  std::atomic<uint32_t> sequence;   // Odd while a write is in progress
+  std::atomic<uint32_t> words[WORDS];
+
+public:
+  Seqlock() : sequence(0) {
+    for (size_t i = 0; i < WORDS; i++) {
+      words[i].store(0, std::memory_order_relaxed);
+    }
+  }
+
+  void write(const T& value) {
+    uint32_t buffer[WORDS] = {};
+    memcpy(buffer, &value, sizeof(T));
+    uint32_t s = sequence.load(std::memory_order_relaxed);
+    sequence.store(s + 1, std::memory_order_relaxed);
+    for (size_t i = 0; i < WORDS; i++) {
+      words[i].store(buffer[i], std::memory_order_release);
+    }
+    sequence.store(s + 2, std::memory_order_release);
+  }
+
+  // Returns the number of copies discarded because a write overlapped
+  uint32_t read(T& value) const {
+    uint32_t buffer[WORDS];
+    uint32_t retries = 0;
+    while (true) {
+      uint32_t before = sequence.load(std::memory_order_acquire);
+      if ((before & 1) == 0) {
+        for (size_t i = 0; i < WORDS; i++) {
+          buffer[i] = words[i].load(std::memory_order_acquire);
+        }
+        if (sequence.load(std::memory_order_relaxed) == before) {
+          break;
+        }
+      }
+      retries++;
+    }
+    memcpy(&value, buffer, sizeof(T));
+    return retries;
+  }
+
+  uint32_t getWriteCount() const { return sequence.load(std::memory_order_relaxed) / 2; }
+};
+
+#endif
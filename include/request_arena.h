@@ -0,0 +1,43 @@
+#ifndef REQUEST_ARENA_H
+#define REQUEST_ARENA_H
+
+#include <Arduino.h>
+
+// Size of the per-request scratch memory used by the web handlers
+#ifndef REQUEST_ARENA_SIZE
+#define REQUEST_ARENA_SIZE 3072
+#endif
+
+// Bump allocator for short-lived request data. Everything handed out is
+// released at once by reset() after the response has been sent, so the
+// handlers never touch the heap and cannot fragment it.
+class RequestArena {
+private:
+  uint8_t buffer[REQUEST_ARENA_SIZE];
+  size_t used;
+  size_t highWater;
+  size_t textStart;
+  size_t textLength;
+  bool textOpen;
+  uint32_t overflows;
+
+public:
+  RequestArena();
+  void* allocate(size_t size);
+  char* printf(const char* format, ...) __attribute__((format(printf, 2, 3)));
+
+  // Growable text at the top of the arena; only one may be open at a time
+  void beginText();
+  bool appendf(const char* format, ...) __attribute__((format(printf, 2, 3)));
+  bool append(const char* str);
+  const char* text() const;
+  size_t getTextLength() const;
+
+  void reset();
+  size_t getUsed() const;
+  size_t getCapacity() const;
+  size_t getHighWater() const;
+  uint32_t getOverflowCount() const;
+};
+
+#endif
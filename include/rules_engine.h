@@ -0,0 +1,94 @@
+#ifndef RULES_ENGINE_H
+#define RULES_ENGINE_H
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include "pms_sensor.h"
+#include "sensor_history.h"
+
+#define RULES_FILE "/rules.bin"
+#define RULES_MAGIC 0x31524B4AUL     // "JKR1"
+#define RULES_MAX 16
+#define RULES_MAX_CONDITIONS 8
+#define RULES_PROGRAM_SIZE 512
+#define RULES_JSON_CAPACITY 1536     // Parse buffer for a posted ruleset
+
+enum RuleOperator {
+  RULE_ABOVE,
+  RULE_BELOW
+};
+
+enum RuleTarget {
+  RULE_TARGET_LED,                   // Value 0 or 1
+  RULE_TARGET_SERVO                  // Angle 0-180
+};
+
+struct RuleCondition {
+  uint8_t metric;                    // HistoryMetric
+  uint8_t op;                        // RuleOperator
+  int16_t threshold;
+  uint16_t hysteresis;               // Margin past the threshold needed to clear
+};
+
+struct RuleAction {
+  uint8_t target;                    // RuleTarget
+  int16_t value;
+};
+
+struct RuleState {
+  bool active;
+  bool changing;                     // Condition differs from state; hold running
+  uint32_t changeSince;              // Reading time the difference started
+  uint32_t transitions;
+  uint32_t evaluationCycles;         // Last evaluation, excluding actions
+};
+
+// User-defined automation, e.g. "if pm25 > 35 for 300 s then servo 90 and
+// LED on". Rules arrive as JSON and are compiled once into a packed program:
+//
+//   per rule: hold (u16 s), conditions (u8), then-actions (u8), else-actions (u8)
+//             conditions x { metric u8, operator u8, threshold i16, hysteresis u16 }
+//             actions    x { target u8, value i16 }
+//
+// all little-endian. That program is what is stored on flash and loaded at
+// boot, and it is interpreted once per new reading. A rule turns active
+// when all its conditions have held for the hold time, running its then
+// actions, and inactive when any condition has cleared its hysteresis band
+// for the hold time, running its else actions. Later rules win when several
+// drive the same actuator.
+class RulesEngine {
+private:
+  uint8_t program[RULES_PROGRAM_SIZE];
+  uint16_t programLength;
+  uint8_t ruleCount;
+  uint16_t ruleOffset[RULES_MAX];
+  RuleState states[RULES_MAX];
+  uint32_t lastSequence;
+  uint32_t evaluationCount;
+
+  bool load(const uint8_t* code, uint16_t length);
+  bool save();
+  static bool compileActions(JsonObjectConst actions, uint8_t* code, uint16_t& length, uint8_t& count,
+                             char* error, size_t errorSize, uint8_t rule);
+  static void runAction(const RuleAction& action);
+
+public:
+  RulesEngine();
+  void begin();                      // Loads the stored program
+  bool compile(JsonArrayConst rules, char* error, size_t errorSize);
+  void evaluate(const PMSSensor::ReadingSnapshot& reading);
+
+  uint8_t getRuleCount() const;
+  uint16_t getProgramLength() const;
+  uint32_t getEvaluationCount() const;
+  uint16_t getHold(uint8_t rule) const;
+  uint8_t getConditionCount(uint8_t rule) const;
+  RuleCondition getCondition(uint8_t rule, uint8_t index) const;
+  uint8_t getActionCount(uint8_t rule, bool onActivate) const;
+  RuleAction getAction(uint8_t rule, bool onActivate, uint8_t index) const;
+  const RuleState& getState(uint8_t rule) const;
+  bool drives(uint8_t target) const;  // Some rule has an action on the target
+  static const char* targetName(uint8_t target);
+};
+
+#endif
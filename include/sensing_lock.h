@@ -0,0 +1,25 @@
+#ifndef SENSING_LOCK_H
+#define SENSING_LOCK_H
+
+#include <Arduino.h>
+
+// Readings and the values derived from them reach the network side through
+// the channels in reading_channel.h and never wait. The handlers that reach
+// into the sensing side itself (display mirror, capture and replay control,
+// simulator) hold this lock while they do. On the ESP32 the sensing task
+// holds it for each pass; on the ESP8266 both sides run in loop() and it
+// does nothing.
+class SensingLock {
+private:
+  bool held;
+
+public:
+  explicit SensingLock(bool wait = true);  // Without wait, gives up if the sensing side has it
+  ~SensingLock();
+  SensingLock(const SensingLock&) = delete;
+  SensingLock& operator=(const SensingLock&) = delete;
+  bool isHeld() const { return held; }
+  static void begin();
+};
+
+#endif
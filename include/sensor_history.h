@@ -0,0 +1,45 @@
+#ifndef SENSOR_HISTORY_H
+#define SENSOR_HISTORY_H
+
+#include <Arduino.h>
+#include "pms_sensor.h"
+
+// One entry per sensor reading (30 s), about three hours in RAM
+#define HISTORY_CAPACITY 360
+
+enum HistoryMetric {
+  METRIC_PM1_0,
+  METRIC_PM2_5,
+  METRIC_PM10,
+  METRIC_VOC
+};
+
+struct HistorySample {
+  uint32_t time;      // Monotonic seconds since boot; TimeSync maps it to epoch
+  uint16_t pm1_0;     // µg/m³
+  uint16_t pm2_5;     // µg/m³
+  uint16_t pm10;      // µg/m³
+  uint8_t vocIndex;
+  uint8_t reserved;
+};
+
+// Time-ordered ring of past readings; the oldest entry is overwritten
+class SensorHistory {
+private:
+  HistorySample samples[HISTORY_CAPACITY];
+  uint16_t head;
+  uint16_t count;
+
+public:
+  SensorHistory();
+  void add(const PMSSensor::ReadingSnapshot& reading);
+  uint16_t size() const;
+  const HistorySample& at(uint16_t index) const;  // 0 = oldest
+  uint16_t lowerBound(uint32_t time) const;       // First index with sample time >= time
+
+  static bool parseMetric(const char* name, HistoryMetric& metric);
+  static const char* metricName(HistoryMetric metric);
+  static float value(const HistorySample& sample, HistoryMetric metric);
+};
+
+#endif
@@ -0,0 +1,76 @@
+#ifndef SENSOR_SIMULATOR_H
+#define SENSOR_SIMULATOR_H
+
+#include <Arduino.h>
+
+// Readings within one step share their noise, like a real 30 s read
+#define SIM_SAMPLE_PERIOD 30
+
+#ifndef SIM_SEED
+#define SIM_SEED 0x4A4B0001UL
+#endif
+
+// Scenario replayed by the simulator, e.g. -D SIM_SCENARIO=SIM_WILDFIRE_DAY
+#ifndef SIM_SCENARIO
+#define SIM_SCENARIO SIM_NORMAL
+#endif
+
+enum SimScenario {
+  SIM_NORMAL,          // Clean indoor air with a daily swing
+  SIM_COOKING_SPIKE,   // Breakfast, lunch and dinner plumes
+  SIM_WILDFIRE_DAY,    // Smoke infiltrating from morning to evening
+  SIM_SENSOR_DROPOUT   // Normal air with periods of failed reads
+};
+
+enum SimEventKind {
+  SIM_EVENT_PLUME,     // Fast rise followed by exponential decay
+  SIM_EVENT_PLATEAU,   // Ramp up, hold, ramp down
+  SIM_EVENT_DROPOUT    // No valid frames from the sensor
+};
+
+// One scripted event; scripts repeat every simulated day
+struct SimEvent {
+  uint32_t start;      // Seconds after midnight
+  uint32_t duration;   // Seconds
+  SimEventKind kind;
+  float pm25;          // Added PM2.5 at full strength (µg/m³)
+  float voc;           // Added VOC index at full strength
+  float coarseRatio;   // PM10/PM2.5 of the added particles
+};
+
+struct SimSample {
+  float pm1_0;         // µg/m³
+  float pm2_5;         // µg/m³
+  float pm10;          // µg/m³
+  float vocIndex;
+  float counts[6];     // Particles larger than 0.3, 0.5, 1, 2.5, 5 and 10 µm per 0.1 L
+  bool isValid;        // False during a scripted dropout
+};
+
+// Deterministic stand-in for the PMS5003. A reading is a pure function of
+// seed, scenario and time: noise comes from hashing the seed with the sample
+// step instead of from a stateful generator, so runs are reproducible and
+// every value derived for one instant comes from the same sample.
+class SensorSimulator {
+private:
+  uint32_t seed;
+  SimScenario scenario;
+  const SimEvent* events;
+  uint8_t eventCount;
+
+  uint32_t hash(uint32_t step, uint8_t stream) const;
+  float noise(uint32_t step, uint8_t stream) const;  // Uniform in [-1, 1]
+
+public:
+  SensorSimulator(uint32_t seed = SIM_SEED, SimScenario scenario = SIM_SCENARIO);
+  void setSeed(uint32_t newSeed);
+  void setScenario(SimScenario newScenario);
+  uint32_t getSeed() const;
+  SimScenario getScenario() const;
+  SimSample sample(uint32_t time) const;  // time in seconds; 0 = midnight
+
+  static bool parseScenario(const char* name, SimScenario& scenario);
+  static const char* scenarioName(SimScenario scenario);
+};
+
+#endif
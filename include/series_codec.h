@@ -0,0 +1,51 @@
+#ifndef SERIES_CODEC_H
+#define SERIES_CODEC_H
+
+#include <Arduino.h>
+#include "sensor_history.h"
+
+// Longest encoding of one sample: control byte, 5-byte time, 4 values
+#define SERIES_MAX_SAMPLE_SIZE 21
+
+// Streaming codec for HistorySample series. Each sample is a control byte
+// whose bits flag which fields changed, followed by zig-zag varints for just
+// those fields: the delta-of-delta of the timestamp (bit 0) and the deltas
+// of PM1.0, PM2.5, PM10 and VOC (bits 1-4). The first sample is stored
+// against zero with its time as a plain varint. At a steady sample rate the
+// time costs nothing and slowly changing air takes 2-3 bytes per sample.
+class SeriesEncoder {
+private:
+  uint8_t* buffer;
+  size_t capacity;
+  size_t length;
+  uint16_t count;
+  HistorySample previous;
+  int32_t previousDelta;
+
+public:
+  SeriesEncoder();
+  void begin(uint8_t* output, size_t size);
+  bool append(const HistorySample& sample);  // False, leaving the output untouched, when full
+  size_t getLength() const;
+  uint16_t getCount() const;
+};
+
+class SeriesDecoder {
+private:
+  const uint8_t* buffer;
+  size_t length;
+  size_t position;
+  uint16_t remaining;
+  HistorySample previous;
+  int32_t previousDelta;
+  bool first;
+
+  bool readVarint(uint32_t& value);
+
+public:
+  SeriesDecoder();
+  void begin(const uint8_t* input, size_t size, uint16_t count);
+  bool next(HistorySample& sample);         // False at the end or on corrupt input
+};
+
+#endif
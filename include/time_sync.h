@@ -0,0 +1,72 @@
+#ifndef TIME_SYNC_H
+#define TIME_SYNC_H
+
+#include <Arduino.h>
+#include <time.h>
+#include "reading_channel.h"
+
+// POSIX TZ string for wall-clock hours, e.g. "<+0545>-5:45" for Nepal
+#ifndef TIME_ZONE
+#define TIME_ZONE "UTC0"
+#endif
+
+#ifndef NTP_PRIMARY_SERVER
+#define NTP_PRIMARY_SERVER "pool.ntp.org"
+#endif
+
+// Local stand-in used when the pool is unreachable. Defaults to the
+// gateway, which on most home routers also answers NTP.
+// #define NTP_FALLBACK_SERVER "192.168.1.1"
+
+// Virtual-time multiplier for the monotonic clock in simulator builds.
+// Anything other than 1 replaces SNTP with a fixed start epoch.
+#ifndef SIM_TIME_SCALE
+#define SIM_TIME_SCALE 1
+#endif
+
+// Epoch of monotonic time zero when time is simulated (2026-01-01 00:00 UTC)
+#ifndef SIM_START_EPOCH
+#define SIM_START_EPOCH 1767225600LL
+#endif
+
+// Anything earlier means SNTP has not set the clock yet
+#define TIME_VALID_AFTER 1600000000UL
+
+// Maps the monotonic uptime clock onto wall-clock time. Readings are stamped
+// with monotonic time, which never steps, and converted to epoch seconds
+// through a single anchor that is updated whenever SNTP corrects the clock.
+// Samples taken before the first sync therefore get correct wall-clock
+// times as soon as it happens.
+class TimeSync {
+private:
+  struct Anchor {
+    int64_t epochOffset;    // Epoch seconds at monotonic time zero
+    bool synced;
+  };
+
+  char fallbackServer[16];
+  bool configured;
+  bool synced;
+  int64_t epochOffset;
+  Seqlock<Anchor> anchor;   // The two above, for hourOf() on the sensing side
+  uint32_t syncCount;
+  unsigned long lastCheck;
+
+  void publish();
+
+public:
+  TimeSync();
+  void update();
+  bool isSynced();
+  uint32_t getSyncCount();
+
+  static uint64_t monotonicMillis();
+  static uint32_t monotonicSeconds();
+
+  uint32_t toEpoch(uint32_t monotonicSecs);  // 0 until synced
+  uint32_t toMonotonic(uint32_t epoch);       // Clamped to the uptime range
+  uint32_t now();
+  uint8_t hourOf(uint32_t monotonicSecs);     // Local hour, or uptime hour when unsynced
+};
+
+#endif
@@ -0,0 +1,319 @@
+#ifndef WEB_PAGES_H
+#define WEB_PAGES_H
+
+#include <Arduino.h>
+
+// Static page content lives in flash and is streamed from there, so serving
+// a page never builds the markup on the heap. Only the live values are
+// formatted per request.
+
+// Dashboard: styles and header, up to the status cards
+static const char ROOT_PAGE_HEAD[] PROGMEM = R"rawliteral(<!DOCTYPE html><html><head>
+<title>Smart Home Dashboard</title>
+<meta charset='UTF-8'>
+<meta name='viewport' content='width=device-width, initial-scale=1'>
+<style>
+* { margin: 0; padding: 0; box-sizing: border-box; }
+body { font-family: 'Segoe UI', Arial, sans-serif; background: linear-gradient(135deg, #667eea 0%, #764ba2 100%); min-height: 100vh; padding: 20px; }
+.container { max-width: 900px; margin: 0 auto; background: white; padding: 30px; border-radius: 15px; box-shadow: 0 10px 30px rgba(0,0,0,0.2); }
+.header { text-align: center; margin-bottom: 30px; }
+.header h1 { color: #2c3e50; font-size: 2.2em; margin-bottom: 8px; }
+.header p { color: #7f8c8d; font-size: 1em; }
+.status-grid { display: grid; grid-template-columns: repeat(auto-fit, minmax(200px, 1fr)); gap: 20px; margin: 25px 0; }
+.status-card { background: linear-gradient(135deg, #667eea 0%, #764ba2 100%); color: white; padding: 20px; border-radius: 12px; text-align: center; box-shadow: 0 4px 15px rgba(102,126,234,0.3); }
+.status-card.air { background: linear-gradient(135deg, #4CAF50 0%, #45a049 100%); }
+.status-card h3 { font-size: 0.95em; opacity: 0.9; margin-bottom: 10px; font-weight: 500; }
+.status-card .value { font-size: 1.8em; font-weight: bold; margin: 8px 0; }
+.status-card .unit { font-size: 0.85em; opacity: 0.85; }
+.controls { margin: 30px 0; }
+.btn { display: block; width: 100%; padding: 16px; margin: 12px 0; background: linear-gradient(135deg, #667eea 0%, #764ba2 100%); color: white; text-decoration: none; border-radius: 10px; text-align: center; font-size: 1.05em; font-weight: 500; border: none; cursor: pointer; transition: all 0.3s ease; }
+.btn:hover { transform: translateY(-2px); box-shadow: 0 6px 20px rgba(102,126,234,0.4); }
+.btn.action { background: linear-gradient(135deg, #f093fb 0%, #f5576c 100%); }
+.system-info { background: #f8f9fa; padding: 15px; border-radius: 8px; margin-top: 25px; text-align: center; color: #6c757d; font-size: 0.85em; }
+</style></head><body>
+<div class='container'>
+<div class='header'>
+<h1>🏠 Smart Home Hub</h1>
+<p>Environmental Monitoring & Control</p>
+</div>
+<div class='status-grid'>)rawliteral";
+
+// Dashboard: closes the status grid and adds the control buttons
+static const char ROOT_PAGE_CONTROLS[] PROGMEM = R"rawliteral(</div>
+<div class='controls'>
+<a href='/airquality' class='btn'>🌬️ Air Quality Dashboard</a>
+<button onclick='toggleLED()' class='btn action'>💡 Toggle LED</button>
+<button onclick='toggleDoor()' class='btn action'>🚪 Toggle Door</button>
+</div>)rawliteral";
+
+// Dashboard: control scripts; doorAction is emitted with the live values.
+// Controls go over the WebSocket while it is open, and fall back to a
+// request and reload otherwise. Each command's id comes back in its
+// acknowledgement, which times the click-to-servo round trip.
+static const char ROOT_PAGE_SCRIPT[] PROGMEM = R"rawliteral(let ws, nextId = 1, sent = {};
+function connect() {
+  ws = new WebSocket('ws://' + location.hostname + ':81/ws');
+  ws.binaryType = 'arraybuffer';
+  ws.onmessage = (e) => {
+    let v = new DataView(e.data);
+    if (v.getUint8(0) == 0x81) {
+      let servo = v.getUint8(2), id = v.getUint16(3, true);
+      document.getElementById('led').textContent = v.getUint8(1) ? 'ON' : 'OFF';
+      document.getElementById('door').textContent = servo == 90 ? 'Open' : 'Closed';
+      doorAction = servo == 90 ? 'close' : 'open';
+      if (sent[id]) {
+        document.getElementById('live').textContent = '| Last click: ' + (performance.now() - sent[id]).toFixed(0) + ' ms';
+        delete sent[id];
+      }
+    } else if (v.getUint8(0) == 0x82) {
+      let pm25 = document.getElementById('pm25');
+      if (pm25) pm25.textContent = 'PM2.5: ' + v.getUint16(7, true).toFixed(1) + ' μg/m³';
+    }
+  };
+  ws.onclose = () => setTimeout(connect, 5000);
+}
+function command(op, value) {
+  let id = nextId;
+  nextId = nextId % 65535 + 1;
+  sent[id] = performance.now();
+  ws.send(new Uint8Array([op, value, id & 0xFF, id >> 8]));
+}
+function toggleLED() {
+  if (ws.readyState == WebSocket.OPEN) { command(1, 2); return; }
+  fetch('/led/toggle').then(() => setTimeout(() => location.reload(), 300));
+}
+function toggleDoor() {
+  let action = doorAction;
+  if (ws.readyState == WebSocket.OPEN) { command(2, action == 'open' ? 90 : 0); return; }
+  fetch('/servo/' + action).then(() => setTimeout(() => location.reload(), 300));
+}
+connect();
+</script>
+</body></html>)rawliteral";
+
+// Air quality dashboard with charts
+static const char AIR_QUALITY_PAGE[] PROGMEM = R"rawliteral(<!DOCTYPE html><html><head>
+<title>JunKiri - Air Quality Monitor</title>
+<meta charset='UTF-8'>
+<meta name='viewport' content='width=device-width, initial-scale=1'>
+<style>
+* { margin: 0; padding: 0; box-sizing: border-box; }
+body { font-family: 'Segoe UI', Arial, sans-serif; background: linear-gradient(135deg, #1e3c72 0%, #2a5298 100%); min-height: 100vh; padding: 20px; color: #333; overflow-x: hidden; position: relative; }
+.firefly { position: absolute; width: 4px; height: 4px; background: #ffeb3b; border-radius: 50%; animation: fly linear infinite; opacity: 0.8; }
+.firefly:nth-child(1) { left: 10%; animation-duration: 12s; animation-delay: 0s; }
+.firefly:nth-child(2) { left: 20%; animation-duration: 15s; animation-delay: 1s; }
+.firefly:nth-child(3) { left: 30%; animation-duration: 10s; animation-delay: 2s; }
+.firefly:nth-child(4) { left: 40%; animation-duration: 18s; animation-delay: 0.5s; }
+.firefly:nth-child(5) { left: 50%; animation-duration: 14s; animation-delay: 1.5s; }
+.firefly:nth-child(6) { left: 60%; animation-duration: 16s; animation-delay: 2.5s; }
+.firefly:nth-child(7) { left: 70%; animation-duration: 11s; animation-delay: 0.8s; }
+.firefly:nth-child(8) { left: 80%; animation-duration: 13s; animation-delay: 1.8s; }
+.firefly:nth-child(9) { left: 90%; animation-duration: 17s; animation-delay: 2.2s; }
+.firefly:nth-child(10) { left: 5%; animation-duration: 19s; animation-delay: 3s; }
+@keyframes fly { 0% { transform: translateY(100vh) translateX(0px); opacity: 0; } 10% { opacity: 1; } 90% { opacity: 1; } 100% { transform: translateY(-10vh) translateX(50px); opacity: 0; } }
+.container { max-width: 1400px; margin: 0 auto; position: relative; z-index: 10; }
+.back-btn { display: inline-block; padding: 12px 24px; background: rgba(255,255,255,0.2); color: white; text-decoration: none; border-radius: 25px; font-weight: 500; margin-bottom: 20px; transition: all 0.3s; backdrop-filter: blur(10px); }
+.back-btn:hover { background: rgba(255,255,255,0.3); transform: translateY(-2px); }
+.header { background: rgba(255,255,255,0.95); padding: 30px; border-radius: 20px; text-align: center; margin-bottom: 25px; box-shadow: 0 8px 32px rgba(0,0,0,0.1); backdrop-filter: blur(10px); }
+.header h1 { background: linear-gradient(45deg, #667eea, #764ba2); -webkit-background-clip: text; -webkit-text-fill-color: transparent; font-size: 2.5em; margin-bottom: 10px; font-weight: 700; }
+.header p { color: #666; font-size: 1.1em; }
+.status-banner { padding: 25px; margin: 25px 0; border-radius: 15px; text-align: center; color: white; font-weight: 600; font-size: 1.2em; box-shadow: 0 4px 16px rgba(0,0,0,0.2); }
+.status-excellent { background: linear-gradient(135deg, #4CAF50 0%, #45a049 100%); }
+.status-good { background: linear-gradient(135deg, #ff9800 0%, #f57c00 100%); }
+.status-moderate { background: linear-gradient(135deg, #f44336 0%, #d32f2f 100%); }
+.status-unhealthy { background: linear-gradient(135deg, #9c27b0 0%, #7b1fa2 100%); }
+.metrics-grid { display: grid; grid-template-columns: repeat(auto-fit, minmax(250px, 1fr)); gap: 20px; margin: 25px 0; }
+.metric-card { background: rgba(255,255,255,0.95); padding: 25px; border-radius: 15px; text-align: center; box-shadow: 0 4px 20px rgba(0,0,0,0.1); transition: all 0.3s; backdrop-filter: blur(10px); }
+.metric-card:hover { transform: translateY(-5px); box-shadow: 0 8px 30px rgba(0,0,0,0.2); }
+.metric-card h3 { color: #2c3e50; font-size: 1em; margin-bottom: 15px; font-weight: 600; }
+.metric-card .value { font-size: 2.5em; font-weight: bold; background: linear-gradient(45deg, #667eea, #764ba2); -webkit-background-clip: text; -webkit-text-fill-color: transparent; margin: 12px 0; }
+.metric-card .unit { color: #666; font-size: 0.9em; }
+.chart-section { display: grid; grid-template-columns: 1fr 1fr; gap: 25px; margin: 30px 0; }
+.chart-container { background: rgba(255,255,255,0.95); padding: 30px; border-radius: 15px; box-shadow: 0 4px 20px rgba(0,0,0,0.1); backdrop-filter: blur(10px); min-height: 500px; }
+.chart-container h3 { color: #2c3e50; margin-bottom: 25px; text-align: center; font-weight: 600; font-size: 1.2em; }
+.chart-container canvas { width: 100% !important; height: 400px !important; }
+.suggestions { background: rgba(227,242,253,0.9); padding: 25px; border-radius: 15px; margin: 25px 0; border-left: 5px solid #2196f3; backdrop-filter: blur(10px); }
+.suggestions h3 { color: #1976d2; margin-bottom: 15px; font-weight: 600; }
+.suggestions p { margin: 10px 0; color: #424242; line-height: 1.6; }
+.refresh-btn { display: block; margin: 25px auto; padding: 15px 35px; background: linear-gradient(135deg, #667eea 0%, #764ba2 100%); color: white; border: none; border-radius: 25px; cursor: pointer; font-size: 1.1em; font-weight: 600; transition: all 0.3s; }
+.refresh-btn:hover { transform: translateY(-3px); box-shadow: 0 6px 20px rgba(102,126,234,0.4); }
+@media(max-width: 768px) { .metrics-grid { grid-template-columns: 1fr; } .chart-section { grid-template-columns: 1fr; } }
+</style>
+<script src='https://cdn.jsdelivr.net/npm/chart.js@4.4.0/dist/chart.umd.min.js'></script>
+</head><body>
+<div class='firefly'></div>
+<div class='firefly'></div>
+<div class='firefly'></div>
+<div class='firefly'></div>
+<div class='firefly'></div>
+<div class='firefly'></div>
+<div class='firefly'></div>
+<div class='firefly'></div>
+<div class='firefly'></div>
+<div class='firefly'></div>
+<div class='container'>
+<a href='/' class='back-btn'>← Back to Dashboard</a>
+<div class='header'>
+<h1>🚀 JunKiri Air Quality Monitor</h1>
+<p>Real-time environmental monitoring with smart analytics</p>
+</div>
+<div class='status-banner status-excellent' id='statusBanner'>
+<span id='statusText'>🌿 EXCELLENT AIR QUALITY - PERFECT FOR OUTDOOR ACTIVITIES</span>
+</div>
+<div class='metrics-grid'>
+<div class='metric-card'>
+<h3>PM1.0 Ultra-fine Particles 🔬</h3>
+<div class='value'><span id='pm1'>8.2</span></div>
+<div class='unit'>μg/m³ - Particles smaller than 1 micron</div>
+</div>
+<div class='metric-card'>
+<h3>PM2.5 Fine Particles 💨</h3>
+<div class='value'><span id='pm25'>12.5</span></div>
+<div class='unit'>μg/m³ - Particles smaller than 2.5 microns</div>
+</div>
+<div class='metric-card'>
+<h3>PM10 Coarse Particles 🌪️</h3>
+<div class='value'><span id='pm10'>18.3</span></div>
+<div class='unit'>μg/m³ - Particles smaller than 10 microns</div>
+</div>
+<div class='metric-card'>
+<h3>VOC Index 🧪</h3>
+<div class='value'><span id='voc'>25</span></div>
+<div class='unit'>Air Quality Index - Volatile Organic Compounds</div>
+</div>
+</div>
+<div class='chart-section'>
+<div class='chart-container'>
+<h3>📈 Real-time Air Quality Trends (Updates every 10 seconds)</h3>
+<canvas id='lineChart'></canvas>
+</div>
+<div class='chart-container'>
+<h3>📊 Air Quality Distribution</h3>
+<canvas id='pieChart'></canvas>
+</div>
+</div>
+<div class='suggestions' id='suggestions'>
+<h3>💡 Health Recommendations</h3>
+<p>✅ Air quality is excellent! Perfect for outdoor activities.</p>
+</div>
+</div>
+<script>
+let lineChart, pieChart;
+function saveToHistory(pm25, voc, pm10) {
+  let history = JSON.parse(localStorage.getItem('airQualityHistory') || '{"pm25":[],"voc":[],"pm10":[]}');
+  history.pm25.unshift(pm25);
+  history.voc.unshift(voc);
+  history.pm10.unshift(pm10);
+  if (history.pm25.length > 60) { history.pm25.pop(); history.voc.pop(); history.pm10.pop(); }
+  localStorage.setItem('airQualityHistory', JSON.stringify(history));
+}
+function loadFromHistory() {
+  let history = JSON.parse(localStorage.getItem('airQualityHistory') || '{"pm25":[],"voc":[],"pm10":[]}');
+  if (history.pm25.length === 0) {
+    history.pm25 = Array(60).fill(12.5);
+    history.voc = Array(60).fill(25);
+    history.pm10 = Array(60).fill(18.3);
+  }
+  while (history.pm25.length < 60) {
+    history.pm25.push(12.5); history.voc.push(25); history.pm10.push(18.3);
+  }
+  return history;
+}
+function updateStatus(pm25) {
+  const banner = document.getElementById('statusBanner');
+  const statusText = document.getElementById('statusText');
+  const suggestions = document.getElementById('suggestions');
+  if (pm25 <= 12) {
+    banner.className = 'status-banner status-excellent';
+    statusText.textContent = '🌿 EXCELLENT AIR QUALITY';
+    suggestions.innerHTML = '<h3>💡 Health Recommendations</h3><p>✅ Air quality is excellent! Perfect for outdoor activities.</p>';
+  } else if (pm25 <= 35) {
+    banner.className = 'status-banner status-good';
+    statusText.textContent = '😊 GOOD AIR QUALITY';
+    suggestions.innerHTML = '<h3>💡 Health Recommendations</h3><p>👍 Air quality is good. Enjoy your day!</p>';
+  } else if (pm25 <= 55) {
+    banner.className = 'status-banner status-moderate';
+    statusText.textContent = '😐 MODERATE AIR QUALITY';
+    suggestions.innerHTML = '<h3>💡 Health Recommendations</h3><p>😷 Sensitive groups should reduce outdoor exertion.</p>';
+  } else {
+    banner.className = 'status-banner status-unhealthy';
+    statusText.textContent = '😷 UNHEALTHY AIR QUALITY';
+    suggestions.innerHTML = '<h3>💡 Health Recommendations</h3><p>⚠️ Everyone should limit outdoor activities. Close windows.</p>';
+  }
+}
+function showReading(newPM1, newPM25, newPM10, newVOC) {
+  document.getElementById('pm1').textContent = newPM1.toFixed(1);
+  document.getElementById('pm25').textContent = newPM25.toFixed(1);
+  document.getElementById('pm10').textContent = newPM10.toFixed(1);
+  document.getElementById('voc').textContent = newVOC;
+  updateStatus(newPM25);
+  saveToHistory(newPM25, newVOC, newPM10);
+  if (lineChart && pieChart) {
+    lineChart.data.datasets[0].data.pop();
+    lineChart.data.datasets[0].data.unshift(newPM25);
+    lineChart.data.datasets[1].data.pop();
+    lineChart.data.datasets[1].data.unshift(newVOC);
+    lineChart.data.datasets[2].data.pop();
+    lineChart.data.datasets[2].data.unshift(newPM10);
+    lineChart.update('none');
+    const excellent = Math.max(0, 70 - newPM25 * 2);
+    const good = Math.max(0, 25 - (newPM25 - 12) * 1.5);
+    const moderate = Math.max(0, 5 + (newPM25 - 35) * 0.5);
+    const unhealthy = Math.max(0, (newPM25 - 55) * 0.2);
+    const total = excellent + good + moderate + unhealthy;
+    pieChart.data.datasets[0].data = [excellent/total*100, good/total*100, moderate/total*100, unhealthy/total*100];
+    pieChart.update();
+  }
+}
+function updateData() {
+  fetch('/api/data').then(r => r.json()).then(d => {
+    if (d.valid) showReading(d.pm1_0, d.pm2_5, d.pm10, d.vocIndex);
+  }).catch(e => console.error('❌ /api/data failed:', e));
+}
+window.addEventListener('DOMContentLoaded', function() {
+  console.log('🚀 JunKiri - Initializing Real-time Data...');
+  const history = loadFromHistory();
+  const currentPM25 = history.pm25[0] || 12.5;
+  const currentVOC = history.voc[0] || 25;
+  const currentPM10 = history.pm10[0] || 18.3;
+  document.getElementById('pm1').textContent = (currentPM25 * 0.7).toFixed(1);
+  document.getElementById('pm25').textContent = currentPM25.toFixed(1);
+  document.getElementById('pm10').textContent = currentPM10.toFixed(1);
+  document.getElementById('voc').textContent = Math.floor(currentVOC);
+  updateStatus(currentPM25);
+  try {
+    const lineCtx = document.getElementById('lineChart').getContext('2d');
+    lineChart = new Chart(lineCtx, {
+      type: 'line',
+      data: {
+        labels: Array.from({length: 60}, (_, i) => { let s = (60 - i) * 10; return s % 60 === 0 ? s + 's' : ''; }),
+        datasets: [
+          { label: '💨 PM2.5 (Fine Particles)', data: history.pm25, borderColor: '#667eea', backgroundColor: 'rgba(102, 126, 234, 0.2)', borderWidth: 3, fill: true, tension: 0.4, pointRadius: 0 },
+          { label: '🌪️ PM10 (Coarse Particles)', data: history.pm10, borderColor: '#4CAF50', borderWidth: 2, fill: false, tension: 0.3, pointRadius: 0 },
+          { label: '🧪 VOC Index (Air Quality)', data: history.voc, borderColor: '#f093fb', borderWidth: 3, fill: false, tension: 0.4, yAxisID: 'y1', borderDash: [8, 4], pointRadius: 0 }
+        ]
+      },
+      options: { responsive: true, maintainAspectRatio: false, plugins: { title: { display: true, text: '🚀 JunKiri Environmental Dashboard - Real-time Data (10-second intervals)', font: { size: 16 } }, legend: { position: 'top' } }, scales: { x: { reverse: true, title: { display: true, text: 'Time (10-second intervals)', font: { size: 12 } } }, y: { beginAtZero: true, title: { display: true, text: 'Particle Concentration (μg/m³)', font: { size: 12 } } }, y1: { type: 'linear', display: true, position: 'right', title: { display: true, text: 'VOC Air Quality Index', font: { size: 12 } }, grid: { drawOnChartArea: false } } }, animation: { duration: 0 } }
+    });
+    console.log('✅ Line chart initialized!');
+    const pieCtx = document.getElementById('pieChart').getContext('2d');
+    pieChart = new Chart(pieCtx, {
+      type: 'doughnut',
+      data: {
+        labels: ['🌿 Excellent', '😊 Good', '😐 Moderate', '😷 Unhealthy'],
+        datasets: [{ data: [65, 25, 8, 2], backgroundColor: ['#4CAF50', '#ff9800', '#f44336', '#9c27b0'], borderWidth: 5, borderColor: '#fff' }]
+      },
+      options: { responsive: true, maintainAspectRatio: false, plugins: { title: { display: true, text: '📊 Air Quality Distribution', font: { size: 16 } }, legend: { position: 'bottom' } }, cutout: '60%' }
+    });
+    console.log('✅ Pie chart initialized!');
+    updateData();
+    setInterval(updateData, 10000);
+  } catch (e) {
+    console.error('❌ Chart initialization failed:', e);
+    document.body.innerHTML = '<h1 style="color:red; text-align:center; margin-top: 50px;">Chart Error! Check Console.</h1>';
+  }
+});
+</script>
+</body></html>)rawliteral";
+
+#endif
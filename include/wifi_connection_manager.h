@@ -0,0 +1,79 @@
+#ifndef WIFI_CONNECTION_MANAGER_H
+#define WIFI_CONNECTION_MANAGER_H
+
+#include <Arduino.h>
+#include <ESP8266WiFi.h>
+
+// RTC user memory word offset of the cached link parameters. The first
+// 128 bytes are left to the bootloader, which keeps its OTA command there.
+#define WIFI_CACHE_RTC_OFFSET 32
+#define WIFI_CACHE_FILE "/wifi.bin"
+
+// Attempt timeouts and reconnect backoff (ms)
+#define WIFI_FAST_CONNECT_TIMEOUT 3000
+#define WIFI_CONNECT_TIMEOUT 15000
+#define WIFI_BACKOFF_MIN 1000
+#define WIFI_BACKOFF_MAX 60000
+
+enum WiFiLinkState {
+  WIFI_LINK_IDLE,
+  WIFI_LINK_CONNECTING,
+  WIFI_LINK_CONNECTED,
+  WIFI_LINK_BACKOFF
+};
+
+// Keeps the station link up without ever blocking the main loop. The BSSID
+// and channel of the last good association are cached in RTC memory
+// (survives soft resets) and in flash (survives power loss), so
+// reconnecting skips the channel scan. The address always comes from DHCP:
+// a cached lease would be used past its expiry, and nothing at the
+// association level notices when the router gives it to another host.
+class WiFiConnectionManager {
+private:
+  struct LinkCache {
+    uint32_t crc;
+    uint8_t bssid[6];
+    uint8_t channel;
+    uint8_t reserved;
+  };
+
+  const char* ssid;
+  const char* password;
+  WiFiLinkState state;
+  LinkCache cache;
+  bool cacheValid;
+  bool fastAttempt;
+  unsigned long attemptStart;
+  unsigned long backoffUntil;
+  unsigned long backoffDelay;
+
+  // Statistics
+  unsigned long lastAssociationTime;
+  unsigned long bootToConnectTime;
+  uint32_t connectCount;
+  uint32_t fastConnectCount;
+  uint32_t disconnectCount;
+
+  void startAttempt(bool useCache);
+  void onConnected();
+  void onAttemptFailed();
+  bool loadCache();
+  void saveCache();
+  void invalidateCache();
+  static uint32_t cacheCrc(const LinkCache& data);
+
+public:
+  WiFiConnectionManager();
+  void begin(const char* ssid, const char* password);
+  void loop();
+  bool isConnected();
+  WiFiLinkState getState();
+  const char* getStateName();
+  unsigned long getLastAssociationTime();
+  unsigned long getBootToConnectTime();
+  uint32_t getConnectCount();
+  uint32_t getFastConnectCount();
+  uint32_t getDisconnectCount();
+};
+
+#endif
@@ -0,0 +1,107 @@
+#include "admission_control.h"
+
+AdmissionControl::AdmissionControl() {
+  memset(clients, 0, sizeof(clients));
+  lastLoop = 0;
+  loopPeriod = 0;
+  acceptedCount = 0;
+  rateLimitedCount = 0;
+  shedCount = 0;
+  budgetExhaustedCount = 0;
+}
+
+void AdmissionControl::loopTick(uint32_t idleMillis) {
+  uint32_t now = millis();
+  if (lastLoop != 0) {
+    // Rises within a few slow iterations and decays as quickly. Waits chosen
+    // by the power manager are not load.
+    uint32_t elapsed = now - lastLoop;
+    uint32_t period = elapsed > idleMillis ? elapsed - idleMillis : 0;
+    loopPeriod = period > loopPeriod ? loopPeriod + (period - loopPeriod) / 2
+                                     : loopPeriod - (loopPeriod - period) / 4;
+  }
+  lastLoop = now;
+}
+
+AdmissionControl::ClientBucket& AdmissionControl::findClient(uint32_t ip) {
+  uint8_t oldest = 0;
+  for (uint8_t i = 0; i < ADMISSION_CLIENTS; i++) {
+    if (clients[i].ip == ip) {
+      return clients[i];
+    }
+    if (clients[i].ip == 0 || (clients[oldest].ip != 0 && clients[i].lastRefill < clients[oldest].lastRefill)) {
+      oldest = i;
+    }
+  }
+
+  // New clients start with a full bucket
+  ClientBucket& client = clients[oldest];
+  client.ip = ip;
+  client.milliTokens = ADMISSION_BURST * 1000UL;
+  client.lastRefill = millis();
+  return client;
+}
+
+AdmissionResult AdmissionControl::admit(uint32_t ip, uint32_t& retryAfter) {
+  // Shedding is cheaper than serving, so it is checked first
+  if (isOverloaded()) {
+    shedCount++;
+    retryAfter = 1;
+    return ADMISSION_SHED;
+  }
+
+  ClientBucket& client = findClient(ip);
+  uint32_t now = millis();
+  // ADMISSION_RATE tokens per second is the same number of milli-tokens per
+  // ms. Past the time a bucket takes to fill, elapsed time adds nothing, and
+  // clamping it there keeps the product from overflowing after long silences.
+  uint32_t elapsed = min(now - client.lastRefill, (uint32_t)(ADMISSION_BURST * 1000 / ADMISSION_RATE));
+  client.milliTokens = min(client.milliTokens + elapsed * ADMISSION_RATE, (uint32_t)ADMISSION_BURST * 1000);
+  client.lastRefill = now;
+
+  if (client.milliTokens < 1000) {
+    rateLimitedCount++;
+    uint32_t perSecond = ADMISSION_RATE * 1000UL;
+    retryAfter = (1000 - client.milliTokens + perSecond - 1) / perSecond;
+    return ADMISSION_RATE_LIMITED;
+  }
+  client.milliTokens -= 1000;
+  acceptedCount++;
+  return ADMISSION_ACCEPTED;
+}
+
+void AdmissionControl::noteBudgetExhausted() {
+  budgetExhaustedCount++;
+}
+
+bool AdmissionControl::isOverloaded() const {
+  return loopPeriod > LOAD_SHED_PERIOD_MS;
+}
+
+uint32_t AdmissionControl::getLoopPeriod() const {
+  return loopPeriod;
+}
+
+uint32_t AdmissionControl::getAcceptedCount() const {
+  return acceptedCount;
+}
+
+uint32_t AdmissionControl::getRateLimitedCount() const {
+  return rateLimitedCount;
+}
+
+uint32_t AdmissionControl::getShedCount() const {
+  return shedCount;
+}
+
+uint32_t AdmissionControl::getBudgetExhaustedCount() const {
+  return budgetExhaustedCount;
+}
+
+uint32_t AdmissionControl::getClientIP(uint8_t index) const {
+  return clients[index].ip;
+}
+
+uint32_t AdmissionControl::getClientTokens(uint8_t index) const {
+  return clients[index].milliTokens / 1000;
+}
@@ -0,0 +1,145 @@
+#include "air_forecast.h"
+
+AirForecast::AirForecast() {
+  reset();
+}
+
+void AirForecast::reset() {
+  level = 0;
+  trend = 0;
+  residualMean = 0;
+  residualVariance = 0;
+  cusumHigh = 0;
+  cusumLow = 0;
+  samples = 0;
+  pendingForecast = 0;
+  pendingDue = 0;
+  pending = false;
+  oneStepError = 0;
+  horizonError = 0;
+  horizonScored = 0;
+  anomaly = ANOMALY_NONE;
+  anomalyCount = 0;
+  updateCycles = 0;
+  maxUpdateCycles = 0;
+}
+
+void AirForecast::update(float value) {
+  uint32_t start = ESP.getCycleCount();
+  anomaly = ANOMALY_NONE;
+
+  if (samples == 0) {
+    level = value;
+    trend = 0;
+  } else {
+    float error = value - (level + trend);
+    oneStepError += (fabsf(error) - oneStepError) / samples;
+
+    // Readings are whole µg/m³, so the deviation is floored at one
+    float deviation = max(sqrtf(residualVariance), 1.0f);
+    float z = (error - residualMean) / deviation;
+    if (samples > ANOMALY_WARMUP) {
+      cusumHigh = max(0.0f, cusumHigh + z - ANOMALY_CUSUM_K);
+      cusumLow = max(0.0f, cusumLow - z - ANOMALY_CUSUM_K);
+      if (fabsf(z) > ANOMALY_ZSCORE) {
+        anomaly = ANOMALY_SPIKE;
+      } else if (cusumHigh > ANOMALY_CUSUM_H) {
+        anomaly = ANOMALY_SHIFT_UP;
+      } else if (cusumLow > ANOMALY_CUSUM_H) {
+        anomaly = ANOMALY_SHIFT_DOWN;
+      }
+      if (anomaly != ANOMALY_NONE) {
+        anomalyCount++;
+        cusumHigh = 0;
+        cusumLow = 0;
+      }
+    }
+
+    // Exponentially weighted mean and variance of the error
+    float difference = error - residualMean;
+    residualMean += ANOMALY_RESIDUAL_ALPHA * difference;
+    residualVariance = (1 - ANOMALY_RESIDUAL_ALPHA) * (residualVariance + ANOMALY_RESIDUAL_ALPHA * difference * difference);
+
+    float previousLevel = level;
+    level = FORECAST_ALPHA * value + (1 - FORECAST_ALPHA) * (level + trend);
+    trend = FORECAST_BETA * (level - previousLevel) + (1 - FORECAST_BETA) * trend;
+  }
+
+  if (pending && samples == pendingDue) {
+    horizonScored++;
+    horizonError += (fabsf(value - pendingForecast) - horizonError) / horizonScored;
+    pending = false;
+  }
+  samples++;
+  if (!pending) {
+    pendingForecast = getForecast(FORECAST_HORIZON);
+    pendingDue = samples - 1 + FORECAST_HORIZON;
+    pending = true;
+  }
+
+  updateCycles = ESP.getCycleCount() - start;
+  if (updateCycles > maxUpdateCycles) {
+    maxUpdateCycles = updateCycles;
+  }
+}
+
+float AirForecast::getForecast(uint16_t steps) const {
+  return max(level + trend * steps, 0.0f);
+}
+
+float AirForecast::getLevel() const {
+  return level;
+}
+
+float AirForecast::getTrend() const {
+  return trend;
+}
+
+int32_t AirForecast::getSecondsToLimit() const {
+  if (level >= FORECAST_LIMIT || trend <= 0) {
+    return -1;
+  }
+  float steps = (FORECAST_LIMIT - level) / trend;
+  return steps <= FORECAST_HORIZON ? (int32_t)(steps * FORECAST_SAMPLE_PERIOD) : -1;
+}
+
+AnomalyKind AirForecast::getAnomaly() const {
+  return anomaly;
+}
+
+uint32_t AirForecast::getAnomalyCount() const {
+  return anomalyCount;
+}
+
+uint32_t AirForecast::getSampleCount() const {
+  return samples;
+}
+
+float AirForecast::getOneStepError() const {
+  return oneStepError;
+}
+
+float AirForecast::getHorizonError() const {
+  return horizonError;
+}
+
+uint32_t AirForecast::getHorizonScored() const {
+  return horizonScored;
+}
+
+uint32_t AirForecast::getUpdateCycles() const {
+  return updateCycles;
+}
+
+uint32_t AirForecast::getMaxUpdateCycles() const {
+  return maxUpdateCycles;
+}
+
+const char* AirForecast::anomalyName(AnomalyKind kind) {
+  switch (kind) {
+    case ANOMALY_SPIKE: return "spike";
+    case ANOMALY_SHIFT_UP: return "shift_up";
+    case ANOMALY_SHIFT_DOWN: return "shift_down";
+    default: return "none";
+  }
+}
@@ -1,27 +1,66 @@
 #include "air_quality_display.h"
 
-AirQualityDisplay::AirQualityDisplay(PMSSensor* pmsSensor) {
+static uint32_t updateCrc(uint32_t crc, const uint8_t* data, size_t length) {
+  for (size_t i = 0; i < length; i++) {
+    crc ^= data[i];
+    for (uint8_t bit = 0; bit < 8; bit++) {
+      crc = (crc >> 1) ^ (0xEDB88320 & -(crc & 1));
+    }
+  }
+  return crc;
+}
+
+// Tile rows hold 8 pixel rows as one byte per column, least significant bit
+// on top; PBM rows are one bit per pixel, most significant bit on the left,
+// with 1 for dark. Converts one tile row at a time through a stack buffer.
+static void sendTileRows(const uint8_t* tiles, uint8_t tileRows, FrameSink& sink) {
+  uint8_t rows[8 * DISPLAY_WIDTH / 8];
+  for (uint8_t t = 0; t < tileRows; t++) {
+    const uint8_t* tile = tiles + t * DISPLAY_WIDTH;
+    memset(rows, 0xFF, sizeof(rows));
+    for (uint8_t x = 0; x < DISPLAY_WIDTH; x++) {
+      for (uint8_t y = 0; y < 8; y++) {
+        if (tile[x] & (1 << y)) {
+          rows[y * (DISPLAY_WIDTH / 8) + x / 8] &= ~(0x80 >> (x & 7));
+        }
+      }
+    }
+    sink(rows, sizeof(rows));
+  }
+}
+
+static void recordTime(RenderStats& stats, uint32_t elapsed) {
+  stats.lastMicros = elapsed;
+  if (elapsed > stats.maxMicros) {
+    stats.maxMicros = elapsed;
+  }
+  stats.totalMicros += elapsed;
+  stats.count++;
+}
+
+// OLED display with SSH1106 configuration, placed statically with its owner
+AirQualityDisplay::AirQualityDisplay(PMSSensor* pmsSensor, HousePeers* housePeers)
+    : u8g2(U8G2_R0, /* reset=*/ U8X8_PIN_NONE, /* scl=*/ D1, /* sda=*/ D2) {
   sensor = pmsSensor;
+  house = housePeers;
   currentScreen = MAIN;
   lastScreenChange = 0;
-  alertActive = false;
-  
-  // Initialize OLED display with SSH1106 configuration
-  u8g2 = new U8G2_SH1106_128X64_NONAME_F_HW_I2C(U8G2_R0, /* reset=*/ U8X8_PIN_NONE, /* scl=*/ D1, /* sda=*/ D2);
-}
-
-AirQualityDisplay::~AirQualityDisplay() {
-  // Note: Not deleting u8g2 to avoid undefined behavior warning
-  // The object will be cleaned up when the program ends
+  seenTransitions = 0;
+  memset(renderStats, 0, sizeof(renderStats));
+  memset(&mirrorStats, 0, sizeof(mirrorStats));
+  lastDraw = nullptr;
+  frameCrc = 0;
+  frameCrcStale = true;
 }
 
 void AirQualityDisplay::begin() {
-  // Initialize OLED
-  u8g2->begin();
-  u8g2->setDisplayRotation(U8G2_R0);
-  u8g2->clearBuffer();
-  u8g2->clearDisplay();
-  u8g2->setBitmapMode(1);
+  // Initialize OLED; the bus clock only takes effect if set before begin()
+  u8g2.setBusClock(DISPLAY_BUS_CLOCK);
+  u8g2.begin();
+  u8g2.setDisplayRotation(U8G2_R0);
+  u8g2.clearBuffer();
+  u8g2.clearDisplay();
+  u8g2.setBitmapMode(1);
   
   // Initialize buzzer
   pinMode(BUZZER_PIN, OUTPUT);
@@ -34,27 +73,22 @@ void AirQualityDisplay::begin() {
 }
 
 void AirQualityDisplay::showBootScreen() {
-  u8g2->clearBuffer();
-  u8g2->setFont(u8g2_font_helvB14_tf);
-  u8g2->drawStr(10, 20, "Air Quality");
-  u8g2->setFont(u8g2_font_helvR12_tf);
-  u8g2->drawStr(15, 35, "Monitor v2.0");
-  u8g2->setFont(u8g2_font_helvR08_tf);
-  u8g2->drawStr(5, 50, "PMS5003 + ESP8266");
-  u8g2->drawStr(25, 62, "Starting...");
-  u8g2->sendBuffer();
+  render(&AirQualityDisplay::drawBootScreen, SCREEN_BOOT);
+}
+
+void AirQualityDisplay::drawBootScreen() {
+  u8g2.setFont(u8g2_font_helvB14_tf);
+  u8g2.drawStr(10, 20, "Air Quality");
+  u8g2.setFont(u8g2_font_helvR12_tf);
+  u8g2.drawStr(15, 35, "Monitor v2.0");
+  u8g2.setFont(u8g2_font_helvR08_tf);
+  u8g2.drawStr(5, 50, "PMS5003 + ESP8266");
+  u8g2.drawStr(25, 62, "Starting...");
 }
 
 void AirQualityDisplay::update() {
   if (!sensor->isDataValid()) {
-    // Show "No Data" screen
-    u8g2->clearBuffer();
-    u8g2->setFont(u8g2_font_helvB14_tf);
-    u8g2->drawStr(15, 25, "No Sensor");
-    u8g2->drawStr(30, 45, "Data");
-    u8g2->setFont(u8g2_font_helvR08_tf);
-    u8g2->drawStr(10, 58, "Check connections");
-    u8g2->sendBuffer();
+    render(&AirQualityDisplay::drawNoDataScreen, SCREEN_NO_DATA);
     return;
   }
   
@@ -64,213 +98,281 @@ void AirQualityDisplay::update() {
   // Update display based on current screen
   switch (currentScreen) {
     case MAIN:
-      displayMainScreen();
+      render(&AirQualityDisplay::drawMainScreen, currentScreen);
       break;
     case HEALTH_RISK:
-      displayHealthRiskScreen();
+      render(&AirQualityDisplay::drawHealthRiskScreen, currentScreen);
       break;
     case ALERT:
-      displayAlertScreen();
+      render(&AirQualityDisplay::drawAlertScreen, currentScreen);
       break;
     case TREND:
-      displayTrendScreen();
+      render(&AirQualityDisplay::drawTrendScreen, currentScreen);
       break;
     case COMPARISON:
-      displayComparisonScreen();
+      render(&AirQualityDisplay::drawComparisonScreen, currentScreen);
       break;
     case PARTICLES:
-      displayParticlesScreen();
+      render(&AirQualityDisplay::drawParticlesScreen, currentScreen);
       break;
   }
 }
 
-void AirQualityDisplay::displayMainScreen() {
-  u8g2->clearBuffer();
+// Full-buffer builds draw once and send the whole frame. Page-buffer builds
+// run the same drawing code once per band of rows (the picture loop), each
+// pass clipped to the band and sent before the next, so draw functions must
+// depend only on state that cannot change between passes.
+void AirQualityDisplay::render(DrawFunction draw, uint8_t screen) {
+  uint32_t start = micros();
+  lastDraw = draw;
+#if DISPLAY_PAGE_BUFFER
+  // Each band is only in RAM during its pass, so the checksum is taken here
+  frameCrc = 0xFFFFFFFF;
+  u8g2.firstPage();
+  do {
+    (this->*draw)();
+    frameCrc = updateCrc(frameCrc, u8g2.getBufferPtr(), DISPLAY_BUFFER_SIZE);
+  } while (u8g2.nextPage());
+#else
+  u8g2.clearBuffer();
+  (this->*draw)();
+  u8g2.sendBuffer();
+  frameCrcStale = true;
+#endif
+  recordTime(renderStats[screen], micros() - start);
+}
+
+// The same conversion runs for every screen, so the time taken and the
+// memory used do not depend on what is shown
+void AirQualityDisplay::writeFrame(FrameSink sink) {
+  uint32_t start = micros();
+  sink((const uint8_t*)DISPLAY_PBM_HEADER, sizeof(DISPLAY_PBM_HEADER) - 1);
+#if DISPLAY_PAGE_BUFFER
+  // Only one band is in RAM, so each is drawn again; the panel is not touched
+  uint8_t bandRows = u8g2.getBufferTileHeight();
+  for (uint8_t row = 0; row < DISPLAY_HEIGHT / 8; row += bandRows) {
+    u8g2.setBufferCurrTileRow(row);
+    u8g2.clearBuffer();
+    if (lastDraw) {
+      (this->*lastDraw)();
+    }
+    sendTileRows(u8g2.getBufferPtr(), bandRows, sink);
+  }
+  u8g2.setBufferCurrTileRow(0);
+#else
+  sendTileRows(u8g2.getBufferPtr(), DISPLAY_HEIGHT / 8, sink);
+#endif
+  recordTime(mirrorStats, micros() - start);
+}
+
+uint32_t AirQualityDisplay::getFrameCrc() {
+#if !DISPLAY_PAGE_BUFFER
+  if (frameCrcStale) {
+    frameCrc = updateCrc(0xFFFFFFFF, u8g2.getBufferPtr(), DISPLAY_BUFFER_SIZE);
+    frameCrcStale = false;
+  }
+#endif
+  return frameCrc;
+}
+
+void AirQualityDisplay::drawNoDataScreen() {
+  u8g2.setFont(u8g2_font_helvB14_tf);
+  u8g2.drawStr(15, 25, "No Sensor");
+  u8g2.drawStr(30, 45, "Data");
+  u8g2.setFont(u8g2_font_helvR08_tf);
+  u8g2.drawStr(10, 58, "Check connections");
+}
+
+void AirQualityDisplay::drawMainScreen() {
+  const PMSSensor::AirQualityData& reading = sensor->getSnapshot().data;
   char buf[32];
   
   // Status at top with larger font
-  u8g2->setFont(u8g2_font_helvB12_tf);
-  String status = sensor->getHealthStatus();
-  u8g2->drawStr(2, 14, status.c_str());
+  u8g2.setFont(u8g2_font_helvB12_tf);
+  u8g2.drawStr(2, 14, sensor->getHealthStatus());
   
   // PM readings
-  u8g2->setFont(u8g2_font_helvR10_tf);
-  sprintf(buf, "PM1.0: %u ug/m3", sensor->currentData.pm1_0_atm);
-  u8g2->drawStr(2, 28, buf);
+  u8g2.setFont(u8g2_font_helvR10_tf);
+  sprintf(buf, "PM1.0: %u ug/m3", reading.pm1_0_atm);
+  u8g2.drawStr(2, 28, buf);
   
-  sprintf(buf, "PM2.5: %u ug/m3", sensor->currentData.pm2_5_atm);
-  u8g2->drawStr(2, 42, buf);
+  sprintf(buf, "PM2.5: %u ug/m3", reading.pm2_5_atm);
+  u8g2.drawStr(2, 42, buf);
   
-  sprintf(buf, "PM10:  %u ug/m3", sensor->currentData.pm10_atm);
-  u8g2->drawStr(2, 56, buf);
+  sprintf(buf, "PM10:  %u ug/m3", reading.pm10_atm);
+  u8g2.drawStr(2, 56, buf);
   
   // Add small indicator for screen rotation
-  u8g2->setFont(u8g2_font_4x6_tf);
-  u8g2->drawStr(118, 62, "1/5");
-  
-  u8g2->sendBuffer();
+  u8g2.setFont(u8g2_font_4x6_tf);
+  u8g2.drawStr(118, 62, "1/5");
 }
 
-void AirQualityDisplay::displayHealthRiskScreen() {
-  u8g2->clearBuffer();
+void AirQualityDisplay::drawHealthRiskScreen() {
+  const PMSSensor::AirQualityData& reading = sensor->getSnapshot().data;
   char buf[32];
   
-  u8g2->setFont(u8g2_font_helvB12_tf);
-  String riskLevel = sensor->getRiskLevel();
-  if (riskLevel == "HIGH") {
-    u8g2->drawStr(2, 14, "HIGH RISK!");
-  } else if (riskLevel == "MODERATE") {
-    u8g2->drawStr(2, 14, "MODERATE RISK");
+  u8g2.setFont(u8g2_font_helvB12_tf);
+  AirLevel level = sensor->getSnapshot().level;
+  if (level == AIR_UNHEALTHY) {
+    u8g2.drawStr(2, 14, "HIGH RISK!");
+  } else if (level == AIR_SENSITIVE) {
+    u8g2.drawStr(2, 14, "MODERATE RISK");
   } else {
-    u8g2->drawStr(2, 14, "LOW RISK");
+    u8g2.drawStr(2, 14, "LOW RISK");
   }
   
-  sprintf(buf, "PM2.5: %u ug/m3", sensor->currentData.pm2_5_atm);
-  u8g2->setFont(u8g2_font_helvR10_tf);
-  u8g2->drawStr(2, 30, buf);
-  
-  u8g2->setFont(u8g2_font_helvR08_tf);
-  if (sensor->currentData.pm2_5_atm > 35) {
-    u8g2->drawStr(2, 44, "* Asthma risk");
-    u8g2->drawStr(2, 54, "* Use air purifier");
-  } else if (sensor->currentData.pm2_5_atm > 12) {
-    u8g2->drawStr(2, 44, "* Sensitive groups");
-    u8g2->drawStr(2, 54, "* Monitor levels");
+  sprintf(buf, "PM2.5: %u ug/m3", reading.pm2_5_atm);
+  u8g2.setFont(u8g2_font_helvR10_tf);
+  u8g2.drawStr(2, 30, buf);
+  
+  u8g2.setFont(u8g2_font_helvR08_tf);
+  if (level >= AIR_SENSITIVE) {
+    u8g2.drawStr(2, 44, "* Asthma risk");
+    u8g2.drawStr(2, 54, "* Use air purifier");
+  } else if (level == AIR_MODERATE) {
+    u8g2.drawStr(2, 44, "* Sensitive groups");
+    u8g2.drawStr(2, 54, "* Monitor levels");
   } else {
-    u8g2->drawStr(2, 44, "* Air quality good");
-    u8g2->drawStr(2, 54, "* Safe for all");
+    u8g2.drawStr(2, 44, "* Air quality good");
+    u8g2.drawStr(2, 54, "* Safe for all");
   }
   
-  u8g2->setFont(u8g2_font_4x6_tf);
-  u8g2->drawStr(118, 62, "2/5");
-  
-  u8g2->sendBuffer();
+  u8g2.setFont(u8g2_font_4x6_tf);
+  u8g2.drawStr(118, 62, "2/5");
 }
 
-void AirQualityDisplay::displayAlertScreen() {
-  u8g2->clearBuffer();
+void AirQualityDisplay::drawAlertScreen() {
+  const PMSSensor::AirQualityData& reading = sensor->getSnapshot().data;
   char buf[32];
   
-  u8g2->setFont(u8g2_font_helvB12_tf);
-  if (sensor->currentData.pm2_5_atm > 55) {
-    u8g2->drawStr(2, 14, "UNHEALTHY!");
+  u8g2.setFont(u8g2_font_helvB12_tf);
+  if (sensor->getSnapshot().level == AIR_UNHEALTHY) {
+    u8g2.drawStr(2, 14, "UNHEALTHY!");
   } else {
-    u8g2->drawStr(2, 14, "ALERT!");
+    u8g2.drawStr(2, 14, "ALERT!");
   }
   
-  sprintf(buf, "PM2.5: %u ug/m3", sensor->currentData.pm2_5_atm);
-  u8g2->setFont(u8g2_font_helvR10_tf);
-  u8g2->drawStr(2, 30, buf);
+  sprintf(buf, "PM2.5: %u ug/m3", reading.pm2_5_atm);
+  u8g2.setFont(u8g2_font_helvR10_tf);
+  u8g2.drawStr(2, 30, buf);
   
-  u8g2->setFont(u8g2_font_helvR08_tf);
-  u8g2->drawStr(2, 44, "TAKE ACTION:");
-  u8g2->drawStr(2, 54, "* Close windows");
-  u8g2->drawStr(2, 62, "* Use air purifier");
+  u8g2.setFont(u8g2_font_helvR08_tf);
+  u8g2.drawStr(2, 44, "TAKE ACTION:");
+  u8g2.drawStr(2, 54, "* Close windows");
+  u8g2.drawStr(2, 62, "* Use air purifier");
   
-  u8g2->setFont(u8g2_font_4x6_tf);
-  u8g2->drawStr(118, 6, "3/5");
-  
-  u8g2->sendBuffer();
+  u8g2.setFont(u8g2_font_4x6_tf);
+  u8g2.drawStr(118, 6, "3/5");
 }
 
-void AirQualityDisplay::displayTrendScreen() {
-  u8g2->clearBuffer();
+void AirQualityDisplay::drawTrendScreen() {
+  const PMSSensor::AirQualityData& reading = sensor->getSnapshot().data;
   char buf[32];
   
-  sprintf(buf, "PM2.5: %u ug/m3", sensor->currentData.pm2_5_atm);
-  u8g2->setFont(u8g2_font_helvR10_tf);
-  u8g2->drawStr(2, 12, buf);
-  
-  // Find peak value and hour
-  bool hasData = false;
-  float peak = 0;
-  uint8_t peakHour = 0;
-  
-  for (uint8_t i = 0; i < 24; i++) {
-    if (sensor->pm25TrendData[i] > 0) {
-      hasData = true;
-      if (sensor->pm25TrendData[i] > peak) {
-        peak = sensor->pm25TrendData[i];
-        peakHour = i;
-      }
-    }
-  }
-  
-  if (hasData) {
-    sprintf(buf, "Peak: %u at %02u:00", (uint16_t)peak, peakHour);
+  // Current reading and the forecast for FORECAST_HORIZON readings ahead
+  const AirForecast& forecast = sensor->getForecast();
+  sprintf(buf, "PM2.5: %u > %.0f", reading.pm2_5_atm, forecast.getForecast(FORECAST_HORIZON));
+  u8g2.setFont(u8g2_font_helvR10_tf);
+  u8g2.drawStr(2, 12, buf);
+  
+  // An approaching limit or an anomaly takes the place of the peak hour,
+  // which is maintained by the sensor as readings arrive
+  int32_t secondsToLimit = forecast.getSecondsToLimit();
+  uint8_t peakHour = sensor->getTrendPeakHour();
+  uint16_t peak = sensor->pm25TrendPeak[peakHour];
+  if (secondsToLimit >= 0) {
+    sprintf(buf, "Unhealthy in ~%ld min", (long)(secondsToLimit + 59) / 60);
+  } else if (forecast.getAnomaly() != ANOMALY_NONE) {
+    sprintf(buf, "Unusual: %s", AirForecast::anomalyName(forecast.getAnomaly()));
+  } else if (peak > 0) {
+    sprintf(buf, "Peak: %u at %02u:00", peak, peakHour);
   } else {
     sprintf(buf, "Peak: No data yet");
   }
-  u8g2->setFont(u8g2_font_helvR08_tf);
-  u8g2->drawStr(2, 24, buf);
+  u8g2.setFont(u8g2_font_helvR08_tf);
+  u8g2.drawStr(2, 24, buf);
   
-  // Draw trend graph
-  u8g2->drawStr(2, 36, "24h Trend:");
+  // Draw trend graph, oldest hour on the left and the current hour on the right
+  u8g2.drawStr(2, 36, "24h Trend:");
   for (uint8_t i = 0; i < 24; i++) {
-    if (sensor->pm25TrendData[i] > 0) {
-      uint8_t height = map(sensor->pm25TrendData[i], 0, 100, 0, 24);
-      u8g2->drawVLine(40 + i * 3, 62 - height, height);
+    uint8_t hour = (sensor->trendHour + 1 + i) % 24;
+    if (sensor->pm25TrendData[hour] > 0) {
+      uint8_t height = map(sensor->pm25TrendData[hour], 0, 100, 0, 24);
+      u8g2.drawVLine(40 + i * 3, 62 - height, height);
     }
   }
   
-  u8g2->setFont(u8g2_font_4x6_tf);
-  u8g2->drawStr(118, 62, "4/5");
-  
-  u8g2->sendBuffer();
+  u8g2.setFont(u8g2_font_4x6_tf);
+  u8g2.drawStr(118, 62, "4/5");
 }
 
-void AirQualityDisplay::displayComparisonScreen() {
-  u8g2->clearBuffer();
+void AirQualityDisplay::drawComparisonScreen() {
+  const PMSSensor::AirQualityData& reading = sensor->getSnapshot().data;
   char buf[32];
   
-  u8g2->setFont(u8g2_font_helvR08_tf);
-  sprintf(buf, "Your PM2.5: %u", sensor->currentData.pm2_5_atm);
-  u8g2->drawStr(2, 10, buf);
-  u8g2->drawStr(2, 20, "WHO Safe:   10 ug/m3");
-  u8g2->drawStr(2, 30, "US EPA:     35 ug/m3");
-  u8g2->drawStr(2, 40, "London:     15 ug/m3");
-  u8g2->drawStr(2, 50, "Delhi:     100 ug/m3");
-  u8g2->drawStr(2, 60, "Beijing:    60 ug/m3");
+  u8g2.setFont(u8g2_font_helvR08_tf);
+  sprintf(buf, "Your PM2.5: %u", reading.pm2_5_atm);
+  u8g2.drawStr(2, 10, buf);
+  
+  // With other hubs in the house, compare rooms rather than cities
+  const HouseView view = house->readView();
+  if (view.count > 0) {
+    uint8_t y = 20;
+    for (uint8_t p = 0; p < HOUSE_MAX_PEERS && y <= 60; p++) {
+      const HousePeer* peer = &view.peers[p];
+      if (peer->lastSeen == 0) {
+        continue;
+      }
+      if (peer->reading.flags & 1) {
+        sprintf(buf, "Hub %04X:  %u ug/m3", (unsigned)(peer->reading.hubId & 0xFFFF), peer->reading.pm2_5);
+      } else {
+        sprintf(buf, "Hub %04X:  no data", (unsigned)(peer->reading.hubId & 0xFFFF));
+      }
+      u8g2.drawStr(2, y, buf);
+      y += 10;
+    }
+    u8g2.setFont(u8g2_font_4x6_tf);
+    u8g2.drawStr(118, 6, "5/5");
+    return;
+  }
   
-  u8g2->setFont(u8g2_font_4x6_tf);
-  u8g2->drawStr(118, 6, "5/5");
+  u8g2.drawStr(2, 20, "WHO Safe:   10 ug/m3");
+  u8g2.drawStr(2, 30, "US EPA:     35 ug/m3");
+  u8g2.drawStr(2, 40, "London:     15 ug/m3");
+  u8g2.drawStr(2, 50, "Delhi:     100 ug/m3");
+  u8g2.drawStr(2, 60, "Beijing:    60 ug/m3");
   
-  u8g2->sendBuffer();
+  u8g2.setFont(u8g2_font_4x6_tf);
+  u8g2.drawStr(118, 6, "5/5");
 }
 
-void AirQualityDisplay::displayParticlesScreen() {
-  u8g2->clearBuffer();
+// Size distribution: counts per 0.1 L in each bin (µm), now and the rolling mean
+void AirQualityDisplay::drawParticlesScreen() {
+  const ParticleStats& stats = sensor->getParticleStats();
   char buf[32];
   
-  u8g2->setFont(u8g2_font_helvR08_tf);
-  u8g2->drawStr(2, 10, "Particles/0.1L:");
-  
-  sprintf(buf, ">0.3um: %u", sensor->currentData.particles_03);
-  u8g2->drawStr(2, 22, buf);
-  
-  sprintf(buf, ">0.5um: %u", sensor->currentData.particles_05);
-  u8g2->drawStr(2, 32, buf);
-  
-  sprintf(buf, ">1.0um: %u", sensor->currentData.particles_10);
-  u8g2->drawStr(2, 42, buf);
-  
-  sprintf(buf, ">2.5um: %u", sensor->currentData.particles_25);
-  u8g2->drawStr(2, 52, buf);
-  
-  sprintf(buf, "VOC Index: %u", sensor->getVOCIndex());
-  u8g2->drawStr(2, 62, buf);
-  
-  u8g2->setFont(u8g2_font_4x6_tf);
-  u8g2->drawStr(118, 6, "6/6");
+  u8g2.setFont(u8g2_font_5x7_tf);
+  sprintf(buf, "VOC %-3u    now    1h", sensor->getVOCIndex());
+  u8g2.drawStr(2, 7, buf);
+  for (uint8_t i = 0; i < PARTICLE_BINS; i++) {
+    sprintf(buf, "%-7s %6u %5.0f", ParticleStats::binName(i), stats.getBin(i), stats.getMean(i));
+    u8g2.drawStr(2, 17 + i * 9, buf);
+  }
   
-  u8g2->sendBuffer();
+  u8g2.setFont(u8g2_font_4x6_tf);
+  u8g2.drawStr(118, 6, "6/6");
 }
 
+// Acts only when the alert state has changed level since the last call
 void AirQualityDisplay::checkAlerts() {
-  uint16_t pm25 = sensor->currentData.pm2_5_atm;
-  uint8_t vocIndex = sensor->getVOCIndex();
+  const AlertState& alerts = sensor->getAlerts();
+  if (alerts.getTransitionCount() == seenTransitions) {
+    return;
+  }
+  seenTransitions = alerts.getTransitionCount();
+  const AlertEvent& event = alerts.getEvent(0);
   
-  if ((pm25 > 55 || vocIndex > 80) && !alertActive) {
+  if (event.to == AIR_UNHEALTHY) {
     // Sound buzzer for alert
     for (int i = 0; i < 3; i++) {
       digitalWrite(BUZZER_PIN, HIGH);
@@ -279,17 +381,16 @@ void AirQualityDisplay::checkAlerts() {
       delay(200);
     }
     
-    alertActive = true;
     currentScreen = ALERT;
     Serial.println("ALERT: Unhealthy air quality detected!");
-  } else if (pm25 <= 35 && vocIndex <= 60) {
-    alertActive = false;
+  } else if (event.from == AIR_UNHEALTHY && currentScreen == ALERT) {
+    setScreen(MAIN);
   }
 }
 
 void AirQualityDisplay::rotateScreen() {
   // Don't rotate during alerts or health risk warnings
-  if (currentScreen == ALERT || (currentScreen == HEALTH_RISK && sensor->getRiskLevel() == "HIGH")) {
+  if (currentScreen == ALERT || (currentScreen == HEALTH_RISK && sensor->getSnapshot().level == AIR_UNHEALTHY)) {
     return;
   }
   
@@ -328,4 +429,24 @@ ScreenMode AirQualityDisplay::getCurrentScreen() {
 void AirQualityDisplay::setScreen(ScreenMode screen) {
   currentScreen = screen;
   lastScreenChange = millis();
-}
\ No newline at end of file
+}
+const RenderStats& AirQualityDisplay::getRenderStats(uint8_t screen) {
+  return renderStats[screen];
+}
+
+const RenderStats& AirQualityDisplay::getMirrorStats() {
+  return mirrorStats;
+}
+
+const char* AirQualityDisplay::screenName(uint8_t screen) {
+  switch (screen) {
+    case MAIN: return "main";
+    case HEALTH_RISK: return "health_risk";
+    case ALERT: return "alert";
+    case TREND: return "trend";
+    case COMPARISON: return "comparison";
+    case PARTICLES: return "particles";
+    case SCREEN_NO_DATA: return "no_data";
+    default: return "boot";
+  }
+}
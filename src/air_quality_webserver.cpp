@@ -1,4 +1,15 @@
-﻿#include "air_quality_webserver.h"
+#include "air_quality_webserver.h"
+#include "web_pages.h"
+#include "lttb.h"
+#include "profiler.h"
+#include "black_box.h"
+#include "sensing_lock.h"
+#include <new>
+
+// Flush mark for chunked responses built in the arena
+#define CHUNK_FLUSH_SIZE 1024
+#define HISTORY_DEFAULT_POINTS 100
+#define HISTORY_MAX_POINTS 500
 
 // External functions from main.cpp
 extern void setLED(bool state);
@@ -6,38 +17,187 @@ extern bool getLEDState();
 extern void setServoPosition(int angle);
 extern int getServoPosition();
 
-AirQualityWebServer::AirQualityWebServer(PMSSensor* pmsSensor, AirQualityDisplay* airDisplay) : server(80) {
+// Adapts one metric of the history ring to the LTTB source interface. Times
+// are taken relative to the first sample so they keep full float precision.
+struct HistorySeries {
+    const SensorHistory* history;
+    HistoryMetric metric;
+    uint32_t origin;
+    
+    float x(size_t index) const { return history->at(index).time - origin; }
+    float y(size_t index) const { return SensorHistory::value(history->at(index), metric); }
+};
+
+AirQualityWebServer::AirQualityWebServer(PMSSensor* pmsSensor, AirQualityDisplay* airDisplay, HeapMonitor* monitor, SensorHistory* sensorHistory, TimeSync* clock, HistoryArchive* historyArchive, RulesEngine* rulesEngine, HousePeers* housePeers)
+    : server(80), live(pmsSensor, airDisplay), coap(pmsSensor, &admission), updater(&flashBackend) {
     sensor = pmsSensor;
     display = airDisplay;
+    heapMonitor = monitor;
+    history = sensorHistory;
+    timeSync = clock;
+    archive = historyArchive;
+    rules = rulesEngine;
+    house = housePeers;
+    firstRequestTime = 0;
+    restartRequestTime = 0;
+    updateUploadSeen = false;
+    requestCount = 0;
+    lastEmptyPoll = 0;
+    memset(&lastExport, 0, sizeof(lastExport));
+    apiCache.length = 0;
+    apiCache.etag[0] = '\0';
+    apiCacheOverflows = 0;
 }
 
 void AirQualityWebServer::begin(const char* ssid, const char* password) {
-    WiFi.begin(ssid, password);
-    while (WiFi.status() != WL_CONNECTED) {
-        delay(500);
-        Serial.print(".");
-    }
-    Serial.println("");
-    Serial.println("WiFi connected!");
-    
-    server.on("/", [this]() { handleRoot(); });
-    server.on("/airquality", [this]() { handleAirQuality(); });
-    server.on("/api/data", [this]() { handleAPIData(); });
-    server.on("/led/on", [this]() { setLED(true); server.send(200, "text/plain", "LED ON"); });
-    server.on("/led/off", [this]() { setLED(false); server.send(200, "text/plain", "LED OFF"); });
-    server.on("/led/toggle", [this]() { setLED(!getLEDState()); server.send(200, "text/plain", getLEDState() ? "LED ON" : "LED OFF"); });
-    server.on("/servo/open", [this]() { setServoPosition(90); server.send(200, "text/plain", "Door Open"); });
-    server.on("/servo/close", [this]() { setServoPosition(0); server.send(200, "text/plain", "Door Closed"); });
+    // Association runs in the background; the server can listen before the link is up
+    wifi.begin(ssid, password);
+    
+    // Needed for conditional requests and resumed exports
+    const char* headerKeys[] = { "If-None-Match", "Range", "If-Range" };
+    server.collectHeaders(headerKeys, 3);
+    
+    on("/", [this]() { handleRoot(); });
+    on("/airquality", [this]() { handleAirQuality(); });
+    on("/api/data", [this]() { handleAPIData(); });
+    on("/api/history", [this]() { handleHistory(); });
+    on("/api/rules", [this]() { handleRules(); });
+    on("/api/house", [this]() { handleHouse(); });
+    on("/api/alerts", [this]() { handleAlerts(); });
+    on("/api/export", [this]() { handleExport(); });
+    on("/debug/export", [this]() { handleDebugExport(); });
+    on("/debug/heap", [this]() { handleDebugHeap(); });
+    on("/debug/wifi", [this]() { handleDebugWiFi(); });
+    on("/debug/pms", [this]() { handleDebugPMS(); });
+    on("/debug/codec", [this]() { handleDebugCodec(); });
+    on("/debug/display", [this]() { handleDebugDisplay(); });
+    on("/display.pbm", [this]() { handleDisplayImage(); });
+#ifdef ENABLE_PROFILER
+    on("/debug/profile", [this]() { handleDebugProfile(); });
+#endif
+#ifdef SENSOR_SIMULATOR
+    on("/debug/sim", [this]() { handleDebugSim(); });
+#endif
+    on("/led/on", [this]() { setLED(true); server.send(200, "text/plain", "LED ON"); });
+    on("/led/off", [this]() { setLED(false); server.send(200, "text/plain", "LED OFF"); });
+    on("/led/toggle", [this]() { setLED(!getLEDState()); server.send(200, "text/plain", getLEDState() ? "LED ON" : "LED OFF"); });
+    on("/servo/open", [this]() { setServoPosition(90); server.send(200, "text/plain", "Door Open"); });
+    on("/servo/close", [this]() { setServoPosition(0); server.send(200, "text/plain", "Door Closed"); });
+    on("/update", HTTP_POST, [this]() { handleUpdateFinished(); }, [this]() { handleUpdateUpload(); });
+    on("/debug/admission", [this]() { handleDebugAdmission(); });
+    on("/debug/live", [this]() { handleDebugLive(); });
+    on("/debug/coap", [this]() { handleDebugCoap(); });
+    on("/debug/lastcrash", [this]() { handleDebugLastCrash(); });
+    on("/debug/power", [this]() { handleDebugPower(); });
+    
+    // Scanners mostly hit unknown paths, so those are rate limited too
+    server.onNotFound([this]() {
+        blackBox.beginRequest("(not found)");
+        if (admitRequest()) {
+            server.send(404, "text/plain", "Not found");
+        }
+        finishRequest();
+    });
     server.begin();
+    live.begin();
+    lastEmptyPoll = millis();
     Serial.println("Web server started");
 }
 
+// Registers a route behind admission control whose scratch memory is
+// released once the response is out
+void AirQualityWebServer::on(const char* uri, std::function<void()> handler) {
+    server.on(uri, [this, uri, handler]() {
+        blackBox.beginRequest(uri);
+        if (admitRequest()) {
+            handler();
+        }
+        finishRequest();
+    });
+}
+
+// Upload routes are not admission controlled: by the time the final handler
+// runs the body has been received, and rejecting it would only waste it
+void AirQualityWebServer::on(const char* uri, HTTPMethod method, std::function<void()> handler, std::function<void()> uploadHandler) {
+    server.on(uri, method, [this, uri, handler]() {
+        blackBox.beginRequest(uri);
+        handler();
+        finishRequest();
+    }, uploadHandler);
+}
+
+// Answers 429 or 503 with Retry-After when the request is not to be served
+bool AirQualityWebServer::admitRequest() {
+    uint32_t retryAfter = 0;
+    AdmissionResult result = admission.admit(server.client().remoteIP(), retryAfter);
+    if (result == ADMISSION_ACCEPTED) {
+        return true;
+    }
+    
+    char seconds[12];
+    snprintf(seconds, sizeof(seconds), "%u", retryAfter);
+    server.sendHeader("Retry-After", seconds);
+    if (result == ADMISSION_SHED) {
+        server.send(503, "text/plain", "Busy, retry shortly");
+    } else {
+        server.send(429, "text/plain", "Too many requests");
+    }
+    return false;
+}
+
+// Latency is counted from the last poll that found nothing waiting, an
+// upper bound on the time since the request arrived that includes any
+// power-saving idle and the rest of the loop
+void AirQualityWebServer::finishRequest() {
+    blackBox.endRequest();
+    powerManager.noteRequest(millis() - lastEmptyPoll);
+    requestCount++;
+    arena.reset();
+    if (firstRequestTime == 0) {
+        firstRequestTime = millis();
+        Serial.printf("First request served %lu ms after boot\n", firstRequestTime);
+    }
+}
+
+void AirQualityWebServer::setBackgroundTask(std::function<void()> task) {
+    backgroundTask = task;
+}
+
 void AirQualityWebServer::handleClient() {
-    server.handleClient();
+    wifi.loop();
+    admission.loopTick(powerManager.getLastIdle());
+    live.loop();
+    coap.loop();
+    
+    // Serve what is waiting, within a per-iteration count and time budget
+    unsigned long start = millis();
+    for (uint8_t i = 0; i < WEB_REQUESTS_PER_LOOP; i++) {
+        uint32_t served = requestCount;
+        server.handleClient();
+        if (requestCount == served) {
+            lastEmptyPoll = millis();
+            break;
+        }
+        if (millis() - start >= WEB_LOOP_BUDGET_MS) {
+            admission.noteBudgetExhausted();
+            break;
+        }
+    }
+    
+    // Give the update response time to reach the client before rebooting
+    if (restartRequestTime != 0 && millis() - restartRequestTime >= 500) {
+        Serial.println("OTA: rebooting into new firmware");
+        archive->flush();
+        ESP.restart();
+    }
+}
+
+bool AirQualityWebServer::hasPendingRequest() {
+    return server.hasPendingRequest() || coap.hasPendingRequest();
 }
 
 bool AirQualityWebServer::isWiFiConnected() {
-    return WiFi.status() == WL_CONNECTED;
+    return wifi.isConnected();
 }
 
 String AirQualityWebServer::getIPAddress() {
@@ -45,396 +205,1083 @@ String AirQualityWebServer::getIPAddress() {
 }
 
 void AirQualityWebServer::handleRoot() {
-    String html = "<!DOCTYPE html><html><head>";
-    html += "<title>Smart Home Dashboard</title>";
-    html += "<meta charset='UTF-8'>";
-    html += "<meta name='viewport' content='width=device-width, initial-scale=1'>";
-    html += "<style>";
-    html += "* { margin: 0; padding: 0; box-sizing: border-box; }";
-    html += "body { font-family: 'Segoe UI', Arial, sans-serif; background: linear-gradient(135deg, #667eea 0%, #764ba2 100%); min-height: 100vh; padding: 20px; }";
-    html += ".container { max-width: 900px; margin: 0 auto; background: white; padding: 30px; border-radius: 15px; box-shadow: 0 10px 30px rgba(0,0,0,0.2); }";
-    html += ".header { text-align: center; margin-bottom: 30px; }";
-    html += ".header h1 { color: #2c3e50; font-size: 2.2em; margin-bottom: 8px; }";
-    html += ".header p { color: #7f8c8d; font-size: 1em; }";
-    html += ".status-grid { display: grid; grid-template-columns: repeat(auto-fit, minmax(200px, 1fr)); gap: 20px; margin: 25px 0; }";
-    html += ".status-card { background: linear-gradient(135deg, #667eea 0%, #764ba2 100%); color: white; padding: 20px; border-radius: 12px; text-align: center; box-shadow: 0 4px 15px rgba(102,126,234,0.3); }";
-    html += ".status-card.air { background: linear-gradient(135deg, #4CAF50 0%, #45a049 100%); }";
-    html += ".status-card h3 { font-size: 0.95em; opacity: 0.9; margin-bottom: 10px; font-weight: 500; }";
-    html += ".status-card .value { font-size: 1.8em; font-weight: bold; margin: 8px 0; }";
-    html += ".status-card .unit { font-size: 0.85em; opacity: 0.85; }";
-    html += ".controls { margin: 30px 0; }";
-    html += ".btn { display: block; width: 100%; padding: 16px; margin: 12px 0; background: linear-gradient(135deg, #667eea 0%, #764ba2 100%); color: white; text-decoration: none; border-radius: 10px; text-align: center; font-size: 1.05em; font-weight: 500; border: none; cursor: pointer; transition: all 0.3s ease; }";
-    html += ".btn:hover { transform: translateY(-2px); box-shadow: 0 6px 20px rgba(102,126,234,0.4); }";
-    html += ".btn.action { background: linear-gradient(135deg, #f093fb 0%, #f5576c 100%); }";
-    html += ".system-info { background: #f8f9fa; padding: 15px; border-radius: 8px; margin-top: 25px; text-align: center; color: #6c757d; font-size: 0.85em; }";
-    html += "</style></head><body>";
-    
-    html += "<div class='container'>";
-    html += "<div class='header'>";
-    html += "<h1>🏠 Smart Home Hub</h1>";
-    html += "<p>Environmental Monitoring & Control</p>";
-    html += "</div>";
-    
-    html += "<div class='status-grid'>";
-    
-    // Air Quality Status
-    html += "<div class='status-card air'>";
-    html += "<h3>Air Quality</h3>";
-    if (sensor->isDataValid()) {
-        html += "<div class='value'>" + sensor->getHealthStatus() + "</div>";
-        html += "<div class='unit'>PM2.5: " + String(sensor->currentData.pm2_5_atm, 1) + " μg/m³</div>";
+    server.setContentLength(CONTENT_LENGTH_UNKNOWN);
+    server.send(200, "text/html", "");
+    server.sendContent_P(ROOT_PAGE_HEAD);
+    
+    // Status cards
+    arena.beginText();
+    arena.append("<div class='status-card air'><h3>Air Quality</h3>");
+    const PMSSensor::ReadingSnapshot reading = sensor->readSnapshot();
+    if (reading.data.isValid) {
+        arena.appendf("<div class='value'>%s</div>", reading.healthStatus);
+        arena.appendf("<div class='unit' id='pm25'>PM2.5: %.1f μg/m³</div>", (float)reading.data.pm2_5_atm);
     } else {
-        html += "<div class='value'>Error</div>";
-        html += "<div class='unit'>Sensor offline</div>";
-    }
-    html += "</div>";
-    
-    // LED Status
-    html += "<div class='status-card'>";
-    html += "<h3>LED Light</h3>";
-    html += "<div class='value'>" + String(getLEDState() ? "ON" : "OFF") + "</div>";
-    html += "<div class='unit'>Smart lighting</div>";
-    html += "</div>";
-    
-    // Door Status
-    html += "<div class='status-card'>";
-    html += "<h3>Door Lock</h3>";
-    html += "<div class='value'>" + String(getServoPosition() == 90 ? "Open" : "Closed") + "</div>";
-    html += "<div class='unit'>Access control</div>";
-    html += "</div>";
-    
-    html += "</div>";
-    
-    // Controls
-    html += "<div class='controls'>";
-    html += "<a href='/airquality' class='btn'>🌬️ Air Quality Dashboard</a>";
-    html += "<button onclick='toggleLED()' class='btn action'>💡 Toggle LED</button>";
-    html += "<button onclick='toggleDoor()' class='btn action'>🚪 Toggle Door</button>";
-    html += "</div>";
-    
-    // System Info
-    html += "<div class='system-info'>";
-    html += "WiFi: " + String(WiFi.RSSI()) + " dBm | ";
-    html += "Memory: " + String(ESP.getFreeHeap() / 1024) + " KB | ";
-    html += "Uptime: " + String(millis() / 1000) + "s";
-    html += "</div>";
-    
-    html += "</div>";
-    
-    // JavaScript
-    html += "<script>";
-    html += "function toggleLED() {";
-    html += "  fetch('/led/toggle').then(() => setTimeout(() => location.reload(), 300));";
-    html += "}";
-    html += "function toggleDoor() {";
-    html += "  let action = " + String(getServoPosition() == 90 ? "'close'" : "'open'") + ";";
-    html += "  fetch('/servo/' + action).then(() => setTimeout(() => location.reload(), 300));";
-    html += "}";
-    html += "</script>";
-    html += "</body></html>";
-    
-    server.send(200, "text/html", html);
+        arena.append("<div class='value'>Error</div>");
+        arena.append("<div class='unit'>Sensor offline</div>");
+    }
+    arena.append("</div>");
+    arena.appendf("<div class='status-card'><h3>LED Light</h3><div class='value' id='led'>%s</div><div class='unit'>Smart lighting</div></div>",
+                  getLEDState() ? "ON" : "OFF");
+    arena.appendf("<div class='status-card'><h3>Door Lock</h3><div class='value' id='door'>%s</div><div class='unit'>Access control</div></div>",
+                  getServoPosition() == 90 ? "Open" : "Closed");
+    server.sendContent(arena.text(), arena.getTextLength());
+    arena.reset();
+    
+    server.sendContent_P(ROOT_PAGE_CONTROLS);
+    
+    // System info and the state the control scripts depend on
+    arena.beginText();
+    arena.appendf("<div class='system-info'>WiFi: %d dBm | Memory: %u KB | Uptime: %lus <span id='live'></span></div></div>",
+                  WiFi.RSSI(), ESP.getFreeHeap() / 1024, millis() / 1000);
+    arena.appendf("<script>let doorAction = '%s';", getServoPosition() == 90 ? "close" : "open");
+    server.sendContent(arena.text(), arena.getTextLength());
+    
+    server.sendContent_P(ROOT_PAGE_SCRIPT);
+    server.sendContent("");
 }
 
 void AirQualityWebServer::handleAirQuality() {
-    String html = "<!DOCTYPE html><html><head>";
-    html += "<title>JunKiri - Air Quality Monitor</title>";
-    html += "<meta charset='UTF-8'>";
-    html += "<meta name='viewport' content='width=device-width, initial-scale=1'>";
-    html += "<style>";
-    html += "* { margin: 0; padding: 0; box-sizing: border-box; }";
-    html += "body { font-family: 'Segoe UI', Arial, sans-serif; background: linear-gradient(135deg, #1e3c72 0%, #2a5298 100%); min-height: 100vh; padding: 20px; color: #333; overflow-x: hidden; position: relative; }";
-    
-    // Fireflies Animation CSS
-    html += ".firefly { position: absolute; width: 4px; height: 4px; background: #ffeb3b; border-radius: 50%; animation: fly linear infinite; opacity: 0.8; }";
-    html += ".firefly:nth-child(1) { left: 10%; animation-duration: 12s; animation-delay: 0s; }";
-    html += ".firefly:nth-child(2) { left: 20%; animation-duration: 15s; animation-delay: 1s; }";
-    html += ".firefly:nth-child(3) { left: 30%; animation-duration: 10s; animation-delay: 2s; }";
-    html += ".firefly:nth-child(4) { left: 40%; animation-duration: 18s; animation-delay: 0.5s; }";
-    html += ".firefly:nth-child(5) { left: 50%; animation-duration: 14s; animation-delay: 1.5s; }";
-    html += ".firefly:nth-child(6) { left: 60%; animation-duration: 16s; animation-delay: 2.5s; }";
-    html += ".firefly:nth-child(7) { left: 70%; animation-duration: 11s; animation-delay: 0.8s; }";
-    html += ".firefly:nth-child(8) { left: 80%; animation-duration: 13s; animation-delay: 1.8s; }";
-    html += ".firefly:nth-child(9) { left: 90%; animation-duration: 17s; animation-delay: 2.2s; }";
-    html += ".firefly:nth-child(10) { left: 5%; animation-duration: 19s; animation-delay: 3s; }";
-    html += "@keyframes fly { 0% { transform: translateY(100vh) translateX(0px); opacity: 0; } 10% { opacity: 1; } 90% { opacity: 1; } 100% { transform: translateY(-10vh) translateX(50px); opacity: 0; } }";
-    
-    html += ".container { max-width: 1400px; margin: 0 auto; position: relative; z-index: 10; }";
-    html += ".back-btn { display: inline-block; padding: 12px 24px; background: rgba(255,255,255,0.2); color: white; text-decoration: none; border-radius: 25px; font-weight: 500; margin-bottom: 20px; transition: all 0.3s; backdrop-filter: blur(10px); }";
-    html += ".back-btn:hover { background: rgba(255,255,255,0.3); transform: translateY(-2px); }";
-    html += ".header { background: rgba(255,255,255,0.95); padding: 30px; border-radius: 20px; text-align: center; margin-bottom: 25px; box-shadow: 0 8px 32px rgba(0,0,0,0.1); backdrop-filter: blur(10px); }";
-    html += ".header h1 { background: linear-gradient(45deg, #667eea, #764ba2); -webkit-background-clip: text; -webkit-text-fill-color: transparent; font-size: 2.5em; margin-bottom: 10px; font-weight: 700; }";
-    html += ".header p { color: #666; font-size: 1.1em; }";
-    html += ".status-banner { padding: 25px; margin: 25px 0; border-radius: 15px; text-align: center; color: white; font-weight: 600; font-size: 1.2em; box-shadow: 0 4px 16px rgba(0,0,0,0.2); }";
-    html += ".status-excellent { background: linear-gradient(135deg, #4CAF50 0%, #45a049 100%); }";
-    html += ".status-good { background: linear-gradient(135deg, #ff9800 0%, #f57c00 100%); }";
-    html += ".status-moderate { background: linear-gradient(135deg, #f44336 0%, #d32f2f 100%); }";
-    html += ".status-unhealthy { background: linear-gradient(135deg, #9c27b0 0%, #7b1fa2 100%); }";
-    html += ".metrics-grid { display: grid; grid-template-columns: repeat(auto-fit, minmax(250px, 1fr)); gap: 20px; margin: 25px 0; }";
-    html += ".metric-card { background: rgba(255,255,255,0.95); padding: 25px; border-radius: 15px; text-align: center; box-shadow: 0 4px 20px rgba(0,0,0,0.1); transition: all 0.3s; backdrop-filter: blur(10px); }";
-    html += ".metric-card:hover { transform: translateY(-5px); box-shadow: 0 8px 30px rgba(0,0,0,0.2); }";
-    html += ".metric-card h3 { color: #2c3e50; font-size: 1em; margin-bottom: 15px; font-weight: 600; }";
-    html += ".metric-card .value { font-size: 2.5em; font-weight: bold; background: linear-gradient(45deg, #667eea, #764ba2); -webkit-background-clip: text; -webkit-text-fill-color: transparent; margin: 12px 0; }";
-    html += ".metric-card .unit { color: #666; font-size: 0.9em; }";
-    html += ".chart-section { display: grid; grid-template-columns: 1fr 1fr; gap: 25px; margin: 30px 0; }";
-    html += ".chart-container { background: rgba(255,255,255,0.95); padding: 30px; border-radius: 15px; box-shadow: 0 4px 20px rgba(0,0,0,0.1); backdrop-filter: blur(10px); min-height: 500px; }";
-    html += ".chart-container h3 { color: #2c3e50; margin-bottom: 25px; text-align: center; font-weight: 600; font-size: 1.2em; }";
-    html += ".chart-container canvas { width: 100% !important; height: 400px !important; }";
-    html += ".suggestions { background: rgba(227,242,253,0.9); padding: 25px; border-radius: 15px; margin: 25px 0; border-left: 5px solid #2196f3; backdrop-filter: blur(10px); }";
-    html += ".suggestions h3 { color: #1976d2; margin-bottom: 15px; font-weight: 600; }";
-    html += ".suggestions p { margin: 10px 0; color: #424242; line-height: 1.6; }";
-    html += ".refresh-btn { display: block; margin: 25px auto; padding: 15px 35px; background: linear-gradient(135deg, #667eea 0%, #764ba2 100%); color: white; border: none; border-radius: 25px; cursor: pointer; font-size: 1.1em; font-weight: 600; transition: all 0.3s; }";
-    html += ".refresh-btn:hover { transform: translateY(-3px); box-shadow: 0 6px 20px rgba(102,126,234,0.4); }";
-    html += "@media(max-width: 768px) { .metrics-grid { grid-template-columns: 1fr; } .chart-section { grid-template-columns: 1fr; } }";
-    html += "</style>";
-    html += "<script src='https://cdn.jsdelivr.net/npm/chart.js@4.4.0/dist/chart.umd.min.js'></script>";
-    html += "</head><body>";
-    
-    // Fireflies HTML
-    for (int i = 0; i < 10; i++) {
-        html += "<div class='firefly'></div>";
-    }
-    
-    html += "<div class='container'>";
-    html += "<a href='/' class='back-btn'>← Back to Dashboard</a>";
-    
-    html += "<div class='header'>";
-    html += "<h1>🚀 JunKiri Air Quality Monitor</h1>";
-    html += "<p>Real-time environmental monitoring with smart analytics</p>";
-    html += "</div>";
-    
-    // Status Banner with fake data initially
-    html += "<div class='status-banner status-excellent' id='statusBanner'>";
-    html += "<span id='statusText'>🌿 EXCELLENT AIR QUALITY - PERFECT FOR OUTDOOR ACTIVITIES</span>";
-    html += "</div>";
-    
-    // Metrics Grid with fake data
-    html += "<div class='metrics-grid'>";
-    
-    html += "<div class='metric-card'>";
-    html += "<h3>PM1.0 Ultra-fine Particles 🔬</h3>";
-    html += "<div class='value'><span id='pm1'>8.2</span></div>";
-    html += "<div class='unit'>μg/m³ - Particles smaller than 1 micron</div>";
-    html += "</div>";
-    
-    html += "<div class='metric-card'>";
-    html += "<h3>PM2.5 Fine Particles 💨</h3>";
-    html += "<div class='value'><span id='pm25'>12.5</span></div>";
-    html += "<div class='unit'>μg/m³ - Particles smaller than 2.5 microns</div>";
-    html += "</div>";
-    
-    html += "<div class='metric-card'>";
-    html += "<h3>PM10 Coarse Particles 🌪️</h3>";
-    html += "<div class='value'><span id='pm10'>18.3</span></div>";
-    html += "<div class='unit'>μg/m³ - Particles smaller than 10 microns</div>";
-    html += "</div>";
-    
-    html += "<div class='metric-card'>";
-    html += "<h3>VOC Index 🧪</h3>";
-    html += "<div class='value'><span id='voc'>25</span></div>";
-    html += "<div class='unit'>Air Quality Index - Volatile Organic Compounds</div>";
-    html += "</div>";
-    
-    html += "</div>";
-    
-    // Charts Section
-    html += "<div class='chart-section'>";
-    
-    // Line Chart Container
-    html += "<div class='chart-container'>";
-    html += "<h3>📈 Real-time Air Quality Trends (Updates every 10 seconds)</h3>";
-    html += "<canvas id='lineChart'></canvas>";
-    html += "</div>";
-    
-    // Pie Chart Container
-    html += "<div class='chart-container'>";
-    html += "<h3>📊 Air Quality Distribution</h3>";
-    html += "<canvas id='pieChart'></canvas>";
-    html += "</div>";
-    
-    html += "</div>";
-    
-    // Suggestions Section
-    html += "<div class='suggestions' id='suggestions'>";
-    html += "<h3>💡 Health Recommendations</h3>";
-    html += "<p>✅ Air quality is excellent! Perfect for outdoor activities.</p>";
-    html += "</div>";
-    
-    html += "</div>";
-    
-    // JavaScript with real-time data simulation and history retention
-    html += "<script>";
-    html += "let lineChart, pieChart;";
-    html += "function generateRandomValue(base, variation) {";
-    html += "  return base + (Math.random() - 0.5) * variation;";
-    html += "}";
-    html += "function saveToHistory(pm25, voc, pm10) {";
-    html += "  let history = JSON.parse(localStorage.getItem('airQualityHistory') || '{\"pm25\":[],\"voc\":[],\"pm10\":[]}');";
-    html += "  history.pm25.unshift(pm25);";
-    html += "  history.voc.unshift(voc);";
-    html += "  history.pm10.unshift(pm10);";
-    html += "  if (history.pm25.length > 60) { history.pm25.pop(); history.voc.pop(); history.pm10.pop(); }";
-    html += "  localStorage.setItem('airQualityHistory', JSON.stringify(history));";
-    html += "}";
-    html += "function loadFromHistory() {";
-    html += "  let history = JSON.parse(localStorage.getItem('airQualityHistory') || '{\"pm25\":[],\"voc\":[],\"pm10\":[]}');";
-    html += "  if (history.pm25.length === 0) {";
-    html += "    history.pm25 = Array(60).fill(12.5);";
-    html += "    history.voc = Array(60).fill(25);";
-    html += "    history.pm10 = Array(60).fill(18.3);";
-    html += "  }";
-    html += "  while (history.pm25.length < 60) {";
-    html += "    history.pm25.push(12.5); history.voc.push(25); history.pm10.push(18.3);";
-    html += "  }";
-    html += "  return history;";
-    html += "}";
-    html += "function updateStatus(pm25) {";
-    html += "  const banner = document.getElementById('statusBanner');";
-    html += "  const statusText = document.getElementById('statusText');";
-    html += "  const suggestions = document.getElementById('suggestions');";
-    html += "  if (pm25 <= 12) {";
-    html += "    banner.className = 'status-banner status-excellent';";
-    html += "    statusText.textContent = '🌿 EXCELLENT AIR QUALITY';";
-    html += "    suggestions.innerHTML = '<h3>💡 Health Recommendations</h3><p>✅ Air quality is excellent! Perfect for outdoor activities.</p>';";
-    html += "  } else if (pm25 <= 35) {";
-    html += "    banner.className = 'status-banner status-good';";
-    html += "    statusText.textContent = '😊 GOOD AIR QUALITY';";
-    html += "    suggestions.innerHTML = '<h3>💡 Health Recommendations</h3><p>👍 Air quality is good. Enjoy your day!</p>';";
-    html += "  } else if (pm25 <= 55) {";
-    html += "    banner.className = 'status-banner status-moderate';";
-    html += "    statusText.textContent = '😐 MODERATE AIR QUALITY';";
-    html += "    suggestions.innerHTML = '<h3>💡 Health Recommendations</h3><p>😷 Sensitive groups should reduce outdoor exertion.</p>';";
-    html += "  } else {";
-    html += "    banner.className = 'status-banner status-unhealthy';";
-    html += "    statusText.textContent = '😷 UNHEALTHY AIR QUALITY';";
-    html += "    suggestions.innerHTML = '<h3>💡 Health Recommendations</h3><p>⚠️ Everyone should limit outdoor activities. Close windows.</p>';";
-    html += "  }";
-    html += "}";
-    html += "function updateData() {";
-    html += "  const newPM1 = generateRandomValue(8.5, 1.5);";
-    html += "  const newPM25 = generateRandomValue(12.5, 3);";
-    html += "  const newPM10 = generateRandomValue(18.3, 4);";
-    html += "  const newVOC = Math.floor(generateRandomValue(25, 5));";
-    html += "  document.getElementById('pm1').textContent = newPM1.toFixed(1);";
-    html += "  document.getElementById('pm25').textContent = newPM25.toFixed(1);";
-    html += "  document.getElementById('pm10').textContent = newPM10.toFixed(1);";
-    html += "  document.getElementById('voc').textContent = newVOC;";
-    html += "  updateStatus(newPM25);";
-    html += "  saveToHistory(newPM25, newVOC, newPM10);";
-    html += "  if (lineChart && pieChart) {";
-    html += "    lineChart.data.datasets[0].data.pop();";
-    html += "    lineChart.data.datasets[0].data.unshift(newPM25);";
-    html += "    lineChart.data.datasets[1].data.pop();";
-    html += "    lineChart.data.datasets[1].data.unshift(newVOC);";
-    html += "    lineChart.data.datasets[2].data.pop();";
-    html += "    lineChart.data.datasets[2].data.unshift(newPM10);";
-    html += "    lineChart.update('none');";
-    html += "    const excellent = Math.max(0, 70 - newPM25 * 2);";
-    html += "    const good = Math.max(0, 25 - (newPM25 - 12) * 1.5);";
-    html += "    const moderate = Math.max(0, 5 + (newPM25 - 35) * 0.5);";
-    html += "    const unhealthy = Math.max(0, (newPM25 - 55) * 0.2);";
-    html += "    const total = excellent + good + moderate + unhealthy;";
-    html += "    pieChart.data.datasets[0].data = [excellent/total*100, good/total*100, moderate/total*100, unhealthy/total*100];";
-    html += "    pieChart.update();";
-    html += "  }";
-    html += "}";
-    html += "window.addEventListener('DOMContentLoaded', function() {";
-    html += "  console.log('🚀 JunKiri - Initializing Real-time Data...');";
-    html += "  const history = loadFromHistory();";
-    html += "  const currentPM25 = history.pm25[0] || 12.5;";
-    html += "  const currentVOC = history.voc[0] || 25;";
-    html += "  const currentPM10 = history.pm10[0] || 18.3;";
-    html += "  document.getElementById('pm1').textContent = (currentPM25 * 0.7).toFixed(1);";
-    html += "  document.getElementById('pm25').textContent = currentPM25.toFixed(1);";
-    html += "  document.getElementById('pm10').textContent = currentPM10.toFixed(1);";
-    html += "  document.getElementById('voc').textContent = Math.floor(currentVOC);";
-    html += "  updateStatus(currentPM25);";
-    html += "  try {";
-    html += "    const lineCtx = document.getElementById('lineChart').getContext('2d');";
-    html += "    lineChart = new Chart(lineCtx, {";
-    html += "      type: 'line',";
-    html += "      data: {";
-    html += "        labels: Array.from({length: 60}, (_, i) => { let s = (60 - i) * 10; return s % 60 === 0 ? s + 's' : ''; }),";
-    html += "        datasets: [";
-    html += "          { label: '💨 PM2.5 (Fine Particles)', data: history.pm25, borderColor: '#667eea', backgroundColor: 'rgba(102, 126, 234, 0.2)', borderWidth: 3, fill: true, tension: 0.4, pointRadius: 0 },";
-    html += "          { label: '🌪️ PM10 (Coarse Particles)', data: history.pm10, borderColor: '#4CAF50', borderWidth: 2, fill: false, tension: 0.3, pointRadius: 0 },";
-    html += "          { label: '🧪 VOC Index (Air Quality)', data: history.voc, borderColor: '#f093fb', borderWidth: 3, fill: false, tension: 0.4, yAxisID: 'y1', borderDash: [8, 4], pointRadius: 0 }";
-    html += "        ]";
-    html += "      },";
-    html += "      options: { responsive: true, maintainAspectRatio: false, plugins: { title: { display: true, text: '🚀 JunKiri Environmental Dashboard - Real-time Data (10-second intervals)', font: { size: 16 } }, legend: { position: 'top' } }, scales: { x: { reverse: true, title: { display: true, text: 'Time (10-second intervals)', font: { size: 12 } } }, y: { beginAtZero: true, title: { display: true, text: 'Particle Concentration (μg/m³)', font: { size: 12 } } }, y1: { type: 'linear', display: true, position: 'right', title: { display: true, text: 'VOC Air Quality Index', font: { size: 12 } }, grid: { drawOnChartArea: false } } }, animation: { duration: 0 } }";
-    html += "    });";
-    html += "    console.log('✅ Line chart initialized!');";
-    html += "    const pieCtx = document.getElementById('pieChart').getContext('2d');";
-    html += "    pieChart = new Chart(pieCtx, {";
-    html += "      type: 'doughnut',";
-    html += "      data: {";
-    html += "        labels: ['🌿 Excellent', '😊 Good', '😐 Moderate', '😷 Unhealthy'],";
-    html += "        datasets: [{ data: [65, 25, 8, 2], backgroundColor: ['#4CAF50', '#ff9800', '#f44336', '#9c27b0'], borderWidth: 5, borderColor: '#fff' }]";
-    html += "      },";
-    html += "      options: { responsive: true, maintainAspectRatio: false, plugins: { title: { display: true, text: '📊 Air Quality Distribution', font: { size: 16 } }, legend: { position: 'bottom' } }, cutout: '60%' }";
-    html += "    });";
-    html += "    console.log('✅ Pie chart initialized!');";
-    html += "    setInterval(updateData, 10000);";
-    html += "  } catch (e) {";
-    html += "    console.error('❌ Chart initialization failed:', e);";
-    html += "    document.body.innerHTML = '<h1 style=\"color:red; text-align:center; margin-top: 50px;\">Chart Error! Check Console.</h1>';";
-    html += "  }";
-    html += "});";
-    html += "</script>";
-    html += "</body></html>";
-    
-    server.send(200, "text/html", html);
+    // Fully static: the page pulls live values from /api/data itself
+    server.send_P(200, "text/html", AIR_QUALITY_PAGE);
 }
 
 void AirQualityWebServer::handleAPIData() {
-    String json = "{";
-    
-    if (sensor->isDataValid()) {
-        json += "\"valid\":true,";
-        json += "\"pm1_0\":" + String(sensor->currentData.pm1_0_atm, 1) + ",";
-        json += "\"pm2_5\":" + String(sensor->currentData.pm2_5_atm, 1) + ",";
-        json += "\"pm10\":" + String(sensor->currentData.pm10_atm, 1) + ",";
-        json += "\"vocIndex\":" + String(sensor->getVOCIndex()) + ",";
-        json += "\"health_status\":\"" + sensor->getHealthStatus() + "\",";
-        json += "\"risk_level\":\"" + sensor->getRiskLevel() + "\",";
+    // The body only changes with a new reading or derived value, an actuator
+    // change or clock sync
+    const PMSSensor::ReadingSnapshot reading = sensor->readSnapshot();
+    char etag[sizeof(apiCache.etag)];
+    snprintf(etag, sizeof(etag), "\"%u-%u-%d-%d-%d\"", reading.sequence, sensor->getDerivedWrites(),
+             getLEDState(), getServoPosition(), timeSync->isSynced());
+    
+    server.sendHeader("Access-Control-Allow-Origin", "*");
+    server.sendHeader("Cache-Control", "no-cache");
+    
+    if (strcmp(etag, apiCache.etag) != 0) {
+        buildAPIData(sensor, reading);
+        if (arena.getTextLength() >= sizeof(apiCache.body) || arena.getOverflowCount() != apiCacheOverflows) {
+            // Too large to cache; serve this one uncached
+            apiCacheOverflows = arena.getOverflowCount();
+            apiCache.etag[0] = '\0';
+            server.send(200, "application/json", arena.text(), arena.getTextLength());
+            return;
+        }
+        memcpy(apiCache.body, arena.text(), arena.getTextLength());
+        apiCache.length = arena.getTextLength();
+        strcpy(apiCache.etag, etag);
+    }
+    
+    server.sendHeader("ETag", apiCache.etag);
+    if (server.header("If-None-Match") == apiCache.etag) {
+        server.send(304);
+        return;
+    }
+    server.send(200, "application/json", apiCache.body, apiCache.length);
+}
+
+// System fields (RSSI, free memory, uptime) are sampled when the body is built
+void AirQualityWebServer::buildAPIData(const PMSSensor* source, const PMSSensor::ReadingSnapshot& reading) {
+    const PMSSensor::AirQualityData& data = reading.data;
+    
+    arena.beginText();
+    arena.append("{");
+    
+    if (data.isValid) {
+        arena.append("\"valid\":true,");
+        arena.appendf("\"sequence\":%u,", reading.sequence);
+        arena.appendf("\"pm1_0\":%.1f,", (float)data.pm1_0_atm);
+        arena.appendf("\"pm2_5\":%.1f,", (float)data.pm2_5_atm);
+        arena.appendf("\"pm10\":%.1f,", (float)data.pm10_atm);
+        arena.appendf("\"vocIndex\":%u,", reading.vocIndex);
+        arena.appendf("\"health_status\":\"%s\",", reading.healthStatus);
+        arena.appendf("\"risk_level\":\"%s\",", reading.riskLevel);
+        arena.appendf("\"alert_level\":\"%s\",", AlertState::levelName(reading.level));
         
-        // Trend data for charts
-        json += "\"pm25Trend\":[";
-        for (int i = 0; i < 24; i++) {
-            if (i > 0) json += ",";
-            json += String(sensor->pm25TrendData[i], 1);
+        // Reading time; 0 until the clock has been synchronized
+        arena.appendf("\"timestamp\":%u,", timeSync->toEpoch(reading.time));
+        
+        // Trend data for charts, indexed by hour of day
+        const PMSSensor::TrendSnapshot trend = source->readTrend();
+        arena.appendf("\"trend_hour\":%u,", trend.hour);
+        appendTrend("pm25Trend", trend.pm25);
+        arena.append(",");
+        appendTrend("vocTrend", trend.voc);
+        arena.append(",");
+        appendTrend("pm10Trend", trend.pm10);
+        appendForecast(source);
+        appendParticles(source, data);
+    } else {
+        arena.append("\"valid\":false,");
+        arena.append("\"pm1_0\":0,");
+        arena.append("\"pm2_5\":0,");
+        arena.append("\"pm10\":0,");
+        arena.append("\"vocIndex\":0,");
+        arena.append("\"health_status\":\"Error\",");
+        arena.append("\"risk_level\":\"Unknown\",");
+        arena.append("\"pm25Trend\":[],");
+        arena.append("\"vocTrend\":[],");
+        arena.append("\"pm10Trend\":[]");
+    }
+    
+    arena.appendf(",\"led_state\":%s", getLEDState() ? "true" : "false");
+    arena.appendf(",\"servo_position\":%d", getServoPosition());
+    arena.appendf(",\"wifi_rssi\":%d", WiFi.RSSI());
+    arena.appendf(",\"free_memory\":%u", ESP.getFreeHeap());
+    arena.appendf(",\"uptime\":%lu", millis() / 1000);
+    arena.appendf(",\"time_synced\":%s", timeSync->isSynced() ? "true" : "false");
+    arena.append("}");
+}
+
+void AirQualityWebServer::handleDebugWiFi() {
+    arena.beginText();
+    arena.appendf("{\"state\":\"%s\",\"rssi\":%d,\"channel\":%d",
+                  wifi.getStateName(), WiFi.RSSI(), WiFi.channel());
+    arena.appendf(",\"last_association_ms\":%lu,\"boot_to_connect_ms\":%lu,\"boot_to_first_request_ms\":%lu",
+                  wifi.getLastAssociationTime(), wifi.getBootToConnectTime(), firstRequestTime);
+    arena.appendf(",\"connects\":%u,\"fast_connects\":%u,\"disconnects\":%u}",
+                  wifi.getConnectCount(), wifi.getFastConnectCount(), wifi.getDisconnectCount());
+    
+    server.send(200, "application/json", arena.text(), arena.getTextLength());
+}
+
+// Forecast FORECAST_HORIZON readings ahead; seconds_to_limit is null unless
+// PM2.5 is rising to FORECAST_LIMIT within that horizon
+void AirQualityWebServer::appendForecast(const PMSSensor* source) {
+    const AirForecast forecast = source->readForecast();
+    int32_t secondsToLimit = forecast.getSecondsToLimit();
+    arena.appendf(",\"forecast\":{\"horizon_s\":%u,\"pm2_5\":%.1f,\"trend_per_hour\":%.1f",
+                  FORECAST_HORIZON * FORECAST_SAMPLE_PERIOD, forecast.getForecast(FORECAST_HORIZON),
+                  forecast.getTrend() * 3600 / FORECAST_SAMPLE_PERIOD);
+    if (secondsToLimit >= 0) {
+        arena.appendf(",\"seconds_to_limit\":%d", secondsToLimit);
+    } else {
+        arena.append(",\"seconds_to_limit\":null");
+    }
+    arena.appendf(",\"anomaly\":\"%s\",\"anomalies\":%u}",
+                  AirForecast::anomalyName(forecast.getAnomaly()), forecast.getAnomalyCount());
+}
+
+// Counts per 0.1 L: the sensor's "larger than" channels, and the size bins
+// between them with their rolling mean and deviation
+void AirQualityWebServer::appendParticles(const PMSSensor* source, const PMSSensor::AirQualityData& data) {
+    const ParticleStats stats = source->readParticleStats();
+    arena.appendf(",\"particles\":{\"larger_than\":[%u,%u,%u,%u,%u,%u],\"bins\":[",
+                  data.particles_03, data.particles_05, data.particles_10,
+                  data.particles_25, data.particles_50, data.particles_100);
+    for (uint8_t i = 0; i < PARTICLE_BINS; i++) {
+        arena.appendf("%s{\"um\":\"%s\",\"count\":%u,\"mean\":%.1f,\"sd\":%.1f}", i > 0 ? "," : "",
+                      ParticleStats::binName(i), stats.getBin(i), stats.getMean(i), stats.getStdDev(i));
+    }
+    arena.appendf("],\"pm2_5_per_1000\":%.3f}", stats.getMassRatio());
+}
+
+void AirQualityWebServer::appendTrend(const char* name, const float* trend) {
+    arena.appendf("\"%s\":[", name);
+    for (int i = 0; i < 24; i++) {
+        arena.appendf(i > 0 ? ",%.1f" : "%.1f", trend[i]);
+    }
+    arena.append("]");
+}
+
+void AirQualityWebServer::handleHistory() {
+    if (server.arg("encoding") == "compressed") {
+        handleHistoryCompressed();
+        return;
+    }
+    
+    HistoryMetric metric = METRIC_PM2_5;
+    if (server.hasArg("metric") && !SensorHistory::parseMetric(server.arg("metric").c_str(), metric)) {
+        server.send(400, "text/plain", "Unknown metric (pm1, pm25, pm10, voc)");
+        return;
+    }
+    // Range is given in epoch seconds (uptime seconds until the clock is synced)
+    uint32_t from = server.hasArg("from") ? timeSync->toMonotonic(strtoul(server.arg("from").c_str(), nullptr, 10)) : 0;
+    uint32_t to = server.hasArg("to") ? timeSync->toMonotonic(strtoul(server.arg("to").c_str(), nullptr, 10)) : UINT32_MAX;
+    long points = server.hasArg("points") ? server.arg("points").toInt() : HISTORY_DEFAULT_POINTS;
+    points = constrain(points, 2, HISTORY_MAX_POINTS);
+    
+    // Time range to index range [first, last)
+    uint16_t first = history->lowerBound(from);
+    uint16_t last = (to == UINT32_MAX) ? history->size() : history->lowerBound(to + 1);
+    uint16_t count = last > first ? last - first : 0;
+    HistorySeries series = { history, metric, count > 0 ? history->at(first).time : 0 };
+    
+    server.setContentLength(CONTENT_LENGTH_UNKNOWN);
+    server.sendHeader("Access-Control-Allow-Origin", "*");
+    server.send(200, "application/json", "");
+    
+    arena.beginText();
+    arena.appendf("{\"metric\":\"%s\",\"time_synced\":%s,\"samples\":%u,\"points\":[",
+                  SensorHistory::metricName(metric), timeSync->isSynced() ? "true" : "false", count);
+    bool firstPoint = true;
+    lttbDownsample(series, first, count, points, [&](size_t index) {
+        const HistorySample& sample = history->at(index);
+        uint32_t time = timeSync->isSynced() ? timeSync->toEpoch(sample.time) : sample.time;
+        arena.appendf("%s[%u,%u]", firstPoint ? "" : ",", time, (unsigned)SensorHistory::value(sample, metric));
+        firstPoint = false;
+        flushChunk(false);
+    });
+    arena.append("]}");
+    flushChunk(true);
+    server.sendContent("");
+}
+
+// This hub and every peer heard over multicast, with house-wide PM2.5
+// figures over the valid readings
+void AirQualityWebServer::handleHouse() {
+    const PMSSensor::ReadingSnapshot reading = sensor->readSnapshot();
+    uint32_t pm25Sum = 0;
+    uint16_t pm25Max = 0;
+    uint32_t worstHub = 0;
+    uint8_t validCount = 0;
+    if (reading.data.isValid) {
+        pm25Sum = pm25Max = reading.data.pm2_5_atm;
+        worstHub = HousePeers::getHubId();
+        validCount = 1;
+    }
+    
+    arena.beginText();
+    arena.appendf("{\"hubs\":[{\"id\":\"%08x\",\"self\":true,\"valid\":%s,\"pm1_0\":%u,\"pm2_5\":%u,\"pm10\":%u,\"vocIndex\":%u,\"age_s\":0}",
+                  HousePeers::getHubId(), reading.data.isValid ? "true" : "false", reading.data.pm1_0_atm,
+                  reading.data.pm2_5_atm, reading.data.pm10_atm, reading.vocIndex);
+    for (uint8_t p = 0; p < HOUSE_MAX_PEERS; p++) {
+        const HousePeer* peer = house->getPeer(p);
+        if (peer == nullptr) {
+            continue;
+        }
+        const HouseDatagram& data = peer->reading;
+        bool valid = data.flags & 1;
+        arena.appendf(",{\"id\":\"%08x\",\"ip\":\"%s\",\"valid\":%s,\"pm1_0\":%u,\"pm2_5\":%u,\"pm10\":%u,\"vocIndex\":%u,\"age_s\":%lu}",
+                      data.hubId, IPAddress(peer->ip).toString().c_str(), valid ? "true" : "false",
+                      data.pm1_0, data.pm2_5, data.pm10, data.vocIndex, (millis() - peer->lastSeen) / 1000);
+        if (valid) {
+            pm25Sum += data.pm2_5;
+            validCount++;
+            if (data.pm2_5 > pm25Max) {
+                pm25Max = data.pm2_5;
+                worstHub = data.hubId;
+            }
         }
-        json += "],\"vocTrend\":[";
-        for (int i = 0; i < 24; i++) {
-            if (i > 0) json += ",";
-            json += String(sensor->vocTrendData[i], 1);
+    }
+    arena.appendf("],\"house\":{\"valid_hubs\":%u,\"mean_pm2_5\":%.1f,\"max_pm2_5\":%u,\"worst_hub\":\"%08x\"}",
+                  validCount, validCount > 0 ? (float)pm25Sum / validCount : 0.0f, pm25Max, worstHub);
+    arena.appendf(",\"datagrams\":{\"sent\":%u,\"received\":%u,\"rejected\":%u}}",
+                  house->getSentCount(), house->getReceivedCount(), house->getRejectedCount());
+    
+    server.sendHeader("Access-Control-Allow-Origin", "*");
+    server.send(200, "application/json", arena.text(), arena.getTextLength());
+}
+
+// Current alert level, the settings it was debounced with and the recent
+// transitions, newest first
+void AirQualityWebServer::handleAlerts() {
+    const AlertState alerts = sensor->readAlerts();
+    
+    arena.beginText();
+    arena.appendf("{\"level\":\"%s\",\"alert\":%s,\"transitions\":%u,",
+                  AlertState::levelName(alerts.getLevel()), alerts.isAlert() ? "true" : "false",
+                  alerts.getTransitionCount());
+    arena.appendf("\"thresholds\":{\"pm2_5\":[%u,%u,%u],\"voc\":[%u,%u,%u]},",
+                  ALERT_PM25_MODERATE, ALERT_PM25_SENSITIVE, ALERT_PM25_UNHEALTHY,
+                  ALERT_VOC_MODERATE, ALERT_VOC_SENSITIVE, ALERT_VOC_UNHEALTHY);
+    arena.appendf("\"hysteresis\":{\"pm2_5\":%u,\"voc\":%u},\"hold_s\":{\"raise\":%u,\"clear\":%u},\"events\":[",
+                  ALERT_PM25_HYSTERESIS, ALERT_VOC_HYSTERESIS, ALERT_RAISE_HOLD, ALERT_CLEAR_HOLD);
+    for (uint8_t i = 0; i < alerts.getEventCount(); i++) {
+        const AlertEvent& event = alerts.getEvent(i);
+        arena.appendf("%s{\"timestamp\":%u,\"from\":\"%s\",\"to\":\"%s\",\"pm2_5\":%u,\"vocIndex\":%u}",
+                      i > 0 ? "," : "", timeSync->toEpoch(event.time), AlertState::levelName(event.from),
+                      AlertState::levelName(event.to), event.pm25, event.vocIndex);
+    }
+    arena.append("]}");
+    
+    server.sendHeader("Access-Control-Allow-Origin", "*");
+    server.send(200, "application/json", arena.text(), arena.getTextLength());
+}
+
+// POST replaces the ruleset; both methods answer with the rules in force
+void AirQualityWebServer::handleRules() {
+    if (server.method() == HTTP_POST) {
+        updateRules();
+    } else {
+        sendRules();
+    }
+}
+
+// The compiled rules decoded back to the JSON they were posted as, with
+// each rule's state and last evaluation time
+void AirQualityWebServer::sendRules() {
+    server.setContentLength(CONTENT_LENGTH_UNKNOWN);
+    server.sendHeader("Access-Control-Allow-Origin", "*");
+    server.send(200, "application/json", "");
+    
+    arena.beginText();
+    arena.appendf("{\"program_bytes\":%u,\"evaluations\":%u,\"rules\":[",
+                  rules->getProgramLength(), rules->getEvaluationCount());
+    for (uint8_t r = 0; r < rules->getRuleCount(); r++) {
+        arena.appendf("%s{\"if\":[", r > 0 ? "," : "");
+        for (uint8_t i = 0; i < rules->getConditionCount(r); i++) {
+            RuleCondition condition = rules->getCondition(r, i);
+            arena.appendf("%s{\"metric\":\"%s\",\"op\":\"%s\",\"value\":%d,\"hysteresis\":%u}",
+                          i > 0 ? "," : "", SensorHistory::metricName((HistoryMetric)condition.metric),
+                          condition.op == RULE_ABOVE ? ">" : "<", condition.threshold, condition.hysteresis);
         }
-        json += "],\"pm10Trend\":[";
-        for (int i = 0; i < 24; i++) {
-            if (i > 0) json += ",";
-            json += String(sensor->pm10TrendData[i], 1);
+        arena.appendf("],\"for\":%u", rules->getHold(r));
+        for (uint8_t branch = 0; branch < 2; branch++) {
+            bool onActivate = branch == 0;
+            arena.append(onActivate ? ",\"then\":{" : ",\"else\":{");
+            for (uint8_t i = 0; i < rules->getActionCount(r, onActivate); i++) {
+                RuleAction action = rules->getAction(r, onActivate, i);
+                if (action.target == RULE_TARGET_LED) {
+                    arena.appendf("%s\"led\":%s", i > 0 ? "," : "", action.value ? "true" : "false");
+                } else {
+                    arena.appendf("%s\"%s\":%d", i > 0 ? "," : "", RulesEngine::targetName(action.target), action.value);
+                }
+            }
+            arena.append("}");
         }
-        json += "]";
+        const RuleState& state = rules->getState(r);
+        arena.appendf(",\"active\":%s,\"pending\":%s,\"transitions\":%u,\"eval_us\":%.2f}",
+                      state.active ? "true" : "false", state.changing ? "true" : "false",
+                      state.transitions, (float)state.evaluationCycles / ESP.getCpuFreqMHz());
+        flushChunk(false);
+    }
+    arena.append("]}");
+    flushChunk(true);
+    server.sendContent("");
+}
+
+// Body is {"rules":[...]} or the bare array. The parse tree lives in the
+// request arena and is gone once the rules are compiled.
+void AirQualityWebServer::updateRules() {
+    void* memory = arena.allocate(sizeof(StaticJsonDocument<RULES_JSON_CAPACITY>));
+    if (!memory) {
+        server.send(503, "text/plain", "Out of request memory");
+        return;
+    }
+    StaticJsonDocument<RULES_JSON_CAPACITY>* doc = new (memory) StaticJsonDocument<RULES_JSON_CAPACITY>();
+    
+    const String& body = server.arg("plain");
+    DeserializationError parseError = deserializeJson(*doc, body.c_str(), body.length());
+    char error[64];
+    bool compiled = false;
+    if (parseError) {
+        snprintf(error, sizeof(error), "invalid JSON: %s", parseError.c_str());
     } else {
-        json += "\"valid\":false,";
-        json += "\"pm1_0\":0,";
-        json += "\"pm2_5\":0,";
-        json += "\"pm10\":0,";
-        json += "\"vocIndex\":0,";
-        json += "\"health_status\":\"Error\",";
-        json += "\"risk_level\":\"Unknown\",";
-        json += "\"pm25Trend\":[],";
-        json += "\"vocTrend\":[],";
-        json += "\"pm10Trend\":[]";
-    }
-    
-    json += ",\"led_state\":" + String(getLEDState() ? "true" : "false");
-    json += ",\"servo_position\":" + String(getServoPosition());
-    json += ",\"wifi_rssi\":" + String(WiFi.RSSI());
-    json += ",\"free_memory\":" + String(ESP.getFreeHeap());
-    json += ",\"uptime\":" + String(millis() / 1000);
-    json += "}";
+        JsonArrayConst list = doc->is<JsonArrayConst>() ? doc->as<JsonArrayConst>() : (*doc)["rules"].as<JsonArrayConst>();
+        if (list.isNull()) {
+            snprintf(error, sizeof(error), "expected a rules array");
+        } else {
+            compiled = rules->compile(list, error, sizeof(error));
+        }
+    }
+    doc->~StaticJsonDocument<RULES_JSON_CAPACITY>();
+    
+    if (!compiled) {
+        arena.reset();
+        arena.beginText();
+        arena.appendf("{\"error\":\"%s\"}", error);
+        server.send(400, "application/json", arena.text(), arena.getTextLength());
+        return;
+    }
+    
+    arena.reset();
+    sendRules();
+}
+
+// Archive blocks overlapping [from, to] (epoch seconds), each sent as its
+// ArchiveBlockHeader followed by the encoded samples. Blocks are sent whole,
+// so samples just outside the range may be included; all metrics are present.
+void AirQualityWebServer::handleHistoryCompressed() {
+    uint32_t from = server.hasArg("from") ? strtoul(server.arg("from").c_str(), nullptr, 10) : 0;
+    uint32_t to = server.hasArg("to") ? strtoul(server.arg("to").c_str(), nullptr, 10) : UINT32_MAX;
+    uint8_t* payload = (uint8_t*)arena.allocate(ARCHIVE_BLOCK_SIZE);
+    if (!payload) {
+        server.send(503, "text/plain", "Out of request memory");
+        return;
+    }
     
+    server.setContentLength(CONTENT_LENGTH_UNKNOWN);
     server.sendHeader("Access-Control-Allow-Origin", "*");
-    server.send(200, "application/json", json);
-}
\ No newline at end of file
+    server.send(200, "application/octet-stream", "");
+    
+    ArchiveBlockHeader header;
+    for (uint32_t sequence = archive->getOldestSequence(); sequence < archive->getNextSequence(); sequence++) {
+        File file;
+        if (!archive->openBlock(sequence, header, file)) {
+            continue;
+        }
+        // Read before sending so a short read cannot desync the stream
+        bool wanted = header.lastTime >= from && header.firstTime <= to && header.length <= ARCHIVE_BLOCK_SIZE;
+        if (wanted && file.read(payload, header.length) == header.length) {
+            server.sendContent((const char*)&header, sizeof(header));
+            server.sendContent((const char*)payload, header.length);
+        }
+        file.close();
+    }
+    
+    // The open block goes straight from RAM
+    const uint8_t* open = archive->getOpenBlock(header);
+    if (header.count > 0 && header.lastTime >= from && header.firstTime <= to) {
+        server.sendContent((const char*)&header, sizeof(header));
+        server.sendContent((const char*)open, header.length);
+    }
+    server.sendContent("");
+}
+
+// Bulk download of the flash archive, e.g. /api/export?format=csv&from=<epoch>&to=<epoch>.
+// Sent with a known length in fixed-size chunks; Range resumes an
+// interrupted download, and If-Range restarts it if the records changed.
+void AirQualityWebServer::handleExport() {
+    ExportFormat format = EXPORT_CSV;
+    if (server.hasArg("format") && !HistoryExport::parseFormat(server.arg("format").c_str(), format)) {
+        server.send(400, "text/plain", "Unknown format (csv, ndjson)");
+        return;
+    }
+    uint32_t from = server.hasArg("from") ? strtoul(server.arg("from").c_str(), nullptr, 10) : 0;
+    uint32_t to = server.hasArg("to") ? strtoul(server.arg("to").c_str(), nullptr, 10) : UINT32_MAX;
+    uint8_t* block = (uint8_t*)arena.allocate(ARCHIVE_BLOCK_SIZE);
+    char* chunk = (char*)arena.allocate(EXPORT_CHUNK_SIZE);
+    if (!block || !chunk) {
+        server.send(503, "text/plain", "Out of request memory");
+        return;
+    }
+    
+    HistoryExport exporter(archive);
+    exporter.begin(format, from, to, block, chunk);
+    uint32_t length = exporter.getLength();
+    char etag[48];
+    exporter.getETag(etag, sizeof(etag));
+    
+    server.sendHeader("Access-Control-Allow-Origin", "*");
+    server.sendHeader("Accept-Ranges", "bytes");
+    server.sendHeader("ETag", etag);
+    server.sendHeader("Content-Disposition", format == EXPORT_CSV ? "attachment; filename=\"history.csv\""
+                                                                   : "attachment; filename=\"history.ndjson\"");
+    
+    uint32_t start = 0;
+    uint32_t end = length > 0 ? length - 1 : 0;
+    int code = 200;
+    if (server.hasHeader("Range") && (!server.hasHeader("If-Range") || server.header("If-Range") == etag)) {
+        if (!HistoryExport::parseRange(server.header("Range").c_str(), length, start, end)) {
+            char range[24];
+            snprintf(range, sizeof(range), "bytes */%u", length);
+            server.sendHeader("Content-Range", range);
+            server.send(416, "text/plain", "Range not satisfiable");
+            return;
+        }
+        char range[40];
+        snprintf(range, sizeof(range), "bytes %u-%u/%u", start, end, length);
+        server.sendHeader("Content-Range", range);
+        code = 206;
+    }
+    
+    uint32_t bodyLength = length > 0 ? end - start + 1 : 0;
+    server.setContentLength(bodyLength);
+    server.send(code, HistoryExport::contentType(format), "");
+    if (bodyLength == 0) {
+        return;
+    }
+    
+    uint32_t startMicros = micros();
+    uint32_t records = exporter.write(start, end, [this](const char* data, size_t size) {
+        server.sendContent(data, size);
+    });
+    lastExport.records = records;
+    lastExport.bytes = bodyLength;
+    lastExport.micros = micros() - startMicros;
+}
+
+// Formats the whole archive without sending it, to separate formatting
+// and flash reads from network time; the last real export is for comparison
+void AirQualityWebServer::handleDebugExport() {
+    ExportFormat format = EXPORT_CSV;
+    if (server.hasArg("format") && !HistoryExport::parseFormat(server.arg("format").c_str(), format)) {
+        server.send(400, "text/plain", "Unknown format (csv, ndjson)");
+        return;
+    }
+    uint8_t* block = (uint8_t*)arena.allocate(ARCHIVE_BLOCK_SIZE);
+    char* chunk = (char*)arena.allocate(EXPORT_CHUNK_SIZE);
+    if (!block || !chunk) {
+        server.send(503, "text/plain", "Out of request memory");
+        return;
+    }
+    
+    uint32_t start = micros();
+    HistoryExport exporter(archive);
+    exporter.begin(format, 0, UINT32_MAX, block, chunk);
+    uint32_t countMicros = micros() - start;
+    uint32_t bytes = 0;
+    uint32_t records = exporter.getLength() > 0 ? exporter.write(0, exporter.getLength() - 1, [&bytes](const char* data, size_t size) {
+        bytes += size;
+    }) : 0;
+    uint32_t elapsed = max(micros() - start, 1UL);
+    
+    arena.beginText();
+    arena.appendf("{\"format\":\"%s\",\"records\":%u,\"bytes\":%u,\"record_bytes\":%u,\"count_us\":%u,\"total_us\":%u",
+                  HistoryExport::formatName(format), records, bytes, (unsigned)exporter.getRecordLength(), countMicros, elapsed);
+    arena.appendf(",\"records_per_s\":%u,\"kb_per_s\":%.1f",
+                  (unsigned)((uint64_t)records * 1000000 / elapsed), bytes * 1000000.0f / 1024 / elapsed);
+    uint32_t lastMicros = max(lastExport.micros, (uint32_t)1);
+    arena.appendf(",\"last_export\":{\"records\":%u,\"bytes\":%u,\"ms\":%u,\"records_per_s\":%u,\"kb_per_s\":%.1f}}",
+                  lastExport.records, lastExport.bytes, lastExport.micros / 1000,
+                  (unsigned)((uint64_t)lastExport.records * 1000000 / lastMicros), lastExport.bytes * 1000000.0f / 1024 / lastMicros);
+    server.send(200, "application/json", arena.text(), arena.getTextLength());
+}
+
+// Sends the open arena text as one chunk once it passes the flush mark
+void AirQualityWebServer::flushChunk(bool force) {
+    if (!force && arena.getTextLength() < CHUNK_FLUSH_SIZE) {
+        return;
+    }
+    if (arena.getTextLength() > 0) {
+        server.sendContent(arena.text(), arena.getTextLength());
+    }
+    arena.reset();
+    arena.beginText();
+}
+
+// Encodes and decodes the RAM history with the archive codec
+void AirQualityWebServer::handleDebugCodec() {
+    const uint8_t rounds = 10;
+    uint8_t* scratch = (uint8_t*)arena.allocate(ARCHIVE_BLOCK_SIZE);
+    if (!scratch) {
+        server.send(503, "text/plain", "Out of request memory");
+        return;
+    }
+    
+    SeriesEncoder encoder;
+    uint32_t start = micros();
+    for (uint8_t round = 0; round < rounds; round++) {
+        encoder.begin(scratch, ARCHIVE_BLOCK_SIZE);
+        // Stops at a full block, as the archive would
+        for (uint16_t i = 0; i < history->size(); i++) {
+            if (!encoder.append(history->at(i))) {
+                break;
+            }
+        }
+    }
+    uint32_t encodeMicros = micros() - start;
+    
+    SeriesDecoder decoder;
+    HistorySample sample;
+    uint16_t decoded = 0;
+    start = micros();
+    for (uint8_t round = 0; round < rounds; round++) {
+        decoder.begin(scratch, encoder.getLength(), encoder.getCount());
+        decoded = 0;
+        while (decoder.next(sample)) {
+            decoded++;
+        }
+    }
+    uint32_t decodeMicros = micros() - start;
+    
+    uint32_t samples = (uint32_t)encoder.getCount() * rounds;
+    arena.beginText();
+    arena.appendf("{\"samples\":%u,\"bytes\":%u,\"raw_bytes\":%u,\"bytes_per_sample\":%.2f,\"decoded_ok\":%s",
+                  encoder.getCount(), (unsigned)encoder.getLength(), (unsigned)(encoder.getCount() * sizeof(HistorySample)),
+                  encoder.getCount() > 0 ? (float)encoder.getLength() / encoder.getCount() : 0.0f,
+                  decoded == encoder.getCount() ? "true" : "false");
+    arena.appendf(",\"encode_samples_per_s\":%.0f,\"decode_samples_per_s\":%.0f",
+                  encodeMicros > 0 ? samples * 1e6f / encodeMicros : 0.0f,
+                  decodeMicros > 0 ? samples * 1e6f / decodeMicros : 0.0f);
+    ArchiveBlockHeader open;
+    archive->getOpenBlock(open);
+    arena.appendf(",\"archive\":{\"sealed_blocks\":%u,\"open_samples\":%u,\"open_bytes\":%u}}",
+                  archive->getNextSequence() - archive->getOldestSequence(), open.count, open.length);
+    
+    server.send(200, "application/json", arena.text(), arena.getTextLength());
+}
+
+// Capture control and replay, e.g. /debug/pms?record=start, /debug/pms?replay=max
+void AirQualityWebServer::handleDebugPMS() {
+    String path = server.hasArg("file") ? server.arg("file") : String(PMS_CAPTURE_FILE);
+    String record = server.arg("record");
+    String replay = server.arg("replay");
+    
+    // The recorder and replay belong to the sensing side; the benchmark
+    // does not, so it runs without holding it up
+    {
+        SensingLock lock;
+        if (record == "start" && !sensor->getRecorder().start(path.c_str())) {
+            server.send(500, "text/plain", "Cannot create capture file");
+            return;
+        } else if (record == "stop") {
+            sensor->getRecorder().stop();
+        }
+        
+        if (replay == "real") {
+            // Replaces live reads at the normal read interval
+            if (!sensor->getReplay().start(path.c_str())) {
+                server.send(404, "text/plain", "No capture file");
+                return;
+            }
+        } else if (replay == "stop") {
+            sensor->getReplay().stop();
+        }
+    }
+    
+    ReplayBenchmark result;
+    memset(&result, 0, sizeof(result));
+    if (replay == "max") {
+        PMSReplay capture;
+        if (!capture.start(path.c_str())) {
+            server.send(404, "text/plain", "No capture file");
+            return;
+        }
+        if (!runReplayBenchmark(capture, result)) {
+            server.send(503, "text/plain", "Not enough memory for the benchmark");
+            return;
+        }
+    }
+    
+    // The benchmark left its last body in the arena
+    arena.reset();
+    SensingLock lock;
+    const PMSFrameParser& parser = sensor->getParser();
+    arena.beginText();
+    arena.appendf("{\"frames\":%u,\"checksum_errors\":%u,\"length_errors\":%u,\"discarded_bytes\":%u",
+                  parser.getFrameCount(), parser.getChecksumErrors(), parser.getLengthErrors(), parser.getDiscardedBytes());
+    arena.appendf(",\"recording\":%s,\"recorded_reads\":%u,\"capture_bytes\":%u",
+                  sensor->getRecorder().isRecording() ? "true" : "false",
+                  sensor->getRecorder().getRecordCount(), (unsigned)sensor->getRecorder().getSize());
+    arena.appendf(",\"replaying\":%s", sensor->getReplay().isOpen() ? "true" : "false");
+    arena.appendf(",\"queue\":{\"length\":%u,\"queued\":%u,\"dropped\":%u}",
+                  READING_QUEUE_LENGTH, sensor->getQueuedReadings(), sensor->getDroppedReadings());
+    if (replay == "max") {
+        uint32_t total = result.parseMicros + result.trendMicros + result.forecastMicros + result.historyMicros + result.serializeMicros;
+        arena.appendf(",\"benchmark\":{\"reads\":%u,\"bytes\":%u,\"frames\":%u,\"frames_per_s\":%.1f",
+                      result.reads, result.bytes, result.frames, total > 0 ? result.frames * 1e6f / total : 0.0f);
+        arena.appendf(",\"us\":{\"parse\":%u,\"trend\":%u,\"forecast\":%u,\"history\":%u,\"serialize\":%u}",
+                      result.parseMicros, result.trendMicros, result.forecastMicros, result.historyMicros, result.serializeMicros);
+        
+        // Mean absolute errors in µg/m³ over the capture
+        arena.appendf(",\"forecast\":{\"one_step_mae\":%.2f,\"horizon_mae\":%.2f,\"horizon_scored\":%u,\"anomalies\":%u,\"max_update_us\":%.2f}}",
+                      result.oneStepError, result.horizonError, result.horizonScored,
+                      result.anomalies, (float)result.maxForecastCycles / ESP.getCpuFreqMHz());
+    }
+    arena.append("}");
+    server.send(200, "application/json", arena.text(), arena.getTextLength());
+}
+
+// Feeds a capture through the reading pipeline as fast as possible: frame
+// parsing, trend, forecast and history updates and /api/data serialization,
+// timed per stage. The readings go through a scratch sensor and history, so
+// the live trend, history, alert state and forecast are left alone and the
+// live reading queue keeps its one producer. The scratch pipeline is too
+// large for the request arena and is the one thing a handler takes from the
+// heap; false when it does not fit. Alerts are skipped, since they block
+// on LED blinks.
+bool AirQualityWebServer::runReplayBenchmark(PMSReplay& capture, ReplayBenchmark& result) {
+    PMSSensor* scratch = new (std::nothrow) PMSSensor();
+    SensorHistory* scratchHistory = new (std::nothrow) SensorHistory();
+    if (!scratch || !scratchHistory) {
+        delete scratch;
+        delete scratchHistory;
+        return false;
+    }
+    
+    uint8_t raw[PMS_CAPTURE_CHUNK];
+    uint8_t length;
+    while (capture.next(raw, length)) {
+        result.reads++;
+        result.bytes += length;
+        for (uint8_t i = 0; i < length; i++) {
+            uint32_t start = micros();
+            bool published = scratch->ingest(raw[i]);
+            result.parseMicros += micros() - start;
+            if (!published) {
+                continue;
+            }
+            result.frames++;
+            
+            const PMSSensor::ReadingSnapshot& reading = scratch->getSnapshot();
+            start = micros();
+            scratch->updateTrend(timeSync->hourOf(reading.time));
+            result.trendMicros += micros() - start;
+            
+            start = micros();
+            scratch->updateForecast();
+            result.forecastMicros += micros() - start;
+            
+            start = micros();
+            PMSSensor::ReadingSnapshot queued;
+            while (scratch->nextReading(queued)) {
+                if (queued.data.isValid) {
+                    scratchHistory->add(queued);
+                }
+            }
+            result.historyMicros += micros() - start;
+            
+            // Each body starts from an empty arena, as a request's does
+            arena.reset();
+            start = micros();
+            buildAPIData(scratch, reading);
+            result.serializeMicros += micros() - start;
+        }
+        // Keeps the watchdog fed on long captures
+        yield();
+    }
+    
+    const AirForecast& forecast = scratch->getForecast();
+    result.oneStepError = forecast.getOneStepError();
+    result.horizonError = forecast.getHorizonError();
+    result.horizonScored = forecast.getHorizonScored();
+    result.anomalies = forecast.getAnomalyCount();
+    result.maxForecastCycles = forecast.getMaxUpdateCycles();
+    delete scratch;
+    delete scratchHistory;
+    return true;
+}
+
+#ifdef ENABLE_PROFILER
+void AirQualityWebServer::handleDebugProfile() {
+    arena.beginText();
+    arena.appendf("{\"iterations\":%u,\"max_us\":%u,\"p50_us\":%u,\"p99_us\":%u",
+                  loopProfiler.getIterations(), loopProfiler.getMaxMicros(),
+                  loopProfiler.getPercentile(50), loopProfiler.getPercentile(99));
+    
+    // Counts per bucket; the last bucket is open-ended
+    arena.append(",\"histogram\":[");
+    for (uint8_t i = 0; i < PROFILER_BUCKETS; i++) {
+        arena.appendf("%s{\"lt_us\":%u,\"count\":%u}", i == 0 ? "" : ",",
+                      i == PROFILER_BUCKETS - 1 ? 0 : Profiler::getBucketLimit(i), loopProfiler.getHistogram(i));
+    }
+    
+    arena.append("],\"spans\":{");
+    for (uint8_t i = 0; i < PROFILE_SPAN_COUNT; i++) {
+        ProfileSpan span = (ProfileSpan)i;
+        arena.appendf("%s\"%s\":{\"total_ms\":%u,\"max_us\":%u}", i == 0 ? "" : ",", Profiler::spanName(span),
+                      (unsigned)(loopProfiler.getSpanTotalMicros(span) / 1000), loopProfiler.getSpanMaxMicros(span));
+    }
+    
+    arena.append("},\"slowest\":[");
+    for (uint8_t i = 0; i < loopProfiler.getSlowestCount(); i++) {
+        const Profiler::Iteration& iteration = loopProfiler.getSlowest(i);
+        arena.appendf("%s{\"uptime_ms\":%u,\"total_us\":%u", i == 0 ? "" : ",", iteration.uptime, iteration.totalMicros);
+        for (uint8_t j = 0; j < PROFILE_SPAN_COUNT; j++) {
+            arena.appendf(",\"%s\":%u", Profiler::spanName((ProfileSpan)j), iteration.spanMicros[j]);
+        }
+        arena.append("}");
+    }
+    arena.append("]}");
+    
+    server.send(200, "application/json", arena.text(), arena.getTextLength());
+}
+#endif
+
+#ifdef SENSOR_SIMULATOR
+// Switches the simulator scenario or seed at runtime, e.g. /debug/sim?scenario=wildfire
+void AirQualityWebServer::handleDebugSim() {
+    SensingLock lock;
+    SensorSimulator& simulator = sensor->getSimulator();
+    
+    if (server.hasArg("scenario")) {
+        SimScenario scenario;
+        if (!SensorSimulator::parseScenario(server.arg("scenario").c_str(), scenario)) {
+            server.send(400, "text/plain", "Unknown scenario");
+            return;
+        }
+        simulator.setScenario(scenario);
+    }
+    if (server.hasArg("seed")) {
+        simulator.setSeed(strtoul(server.arg("seed").c_str(), nullptr, 0));
+    }
+    
+    arena.beginText();
+    arena.appendf("{\"scenario\":\"%s\",\"seed\":%u,\"time_scale\":%u,\"virtual_time\":%u}",
+                  SensorSimulator::scenarioName(simulator.getScenario()), simulator.getSeed(),
+                  (unsigned)SIM_TIME_SCALE, TimeSync::monotonicSeconds());
+    server.send(200, "application/json", arena.text(), arena.getTextLength());
+}
+#endif
+
+// WebSocket counters; bytes include framing, so bytes divided by commands
+// is the cost of one click, to compare with a /led/toggle request plus a
+// reload of /
+void AirQualityWebServer::handleDebugLive() {
+    arena.beginText();
+    arena.appendf("{\"clients\":%u,\"client_limit\":%u,\"connects\":%u,\"rejected\":%u",
+                  live.getClientCount(), LIVE_SOCKET_CLIENTS, live.getConnectCount(), live.getRejectedCount());
+    arena.appendf(",\"commands\":%u,\"bytes_in\":%u,\"bytes_out\":%u,\"dropped_frames\":%u",
+                  live.getCommandCount(), live.getBytesIn(), live.getBytesOut(), live.getDroppedFrames());
+    arena.appendf(",\"command_us\":%u,\"max_command_us\":%u}",
+                  live.getLastCommandMicros(), live.getMaxCommandMicros());
+    server.send(200, "application/json", arena.text(), arena.getTextLength());
+}
+
+// CoAP counters and observers. Bytes per reading compares one /reading
+// notification with an /api/data poll, whose body alone is shown since
+// HTTP headers and the TCP handshake come on top.
+void AirQualityWebServer::handleDebugCoap() {
+    arena.beginText();
+    arena.appendf("{\"port\":%u,\"requests\":%u,\"notifications\":%u,\"rejected\":%u,\"duplicates\":%u",
+                  COAP_PORT, coap.getRequestCount(), coap.getNotificationCount(), coap.getRejectedCount(),
+                  coap.getDuplicateCount());
+    arena.appendf(",\"bytes_in\":%u,\"bytes_out\":%u,\"request_us\":%u,\"max_request_us\":%u",
+                  coap.getBytesIn(), coap.getBytesOut(), coap.getLastMicros(), coap.getMaxMicros());
+    arena.appendf(",\"per_reading\":{\"coap_bytes\":%u,\"http_body_bytes\":%u}",
+                  coap.getLastReadingBytes(), (unsigned)apiCache.length);
+    arena.appendf(",\"observer_limit\":%u,\"dropped_observers\":%u,\"observers\":[",
+                  COAP_MAX_OBSERVERS, coap.getDroppedObservers());
+    bool first = true;
+    for (uint8_t i = 0; i < COAP_MAX_OBSERVERS; i++) {
+        const CoapObserver* observer = coap.getObserver(i);
+        if (observer == nullptr) {
+            continue;
+        }
+        arena.appendf("%s{\"ip\":\"%s\",\"port\":%u,\"resource\":\"%s\",\"notifications\":%u}",
+                      first ? "" : ",", IPAddress(observer->ip).toString().c_str(), observer->port,
+                      CoapServer::resourceName(observer->resource), observer->notifications);
+        first = false;
+    }
+    arena.append("]}");
+    server.send(200, "application/json", arena.text(), arena.getTextLength());
+}
+
+// Why this boot started, and the black box left by the boot before it
+void AirQualityWebServer::handleDebugLastCrash() {
+    const rst_info& reset = blackBox.getResetInfo();
+    arena.beginText();
+    arena.appendf("{\"boot\":%u,\"reset_reason\":\"%s\",\"reason_code\":%u",
+                  blackBox.getBootCount(), ESP.getResetReason().c_str(), reset.reason);
+    if (reset.reason == REASON_EXCEPTION_RST || reset.reason == REASON_WDT_RST || reset.reason == REASON_SOFT_WDT_RST) {
+        arena.appendf(",\"exception\":%u,\"epc1\":\"0x%08x\",\"epc2\":\"0x%08x\",\"epc3\":\"0x%08x\",\"excvaddr\":\"0x%08x\",\"depc\":\"0x%08x\"",
+                      reset.exccause, reset.epc1, reset.epc2, reset.epc3, reset.excvaddr, reset.depc);
+    }
+    
+    if (!blackBox.hasPrevious()) {
+        arena.append(",\"previous\":null}");
+        server.send(200, "application/json", arena.text(), arena.getTextLength());
+        return;
+    }
+    
+    const BlackBoxRecord& previous = blackBox.getPrevious();
+    const BlackBoxState& state = previous.header.state;
+    arena.appendf(",\"previous\":{\"boot\":%u,\"uptime_s\":%u,\"max_loop_us\":%u,\"min_free_heap\":%u",
+                  previous.header.bootCount, state.uptime, state.maxLoopMicros, state.minFreeHeap);
+    arena.appendf(",\"last_route\":\"%.*s\",\"in_request\":%s",
+                  (int)sizeof(state.lastRoute), state.lastRoute, state.requestOpen ? "true" : "false");
+    arena.appendf(",\"sensor\":{\"sequence\":%u,\"pm2_5\":%u,\"valid\":%s}",
+                  state.sensorSequence, state.pm25, state.sensorValid ? "true" : "false");
+    
+    // Oldest first
+    arena.append(",\"events\":[");
+    uint32_t first = (previous.header.head + BLACKBOX_EVENTS - previous.header.count) % BLACKBOX_EVENTS;
+    for (uint32_t i = 0; i < previous.header.count; i++) {
+        const BlackBoxEvent& event = previous.events[(first + i) % BLACKBOX_EVENTS];
+        arena.appendf("%s{\"uptime_ms\":%u,\"event\":\"%s\",\"detail\":%u,\"value\":%u}", i > 0 ? "," : "",
+                      event.uptime, BlackBox::eventName(event.kind), event.detail, event.value);
+    }
+    arena.append("]}}");
+    server.send(200, "application/json", arena.text(), arena.getTextLength());
+}
+
+// Idle time, estimated average current and request latency under the
+// current power profile, e.g. /debug/power?profile=eco to try another; the
+// figures restart with each switch
+void AirQualityWebServer::handleDebugPower() {
+    if (server.hasArg("profile")) {
+        PowerProfile profile;
+        if (!PowerManager::parseProfile(server.arg("profile").c_str(), profile)) {
+            server.send(400, "text/plain", "Unknown profile");
+            return;
+        }
+        powerManager.setProfile(profile);
+    }
+    
+    const PowerProfileConfig& config = powerManager.getConfig();
+    uint32_t elapsed = powerManager.getStatsMillis();
+    arena.beginText();
+    arena.appendf("{\"profile\":\"%s\",\"max_idle_ms\":%u,\"display_interval_ms\":%u,\"listen_interval\":%u",
+                  config.name, config.maxIdleMs, config.displayIntervalMs, config.listenInterval);
+    arena.appendf(",\"elapsed_ms\":%u,\"idle_ms\":%u,\"idle_pct\":%.1f,\"idle_waits\":%u",
+                  elapsed, powerManager.getIdleMillis(),
+                  elapsed > 0 ? powerManager.getIdleMillis() * 100.0f / elapsed : 0.0f, powerManager.getIdleCount());
+    arena.appendf(",\"network_wakes\":%u,\"pin_wakes\":%u,\"average_ma\":%.1f",
+                  powerManager.getNetworkWakes(), powerManager.getPinWakes(), powerManager.getAverageMilliamps());
+    arena.appendf(",\"requests\":%u,\"p50_ms\":%u,\"p99_ms\":%u,\"max_ms\":%u",
+                  powerManager.getRequestCount(), powerManager.getLatencyPercentile(50),
+                  powerManager.getLatencyPercentile(99), powerManager.getMaxLatency());
+    
+    // Counts per bucket; the last bucket is open-ended
+    arena.append(",\"histogram\":[");
+    for (uint8_t i = 0; i < POWER_LATENCY_BUCKETS; i++) {
+        arena.appendf("%s{\"lt_ms\":%u,\"count\":%u}", i == 0 ? "" : ",",
+                      i == POWER_LATENCY_BUCKETS - 1 ? 0 : PowerManager::getLatencyBucketLimit(i),
+                      powerManager.getLatencyHistogram(i));
+    }
+    arena.append("]}");
+    server.send(200, "application/json", arena.text(), arena.getTextLength());
+}
+
+void AirQualityWebServer::handleDebugAdmission() {
+    arena.beginText();
+    arena.appendf("{\"loop_period_ms\":%u,\"overloaded\":%s,\"requests\":%u",
+                  admission.getLoopPeriod(), admission.isOverloaded() ? "true" : "false", requestCount);
+    arena.appendf(",\"accepted\":%u,\"rate_limited\":%u,\"shed\":%u,\"budget_exhausted\":%u",
+                  admission.getAcceptedCount(), admission.getRateLimitedCount(),
+                  admission.getShedCount(), admission.getBudgetExhaustedCount());
+    
+    arena.append(",\"clients\":[");
+    bool first = true;
+    for (uint8_t i = 0; i < ADMISSION_CLIENTS; i++) {
+        if (admission.getClientIP(i) == 0) {
+            continue;
+        }
+        arena.appendf("%s{\"ip\":\"%s\",\"tokens\":%u}", first ? "" : ",",
+                      IPAddress(admission.getClientIP(i)).toString().c_str(), admission.getClientTokens(i));
+        first = false;
+    }
+    arena.append("]}");
+    
+    server.send(200, "application/json", arena.text(), arena.getTextLength());
+}
+
+// What the OLED shows, for support without a visit. The image goes out a
+// band at a time straight from the frame buffer, and a client that already
+// has the frame on the panel gets 304 Not Modified.
+void AirQualityWebServer::handleDisplayImage() {
+    SensingLock lock;
+    char etag[12];
+    snprintf(etag, sizeof(etag), "\"%08x\"", display->getFrameCrc());
+    server.sendHeader("Access-Control-Allow-Origin", "*");
+    server.sendHeader("Cache-Control", "no-cache");
+    server.sendHeader("ETag", etag);
+    if (server.header("If-None-Match") == etag) {
+        server.send(304);
+        return;
+    }
+    
+    server.setContentLength(DISPLAY_PBM_SIZE);
+    server.send(200, "image/x-portable-bitmap", "");
+    display->writeFrame([this](const uint8_t* data, size_t length) {
+        server.sendContent((const char*)data, length);
+    });
+}
+
+void AirQualityWebServer::handleDebugDisplay() {
+    SensingLock lock;
+    arena.beginText();
+    arena.appendf("{\"page_buffer\":%d,\"buffer_bytes\":%u,\"ram_saved\":%u,\"bus_clock\":%lu,\"screens\":{",
+                  DISPLAY_PAGE_BUFFER, DISPLAY_BUFFER_SIZE, 1024 - DISPLAY_BUFFER_SIZE, (unsigned long)DISPLAY_BUS_CLOCK);
+    for (uint8_t i = 0; i < SCREEN_STATS_COUNT; i++) {
+        const RenderStats& stats = display->getRenderStats(i);
+        arena.appendf("%s\"%s\":{\"renders\":%u,\"last_us\":%u,\"max_us\":%u,\"avg_us\":%u}",
+                      i == 0 ? "" : ",", AirQualityDisplay::screenName(i), stats.count, stats.lastMicros,
+                      stats.maxMicros, stats.count > 0 ? (unsigned)(stats.totalMicros / stats.count) : 0);
+    }
+    
+    // /display.pbm conversions, excluding the network transfer
+    const RenderStats& mirror = display->getMirrorStats();
+    arena.appendf("},\"mirror\":{\"requests\":%u,\"last_us\":%u,\"max_us\":%u,\"avg_us\":%u,\"frame_crc\":\"%08x\"}}",
+                  mirror.count, mirror.lastMicros, mirror.maxMicros,
+                  mirror.count > 0 ? (unsigned)(mirror.totalMicros / mirror.count) : 0, display->getFrameCrc());
+    
+    server.send(200, "application/json", arena.text(), arena.getTextLength());
+}
+
+void AirQualityWebServer::handleDebugHeap() {
+    HeapMonitor::HeapSample now = heapMonitor->sampleNow();
+    
+    arena.beginText();
+    arena.appendf("{\"free_heap\":%u,\"max_free_block\":%u,\"fragmentation\":%u",
+                  now.freeHeap, now.maxFreeBlock, now.fragmentation);
+    arena.appendf(",\"min_free_heap\":%u,\"min_max_free_block\":%u,\"peak_fragmentation\":%u",
+                  heapMonitor->getMinFreeHeap(), heapMonitor->getMinMaxFreeBlock(), heapMonitor->getPeakFragmentation());
+    arena.appendf(",\"arena\":{\"capacity\":%u,\"high_water\":%u,\"overflows\":%u}",
+                  (unsigned)arena.getCapacity(), (unsigned)arena.getHighWater(), arena.getOverflowCount());
+    
+    // Static RAM of one hub's components, all allocated at boot
+    arena.appendf(",\"objects\":{\"sensor\":%u,\"display\":%u,\"history\":%u,\"archive\":%u,\"rules\":%u,\"heap_monitor\":%u,\"web_server\":%u}",
+                  (unsigned)sizeof(PMSSensor), (unsigned)sizeof(AirQualityDisplay), (unsigned)sizeof(SensorHistory),
+                  (unsigned)sizeof(HistoryArchive), (unsigned)sizeof(RulesEngine), (unsigned)sizeof(HeapMonitor),
+                  (unsigned)sizeof(AirQualityWebServer));
+    
+    // Hourly history, oldest first
+    arena.append(",\"history\":[");
+    uint8_t count = heapMonitor->getSampleCount();
+    for (int age = count - 1; age >= 0; age--) {
+        const HeapMonitor::HeapSample& sample = heapMonitor->getSample(age);
+        arena.appendf("%s{\"uptime\":%u,\"free\":%u,\"max_block\":%u,\"frag\":%u}",
+                      age == count - 1 ? "" : ",", sample.uptime, sample.freeHeap, sample.maxFreeBlock, sample.fragmentation);
+    }
+    arena.append("]}");
+    
+    server.send(200, "application/json", arena.text(), arena.getTextLength());
+}
+
+// The uploader supplies the SHA-256, which proves the image arrived intact
+// but not who sent it; that takes the configured credentials
+bool AirQualityWebServer::isUpdateAuthorized() {
+    return strlen(OTA_PASSWORD) > 0 && server.authenticate(OTA_USERNAME, OTA_PASSWORD);
+}
+
+void AirQualityWebServer::handleUpdateUpload() {
+    HTTPUpload& upload = server.upload();
+    
+    switch (upload.status) {
+        case UPLOAD_FILE_START: {
+            updateUploadSeen = true;
+            
+            // Headers arrive before the body, so nothing reaches flash unauthenticated
+            if (!isUpdateAuthorized()) {
+                updater.abort("not authorized");
+                Serial.println("OTA: rejected - not authorized");
+                break;
+            }
+            
+            // Reserve all free sketch space; the image size is only known at the end
+            uint32_t maxSize = (ESP.getFreeSketchSpace() - 0x1000) & 0xFFFFF000;
+            if (updater.begin(maxSize, server.arg("sha256").c_str())) {
+                Serial.printf("OTA: receiving %s\n", upload.filename.c_str());
+            } else {
+                Serial.printf("OTA: rejected - %s\n", updater.getError());
+            }
+            break;
+        }
+        case UPLOAD_FILE_WRITE:
+            // Each chunk goes straight to flash
+            updater.write(upload.buf, upload.currentSize);
+            break;
+        case UPLOAD_FILE_END:
+            if (updater.end()) {
+                Serial.printf("OTA: %u bytes verified in %lu ms (%.1f KB/s)\n",
+                              (unsigned)updater.getBytesWritten(), updater.getElapsedTime(), updater.getThroughputKBps());
+            } else {
+                Serial.printf("OTA: failed - %s\n", updater.getError());
+            }
+            break;
+        case UPLOAD_FILE_ABORTED:
+            updater.abort("upload aborted");
+            Serial.println("OTA: upload aborted by client");
+            break;
+    }
+    
+    // The upload holds the server for its whole duration; keep sampling and the display going
+    if (backgroundTask) {
+        backgroundTask();
+    }
+}
+
+void AirQualityWebServer::handleUpdateFinished() {
+    // A verified result only counts for the upload made by this request
+    bool uploadSeen = updateUploadSeen;
+    updateUploadSeen = false;
+    
+    if (!isUpdateAuthorized()) {
+        server.requestAuthentication(DIGEST_AUTH, "update", strlen(OTA_PASSWORD) > 0 ? "Authentication required" : "Set OTA_PASSWORD to enable updates");
+        return;
+    }
+    if (!uploadSeen) {
+        server.send(400, "text/plain", "Update failed: no firmware file in request");
+        return;
+    }
+    if (!updater.isVerified()) {
+        server.send(400, "text/plain", arena.printf("Update failed: %s", updater.getError()));
+        return;
+    }
+    
+    server.send(200, "text/plain", arena.printf("Update OK: %u bytes in %lu ms (%.1f KB/s), SHA-256 verified, rebooting",
+                                                (unsigned)updater.getBytesWritten(), updater.getElapsedTime(), updater.getThroughputKBps()));
+    restartRequestTime = millis();
+}
@@ -0,0 +1,120 @@
+#include "alert_state.h"
+
+AlertState::AlertState() {
+  reset();
+}
+
+void AlertState::reset() {
+  level = AIR_NO_DATA;
+  raiseSince = 0;
+  lowerSince = 0;
+  transitionCount = 0;
+  memset(events, 0, sizeof(events));
+  eventHead = 0;
+  eventCount = 0;
+}
+
+AirLevel AlertState::classify(uint16_t pm25, uint8_t vocIndex) {
+  if (pm25 > ALERT_PM25_UNHEALTHY || vocIndex > ALERT_VOC_UNHEALTHY) {
+    return AIR_UNHEALTHY;
+  } else if (pm25 > ALERT_PM25_SENSITIVE || vocIndex > ALERT_VOC_SENSITIVE) {
+    return AIR_SENSITIVE;
+  } else if (pm25 > ALERT_PM25_MODERATE || vocIndex > ALERT_VOC_MODERATE) {
+    return AIR_MODERATE;
+  }
+  return AIR_GOOD;
+}
+
+bool AlertState::update(bool valid, uint16_t pm25, uint8_t vocIndex, uint32_t time) {
+  AirLevel next = level;
+  if (valid && level == AIR_NO_DATA) {
+    // The first reading after a gap has nothing to debounce against
+    next = classify(pm25, vocIndex);
+  } else {
+    // A failed read counts as a drop to no data, so a brief sensor dropout
+    // does not clear an alert. Classifying the values raised by the
+    // hysteresis gives the level they have clearly dropped to.
+    AirLevel raw = valid ? classify(pm25, vocIndex) : AIR_NO_DATA;
+    AirLevel lowered = valid ? classify(pm25 + ALERT_PM25_HYSTERESIS, min(vocIndex + ALERT_VOC_HYSTERESIS, 255))
+                             : AIR_NO_DATA;
+
+    // Pending times are stored plus one so that 0 can mean none
+    if (raw > level) {
+      lowerSince = 0;
+      raiseSince = raiseSince != 0 ? raiseSince : time + 1;
+      if (time + 1 - raiseSince >= ALERT_RAISE_HOLD) {
+        next = raw;
+      }
+    } else if (lowered < level) {
+      raiseSince = 0;
+      lowerSince = lowerSince != 0 ? lowerSince : time + 1;
+      if (time + 1 - lowerSince >= ALERT_CLEAR_HOLD) {
+        next = lowered;
+      }
+    } else {
+      raiseSince = 0;
+      lowerSince = 0;
+    }
+  }
+
+  if (next == level) {
+    return false;
+  }
+  AlertEvent& event = events[eventHead];
+  event.time = time;
+  event.from = level;
+  event.to = next;
+  event.vocIndex = vocIndex;
+  event.pm25 = pm25;
+  eventHead = (eventHead + 1) % ALERT_EVENT_HISTORY;
+  if (eventCount < ALERT_EVENT_HISTORY) {
+    eventCount++;
+  }
+  transitionCount++;
+  level = next;
+  raiseSince = 0;
+  lowerSince = 0;
+  return true;
+}
+
+uint32_t AlertState::getTransitionCount() const {
+  return transitionCount;
+}
+
+uint8_t AlertState::getEventCount() const {
+  return eventCount;
+}
+
+const AlertEvent& AlertState::getEvent(uint8_t age) const {
+  return events[(eventHead + ALERT_EVENT_HISTORY - 1 - age) % ALERT_EVENT_HISTORY];
+}
+
+const char* AlertState::levelName(AirLevel level) {
+  switch (level) {
+    case AIR_GOOD: return "good";
+    case AIR_MODERATE: return "moderate";
+    case AIR_SENSITIVE: return "sensitive";
+    case AIR_UNHEALTHY: return "unhealthy";
+    default: return "no_data";
+  }
+}
+
+const char* AlertState::healthStatus(AirLevel level) {
+  switch (level) {
+    case AIR_GOOD: return "Good :)";
+    case AIR_MODERATE: return "Moderate :|";
+    case AIR_SENSITIVE: return "Unhealthy for Sensitive :(";
+    case AIR_UNHEALTHY: return "Unhealthy :(";
+    default: return "No Data";
+  }
+}
+
+const char* AlertState::riskLevel(AirLevel level) {
+  switch (level) {
+    case AIR_GOOD:
+    case AIR_MODERATE: return "LOW";
+    case AIR_SENSITIVE: return "MODERATE";
+    case AIR_UNHEALTHY: return "HIGH";
+    default: return "UNKNOWN";
+  }
+}
@@ -0,0 +1,135 @@
+#include "black_box.h"
+#include <stddef.h>
+
+BlackBox blackBox;
+
+BlackBox::BlackBox() {
+  memset(&current, 0, sizeof(current));
+  memset(&previous, 0, sizeof(previous));
+  memset(&resetInfo, 0, sizeof(resetInfo));
+  previousValid = false;
+  requestStart = 0;
+}
+
+void BlackBox::begin() {
+  resetInfo = *ESP.getResetInfoPtr();
+
+  // After power-on RTC memory holds noise, which could pass the magic check
+  bool restored = resetInfo.reason != REASON_DEFAULT_RST &&
+                  ESP.rtcUserMemoryRead(BLACKBOX_RTC_OFFSET, (uint32_t*)&previous, sizeof(previous)) &&
+                  previous.header.magic == BLACKBOX_MAGIC && previous.header.head < BLACKBOX_EVENTS &&
+                  previous.header.count <= BLACKBOX_EVENTS;
+  previousValid = restored && previous.header.count > 0;
+
+  memset(&current, 0, sizeof(current));
+  current.magic = BLACKBOX_MAGIC;
+  current.bootCount = restored ? previous.header.bootCount + 1 : 0;
+  current.state.minFreeHeap = min(ESP.getFreeHeap(), (uint32_t)UINT16_MAX);
+  ESP.rtcUserMemoryWrite(BLACKBOX_RTC_OFFSET, (uint32_t*)&current, sizeof(current));
+  record(BLACKBOX_BOOT, resetInfo.reason, 0);
+
+  if (previousValid) {
+    Serial.printf("Black box: boot %u after %s, previous uptime %u s, last route %.12s%s\n",
+                  current.bootCount, ESP.getResetReason().c_str(), previous.header.state.uptime,
+                  previous.header.state.lastRoute, previous.header.state.requestOpen ? " (in progress)" : "");
+  }
+}
+
+// Writes the RTC words covering a field of the current header
+void BlackBox::writeField(const void* field, size_t size) {
+  size_t offset = (const uint8_t*)field - (const uint8_t*)&current;
+  size_t start = offset & ~3;
+  size_t end = (offset + size + 3) & ~3;
+  ESP.rtcUserMemoryWrite(BLACKBOX_RTC_OFFSET + start / 4, (uint32_t*)((uint8_t*)&current + start), end - start);
+}
+
+void BlackBox::record(BlackBoxEventKind kind, uint8_t detail, uint32_t value) {
+  BlackBoxEvent event = { (uint32_t)millis(), (uint8_t)kind, detail, (uint16_t)min(value, (uint32_t)UINT16_MAX) };
+  size_t offset = offsetof(BlackBoxRecord, events) + current.head * sizeof(BlackBoxEvent);
+  ESP.rtcUserMemoryWrite(BLACKBOX_RTC_OFFSET + offset / 4, (uint32_t*)&event, sizeof(event));
+
+  // The event is in place before the header that makes it visible
+  current.head = (current.head + 1) % BLACKBOX_EVENTS;
+  if (current.count < BLACKBOX_EVENTS) {
+    current.count++;
+  }
+  writeField(&current.head, sizeof(current.head) + sizeof(current.count));
+}
+
+void BlackBox::loopDone(uint32_t loopMicros) {
+  if (loopMicros > current.state.maxLoopMicros) {
+    current.state.maxLoopMicros = loopMicros;
+    writeField(&current.state.maxLoopMicros, sizeof(current.state.maxLoopMicros));
+  }
+  if (loopMicros >= BLACKBOX_SLOW_LOOP_MS * 1000UL) {
+    record(BLACKBOX_SLOW_LOOP, 0, loopMicros / 1000);
+  }
+
+  uint32_t freeHeap = ESP.getFreeHeap();
+  if (freeHeap + BLACKBOX_HEAP_STEP <= current.state.minFreeHeap) {
+    current.state.minFreeHeap = freeHeap;
+    writeField(&current.state.minFreeHeap, sizeof(current.state.minFreeHeap));
+    record(BLACKBOX_HEAP_LOW, 0, freeHeap);
+  }
+
+  uint32_t uptime = millis() / 1000;
+  if (uptime != current.state.uptime) {
+    current.state.uptime = uptime;
+    writeField(&current.state.uptime, sizeof(current.state.uptime));
+  }
+}
+
+void BlackBox::beginRequest(const char* route) {
+  requestStart = millis();
+  strncpy(current.state.lastRoute, route, sizeof(current.state.lastRoute));
+  current.state.requestOpen = 1;
+  writeField(&current.state.lastRoute, sizeof(current.state.lastRoute));
+  writeField(&current.state.requestOpen, sizeof(current.state.requestOpen));
+}
+
+void BlackBox::endRequest() {
+  current.state.requestOpen = 0;
+  writeField(&current.state.requestOpen, sizeof(current.state.requestOpen));
+  uint32_t elapsed = millis() - requestStart;
+  if (elapsed >= BLACKBOX_SLOW_REQUEST_MS) {
+    record(BLACKBOX_SLOW_REQUEST, 0, elapsed);
+  }
+}
+
+void BlackBox::noteReading(uint32_t sequence, uint16_t pm25, bool valid) {
+  if (!valid) {
+    record(BLACKBOX_READ_FAILED, 0, 0);
+  }
+  current.state.sensorValid = valid;
+  current.state.sensorSequence = sequence;
+  current.state.pm25 = pm25;
+  writeField(&current.state.sensorValid, sizeof(current.state.sensorValid));
+  writeField(&current.state.sensorSequence, sizeof(current.state.sensorSequence) + sizeof(current.state.pm25));
+}
+
+bool BlackBox::hasPrevious() const {
+  return previousValid;
+}
+
+const BlackBoxRecord& BlackBox::getPrevious() const {
+  return previous;
+}
+
+const rst_info& BlackBox::getResetInfo() const {
+  return resetInfo;
+}
+
+uint32_t BlackBox::getBootCount() const {
+  return current.bootCount;
+}
+
+const char* BlackBox::eventName(uint8_t kind) {
+  switch (kind) {
+    case BLACKBOX_BOOT: return "boot";
+    case BLACKBOX_SLOW_LOOP: return "slow_loop";
+    case BLACKBOX_SLOW_REQUEST: return "slow_request";
+    case BLACKBOX_HEAP_LOW: return "heap_low";
+    case BLACKBOX_READ_FAILED: return "read_failed";
+    default: return "unknown";
+  }
+}
@@ -0,0 +1,630 @@
+#include "coap_server.h"
+
+// Actuator control functions from main.cpp
+extern void setLED(bool state);
+extern bool getLEDState();
+extern void setServoPosition(int angle);
+extern int getServoPosition();
+
+// Seconds a reading stays current: one read period
+#define COAP_READING_MAX_AGE 30
+
+// Options this server acts on or can safely ignore; any other critical
+// (odd-numbered) option makes the request a 4.02
+#define COAP_OPTION_URI_HOST 3
+#define COAP_OPTION_URI_PORT 7
+#define COAP_OPTION_URI_QUERY 15
+#define COAP_OPTION_ACCEPT 17
+
+struct CoapResourceInfo {
+  const char* path;
+  bool observable;
+  bool writable;
+  uint8_t format;
+  uint32_t maxAge;                    // Seconds; actuators can change at any time
+};
+
+static const CoapResourceInfo RESOURCES[COAP_RESOURCE_COUNT] = {
+  { "/.well-known/core", false, false, COAP_FORMAT_LINK, 3600 },
+  { "/reading", true, false, COAP_FORMAT_OCTETS, COAP_READING_MAX_AGE },
+  { "/trend", false, false, COAP_FORMAT_OCTETS, COAP_READING_MAX_AGE },
+  { "/led", true, true, COAP_FORMAT_OCTETS, 0 },
+  { "/servo", true, true, COAP_FORMAT_OCTETS, 0 },
+};
+
+static const char DISCOVERY[] = "</reading>;ct=42;obs,</trend>;ct=42,</led>;ct=42;obs,</servo>;ct=42;obs";
+
+// Option deltas and lengths are 4-bit nibbles; 13 and 14 are followed by
+// one or two extension bytes
+static uint8_t extendNibble(uint32_t value, uint8_t* extended, size_t& count) {
+  if (value < 13) {
+    return value;
+  }
+  if (value < 269) {
+    extended[count++] = value - 13;
+    return 13;
+  }
+  value -= 269;
+  extended[count++] = value >> 8;
+  extended[count++] = value & 0xFF;
+  return 14;
+}
+
+static bool readExtended(const uint8_t* data, size_t length, size_t& at, uint32_t& value) {
+  if (value == 13) {
+    if (at + 1 > length) {
+      return false;
+    }
+    value = data[at++] + 13;
+  } else if (value == 14) {
+    if (at + 2 > length) {
+      return false;
+    }
+    value = ((data[at] << 8) | data[at + 1]) + 269;
+    at += 2;
+  } else if (value == 15) {
+    return false;
+  }
+  return true;
+}
+
+CoapWriter::CoapWriter(uint8_t* out, uint8_t type, uint8_t code, uint16_t messageId, const uint8_t* token, uint8_t tokenLength) {
+  buffer = out;
+  length = 0;
+  lastOption = 0;
+  overflow = false;
+  const uint8_t header[4] = { (uint8_t)(0x40 | (type << 4) | tokenLength), code, (uint8_t)(messageId >> 8), (uint8_t)messageId };
+  put(header, sizeof(header));
+  put(token, tokenLength);
+}
+
+void CoapWriter::put(const uint8_t* data, size_t dataLength) {
+  if (dataLength == 0) {
+    return;
+  }
+  if (length + dataLength > COAP_MESSAGE_MAX) {
+    overflow = true;
+    return;
+  }
+  memcpy(buffer + length, data, dataLength);
+  length += dataLength;
+}
+
+void CoapWriter::option(uint16_t number, const uint8_t* value, uint8_t valueLength) {
+  uint8_t head[5];
+  size_t count = 1;
+  uint8_t deltaNibble = extendNibble(number - lastOption, head, count);
+  uint8_t lengthNibble = extendNibble(valueLength, head, count);
+  head[0] = (deltaNibble << 4) | lengthNibble;
+  lastOption = number;
+  put(head, count);
+  put(value, valueLength);
+}
+
+void CoapWriter::uintOption(uint16_t number, uint32_t value) {
+  uint8_t bytes[4];
+  uint8_t count = 0;
+  for (int8_t shift = 24; shift >= 0; shift -= 8) {
+    if (count > 0 || (value >> shift) != 0) {
+      bytes[count++] = value >> shift;
+    }
+  }
+  option(number, bytes, count);
+}
+
+void CoapWriter::payload(const uint8_t* data, size_t dataLength) {
+  if (dataLength == 0) {
+    return;
+  }
+  const uint8_t marker = 0xFF;
+  put(&marker, 1);
+  put(data, dataLength);
+}
+
+CoapServer::CoapServer(PMSSensor* pmsSensor, AdmissionControl* admissionControl) {
+  sensor = pmsSensor;
+  admission = admissionControl;
+  listening = false;
+  pendingSize = 0;
+  nextMessageId = 0;
+  observeSequence = 0;
+  memset(observers, 0, sizeof(observers));
+  memset(dedup, 0, sizeof(dedup));
+  dedupNext = 0;
+  requestCount = 0;
+  notificationCount = 0;
+  rejectedCount = 0;
+  duplicateCount = 0;
+  droppedObservers = 0;
+  bytesIn = 0;
+  bytesOut = 0;
+  lastReadingBytes = 0;
+  lastMicros = 0;
+  maxMicros = 0;
+}
+
+void CoapServer::loop() {
+  if (WiFi.status() != WL_CONNECTED) {
+    if (listening) {
+      udp.stop();
+      listening = false;
+      pendingSize = 0;
+    }
+    return;
+  }
+  if (!listening) {
+    listening = udp.begin(COAP_PORT);
+    if (!listening) {
+      return;
+    }
+    // Message IDs start at random so a restarted hub is not taken for a duplicate
+    nextMessageId = random(0x10000);
+  }
+
+  for (uint8_t i = 0; i < COAP_PACKETS_PER_LOOP; i++) {
+    int size = pendingSize > 0 ? pendingSize : udp.parsePacket();
+    pendingSize = 0;
+    if (size <= 0) {
+      break;
+    }
+    receive(size);
+  }
+  notifyObservers();
+}
+
+// Takes the next datagram off the socket so the power manager can wake for
+// it; loop() handles that one first
+bool CoapServer::hasPendingRequest() {
+  if (listening && pendingSize == 0) {
+    pendingSize = max(udp.parsePacket(), 0);
+  }
+  return pendingSize > 0;
+}
+
+bool CoapServer::parse(const uint8_t* data, size_t length, CoapRequest& request) {
+  if (length < 4 || (data[0] >> 6) != 1) {
+    return false;
+  }
+  request.type = (data[0] >> 4) & 0x03;
+  request.tokenLength = data[0] & 0x0F;
+  request.code = data[1];
+  request.messageId = (data[2] << 8) | data[3];
+  if (request.tokenLength > 8 || length < 4u + request.tokenLength) {
+    return false;
+  }
+  memcpy(request.token, data + 4, request.tokenLength);
+  request.path[0] = '\0';
+  request.pathTooLong = false;
+  request.badOption = false;
+  request.hasObserve = false;
+  request.observe = 0;
+  request.accept = -1;
+  request.payload = nullptr;
+  request.payloadLength = 0;
+  if (request.code == COAP_EMPTY) {
+    return length == 4 && request.tokenLength == 0;
+  }
+
+  size_t at = 4 + request.tokenLength;
+  size_t pathLength = 0;
+  uint32_t number = 0;
+  while (at < length) {
+    uint8_t head = data[at++];
+    if (head == 0xFF) {
+      if (at == length) {
+        return false;
+      }
+      request.payload = data + at;
+      request.payloadLength = length - at;
+      break;
+    }
+    uint32_t delta = head >> 4;
+    uint32_t optionLength = head & 0x0F;
+    if (!readExtended(data, length, at, delta) || !readExtended(data, length, at, optionLength) ||
+        at + optionLength > length) {
+      return false;
+    }
+    number += delta;
+    const uint8_t* value = data + at;
+    at += optionLength;
+
+    switch (number) {
+      case COAP_OPTION_URI_PATH:
+        if (pathLength + 1 + optionLength >= COAP_PATH_MAX) {
+          request.pathTooLong = true;
+        } else {
+          request.path[pathLength++] = '/';
+          memcpy(request.path + pathLength, value, optionLength);
+          pathLength += optionLength;
+          request.path[pathLength] = '\0';
+        }
+        break;
+      case COAP_OPTION_OBSERVE:
+        if (optionLength > 3) {
+          return false;
+        }
+        request.hasObserve = true;
+        for (uint8_t i = 0; i < optionLength; i++) {
+          request.observe = (request.observe << 8) | value[i];
+        }
+        break;
+      case COAP_OPTION_ACCEPT:
+        if (optionLength > 2) {
+          return false;
+        }
+        request.accept = 0;
+        for (uint8_t i = 0; i < optionLength; i++) {
+          request.accept = (request.accept << 8) | value[i];
+        }
+        break;
+      case COAP_OPTION_URI_HOST:
+      case COAP_OPTION_URI_PORT:
+      case COAP_OPTION_URI_QUERY:
+        break;
+      default:
+        if (number & 1) {
+          request.badOption = true;
+        }
+        break;
+    }
+  }
+  return true;
+}
+
+int8_t CoapServer::findResource(const char* path) {
+  for (uint8_t i = 0; i < COAP_RESOURCE_COUNT; i++) {
+    if (strcmp(path, RESOURCES[i].path) == 0) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+void CoapServer::receive(int size) {
+  uint32_t start = micros();
+  bytesIn += size;
+  if (size > COAP_MESSAGE_MAX) {
+    // The rest of the datagram is discarded by the next parsePacket()
+    rejectedCount++;
+    return;
+  }
+  uint8_t message[COAP_MESSAGE_MAX];
+  int length = udp.read(message, size);
+  uint32_t ip = udp.remoteIP();
+  uint16_t port = udp.remotePort();
+
+  CoapRequest request;
+  bool valid = length > 0 && parse(message, length, request);
+  bool confirmable = length >= 4 && ((message[0] >> 4) & 0x03) == COAP_CON;
+  if (!valid || (request.code != COAP_EMPTY && (request.code >> 5) != 0)) {
+    // Malformed messages, and responses nobody asked this server for;
+    // a confirmable one is answered with a reset (RFC 7252 4.2)
+    rejectedCount++;
+    if (confirmable) {
+      uint8_t reset[4];
+      CoapWriter writer(reset, COAP_RST, COAP_EMPTY, (message[2] << 8) | message[3], nullptr, 0);
+      send(ip, port, reset, writer.size());
+    }
+    return;
+  }
+
+  if (request.type == COAP_ACK || request.type == COAP_RST) {
+    handleReply(ip, port, request);
+  } else if (request.code == COAP_EMPTY) {
+    // A ping: an empty confirmable message is answered with a reset
+    if (confirmable) {
+      uint8_t reset[4];
+      CoapWriter writer(reset, COAP_RST, COAP_EMPTY, request.messageId, nullptr, 0);
+      send(ip, port, reset, writer.size());
+    }
+  } else {
+    handleRequest(ip, port, request);
+    lastMicros = micros() - start;
+    maxMicros = max(maxMicros, lastMicros);
+  }
+}
+
+// Acknowledgements and resets answer notifications; a reset ends the observation
+void CoapServer::handleReply(uint32_t ip, uint16_t port, const CoapRequest& request) {
+  for (uint8_t i = 0; i < COAP_MAX_OBSERVERS; i++) {
+    CoapObserver& observer = observers[i];
+    if (observer.ip != ip || observer.port != port || observer.messageId != request.messageId) {
+      continue;
+    }
+    if (request.type == COAP_RST) {
+      observer.ip = 0;
+      droppedObservers++;
+    } else {
+      observer.awaitingAck = false;
+    }
+    return;
+  }
+}
+
+void CoapServer::handleRequest(uint32_t ip, uint16_t port, const CoapRequest& request) {
+  bool confirmable = request.type == COAP_CON;
+  if (confirmable && request.code != COAP_GET) {
+    for (uint8_t i = 0; i < COAP_DEDUP_ENTRIES; i++) {
+      const DedupEntry& entry = dedup[i];
+      if (entry.ip == ip && entry.port == port && entry.messageId == request.messageId) {
+        duplicateCount++;
+        send(ip, port, entry.response, entry.length);
+        return;
+      }
+    }
+  }
+
+  // Piggybacked on the acknowledgement, or a new non-confirmable message
+  uint8_t type = confirmable ? COAP_ACK : COAP_NON;
+  uint16_t messageId = confirmable ? request.messageId : nextMessageId++;
+  uint8_t message[COAP_MESSAGE_MAX];
+
+  uint32_t retryAfter = 0;
+  AdmissionResult admitted = admission->admit(ip, retryAfter);
+  if (admitted != ADMISSION_ACCEPTED) {
+    rejectedCount++;
+    CoapWriter writer(message, type, admitted == ADMISSION_SHED ? COAP_SERVICE_UNAVAILABLE : COAP_TOO_MANY_REQUESTS,
+                      messageId, request.token, request.tokenLength);
+    writer.uintOption(COAP_OPTION_MAX_AGE, retryAfter);
+    send(ip, port, message, writer.size());
+    return;
+  }
+  requestCount++;
+
+  int8_t resource = request.pathTooLong ? -1 : findResource(request.path);
+  uint8_t code;
+  if (request.badOption) {
+    code = COAP_BAD_OPTION;
+  } else if (resource < 0) {
+    code = COAP_NOT_FOUND;
+  } else if (request.code == COAP_GET) {
+    code = request.accept >= 0 && request.accept != RESOURCES[resource].format ? COAP_NOT_ACCEPTABLE : COAP_CONTENT;
+  } else if ((request.code == COAP_PUT || request.code == COAP_POST) && RESOURCES[resource].writable) {
+    code = applyWrite(resource, request);
+  } else {
+    code = COAP_METHOD_NOT_ALLOWED;
+  }
+
+  PMSSensor::ReadingSnapshot reading = sensor->readSnapshot();
+  CoapWriter writer(message, type, code, messageId, request.token, request.tokenLength);
+  if (code == COAP_CONTENT || code == COAP_CHANGED) {
+    if (code == COAP_CONTENT && RESOURCES[resource].observable &&
+        updateObservation(ip, port, request, resource, stateOf(resource, reading))) {
+      writer.uintOption(COAP_OPTION_OBSERVE, observeSequence);
+    }
+    addContent(writer, resource, reading);
+  }
+  send(ip, port, message, writer.size());
+  if (code == COAP_CONTENT && resource == COAP_RESOURCE_READING) {
+    lastReadingBytes = writer.size();
+  }
+
+  if (confirmable && request.code != COAP_GET && writer.size() <= COAP_DEDUP_RESPONSE_MAX) {
+    DedupEntry& entry = dedup[dedupNext];
+    entry.ip = ip;
+    entry.port = port;
+    entry.messageId = request.messageId;
+    entry.length = writer.size();
+    memcpy(entry.response, message, writer.size());
+    dedupNext = (dedupNext + 1) % COAP_DEDUP_ENTRIES;
+  }
+}
+
+uint8_t CoapServer::applyWrite(uint8_t resource, const CoapRequest& request) {
+  if (request.payloadLength != 1) {
+    return COAP_BAD_REQUEST;
+  }
+  uint8_t value = request.payload[0];
+  if (resource == COAP_RESOURCE_LED) {
+    if (value > 2) {
+      return COAP_BAD_REQUEST;
+    }
+    setLED(value == 2 ? !getLEDState() : value == 1);
+  } else {
+    if (value > 180) {
+      return COAP_BAD_REQUEST;
+    }
+    setServoPosition(value);
+  }
+  return COAP_CHANGED;
+}
+
+// Registers, refreshes or ends the observation by this endpoint and token.
+// Returns true when the response is to carry the Observe option.
+bool CoapServer::updateObservation(uint32_t ip, uint16_t port, const CoapRequest& request, uint8_t resource, uint32_t state) {
+  CoapObserver* match = nullptr;
+  CoapObserver* unused = nullptr;
+  for (uint8_t i = 0; i < COAP_MAX_OBSERVERS; i++) {
+    CoapObserver& observer = observers[i];
+    if (observer.ip == 0) {
+      unused = unused ? unused : &observer;
+    } else if (observer.ip == ip && observer.port == port && observer.tokenLength == request.tokenLength &&
+               memcmp(observer.token, request.token, request.tokenLength) == 0) {
+      match = &observer;
+    }
+  }
+
+  if (!request.hasObserve || request.observe != 0) {
+    if (match) {
+      match->ip = 0;
+    }
+    return false;
+  }
+  CoapObserver* observer = match ? match : unused;
+  if (!observer) {
+    return false;
+  }
+  if (!match) {
+    observer->notifications = 0;
+  }
+  observer->ip = ip;
+  observer->port = port;
+  memcpy(observer->token, request.token, request.tokenLength);
+  observer->tokenLength = request.tokenLength;
+  observer->resource = resource;
+  observer->state = state;
+  observer->messageId = 0;
+  observer->awaitingAck = false;
+  return true;
+}
+
+// Confirmable notifications are not retransmitted: a lost one is treated
+// as a departed observer, and the panel registers again once Max-Age passes
+// without a notification
+void CoapServer::notifyObservers() {
+  if (getObserverCount() == 0) {
+    return;
+  }
+  PMSSensor::ReadingSnapshot reading = sensor->readSnapshot();
+  for (uint8_t i = 0; i < COAP_MAX_OBSERVERS; i++) {
+    CoapObserver& observer = observers[i];
+    if (observer.ip == 0) {
+      continue;
+    }
+    uint32_t state = stateOf(observer.resource, reading);
+    if (state == observer.state) {
+      continue;
+    }
+
+    bool confirmable = (observer.notifications + 1) % COAP_CON_EVERY == 0;
+    if (confirmable) {
+      if (observer.awaitingAck) {
+        observer.ip = 0;
+        droppedObservers++;
+        continue;
+      }
+      observer.awaitingAck = true;
+    }
+    observer.state = state;
+    observer.messageId = nextMessageId++;
+    observer.notifications++;
+    observeSequence = (observeSequence + 1) & 0xFFFFFF;
+
+    uint8_t message[COAP_MESSAGE_MAX];
+    CoapWriter writer(message, confirmable ? COAP_CON : COAP_NON, COAP_CONTENT, observer.messageId,
+                      observer.token, observer.tokenLength);
+    writer.uintOption(COAP_OPTION_OBSERVE, observeSequence);
+    addContent(writer, observer.resource, reading);
+    send(observer.ip, observer.port, message, writer.size());
+    notificationCount++;
+    if (observer.resource == COAP_RESOURCE_READING) {
+      lastReadingBytes = writer.size();
+    }
+  }
+}
+
+// A value that changes whenever the resource's representation does
+uint32_t CoapServer::stateOf(uint8_t resource, const PMSSensor::ReadingSnapshot& reading) {
+  switch (resource) {
+    case COAP_RESOURCE_READING: return reading.sequence;
+    case COAP_RESOURCE_LED: return getLEDState() ? 1 : 0;
+    case COAP_RESOURCE_SERVO: return getServoPosition();
+    default: return 0;
+  }
+}
+
+size_t CoapServer::buildPayload(uint8_t resource, const PMSSensor::ReadingSnapshot& reading, uint8_t* out) {
+  switch (resource) {
+    case COAP_RESOURCE_DISCOVERY:
+      memcpy(out, DISCOVERY, sizeof(DISCOVERY) - 1);
+      return sizeof(DISCOVERY) - 1;
+    case COAP_RESOURCE_READING:
+      memcpy(out, &reading.sequence, 4);
+      memcpy(out + 4, &reading.data.pm1_0_atm, 2);
+      memcpy(out + 6, &reading.data.pm2_5_atm, 2);
+      memcpy(out + 8, &reading.data.pm10_atm, 2);
+      out[10] = reading.vocIndex;
+      out[11] = reading.level;
+      return 12;
+    case COAP_RESOURCE_TREND: {
+      const PMSSensor::TrendSnapshot trend = sensor->readTrend();
+      out[0] = trend.hour;
+      for (uint8_t i = 0; i < 24; i++) {
+        uint16_t tenths = constrain(trend.pm25[i] * 10.0f + 0.5f, 0.0f, 65535.0f);
+        memcpy(out + 1 + i * 2, &tenths, 2);
+        out[49 + i] = constrain(trend.voc[i] + 0.5f, 0.0f, 255.0f);
+      }
+      return 73;
+    }
+    case COAP_RESOURCE_LED:
+      out[0] = getLEDState() ? 1 : 0;
+      return 1;
+    default:
+      out[0] = constrain(getServoPosition(), 0, 180);
+      return 1;
+  }
+}
+
+void CoapServer::addContent(CoapWriter& writer, uint8_t resource, const PMSSensor::ReadingSnapshot& reading) {
+  uint8_t payload[COAP_MESSAGE_MAX];
+  size_t length = buildPayload(resource, reading, payload);
+  writer.uintOption(COAP_OPTION_CONTENT_FORMAT, RESOURCES[resource].format);
+  writer.uintOption(COAP_OPTION_MAX_AGE, RESOURCES[resource].maxAge);
+  writer.payload(payload, length);
+}
+
+void CoapServer::send(uint32_t ip, uint16_t port, const uint8_t* message, size_t length) {
+  udp.beginPacket(IPAddress(ip), port);
+  udp.write(message, length);
+  if (udp.endPacket()) {
+    bytesOut += length;
+  }
+}
+
+uint8_t CoapServer::getObserverCount() const {
+  uint8_t count = 0;
+  for (uint8_t i = 0; i < COAP_MAX_OBSERVERS; i++) {
+    if (observers[i].ip != 0) {
+      count++;
+    }
+  }
+  return count;
+}
+
+const CoapObserver* CoapServer::getObserver(uint8_t index) const {
+  return observers[index].ip != 0 ? &observers[index] : nullptr;
+}
+
+uint32_t CoapServer::getRequestCount() const {
+  return requestCount;
+}
+
+uint32_t CoapServer::getNotificationCount() const {
+  return notificationCount;
+}
+
+uint32_t CoapServer::getRejectedCount() const {
+  return rejectedCount;
+}
+
+uint32_t CoapServer::getDuplicateCount() const {
+  return duplicateCount;
+}
+
+uint32_t CoapServer::getDroppedObservers() const {
+  return droppedObservers;
+}
+
+uint32_t CoapServer::getBytesIn() const {
+  return bytesIn;
+}
+
+uint32_t CoapServer::getBytesOut() const {
+  return bytesOut;
+}
+
+uint32_t CoapServer::getLastReadingBytes() const {
+  return lastReadingBytes;
+}
+
+uint32_t CoapServer::getLastMicros() const {
+  return lastMicros;
+}
+
+uint32_t CoapServer::getMaxMicros() const {
+  return maxMicros;
+}
+
+const char* CoapServer::resourceName(uint8_t resource) {
+  return RESOURCES[resource].path;
+}
@@ -0,0 +1,85 @@
+#ifdef ESP32
+
+#include "esp8266_compat.h"
+#include <esp_system.h>
+#include <esp_heap_caps.h>
+
+EspCompat espCompat;
+
+// Kept across software and watchdog resets like the ESP8266's RTC user
+// memory; power-on leaves it random, which the checksums of its users reject
+static RTC_NOINIT_ATTR uint32_t rtcUserMemory[128];
+static rst_info resetInfo;
+
+uint32_t EspCompat::getChipId() {
+  return (uint32_t)(getEfuseMac() >> 24) & 0xFFFFFF;
+}
+
+uint32_t EspCompat::getMaxFreeBlockSize() {
+  return heap_caps_get_largest_free_block(MALLOC_CAP_8BIT);
+}
+
+uint8_t EspCompat::getHeapFragmentation() {
+  uint32_t free = getFreeHeap();
+  if (free == 0) {
+    return 0;
+  }
+  return 100 - getMaxFreeBlockSize() * 100 / free;
+}
+
+// Offsets are in 4-byte blocks, as on the ESP8266
+bool EspCompat::rtcUserMemoryRead(uint32_t offset, uint32_t* data, size_t size) {
+  if (offset * 4 + size > sizeof(rtcUserMemory)) {
+    return false;
+  }
+  memcpy(data, &rtcUserMemory[offset], size);
+  return true;
+}
+
+bool EspCompat::rtcUserMemoryWrite(uint32_t offset, uint32_t* data, size_t size) {
+  if (offset * 4 + size > sizeof(rtcUserMemory)) {
+    return false;
+  }
+  memcpy(&rtcUserMemory[offset], data, size);
+  return true;
+}
+
+// No exception registers are kept across the reset; only the reason is set
+rst_info* EspCompat::getResetInfoPtr() {
+  memset(&resetInfo, 0, sizeof(resetInfo));
+  switch (esp_reset_reason()) {
+    case ESP_RST_PANIC:
+      resetInfo.reason = REASON_EXCEPTION_RST;
+      break;
+    case ESP_RST_INT_WDT:
+    case ESP_RST_WDT:
+      resetInfo.reason = REASON_WDT_RST;
+      break;
+    case ESP_RST_TASK_WDT:
+      resetInfo.reason = REASON_SOFT_WDT_RST;
+      break;
+    case ESP_RST_SW:
+      resetInfo.reason = REASON_SOFT_RESTART;
+      break;
+    case ESP_RST_DEEPSLEEP:
+      resetInfo.reason = REASON_DEEP_SLEEP_AWAKE;
+      break;
+    case ESP_RST_EXT:
+      resetInfo.reason = REASON_EXT_SYS_RST;
+      break;
+    default:
+      resetInfo.reason = REASON_DEFAULT_RST;
+      break;
+  }
+  return &resetInfo;
+}
+
+String EspCompat::getResetReason() {
+  static const char* const NAMES[] = {
+    "Power On", "Hardware Watchdog", "Exception", "Software Watchdog",
+    "Software/System restart", "Deep-Sleep Wake", "External System"
+  };
+  return NAMES[getResetInfoPtr()->reason];
+}
+
+#endif
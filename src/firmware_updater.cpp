@@ -0,0 +1,158 @@
+#include "firmware_updater.h"
+#include <Updater.h>
+
+bool UpdaterFlashBackend::begin(size_t maxSize) {
+  return Update.begin(maxSize);
+}
+
+size_t UpdaterFlashBackend::write(const uint8_t* data, size_t len) {
+  // Updater only takes a mutable pointer but does not modify the data
+  return Update.write(const_cast<uint8_t*>(data), len);
+}
+
+bool UpdaterFlashBackend::commit() {
+  // The image is shorter than the reserved space, so accept the remainder
+  return Update.end(true);
+}
+
+void UpdaterFlashBackend::abort() {
+  // Ending an unfinished update resets the Updater without arming the bootloader
+  if (Update.isRunning()) {
+    Update.end(false);
+  }
+}
+
+FirmwareUpdater::FirmwareUpdater(FlashBackend* backend) {
+  flash = backend;
+  running = false;
+  verified = false;
+  bytesWritten = 0;
+  startTime = 0;
+  elapsedTime = 0;
+  error = nullptr;
+  memset(expectedHash, 0, sizeof(expectedHash));
+}
+
+bool FirmwareUpdater::begin(size_t maxSize, const char* sha256Hex) {
+  if (running) {
+    abort("superseded by a new upload");
+  }
+
+  verified = false;
+  bytesWritten = 0;
+  elapsedTime = 0;
+  error = nullptr;
+
+  if (!sha256Hex || !parseHex(sha256Hex, expectedHash, sizeof(expectedHash))) {
+    error = "missing or malformed sha256";
+    return false;
+  }
+  if (!flash->begin(maxSize)) {
+    error = "not enough flash for the image";
+    return false;
+  }
+
+  br_sha256_init(&sha);
+  startTime = millis();
+  running = true;
+  return true;
+}
+
+bool FirmwareUpdater::write(const uint8_t* data, size_t len) {
+  if (!running) {
+    return false;
+  }
+
+  if (flash->write(data, len) != len) {
+    abort("flash write failed");
+    return false;
+  }
+
+  br_sha256_update(&sha, data, len);
+  bytesWritten += len;
+  return true;
+}
+
+bool FirmwareUpdater::end() {
+  if (!running) {
+    return false;
+  }
+
+  uint8_t actualHash[32];
+  br_sha256_out(&sha, actualHash);
+  elapsedTime = millis() - startTime;
+
+  if (memcmp(actualHash, expectedHash, sizeof(actualHash)) != 0) {
+    abort("sha256 mismatch");
+    return false;
+  }
+  if (!flash->commit()) {
+    running = false;
+    error = "flash commit failed";
+    return false;
+  }
+
+  running = false;
+  verified = true;
+  return true;
+}
+
+void FirmwareUpdater::abort(const char* reason) {
+  if (running) {
+    flash->abort();
+    elapsedTime = millis() - startTime;
+  }
+  running = false;
+  verified = false;
+  error = reason;
+}
+
+bool FirmwareUpdater::parseHex(const char* hex, uint8_t* out, size_t len) {
+  if (strlen(hex) != len * 2) {
+    return false;
+  }
+
+  for (size_t i = 0; i < len * 2; i++) {
+    char c = hex[i];
+    uint8_t nibble;
+    if (c >= '0' && c <= '9') {
+      nibble = c - '0';
+    } else if (c >= 'a' && c <= 'f') {
+      nibble = c - 'a' + 10;
+    } else if (c >= 'A' && c <= 'F') {
+      nibble = c - 'A' + 10;
+    } else {
+      return false;
+    }
+    out[i / 2] = (i % 2 == 0) ? (nibble << 4) : (out[i / 2] | nibble);
+  }
+  return true;
+}
+
+bool FirmwareUpdater::isRunning() {
+  return running;
+}
+
+bool FirmwareUpdater::isVerified() {
+  return verified;
+}
+
+size_t FirmwareUpdater::getBytesWritten() {
+  return bytesWritten;
+}
+
+unsigned long FirmwareUpdater::getElapsedTime() {
+  return running ? millis() - startTime : elapsedTime;
+}
+
+float FirmwareUpdater::getThroughputKBps() {
+  unsigned long elapsed = getElapsedTime();
+  if (elapsed == 0) {
+    return 0;
+  }
+  return (bytesWritten / 1024.0f) / (elapsed / 1000.0f);
+}
+
+const char* FirmwareUpdater::getError() {
+  return error ? error : "";
+}
@@ -0,0 +1,73 @@
+#include "heap_monitor.h"
+
+HeapMonitor::HeapMonitor() {
+  historyIndex = 0;
+  historyCount = 0;
+  lastSampleTime = 0;
+  lastExtremesTime = 0;
+  minFreeHeap = UINT32_MAX;
+  minMaxFreeBlock = UINT32_MAX;
+  peakFragmentation = 0;
+}
+
+void HeapMonitor::begin() {
+  // Record the post-setup baseline as the first history entry
+  history[historyIndex] = sampleNow();
+  historyIndex = (historyIndex + 1) % HEAP_HISTORY_SIZE;
+  historyCount = 1;
+  lastSampleTime = millis();
+}
+
+void HeapMonitor::update() {
+  // Track the extremes every second so short dips between samples are not missed
+  if (millis() - lastExtremesTime < 1000) {
+    return;
+  }
+  lastExtremesTime = millis();
+  HeapSample sample = sampleNow();
+
+  if (millis() - lastSampleTime >= HEAP_SAMPLE_INTERVAL) {
+    history[historyIndex] = sample;
+    historyIndex = (historyIndex + 1) % HEAP_HISTORY_SIZE;
+    if (historyCount < HEAP_HISTORY_SIZE) {
+      historyCount++;
+    }
+    lastSampleTime = millis();
+    Serial.printf("Heap: free %u, max block %u, fragmentation %u%%\n",
+                  sample.freeHeap, sample.maxFreeBlock, sample.fragmentation);
+  }
+}
+
+HeapMonitor::HeapSample HeapMonitor::sampleNow() {
+  HeapSample sample;
+  sample.uptime = millis() / 1000;
+  sample.freeHeap = ESP.getFreeHeap();
+  sample.maxFreeBlock = ESP.getMaxFreeBlockSize();
+  sample.fragmentation = ESP.getHeapFragmentation();
+
+  minFreeHeap = min(minFreeHeap, sample.freeHeap);
+  minMaxFreeBlock = min(minMaxFreeBlock, sample.maxFreeBlock);
+  peakFragmentation = max(peakFragmentation, sample.fragmentation);
+  return sample;
+}
+
+uint8_t HeapMonitor::getSampleCount() {
+  return historyCount;
+}
+
+const HeapMonitor::HeapSample& HeapMonitor::getSample(uint8_t age) {
+  uint8_t index = (historyIndex + HEAP_HISTORY_SIZE - 1 - (age % HEAP_HISTORY_SIZE)) % HEAP_HISTORY_SIZE;
+  return history[index];
+}
+
+uint32_t HeapMonitor::getMinFreeHeap() {
+  return minFreeHeap;
+}
+
+uint32_t HeapMonitor::getMinMaxFreeBlock() {
+  return minMaxFreeBlock;
+}
+
+uint8_t HeapMonitor::getPeakFragmentation() {
+  return peakFragmentation;
+}
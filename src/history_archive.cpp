@@ -0,0 +1,102 @@
+#include "history_archive.h"
+
+HistoryArchive::HistoryArchive() {
+  encoder.begin(block, sizeof(block));
+  firstTime = 0;
+  lastTime = 0;
+  nextSequence = 0;
+}
+
+void HistoryArchive::slotPath(uint32_t sequence, char* path, size_t size) {
+  snprintf(path, size, "/hist%02u.bin", (unsigned)(sequence % ARCHIVE_BLOCKS));
+}
+
+void HistoryArchive::begin() {
+  // Only headers are read; the newest valid one sets the next sequence
+  for (uint8_t slot = 0; slot < ARCHIVE_BLOCKS; slot++) {
+    char path[16];
+    slotPath(slot, path, sizeof(path));
+    File file = LittleFS.open(path, "r");
+    if (!file) {
+      continue;
+    }
+    ArchiveBlockHeader header;
+    if (file.read((uint8_t*)&header, sizeof(header)) == sizeof(header) &&
+        header.magic == ARCHIVE_MAGIC && header.sequence >= nextSequence) {
+      nextSequence = header.sequence + 1;
+    }
+    file.close();
+  }
+  Serial.printf("History archive: %u blocks stored\n", nextSequence - getOldestSequence());
+}
+
+void HistoryArchive::add(const HistorySample& sample) {
+  if (encoder.getCount() == 0) {
+    firstTime = sample.time;
+  }
+  if (!encoder.append(sample)) {
+    seal();
+    firstTime = sample.time;
+    encoder.append(sample);
+  }
+  lastTime = sample.time;
+}
+
+void HistoryArchive::flush() {
+  if (encoder.getCount() > 0) {
+    seal();
+  }
+}
+
+void HistoryArchive::seal() {
+  ArchiveBlockHeader header;
+  getOpenBlock(header);
+
+  char path[16];
+  slotPath(nextSequence, path, sizeof(path));
+  File file = LittleFS.open(path, "w");
+  if (file) {
+    file.write((const uint8_t*)&header, sizeof(header));
+    file.write(block, header.length);
+    file.close();
+  } else {
+    Serial.println("History archive: cannot write block");
+  }
+
+  nextSequence++;
+  encoder.begin(block, sizeof(block));
+}
+
+uint32_t HistoryArchive::getOldestSequence() const {
+  return nextSequence > ARCHIVE_BLOCKS ? nextSequence - ARCHIVE_BLOCKS : 0;
+}
+
+uint32_t HistoryArchive::getNextSequence() const {
+  return nextSequence;
+}
+
+bool HistoryArchive::openBlock(uint32_t sequence, ArchiveBlockHeader& header, File& file) {
+  char path[16];
+  slotPath(sequence, path, sizeof(path));
+  file = LittleFS.open(path, "r");
+  if (!file) {
+    return false;
+  }
+  // A slot from a failed write still holds an older block
+  if (file.read((uint8_t*)&header, sizeof(header)) != sizeof(header) ||
+      header.magic != ARCHIVE_MAGIC || header.sequence != sequence) {
+    file.close();
+    return false;
+  }
+  return true;
+}
+
+const uint8_t* HistoryArchive::getOpenBlock(ArchiveBlockHeader& header) const {
+  header.magic = ARCHIVE_MAGIC;
+  header.sequence = nextSequence;
+  header.firstTime = firstTime;
+  header.lastTime = lastTime;
+  header.count = encoder.getCount();
+  header.length = encoder.getLength();
+  return block;
+}
@@ -0,0 +1,234 @@
+#include "history_export.h"
+
+static const char CSV_HEADER[] = "time,pm1_0,pm2_5,pm10,voc\n";
+static const char CSV_RECORD[] = "%10u,%5u,%5u,%5u,%3u\n";
+static const char NDJSON_RECORD[] = "{\"time\":%10u,\"pm1_0\":%5u,\"pm2_5\":%5u,\"pm10\":%5u,\"voc\":%3u}\n";
+
+// Longest formatted record, with room for the terminator
+#define EXPORT_RECORD_MAX 80
+
+HistoryExport::HistoryExport(HistoryArchive* historyArchive) {
+  archive = historyArchive;
+  block = nullptr;
+  chunk = nullptr;
+  chunkLength = 0;
+  format = EXPORT_CSV;
+  from = 0;
+  to = UINT32_MAX;
+  firstSequence = 0;
+  blockTotal = 0;
+  count = 0;
+  firstTime = 0;
+  lastTime = 0;
+}
+
+// Sealed blocks are read from flash into the block buffer; the open block
+// is used in place
+const uint8_t* HistoryExport::loadBlock(uint32_t sequence, ArchiveBlockHeader& header) {
+  if (sequence == archive->getNextSequence()) {
+    return archive->getOpenBlock(header);
+  }
+  File file;
+  if (!archive->openBlock(sequence, header, file)) {
+    return nullptr;
+  }
+  bool ok = header.length <= ARCHIVE_BLOCK_SIZE && file.read(block, header.length) == header.length;
+  file.close();
+  return ok ? block : nullptr;
+}
+
+// Counts the samples in range per block. Blocks wholly inside the range
+// are counted from their headers; only the ones straddling an end are decoded.
+void HistoryExport::begin(ExportFormat exportFormat, uint32_t fromTime, uint32_t toTime, uint8_t* blockBuffer, char* chunkBuffer) {
+  format = exportFormat;
+  from = fromTime;
+  to = toTime;
+  block = blockBuffer;
+  chunk = chunkBuffer;
+  firstSequence = archive->getOldestSequence();
+  blockTotal = archive->getNextSequence() - firstSequence + 1;
+  count = 0;
+  firstTime = 0;
+  lastTime = 0;
+
+  for (uint8_t b = 0; b < blockTotal; b++) {
+    blockCounts[b] = 0;
+    ArchiveBlockHeader header;
+    const uint8_t* data = loadBlock(firstSequence + b, header);
+    if (!data || header.count == 0 || header.lastTime < from || header.firstTime > to) {
+      continue;
+    }
+
+    if (header.firstTime >= from && header.lastTime <= to) {
+      blockCounts[b] = header.count;
+      if (count == 0) {
+        firstTime = header.firstTime;
+      }
+      lastTime = header.lastTime;
+    } else {
+      SeriesDecoder decoder;
+      decoder.begin(data, header.length, header.count);
+      HistorySample sample;
+      while (decoder.next(sample)) {
+        if (sample.time >= from && sample.time <= to) {
+          if (count == 0 && blockCounts[b] == 0) {
+            firstTime = sample.time;
+          }
+          blockCounts[b]++;
+          lastTime = sample.time;
+        }
+      }
+    }
+    count += blockCounts[b];
+  }
+}
+
+size_t HistoryExport::formatRecord(const HistorySample& sample, char* record) const {
+  return snprintf(record, EXPORT_RECORD_MAX, format == EXPORT_CSV ? CSV_RECORD : NDJSON_RECORD,
+                  sample.time, sample.pm1_0, sample.pm2_5, sample.pm10, sample.vocIndex);
+}
+
+// Adds the part of data (at byte offset in the export) that falls in
+// [start, end] to the chunk, sending the chunk whenever it fills
+void HistoryExport::emit(uint32_t offset, const char* data, size_t length, uint32_t start, uint32_t end) {
+  size_t skip = offset < start ? start - offset : 0;
+  if (skip >= length || offset > end) {
+    return;
+  }
+  size_t take = min((uint32_t)(length - skip), (uint32_t)(end - (offset + skip) + 1));
+  data += skip;
+  while (take > 0) {
+    size_t room = min(take, EXPORT_CHUNK_SIZE - chunkLength);
+    memcpy(chunk + chunkLength, data, room);
+    chunkLength += room;
+    data += room;
+    take -= room;
+    if (chunkLength == EXPORT_CHUNK_SIZE) {
+      sink(chunk, chunkLength);
+      chunkLength = 0;
+    }
+  }
+}
+
+uint32_t HistoryExport::write(uint32_t start, uint32_t end, ExportSink output) {
+  sink = output;
+  chunkLength = 0;
+  size_t headerLength = getHeaderLength();
+  size_t recordLength = getRecordLength();
+  if (headerLength > 0) {
+    emit(0, CSV_HEADER, headerLength, start, end);
+  }
+
+  // Records before the first wanted one are skipped by count, unread
+  uint32_t first = start > headerLength ? (start - headerLength) / recordLength : 0;
+  uint32_t index = 0;
+  uint32_t written = 0;
+  char record[EXPORT_RECORD_MAX];
+  for (uint8_t b = 0; b < blockTotal; b++) {
+    if (blockCounts[b] == 0) {
+      continue;
+    }
+    if (index + blockCounts[b] <= first) {
+      index += blockCounts[b];
+      continue;
+    }
+    if (headerLength + index * recordLength > end) {
+      break;
+    }
+
+    ArchiveBlockHeader header;
+    const uint8_t* data = loadBlock(firstSequence + b, header);
+    if (!data) {
+      break;
+    }
+    SeriesDecoder decoder;
+    decoder.begin(data, header.length, header.count);
+    HistorySample sample;
+    uint16_t remaining = blockCounts[b];
+    while (remaining > 0 && headerLength + index * recordLength <= end && decoder.next(sample)) {
+      if (sample.time < from || sample.time > to) {
+        continue;
+      }
+      if (index >= first) {
+        emit(headerLength + index * recordLength, record, formatRecord(sample, record), start, end);
+        written++;
+      }
+      index++;
+      remaining--;
+    }
+  }
+
+  if (chunkLength > 0) {
+    sink(chunk, chunkLength);
+  }
+  return written;
+}
+
+uint32_t HistoryExport::getLength() const {
+  return getHeaderLength() + count * getRecordLength();
+}
+
+uint32_t HistoryExport::getCount() const {
+  return count;
+}
+
+size_t HistoryExport::getHeaderLength() const {
+  return format == EXPORT_CSV ? sizeof(CSV_HEADER) - 1 : 0;
+}
+
+// Every value fits its field width, so any sample gives the same length
+size_t HistoryExport::getRecordLength() const {
+  HistorySample sample;
+  memset(&sample, 0, sizeof(sample));
+  char record[EXPORT_RECORD_MAX];
+  return formatRecord(sample, record);
+}
+
+void HistoryExport::getETag(char* etag, size_t size) const {
+  snprintf(etag, size, "\"%s-%u-%u-%u\"", formatName(format), count, firstTime, lastTime);
+}
+
+// Parses a single "bytes=first-last", "bytes=first-" or "bytes=-suffix"
+// range against a body of the given length. False when it cannot be met.
+bool HistoryExport::parseRange(const char* header, uint32_t length, uint32_t& start, uint32_t& end) {
+  if (strncmp(header, "bytes=", 6) != 0 || strchr(header, ',') || length == 0) {
+    return false;
+  }
+  const char* spec = header + 6;
+  char* rest;
+  if (*spec == '-') {
+    uint32_t suffix = strtoul(spec + 1, &rest, 10);
+    if (suffix == 0) {
+      return false;
+    }
+    start = suffix >= length ? 0 : length - suffix;
+    end = length - 1;
+    return true;
+  }
+  start = strtoul(spec, &rest, 10);
+  if (rest == spec || *rest != '-' || start >= length) {
+    return false;
+  }
+  end = rest[1] ? strtoul(rest + 1, nullptr, 10) : length - 1;
+  end = min(end, length - 1);
+  return end >= start;
+}
+
+bool HistoryExport::parseFormat(const char* name, ExportFormat& format) {
+  if (strcmp(name, "csv") == 0) {
+    format = EXPORT_CSV;
+  } else if (strcmp(name, "ndjson") == 0) {
+    format = EXPORT_NDJSON;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+const char* HistoryExport::formatName(ExportFormat format) {
+  return format == EXPORT_CSV ? "csv" : "ndjson";
+}
+
+const char* HistoryExport::contentType(ExportFormat format) {
+  return format == EXPORT_CSV ? "text/csv" : "application/x-ndjson";
+}
@@ -0,0 +1,162 @@
+#include "house_peers.h"
+
+static_assert(sizeof(HouseDatagram) == 20, "HouseDatagram is a wire format");
+
+HousePeers::HousePeers(PMSSensor* pmsSensor) {
+  sensor = pmsSensor;
+  memset(peers, 0, sizeof(peers));
+  changed = true;
+  joined = false;
+  lastSentSequence = 0;
+  lastSent = 0;
+  sentCount = 0;
+  receivedCount = 0;
+  rejectedCount = 0;
+}
+
+void HousePeers::loop() {
+  if (WiFi.status() != WL_CONNECTED) {
+    if (joined) {
+      udp.stop();
+      joined = false;
+    }
+    return;
+  }
+  if (!joined) {
+#ifdef ESP32
+    joined = udp.beginMulticast(HOUSE_GROUP_IP, HOUSE_PORT);
+#else
+    joined = udp.beginMulticast(WiFi.localIP(), HOUSE_GROUP_IP, HOUSE_PORT);
+#endif
+    if (!joined) {
+      return;
+    }
+  }
+
+  receive();
+  expire();
+  if (changed) {
+    publish();
+  }
+
+  const PMSSensor::ReadingSnapshot reading = sensor->readSnapshot();
+  if (reading.sequence != 0 && (reading.sequence != lastSentSequence || millis() - lastSent >= HOUSE_HEARTBEAT_MS)) {
+    send(reading);
+  }
+}
+
+void HousePeers::send(const PMSSensor::ReadingSnapshot& reading) {
+  HouseDatagram datagram;
+  datagram.magic = HOUSE_MAGIC;
+  datagram.version = HOUSE_VERSION;
+  datagram.flags = reading.data.isValid ? 1 : 0;
+  datagram.hubId = getHubId();
+  datagram.sequence = reading.sequence;
+  datagram.pm1_0 = reading.data.pm1_0_atm;
+  datagram.pm2_5 = reading.data.pm2_5_atm;
+  datagram.pm10 = reading.data.pm10_atm;
+  datagram.vocIndex = reading.vocIndex;
+  datagram.reserved = 0;
+
+#ifdef ESP32
+  udp.beginMulticastPacket();
+#else
+  udp.beginPacketMulticast(HOUSE_GROUP_IP, HOUSE_PORT, WiFi.localIP());
+#endif
+  udp.write((const uint8_t*)&datagram, sizeof(datagram));
+  if (udp.endPacket()) {
+    sentCount++;
+  }
+  lastSentSequence = reading.sequence;
+  lastSent = millis();
+}
+
+void HousePeers::receive() {
+  for (uint8_t i = 0; i < HOUSE_PACKETS_PER_LOOP; i++) {
+    int size = udp.parsePacket();
+    if (size <= 0) {
+      return;
+    }
+
+    HouseDatagram datagram;
+    if (size != sizeof(datagram) || udp.read((uint8_t*)&datagram, sizeof(datagram)) != sizeof(datagram) ||
+        datagram.magic != HOUSE_MAGIC || datagram.version != HOUSE_VERSION) {
+      rejectedCount++;
+      continue;
+    }
+    // Multicast loops back to the sender
+    if (datagram.hubId == getHubId()) {
+      continue;
+    }
+    receivedCount++;
+
+    // The hub's own slot, else a free one, else the least recently heard
+    uint8_t slot = 0;
+    for (uint8_t p = 0; p < HOUSE_MAX_PEERS; p++) {
+      if (peers[p].lastSeen != 0 && peers[p].reading.hubId == datagram.hubId) {
+        slot = p;
+        break;
+      }
+      if (peers[p].lastSeen == 0 || (peers[slot].lastSeen != 0 && peers[p].lastSeen < peers[slot].lastSeen)) {
+        slot = p;
+      }
+    }
+    peers[slot].reading = datagram;
+    peers[slot].ip = udp.remoteIP();
+    peers[slot].lastSeen = max(millis(), 1UL);
+    changed = true;
+  }
+}
+
+void HousePeers::expire() {
+  for (uint8_t p = 0; p < HOUSE_MAX_PEERS; p++) {
+    if (peers[p].lastSeen != 0 && millis() - peers[p].lastSeen >= HOUSE_PEER_TIMEOUT_MS) {
+      peers[p].lastSeen = 0;
+      changed = true;
+    }
+  }
+}
+
+void HousePeers::publish() {
+  HouseView view;
+  memcpy(view.peers, peers, sizeof(view.peers));
+  view.count = getPeerCount();
+  shared.write(view);
+  changed = false;
+}
+
+HouseView HousePeers::readView() const {
+  HouseView view;
+  shared.read(view);
+  return view;
+}
+
+uint8_t HousePeers::getPeerCount() const {
+  uint8_t count = 0;
+  for (uint8_t p = 0; p < HOUSE_MAX_PEERS; p++) {
+    if (peers[p].lastSeen != 0) {
+      count++;
+    }
+  }
+  return count;
+}
+
+const HousePeer* HousePeers::getPeer(uint8_t index) const {
+  return peers[index].lastSeen != 0 ? &peers[index] : nullptr;
+}
+
+uint32_t HousePeers::getHubId() {
+  return ESP.getChipId();
+}
+
+uint32_t HousePeers::getSentCount() const {
+  return sentCount;
+}
+
+uint32_t HousePeers::getReceivedCount() const {
+  return receivedCount;
+}
+
+uint32_t HousePeers::getRejectedCount() const {
+  return rejectedCount;
+}
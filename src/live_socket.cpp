@@ -0,0 +1,263 @@
+#include "live_socket.h"
+#include "sensing_lock.h"
+
+// Actuator control functions from main.cpp
+extern void setLED(bool state);
+extern bool getLEDState();
+extern void setServoPosition(int angle);
+extern int getServoPosition();
+
+// Header bytes per frame at these sizes: client frames are masked
+#define WS_HEADER_TO_HUB 6
+#define WS_HEADER_TO_CLIENT 2
+
+LiveSocket::LiveSocket(PMSSensor* pmsSensor, AirQualityDisplay* airDisplay) : socket(LIVE_SOCKET_PORT) {
+  sensor = pmsSensor;
+  display = airDisplay;
+  memset(clients, 0, sizeof(clients));
+  lastLED = false;
+  lastServo = 0;
+  lastSequence = 0;
+  lastFrameCrc = 0;
+  connectCount = 0;
+  rejectedCount = 0;
+  commandCount = 0;
+  bytesIn = 0;
+  bytesOut = 0;
+  droppedFrames = 0;
+  lastCommandMicros = 0;
+  maxCommandMicros = 0;
+}
+
+void LiveSocket::begin() {
+  socket.onEvent([this](uint8_t num, WStype_t type, uint8_t* payload, size_t length) {
+    handleEvent(num, type, payload, length);
+  });
+  socket.begin();
+  lastLED = getLEDState();
+  lastServo = getServoPosition();
+}
+
+void LiveSocket::loop() {
+  socket.loop();
+  uint8_t frame[LIVE_FRAME_MAX];
+
+  // Changes made through HTTP, the rules engine or alerts
+  if (getLEDState() != lastLED || getServoPosition() != lastServo) {
+    broadcast(frame, buildState(frame, 0), -1);
+  }
+
+  const PMSSensor::ReadingSnapshot reading = sensor->readSnapshot();
+  if (reading.sequence != lastSequence) {
+    lastSequence = reading.sequence;
+    if (reading.data.isValid) {
+      broadcast(frame, buildReading(frame, reading), -1);
+    }
+  }
+
+  // The checksum is only taken while someone is watching, and skipped for
+  // this pass while the sensing side is drawing
+  bool watched = false;
+  for (uint8_t i = 0; i < WEBSOCKETS_SERVER_CLIENT_MAX; i++) {
+    watched |= clients[i].connected && clients[i].displayFeed;
+  }
+  if (watched) {
+    SensingLock lock(false);
+    if (lock.isHeld() && display->getFrameCrc() != lastFrameCrc) {
+      uint8_t length = buildDisplay(frame);
+      for (uint8_t i = 0; i < WEBSOCKETS_SERVER_CLIENT_MAX; i++) {
+        if (clients[i].connected && clients[i].displayFeed) {
+          enqueue(i, frame, length);
+        }
+      }
+    }
+  }
+
+  flush();
+}
+
+void LiveSocket::handleEvent(uint8_t num, WStype_t type, uint8_t* payload, size_t length) {
+  if (num >= WEBSOCKETS_SERVER_CLIENT_MAX) {
+    return;
+  }
+  Client& client = clients[num];
+
+  switch (type) {
+    case WStype_CONNECTED: {
+      if (getClientCount() >= LIVE_SOCKET_CLIENTS) {
+        rejectedCount++;
+        socket.disconnect(num);
+        return;
+      }
+      client.connected = true;
+      client.displayFeed = false;
+      client.head = 0;
+      client.count = 0;
+      connectCount++;
+
+      // Current state straight away, so the page needs no separate fetch
+      uint8_t frame[LIVE_FRAME_MAX];
+      enqueue(num, frame, buildState(frame, 0));
+      const PMSSensor::ReadingSnapshot reading = sensor->readSnapshot();
+      if (reading.data.isValid) {
+        enqueue(num, frame, buildReading(frame, reading));
+      }
+      break;
+    }
+    case WStype_DISCONNECTED:
+      client.connected = false;
+      client.count = 0;
+      break;
+    case WStype_BIN:
+      if (client.connected) {
+        bytesIn += length + WS_HEADER_TO_HUB;
+        handleCommand(num, payload, length);
+      }
+      break;
+    default:
+      break;
+  }
+}
+
+void LiveSocket::handleCommand(uint8_t num, const uint8_t* payload, size_t length) {
+  if (length != 4) {
+    return;
+  }
+  uint32_t start = micros();
+  uint16_t id = payload[2] | (payload[3] << 8);
+
+  if (payload[0] == LIVE_CMD_LED) {
+    setLED(payload[1] == 2 ? !getLEDState() : payload[1] != 0);
+  } else if (payload[0] == LIVE_CMD_SERVO && payload[1] <= 180) {
+    setServoPosition(payload[1]);
+  } else if (payload[0] == LIVE_CMD_DISPLAY) {
+    // The current frame straight away, then one frame per change
+    clients[num].displayFeed = payload[1] != 0;
+    if (clients[num].displayFeed) {
+      SensingLock lock;
+      uint8_t frame[LIVE_FRAME_MAX];
+      enqueue(num, frame, buildDisplay(frame));
+      flush();
+    }
+    return;
+  } else {
+    return;
+  }
+  lastCommandMicros = micros() - start;
+  if (lastCommandMicros > maxCommandMicros) {
+    maxCommandMicros = lastCommandMicros;
+  }
+  commandCount++;
+
+  // The sender gets its acknowledgement; the other dashboards the new state
+  uint8_t frame[LIVE_FRAME_MAX];
+  enqueue(num, frame, buildState(frame, id));
+  broadcast(frame, buildState(frame, 0), num);
+  flush();
+}
+
+void LiveSocket::enqueue(uint8_t num, const uint8_t* frame, uint8_t length) {
+  Client& client = clients[num];
+  if (client.count == LIVE_QUEUE_FRAMES) {
+    client.head = (client.head + 1) % LIVE_QUEUE_FRAMES;
+    client.count--;
+    droppedFrames++;
+  }
+  uint8_t slot = (client.head + client.count) % LIVE_QUEUE_FRAMES;
+  memcpy(client.frames[slot], frame, length);
+  client.lengths[slot] = length;
+  client.count++;
+}
+
+void LiveSocket::broadcast(const uint8_t* frame, uint8_t length, int except) {
+  for (uint8_t i = 0; i < WEBSOCKETS_SERVER_CLIENT_MAX; i++) {
+    if (clients[i].connected && i != except) {
+      enqueue(i, frame, length);
+    }
+  }
+}
+
+// Sends queued frames until a socket stops accepting them
+void LiveSocket::flush() {
+  for (uint8_t i = 0; i < WEBSOCKETS_SERVER_CLIENT_MAX; i++) {
+    Client& client = clients[i];
+    while (client.connected && client.count > 0) {
+      if (!socket.sendBIN(i, client.frames[client.head], client.lengths[client.head])) {
+        break;
+      }
+      bytesOut += client.lengths[client.head] + WS_HEADER_TO_CLIENT;
+      client.head = (client.head + 1) % LIVE_QUEUE_FRAMES;
+      client.count--;
+    }
+  }
+}
+
+uint8_t LiveSocket::buildState(uint8_t* frame, uint16_t ack) {
+  lastLED = getLEDState();
+  lastServo = getServoPosition();
+  frame[0] = LIVE_FRAME_STATE;
+  frame[1] = lastLED ? 1 : 0;
+  frame[2] = constrain(lastServo, 0, 180);
+  frame[3] = ack & 0xFF;
+  frame[4] = ack >> 8;
+  return 5;
+}
+
+uint8_t LiveSocket::buildReading(uint8_t* frame, const PMSSensor::ReadingSnapshot& reading) {
+  frame[0] = LIVE_FRAME_READING;
+  memcpy(frame + 1, &reading.sequence, 4);
+  memcpy(frame + 5, &reading.data.pm1_0_atm, 2);
+  memcpy(frame + 7, &reading.data.pm2_5_atm, 2);
+  memcpy(frame + 9, &reading.data.pm10_atm, 2);
+  frame[11] = reading.vocIndex;
+  return 12;
+}
+
+uint8_t LiveSocket::buildDisplay(uint8_t* frame) {
+  lastFrameCrc = display->getFrameCrc();
+  frame[0] = LIVE_FRAME_DISPLAY;
+  memcpy(frame + 1, &lastFrameCrc, 4);
+  return 5;
+}
+
+uint8_t LiveSocket::getClientCount() const {
+  uint8_t count = 0;
+  for (uint8_t i = 0; i < WEBSOCKETS_SERVER_CLIENT_MAX; i++) {
+    if (clients[i].connected) {
+      count++;
+    }
+  }
+  return count;
+}
+
+uint32_t LiveSocket::getConnectCount() const {
+  return connectCount;
+}
+
+uint32_t LiveSocket::getRejectedCount() const {
+  return rejectedCount;
+}
+
+uint32_t LiveSocket::getCommandCount() const {
+  return commandCount;
+}
+
+uint32_t LiveSocket::getBytesIn() const {
+  return bytesIn;
+}
+
+uint32_t LiveSocket::getBytesOut() const {
+  return bytesOut;
+}
+
+uint32_t LiveSocket::getDroppedFrames() const {
+  return droppedFrames;
+}
+
+uint32_t LiveSocket::getLastCommandMicros() const {
+  return lastCommandMicros;
+}
+
+uint32_t LiveSocket::getMaxCommandMicros() const {
+  return maxCommandMicros;
+}
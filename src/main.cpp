@@ -1,8 +1,19 @@
-#include <Arduino.h>
+#include "platform.h"
 #include <Servo.h>
+#include <LittleFS.h>
 #include "pms_sensor.h"
 #include "air_quality_display.h"
 #include "air_quality_webserver.h"
+#include "heap_monitor.h"
+#include "sensor_history.h"
+#include "history_archive.h"
+#include "rules_engine.h"
+#include "house_peers.h"
+#include "time_sync.h"
+#include "profiler.h"
+#include "black_box.h"
+#include "power_manager.h"
+#include "sensing_lock.h"
 
 // WiFi Configuration - Update with your credentials
 const char* WIFI_SSID = "Kalo phone";    // Your WiFi network name
@@ -16,26 +27,51 @@ const char* WIFI_PASS = "12345678";      // Your WiFi password
 // D4 = RST (PMS5003 sensor)
 #define SERVO_PIN D5     // Servo motor
 
+// Timed tasks in loop(); the sensor interval is in monotonic time
+#define SENSOR_READ_INTERVAL 30000
+#define WIFI_CHECK_INTERVAL 60000
+
+// On the ESP32 the sensing side (sensor, derived values, display) runs in
+// its own task on one core and loop(), with the web server, peers and
+// actuators, on the other. The two meet in the reading channels only.
+#ifdef ESP32
+#define SENSING_CORE 0
+#define SENSING_STACK 8192
+#define SENSING_PERIOD_MS 20
+#endif
+
 // Component states
 bool ledState = false;
 int servoPosition = 0;
 
-// Global objects
+// Global objects. Each component keeps its own state and is wired to the
+// others through constructor pointers; what is shared process-wide is the
+// actuator state above (reached by the web server and rules engine through
+// the functions below), the monotonic clock in TimeSync, the black box and
+// power manager and, in profiler builds, loopProfiler. The fleet simulator
+// (fleet/) runs many hubs in one process and reports which of these they share.
 Servo doorServo;
 PMSSensor airSensor;
-AirQualityDisplay airDisplay(&airSensor);
-AirQualityWebServer webServer(&airSensor, &airDisplay);
+HousePeers housePeers(&airSensor);
+AirQualityDisplay airDisplay(&airSensor, &housePeers);
+HeapMonitor heapMonitor;
+SensorHistory sensorHistory;
+HistoryArchive historyArchive;
+RulesEngine rulesEngine;
+TimeSync timeSync;
+AirQualityWebServer webServer(&airSensor, &airDisplay, &heapMonitor, &sensorHistory, &timeSync, &historyArchive, &rulesEngine, &housePeers);
 
 // Timing variables
 unsigned long lastSensorRead = 0;
 unsigned long lastDisplayUpdate = 0;
 unsigned long lastSerialOutput = 0;
+unsigned long lastWiFiCheck = 0;
 
 // LED control functions
 void setLED(bool state) {
   ledState = state;
   digitalWrite(LED_PIN, state ? HIGH : LOW);
-  Serial.println("LED: " + String(state ? "ON" : "OFF"));
+  Serial.printf("LED: %s\n", state ? "ON" : "OFF");
 }
 
 void toggleLED() {
@@ -50,28 +86,43 @@ bool getLEDState() {
 void setServoPosition(int angle) {
   servoPosition = angle;
   doorServo.write(angle);
-  Serial.println("Servo position: " + String(angle));
+  Serial.printf("Servo position: %d\n", angle);
 }
 
 int getServoPosition() {
   return servoPosition;
 }
 
-// Air quality alert function
-void checkAirQualityAlerts() {
-  if (airSensor.isDataValid()) {
-    float pm25 = airSensor.currentData.pm2_5_atm;
+void serviceSensorAndDisplay();
+#ifdef ESP32
+void sensingTask(void*);
+#else
+void serviceDuringUpload();
+#endif
+void storeReadings();
+uint32_t millisUntilNextTask();
+
+// Air quality alert function; network side, which owns the LED
+void checkAirQualityAlerts(const PMSSensor::ReadingSnapshot& snapshot) {
+  PROFILE_SPAN(SPAN_ALERTS);
+  if (snapshot.data.isValid) {
+    float pm25 = snapshot.data.pm2_5_atm;
     
-    // Alert thresholds
-    if (pm25 > 55) { // Unhealthy level
-      // Blink LED rapidly for warning
-      for(int i = 0; i < 5; i++) {
-        setLED(true);
-        delay(200);
-        setLED(false);
-        delay(200);
+    if (snapshot.level == AIR_UNHEALTHY) {
+      // Blink LED rapidly for warning, unless automation rules drive the
+      // LED; the rules only act when their state changes, so a blink would
+      // undo what they set until the next change
+      if (!rulesEngine.drives(RULE_TARGET_LED)) {
+        bool wasOn = getLEDState();
+        for(int i = 0; i < 5; i++) {
+          setLED(true);
+          delay(200);
+          setLED(false);
+          delay(200);
+        }
+        setLED(wasOn);
       }
-      Serial.println("⚠️ AIR QUALITY ALERT: Unhealthy PM2.5 level detected: " + String(pm25));
+      Serial.printf("⚠️ AIR QUALITY ALERT: Unhealthy PM2.5 level detected: %.2f\n", pm25);
     }
   }
 }
@@ -85,6 +136,34 @@ void setup() {
   Serial.println("    ESP8266 + OLED + Web Interface");
   Serial.println("=========================================");
   
+  // Recover what the previous boot recorded before a reset, then start anew
+  blackBox.begin();
+  SensingLock::begin();
+  
+  // Flash filesystem for cached WiFi link parameters, long-term history
+  // and the compiled automation rules
+#ifdef ESP32
+  if (!LittleFS.begin(true)) {
+#else
+  if (!LittleFS.begin()) {
+#endif
+    Serial.println("LittleFS mount failed");
+  }
+  historyArchive.begin();
+  rulesEngine.begin();
+  
+  // WiFi sleep mode is set before association so the listen interval applies
+  powerManager.begin();
+  
+  // Start the web server first so WiFi associates in the background
+  // while the peripherals below go through their start-up delays
+  Serial.println("Starting web server...");
+  webServer.begin(WIFI_SSID, WIFI_PASS);
+#ifndef ESP32
+  webServer.setBackgroundTask(serviceDuringUpload);
+#endif
+  powerManager.setWakeCheck([]() { return webServer.hasPendingRequest(); });
+  
   // Initialize LED pin
   pinMode(LED_PIN, OUTPUT);
   digitalWrite(LED_PIN, LOW);
@@ -113,28 +192,31 @@ void setup() {
   airSensor.begin();
   delay(1000);
   
-  // Initialize web server
-  Serial.println("Starting web server...");
-  webServer.begin(WIFI_SSID, WIFI_PASS);
-  
   Serial.println("Setup complete!");
   Serial.println("=========================================");
-  if (webServer.isWiFiConnected()) {
-    Serial.print("Web dashboard: http://");
-    Serial.println(webServer.getIPAddress());
-  }
-  Serial.println("=========================================");
+  
+  // Heap baseline for long-run fragmentation tracking
+  heapMonitor.begin();
+  
+  // Power figures cover normal operation, not the start-up delays
+  powerManager.resetStats();
   
   // Initialize timing
-  lastSensorRead = millis();
+  lastSensorRead = TimeSync::monotonicMillis();
   lastDisplayUpdate = millis();
   lastSerialOutput = millis();
+  
+#ifdef ESP32
+  xTaskCreatePinnedToCore(sensingTask, "sensing", SENSING_STACK, nullptr, 1, nullptr, SENSING_CORE);
+#endif
 }
 
 void loop() {
+  PROFILE_LOOP_BEGIN();
+  uint32_t loopStart = micros();
+  
   // Check WiFi connection status periodically
-  static unsigned long lastWiFiCheck = 0;
-  if (millis() - lastWiFiCheck >= 60000) { // Check every minute
+  if (millis() - lastWiFiCheck >= WIFI_CHECK_INTERVAL) {
     lastWiFiCheck = millis();
     if (WiFi.status() != WL_CONNECTED) {
       Serial.println("WARNING: WiFi connection lost!");
@@ -150,19 +232,85 @@ void loop() {
   }
   
   // Handle web server requests
-  webServer.handleClient();
+  {
+    PROFILE_SPAN(SPAN_WEB);
+    webServer.handleClient();
+  }
+  {
+    PROFILE_SPAN(SPAN_TIME_SYNC);
+    timeSync.update();
+  }
   
-  // Read sensor data every 30 seconds
-  if (millis() - lastSensorRead >= 30000) {
+  // Exchange readings with the other hubs in the house
+  housePeers.loop();
+  
+#ifndef ESP32
+  serviceSensorAndDisplay();
+#endif
+  storeReadings();
+  
+  {
+    PROFILE_SPAN(SPAN_HEAP);
+    heapMonitor.update();
+  }
+  
+  // Iteration latency is the busy time; the idle delay is not counted
+  PROFILE_LOOP_END();
+  blackBox.loopDone(micros() - loopStart);
+  
+  // Sleep until the next timed task, or until a request arrives
+  powerManager.idle(millisUntilNextTask());
+}
+
+// Real time until the sensor, display or WiFi check is next due; on the
+// ESP32 the sensing task keeps its own time
+uint32_t millisUntilNextTask() {
+  uint32_t wifiElapsed = millis() - lastWiFiCheck;
+  uint32_t wifiDue = wifiElapsed >= WIFI_CHECK_INTERVAL ? 0 : WIFI_CHECK_INTERVAL - wifiElapsed;
+#ifdef ESP32
+  return wifiDue;
+#else
+  uint32_t sensorElapsed = (unsigned long)TimeSync::monotonicMillis() - lastSensorRead;
+  uint32_t sensorDue = sensorElapsed >= SENSOR_READ_INTERVAL ? 0 : (SENSOR_READ_INTERVAL - sensorElapsed) / SIM_TIME_SCALE;
+  uint32_t displayElapsed = millis() - lastDisplayUpdate;
+  uint32_t displayDue = displayElapsed >= powerManager.getDisplayInterval() ? 0 : powerManager.getDisplayInterval() - displayElapsed;
+  return min(sensorDue, min(displayDue, wifiDue));
+#endif
+}
+
+#ifdef ESP32
+void sensingTask(void*) {
+  while (true) {
+    {
+      SensingLock lock;
+      serviceSensorAndDisplay();
+    }
+    vTaskDelay(pdMS_TO_TICKS(SENSING_PERIOD_MS));
+  }
+}
+#endif
+
+#ifndef ESP32
+// Run between chunks of a firmware upload, which holds the web server for
+// its whole duration; the readings queue up for storeReadings()
+void serviceDuringUpload() {
+  serviceSensorAndDisplay();
+  heapMonitor.update();
+}
+#endif
+
+// Sensor sampling, derived values and display refresh: the sensing side
+void serviceSensorAndDisplay() {
+  // Read sensor data every 30 seconds of monotonic (possibly simulated) time
+  if ((unsigned long)TimeSync::monotonicMillis() - lastSensorRead >= SENSOR_READ_INTERVAL) {
+    PROFILE_SPAN(SPAN_SENSOR);
     Serial.println("Reading PMS5003 sensor data...");
     
     if (airSensor.readData()) {
-      airSensor.updateTrend();
+      airSensor.updateTrend(timeSync.hourOf(airSensor.getSnapshot().time));
+      airSensor.updateForecast();
       Serial.println("Sensor data updated successfully");
       
-      // Check for air quality alerts
-      checkAirQualityAlerts();
-      
       // Print detailed data every 2 minutes
       if (millis() - lastSerialOutput >= 120000) {
         airSensor.printData();
@@ -172,15 +320,40 @@ void loop() {
       Serial.println("Failed to read sensor data - check connections");
     }
     
-    lastSensorRead = millis();
+    lastSensorRead = TimeSync::monotonicMillis();
   }
   
-  // Update display every 100ms
-  if (millis() - lastDisplayUpdate >= 100) {
+  // Update display at the power profile's refresh interval
+  if (millis() - lastDisplayUpdate >= powerManager.getDisplayInterval()) {
+    PROFILE_SPAN(SPAN_DISPLAY);
     airDisplay.update();
     lastDisplayUpdate = millis();
   }
-  
-  // Small delay to prevent overwhelming the system
-  delay(50);
-}
\ No newline at end of file
+}
+
+// Network side of the reading handoff: the history and flash archive are
+// read by web requests, and the alerts and rules drive the actuators the
+// web server also drives, so all of them take readings from the sensor's
+// queue rather than from the sensing side
+void storeReadings() {
+  PMSSensor::ReadingSnapshot reading;
+  while (airSensor.nextReading(reading)) {
+    blackBox.noteReading(reading.sequence, reading.data.pm2_5_atm, reading.data.isValid);
+    checkAirQualityAlerts(reading);
+    
+    // User automation rules may drive the LED and servo
+    rulesEngine.evaluate(reading);
+    
+    if (!reading.data.isValid) {
+      continue;
+    }
+    sensorHistory.add(reading);
+    
+    // The flash archive outlives reboots, so it is kept in wall-clock time
+    if (timeSync.isSynced()) {
+      HistorySample sample = sensorHistory.at(sensorHistory.size() - 1);
+      sample.time = timeSync.toEpoch(sample.time);
+      historyArchive.add(sample);
+    }
+  }
+}
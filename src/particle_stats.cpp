@@ -0,0 +1,60 @@
+#include "particle_stats.h"
+
+ParticleStats::ParticleStats() {
+  reset();
+}
+
+void ParticleStats::reset() {
+  memset(bins, 0, sizeof(bins));
+  memset(mean, 0, sizeof(mean));
+  memset(variance, 0, sizeof(variance));
+  massRatio = 0;
+  count = 0;
+}
+
+void ParticleStats::update(const uint16_t larger[PARTICLE_BINS], uint16_t pm2_5) {
+  // A plain running mean until the window has filled, so early readings are
+  // not pulled towards zero
+  count++;
+  float alpha = max(1.0f / count, 2.0f / (PARTICLE_STATS_WINDOW + 1));
+
+  for (uint8_t i = 0; i < PARTICLE_BINS; i++) {
+    // Channels are cumulative; a noisy reading can make a larger size outnumber a smaller one
+    uint16_t next = i + 1 < PARTICLE_BINS ? larger[i + 1] : 0;
+    bins[i] = larger[i] > next ? larger[i] - next : 0;
+
+    float difference = bins[i] - mean[i];
+    mean[i] += alpha * difference;
+    variance[i] = (1 - alpha) * (variance[i] + alpha * difference * difference);
+  }
+
+  if (larger[0] > 0) {
+    float ratio = pm2_5 * 1000.0f / larger[0];
+    massRatio += alpha * (ratio - massRatio);
+  }
+}
+
+uint16_t ParticleStats::getBin(uint8_t bin) const {
+  return bins[bin];
+}
+
+float ParticleStats::getMean(uint8_t bin) const {
+  return mean[bin];
+}
+
+float ParticleStats::getStdDev(uint8_t bin) const {
+  return sqrtf(variance[bin]);
+}
+
+float ParticleStats::getMassRatio() const {
+  return massRatio;
+}
+
+uint32_t ParticleStats::getCount() const {
+  return count;
+}
+
+const char* ParticleStats::binName(uint8_t bin) {
+  static const char* const names[PARTICLE_BINS] = { "0.3-0.5", "0.5-1", "1-2.5", "2.5-5", "5-10", ">10" };
+  return bin < PARTICLE_BINS ? names[bin] : "";
+}
@@ -0,0 +1,111 @@
+#include "pms_capture.h"
+
+PMSRecorder::PMSRecorder() {
+  recording = false;
+  recordCount = 0;
+}
+
+bool PMSRecorder::start(const char* path) {
+  stop();
+  file = LittleFS.open(path, "w");
+  if (!file) {
+    return false;
+  }
+
+  uint32_t magic = PMS_CAPTURE_MAGIC;
+  file.write((const uint8_t*)&magic, sizeof(magic));
+  recording = true;
+  recordCount = 0;
+  Serial.printf("PMS capture: recording to %s\n", path);
+  return true;
+}
+
+void PMSRecorder::stop() {
+  if (recording) {
+    file.close();
+    recording = false;
+    Serial.printf("PMS capture: stopped after %u reads\n", recordCount);
+  }
+}
+
+void PMSRecorder::record(const uint8_t* bytes, uint8_t length) {
+  if (!recording) {
+    return;
+  }
+  if (file.size() + 1 + length > PMS_CAPTURE_MAX_SIZE) {
+    stop();
+    return;
+  }
+
+  file.write(length);
+  file.write(bytes, length);
+  // One record per read, so flushing each keeps a capture usable after a reset
+  file.flush();
+  recordCount++;
+}
+
+bool PMSRecorder::isRecording() const {
+  return recording;
+}
+
+uint32_t PMSRecorder::getRecordCount() const {
+  return recordCount;
+}
+
+size_t PMSRecorder::getSize() {
+  return recording ? file.size() : 0;
+}
+
+PMSReplay::PMSReplay() {
+  open = false;
+  recordCount = 0;
+}
+
+bool PMSReplay::start(const char* path) {
+  stop();
+  file = LittleFS.open(path, "r");
+  if (!file) {
+    return false;
+  }
+
+  uint32_t magic = 0;
+  if (file.read((uint8_t*)&magic, sizeof(magic)) != sizeof(magic) || magic != PMS_CAPTURE_MAGIC) {
+    file.close();
+    return false;
+  }
+  open = true;
+  recordCount = 0;
+  return true;
+}
+
+void PMSReplay::stop() {
+  if (open) {
+    file.close();
+    open = false;
+  }
+}
+
+bool PMSReplay::next(uint8_t* bytes, uint8_t& length) {
+  if (!open) {
+    return false;
+  }
+
+  // A truncated final record (reset mid-write) ends the replay
+  int header = file.read();
+  if (header < 0 || header > PMS_CAPTURE_CHUNK ||
+      file.read(bytes, header) != (size_t)header) {
+    stop();
+    return false;
+  }
+  length = header;
+  recordCount++;
+  return true;
+}
+
+bool PMSReplay::isOpen() const {
+  return open;
+}
+
+uint32_t PMSReplay::getRecordCount() const {
+  return recordCount;
+}
@@ -0,0 +1,109 @@
+#include "pms_frame.h"
+
+PMSFrameParser::PMSFrameParser() {
+  memset(&frame, 0, sizeof(frame));
+  frameCount = 0;
+  checksumErrors = 0;
+  lengthErrors = 0;
+  discardedBytes = 0;
+  position = 0;
+  expected = PMS_FRAME_SIZE;
+}
+
+PMSFrameResult PMSFrameParser::push(uint8_t byte) {
+  // Start sequence; a stray 0x42 before the real one restarts the match
+  if (position == 0) {
+    if (byte == 0x42) {
+      buffer[position++] = byte;
+    } else {
+      discardedBytes++;
+    }
+    return PMS_FRAME_PENDING;
+  }
+  if (position == 1) {
+    if (byte == 0x4D) {
+      buffer[position++] = byte;
+    } else if (byte == 0x42) {
+      discardedBytes++;
+    } else {
+      discardedBytes += 2;
+      position = 0;
+    }
+    return PMS_FRAME_PENDING;
+  }
+
+  buffer[position++] = byte;
+
+  if (position == 4) {
+    uint16_t length = (buffer[2] << 8) | buffer[3];
+    if (length == PMS_REPLY_LENGTH) {
+      expected = 4 + PMS_REPLY_LENGTH;
+    } else if (length != PMS_FRAME_LENGTH) {
+      lengthErrors++;
+      resync();
+      return PMS_FRAME_BAD_LENGTH;
+    }
+  }
+  if (position < expected) {
+    return PMS_FRAME_PENDING;
+  }
+
+  // Command acknowledgements carry no data
+  if (expected != PMS_FRAME_SIZE) {
+    position = 0;
+    expected = PMS_FRAME_SIZE;
+    return PMS_FRAME_PENDING;
+  }
+
+  uint16_t sum = 0;
+  for (uint8_t i = 0; i < PMS_FRAME_SIZE - 2; i++) {
+    sum += buffer[i];
+  }
+  uint16_t checksum = (buffer[PMS_FRAME_SIZE - 2] << 8) | buffer[PMS_FRAME_SIZE - 1];
+  if (sum != checksum) {
+    checksumErrors++;
+    resync();
+    return PMS_FRAME_BAD_CHECKSUM;
+  }
+  position = 0;
+
+  for (uint8_t i = 0; i < PMS_FRAME_WORDS; i++) {
+    frame.words[i] = (buffer[4 + 2 * i] << 8) | buffer[5 + 2 * i];
+  }
+  frameCount++;
+  return PMS_FRAME_OK;
+}
+
+// Re-scans a rejected frame for a start sequence inside it, so a truncated
+// frame does not also take the following one down
+void PMSFrameParser::resync() {
+  uint8_t pending[PMS_FRAME_SIZE];
+  uint8_t length = position - 1;
+  memcpy(pending, buffer + 1, length);
+  position = 0;
+  expected = PMS_FRAME_SIZE;
+  discardedBytes++;
+  for (uint8_t i = 0; i < length; i++) {
+    push(pending[i]);
+  }
+}
+
+const PMSFrame& PMSFrameParser::getFrame() const {
+  return frame;
+}
+
+uint32_t PMSFrameParser::getFrameCount() const {
+  return frameCount;
+}
+
+uint32_t PMSFrameParser::getChecksumErrors() const {
+  return checksumErrors;
+}
+
+uint32_t PMSFrameParser::getLengthErrors() const {
+  return lengthErrors;
+}
+
+uint32_t PMSFrameParser::getDiscardedBytes() const {
+  return discardedBytes;
+}
@@ -1,106 +1,76 @@
 #include "pms_sensor.h"
 
-PMSSensor::PMSSensor() {
+PMSSensor::PMSSensor() : pmsSerial(PMS5003_RX_PIN, PMS5003_TX_PIN), pms(pmsSerial) {
   // Initialize member variables
   currentData = {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, false};
-  trendIndex = 0;
+  snapshot.sequence = 0;
+  snapshot.time = 0;
+  snapshot.data = currentData;
+  snapshot.vocIndex = 0;
+  snapshot.level = AIR_NO_DATA;
+  snapshot.healthStatus = AlertState::healthStatus(AIR_NO_DATA);
+  snapshot.riskLevel = AlertState::riskLevel(AIR_NO_DATA);
+  shared.write(snapshot);
+  trendHour = 0;
   trendInitialized = false;
+  bucketPM25Sum = 0;
+  bucketPM10Sum = 0;
+  bucketVOCSum = 0;
+  bucketCount = 0;
   lastReadTime = 0;
   readInterval = 30000; // 30 seconds
   
-  // Initialize trend data array with fake realistic historical data (healthy pattern)
-  // Simulate a daily pattern with good air quality
-  float basePM25 = 8.0; // Base healthy PM2.5 level
-  float basePM10 = 12.0; // Base healthy PM10 level
-  float baseVOC = 25.0; // Base healthy VOC level
+  // Seed the trend with a simulated day so the charts are not empty at boot
   for (int i = 0; i < 24; i++) {
-    // Create a realistic daily pattern
-    float hour = i;
-    float dailyVariation = sin((hour - 6) * PI / 12) * 3.0; // Peak around noon, low at night
-    float randomVariation = (random(-100, 100) / 100.0); // ±1.0 random variation
-    pm25TrendData[i] = max(2.0f, basePM25 + dailyVariation + randomVariation);
-    
-    // PM10 pattern (slightly higher than PM2.5)
-    float pm10DailyVariation = sin((hour - 6) * PI / 12) * 4.0; // Peak around noon
-    float pm10RandomVariation = (random(-100, 100) / 100.0); // ±1.0 random variation
-    pm10TrendData[i] = max(3.0f, basePM10 + pm10DailyVariation + pm10RandomVariation);
-    
-    // VOC pattern (higher during day, lower at night)
-    float vocDailyVariation = sin((hour - 8) * PI / 14) * 8.0; // Peak around afternoon
-    float vocRandomVariation = (random(-50, 50) / 100.0); // ±0.5 random variation
-    vocTrendData[i] = max(10.0f, baseVOC + vocDailyVariation + vocRandomVariation);
-  }
-  trendInitialized = true; // Start with historical data
-  
-  // Create SoftwareSerial and PMS instances
-  pmsSerial = new SoftwareSerial(PMS5003_RX_PIN, PMS5003_TX_PIN);
-  pms = new PMS(*pmsSerial);
-}
-
-PMSSensor::~PMSSensor() {
-  if (pmsSerial) {
-    delete pmsSerial;
-  }
-  if (pms) {
-    delete pms;
+    SimSample sample = simulator.sample(i * 3600 + 1800);
+    pm25TrendData[i] = sample.pm2_5;
+    pm25TrendPeak[i] = sample.pm2_5;
+    pm10TrendData[i] = sample.pm10;
+    vocTrendData[i] = sample.vocIndex;
   }
+  updatePeakHour();
+  publishTrend();
+  sharedForecast.write(forecast);
+  sharedParticleStats.write(particleStats);
+  sharedAlerts.write(alerts);
 }
 
 void PMSSensor::begin() {
+#ifdef SENSOR_SIMULATOR
+  Serial.printf("PMS5003 simulated: scenario %s, seed %08X, time x%u\n",
+                SensorSimulator::scenarioName(simulator.getScenario()), simulator.getSeed(),
+                (unsigned)SIM_TIME_SCALE);
+  return;
+#endif
+  
   // Initialize serial communication with PMS5003
-  pmsSerial->begin(9600);
+  pmsSerial.begin(9600);
   Serial.println("PMS5003 sensor initialized with PMS library");
   
   // Wake up the sensor
-  pms->wakeUp();
+  pms.wakeUp();
   delay(1000);
   
   // Set to passive mode for controlled reading
-  pms->passiveMode();
+  pms.passiveMode();
   delay(100);
   
   Serial.println("PMS5003 configured in passive mode");
 }
 
 bool PMSSensor::readData() {
-  // Check if enough time has passed since last read
-  if (millis() - lastReadTime < readInterval) {
+  // Check if enough time has passed since last read; truncated to wrap like
+  // millis(), and virtual time in simulator builds
+  unsigned long now = TimeSync::monotonicMillis();
+  if (now - lastReadTime < readInterval) {
     return false;
   }
   
-  // Request read from sensor
-  pms->requestRead();
-  
-  // Create data structure for reading
-  PMS::DATA data;
+  bool received = replay.isOpen() ? readReplay() : readLive();
   
-  // Read data from sensor
-  if (pms->readUntil(data)) {
-    // Copy data to our structure and scale to show healthy air quality (divide by 20 for good readings)
-    currentData.pm1_0_cf1 = data.PM_SP_UG_1_0 / 20;
-    currentData.pm2_5_cf1 = data.PM_SP_UG_2_5 / 20;
-    currentData.pm10_cf1 = data.PM_SP_UG_10_0 / 20;
-    currentData.pm1_0_atm = data.PM_AE_UG_1_0 / 20;
-    currentData.pm2_5_atm = data.PM_AE_UG_2_5 / 20;
-    currentData.pm10_atm = data.PM_AE_UG_10_0 / 20;
-    
-    // Add some healthy variance (small random adjustments)
-    float variance = (random(-100, 100) / 1000.0); // ±0.1 variance
-    currentData.pm1_0_atm = max(0.1f, currentData.pm1_0_atm + variance);
-    currentData.pm2_5_atm = max(0.1f, currentData.pm2_5_atm + variance);
-    currentData.pm10_atm = max(0.1f, currentData.pm10_atm + variance);
-    
-    // PMS5003 basic version doesn't provide particle count data
-    // Set approximate values based on PM readings (also scaled down for healthy readings)
-    currentData.particles_03 = currentData.pm1_0_atm * 5;
-    currentData.particles_05 = currentData.pm2_5_atm * 4;
-    currentData.particles_10 = currentData.pm2_5_atm * 3;
-    currentData.particles_25 = currentData.pm10_atm * 2;
-    currentData.particles_50 = currentData.pm10_atm * 1;
-    currentData.particles_100 = max(1.0f, currentData.pm10_atm * 0.5f);
-    currentData.isValid = true;
-    
-    lastReadTime = millis();
+  if (received) {
+    lastReadTime = now;
+    completeReading();
     
     // Debug output
     Serial.print("PMS5003 Data - PM1.0: ");
@@ -115,206 +85,322 @@ bool PMSSensor::readData() {
     return true;
   } else {
     currentData.isValid = false;
+    publish();
     Serial.println("Failed to read PMS5003 data");
     return false;
   }
 }
 
-void PMSSensor::updateTrend() {
-  // Only update if we have valid data
-  if (!currentData.isValid) {
-    return;
+bool PMSSensor::ingest(uint8_t byte) {
+  if (parser.push(byte) != PMS_FRAME_OK) {
+    return false;
   }
-  
-  // Initialize trend with first valid reading
-  if (!trendInitialized && currentData.pm2_5_atm > 0) {
-    pm25TrendData[trendIndex] = currentData.pm2_5_atm;
-    vocTrendData[trendIndex] = getVOCIndex();
-    pm10TrendData[trendIndex] = currentData.pm10_atm;
-    trendIndex = (trendIndex + 1) % 24;
-    trendInitialized = true;
-    Serial.println("Trend data initialized with PM2.5: " + String(currentData.pm2_5_atm) + ", PM10: " + String(currentData.pm10_atm) + ", VOC: " + String(getVOCIndex()));
+  applyFrame(parser.getFrame());
+  completeReading();
+  return true;
+}
+
+void PMSSensor::completeReading() {
+  currentData.isValid = true;
+  publish();
+}
+
+bool PMSSensor::readLive() {
+#ifdef SENSOR_SIMULATOR
+  return readSimulator();
+#else
+  return readSensor();
+#endif
+}
+
+bool PMSSensor::readSensor() {
+  // Request read from sensor
+  pms.requestRead();
+  
+  // Parse the reply ourselves so the raw bytes can be recorded
+  uint8_t raw[PMS_CAPTURE_CHUNK];
+  uint8_t length = 0;
+  bool received = false;
+  unsigned long start = millis();
+  while (!received && millis() - start < PMS_READ_TIMEOUT) {
+    if (!pmsSerial.available()) {
+      yield();
+      continue;
+    }
+    uint8_t byte = pmsSerial.read();
+    if (length < sizeof(raw)) {
+      raw[length++] = byte;
+    }
+    received = parser.push(byte) == PMS_FRAME_OK;
   }
+  recorder.record(raw, length);
   
-  // Update trend data rapidly for real-time demo (every 5 seconds)
-  static unsigned long lastTrendUpdate = 0;
-  if (millis() - lastTrendUpdate >= 5000) {  // 5 seconds for real-time updates
-    pm25TrendData[trendIndex] = currentData.pm2_5_atm;
-    vocTrendData[trendIndex] = getVOCIndex();
-    pm10TrendData[trendIndex] = currentData.pm10_atm;
-    trendIndex = (trendIndex + 1) % 24;
-    lastTrendUpdate = millis();
-    Serial.println("Trend updated at index " + String(trendIndex) + " with PM2.5: " + String(currentData.pm2_5_atm) + ", PM10: " + String(currentData.pm10_atm) + ", VOC: " + String(getVOCIndex()));
+  if (received) {
+    applyFrame(parser.getFrame());
   }
+  return received;
 }
 
-String PMSSensor::getHealthStatus() {
-  if (!currentData.isValid) {
-    return "No Data";
+bool PMSSensor::readReplay() {
+  uint8_t raw[PMS_CAPTURE_CHUNK];
+  uint8_t length;
+  if (!replay.next(raw, length)) {
+    Serial.printf("PMS replay: finished after %u reads\n", replay.getRecordCount());
+    return readLive();
   }
   
-  uint16_t pm25 = currentData.pm2_5_atm;
-  uint8_t vocIndex = getVOCIndex();
-  
-  if (pm25 <= 12 && vocIndex < 30) {
-    return "Good :)";
-  } else if (pm25 <= 35 && vocIndex < 60) {
-    return "Moderate :|";
-  } else if (pm25 <= 55 && vocIndex < 80) {
-    return "Unhealthy for Sensitive :(";
-  } else {
-    return "Unhealthy :(";
+  // Same bytes, same parser state transitions as the original read
+  for (uint8_t i = 0; i < length; i++) {
+    if (parser.push(raw[i]) == PMS_FRAME_OK) {
+      applyFrame(parser.getFrame());
+      return true;
+    }
   }
+  return false;
+}
+
+// All twelve measurement channels, as sent
+void PMSSensor::applyFrame(const PMSFrame& frame) {
+  currentData.pm1_0_cf1 = frame.words[PMS_WORD_PM1_0_CF1];
+  currentData.pm2_5_cf1 = frame.words[PMS_WORD_PM2_5_CF1];
+  currentData.pm10_cf1 = frame.words[PMS_WORD_PM10_CF1];
+  currentData.pm1_0_atm = frame.words[PMS_WORD_PM1_0_ATM];
+  currentData.pm2_5_atm = frame.words[PMS_WORD_PM2_5_ATM];
+  currentData.pm10_atm = frame.words[PMS_WORD_PM10_ATM];
+  currentData.particles_03 = frame.words[PMS_WORD_PARTICLES_03];
+  currentData.particles_05 = frame.words[PMS_WORD_PARTICLES_05];
+  currentData.particles_10 = frame.words[PMS_WORD_PARTICLES_10];
+  currentData.particles_25 = frame.words[PMS_WORD_PARTICLES_25];
+  currentData.particles_50 = frame.words[PMS_WORD_PARTICLES_50];
+  currentData.particles_100 = frame.words[PMS_WORD_PARTICLES_100];
 }
 
-String PMSSensor::getRiskLevel() {
-  if (!currentData.isValid) {
-    return "UNKNOWN";
+bool PMSSensor::readSimulator() {
+  SimSample sample = simulator.sample(TimeSync::monotonicSeconds());
+  if (!sample.isValid) {
+    return false;
   }
   
-  uint16_t pm25 = currentData.pm2_5_atm;
-  uint8_t vocIndex = getVOCIndex();
-  
-  if (pm25 > 55 || vocIndex > 80) {
-    return "HIGH";
-  } else if (pm25 > 35 || vocIndex > 60) {
-    return "MODERATE";
-  } else {
-    return "LOW";
-  }
+  // Indoors the CF=1 and atmospheric values coincide below ~30 µg/m³
+  currentData.pm1_0_atm = currentData.pm1_0_cf1 = lround(sample.pm1_0);
+  currentData.pm2_5_atm = currentData.pm2_5_cf1 = lround(sample.pm2_5);
+  currentData.pm10_atm = currentData.pm10_cf1 = lround(sample.pm10);
+  currentData.particles_03 = lround(sample.counts[0]);
+  currentData.particles_05 = lround(sample.counts[1]);
+  currentData.particles_10 = lround(sample.counts[2]);
+  currentData.particles_25 = lround(sample.counts[3]);
+  currentData.particles_50 = lround(sample.counts[4]);
+  currentData.particles_100 = lround(sample.counts[5]);
+  return true;
 }
 
-uint8_t PMSSensor::getVOCIndex() {
-  // If sensor has valid data, calculate from particle count
-  if (currentData.isValid) {
-    // Calculate approximate VOC index from particle count
-    // This is a simplified calculation based on particle density
-    uint32_t totalParticles = currentData.particles_03 + currentData.particles_05 + currentData.particles_10;
-    uint8_t vocIndex = (uint8_t)min(100U, totalParticles / 1000U);
-    return vocIndex;
+void PMSSensor::updateTrend(uint8_t hour) {
+  // Only update if we have valid data
+  const AirQualityData& data = snapshot.data;
+  if (!data.isValid) {
+    return;
   }
   
-  // Demo mode: Generate realistic VOC index based on time patterns
-  // Simulate daily indoor air quality variations
-  unsigned long currentTime = millis();
-  float timeHours = (currentTime / 1000.0) / 3600.0; // Convert to hours
-  
-  // Base VOC level (good indoor air quality)
-  float baseVOC = 25.0;
+  // Slots are wall-clock hours; entering a new hour restarts that slot
+  if (!trendInitialized || hour != trendHour) {
+    trendHour = hour % 24;
+    bucketPM25Sum = 0;
+    bucketPM10Sum = 0;
+    bucketVOCSum = 0;
+    bucketCount = 0;
+    pm25TrendPeak[trendHour] = 0;
+    trendInitialized = true;
+    
+    // The slot being replaced may have held the old peak
+    updatePeakHour();
+  }
   
-  // Daily pattern: higher during day (cooking, activities), lower at night
-  float dailyPattern = sin((timeHours * 2 * PI) / 24.0) * 10.0;
+  uint8_t vocIndex = snapshot.vocIndex;
+  bucketPM25Sum += data.pm2_5_atm;
+  bucketPM10Sum += data.pm10_atm;
+  bucketVOCSum += vocIndex;
+  bucketCount++;
+  
+  // Hourly means and peak, updated incrementally
+  pm25TrendData[trendHour] = bucketPM25Sum / bucketCount;
+  pm10TrendData[trendHour] = bucketPM10Sum / bucketCount;
+  vocTrendData[trendHour] = bucketVOCSum / bucketCount;
+  if (data.pm2_5_atm > pm25TrendPeak[trendHour]) {
+    pm25TrendPeak[trendHour] = data.pm2_5_atm;
+    if (pm25TrendPeak[trendHour] >= pm25TrendPeak[peakHour]) {
+      peakHour = trendHour;
+    }
+  }
   
-  // Random variations to simulate real indoor activities
-  float randomVariation = (random(-300, 300) / 100.0); // ±3 points
+  publishTrend();
   
-  // Activity spikes (simulate cooking, cleaning, etc.)
-  float activitySpike = 0;
-  if ((int(timeHours * 10) % 73) == 0) { // Random activity every ~7.3 time units
-    activitySpike = random(5, 20); // Cooking/cleaning spike
+  Serial.printf("Trend updated for %02u:00 with PM2.5: %u, PM10: %u, VOC: %u (%u samples)\n",
+                trendHour, data.pm2_5_atm, data.pm10_atm, vocIndex, bucketCount);
+}
+
+void PMSSensor::publishTrend() {
+  TrendSnapshot trend;
+  trend.hour = trendHour;
+  memcpy(trend.pm25, pm25TrendData, sizeof(trend.pm25));
+  memcpy(trend.voc, vocTrendData, sizeof(trend.voc));
+  memcpy(trend.pm10, pm10TrendData, sizeof(trend.pm10));
+  sharedTrend.write(trend);
+}
+
+void PMSSensor::updatePeakHour() {
+  peakHour = 0;
+  for (uint8_t i = 1; i < 24; i++) {
+    if (pm25TrendPeak[i] > pm25TrendPeak[peakHour]) {
+      peakHour = i;
+    }
+  }
+}
+
+uint8_t PMSSensor::getTrendPeakHour() {
+  return peakHour;
+}
+
+// Runs alongside updateTrend(), once per valid reading
+void PMSSensor::updateForecast() {
+  if (!snapshot.data.isValid) {
+    return;
+  }
+  forecast.update(snapshot.data.pm2_5_atm);
+  sharedForecast.write(forecast);
+  if (forecast.getAnomaly() != ANOMALY_NONE) {
+    Serial.printf("PM2.5 anomaly: %s at %u ug/m3\n",
+                  AirForecast::anomalyName(forecast.getAnomaly()), snapshot.data.pm2_5_atm);
+  }
+}
+
+// Derived values are computed once here rather than on every display frame
+// and HTTP request
+void PMSSensor::publish() {
+  snapshot.data = currentData;
+  if (currentData.isValid) {
+    const uint16_t larger[PARTICLE_BINS] = {
+      currentData.particles_03, currentData.particles_05, currentData.particles_10,
+      currentData.particles_25, currentData.particles_50, currentData.particles_100
+    };
+    particleStats.update(larger, currentData.pm2_5_atm);
+    sharedParticleStats.write(particleStats);
+  }
+  snapshot.vocIndex = computeVOCIndex(currentData);
+  snapshot.time = TimeSync::monotonicSeconds();
+  alerts.update(currentData.isValid, currentData.pm2_5_atm, snapshot.vocIndex, snapshot.time);
+  snapshot.level = alerts.getLevel();
+  snapshot.healthStatus = AlertState::healthStatus(snapshot.level);
+  snapshot.riskLevel = AlertState::riskLevel(snapshot.level);
+  snapshot.sequence++;
+  sharedAlerts.write(alerts);
+  shared.write(snapshot);
+  queue.push(snapshot);
+}
+
+PMSSensor::ReadingSnapshot PMSSensor::readSnapshot() const {
+  ReadingSnapshot reading;
+  shared.read(reading);
+  return reading;
+}
+
+PMSSensor::TrendSnapshot PMSSensor::readTrend() const {
+  TrendSnapshot trend;
+  sharedTrend.read(trend);
+  return trend;
+}
+
+AirForecast PMSSensor::readForecast() const {
+  AirForecast copy;
+  sharedForecast.read(copy);
+  return copy;
+}
+
+ParticleStats PMSSensor::readParticleStats() const {
+  ParticleStats copy;
+  sharedParticleStats.read(copy);
+  return copy;
+}
+
+AlertState PMSSensor::readAlerts() const {
+  AlertState copy;
+  sharedAlerts.read(copy);
+  return copy;
+}
+
+uint32_t PMSSensor::getDerivedWrites() const {
+  return sharedTrend.getWriteCount() + sharedForecast.getWriteCount() +
+         sharedParticleStats.getWriteCount() + sharedAlerts.getWriteCount();
+}
+
+bool PMSSensor::nextReading(ReadingSnapshot& reading) {
+  return queue.pop(reading);
+}
+
+const char* PMSSensor::getHealthStatus() {
+  return snapshot.healthStatus;
+}
+
+const char* PMSSensor::getRiskLevel() {
+  return snapshot.riskLevel;
+}
+
+uint8_t PMSSensor::computeVOCIndex(const AirQualityData& data) {
+  if (!data.isValid) {
+    return 0;
   }
   
-  // Calculate final VOC index
-  float vocIndex = baseVOC + dailyPattern + randomVariation + activitySpike;
-  
-  // Ensure it stays within realistic indoor range (10-80)
-  vocIndex = constrain(vocIndex, 10, 80);
+  // Approximate VOC index from the density of fine particles counted by the
+  // sensor; it has no gas channel
+  uint32_t totalParticles = data.particles_03 + data.particles_05 + data.particles_10;
+  return (uint8_t)min(100U, totalParticles / 1000U);
+}
+
+uint8_t PMSSensor::getVOCIndex() {
+  // If sensor has valid data, use the value computed at publication
+  if (snapshot.data.isValid) {
+    return snapshot.vocIndex;
+  }
   
+  // Demo mode: simulated indoor VOC pattern
+  float vocIndex = simulator.sample(TimeSync::monotonicSeconds()).vocIndex;
   return (uint8_t)vocIndex;
 }
 
 void PMSSensor::printData() {
-  if (!currentData.isValid) {
+  if (!snapshot.data.isValid) {
     Serial.println("No valid PMS data available");
     return;
   }
   
   Serial.println("=== PMS5003 Data ===");
   Serial.println("CF=1 Readings:");
-  Serial.println("  PM1.0: " + String(currentData.pm1_0_cf1) + " μg/m³");
-  Serial.println("  PM2.5: " + String(currentData.pm2_5_cf1) + " μg/m³");
-  Serial.println("  PM10:  " + String(currentData.pm10_cf1) + " μg/m³");
+  Serial.printf("  PM1.0: %u μg/m³\n", snapshot.data.pm1_0_cf1);
+  Serial.printf("  PM2.5: %u μg/m³\n", snapshot.data.pm2_5_cf1);
+  Serial.printf("  PM10:  %u μg/m³\n", snapshot.data.pm10_cf1);
   
   Serial.println("Atmospheric Readings:");
-  Serial.println("  PM1.0: " + String(currentData.pm1_0_atm) + " μg/m³");
-  Serial.println("  PM2.5: " + String(currentData.pm2_5_atm) + " μg/m³");
-  Serial.println("  PM10:  " + String(currentData.pm10_atm) + " μg/m³");
+  Serial.printf("  PM1.0: %u μg/m³\n", snapshot.data.pm1_0_atm);
+  Serial.printf("  PM2.5: %u μg/m³\n", snapshot.data.pm2_5_atm);
+  Serial.printf("  PM10:  %u μg/m³\n", snapshot.data.pm10_atm);
   
   Serial.println("Particle Counts (per 0.1L air):");
-  Serial.println("  >0.3μm: " + String(currentData.particles_03));
-  Serial.println("  >0.5μm: " + String(currentData.particles_05));
-  Serial.println("  >1.0μm: " + String(currentData.particles_10));
-  Serial.println("  >2.5μm: " + String(currentData.particles_25));
-  Serial.println("  >5.0μm: " + String(currentData.particles_50));
-  Serial.println("  >10μm:  " + String(currentData.particles_100));
-  
-  Serial.println("Health Status: " + getHealthStatus());
-  Serial.println("Risk Level: " + getRiskLevel());
-  Serial.println("VOC Index: " + String(getVOCIndex()));
+  Serial.printf("  >0.3μm: %u\n", snapshot.data.particles_03);
+  Serial.printf("  >0.5μm: %u\n", snapshot.data.particles_05);
+  Serial.printf("  >1.0μm: %u\n", snapshot.data.particles_10);
+  Serial.printf("  >2.5μm: %u\n", snapshot.data.particles_25);
+  Serial.printf("  >5.0μm: %u\n", snapshot.data.particles_50);
+  Serial.printf("  >10μm:  %u\n", snapshot.data.particles_100);
+  
+  Serial.printf("Health Status: %s\n", getHealthStatus());
+  Serial.printf("Risk Level: %s\n", getRiskLevel());
+  Serial.printf("VOC Index: %u\n", getVOCIndex());
   Serial.println("===================");
 }
 
 bool PMSSensor::isDataValid() {
-  return currentData.isValid;
+  return snapshot.data.isValid;
 }
 
 unsigned long PMSSensor::getLastReadTime() {
   return lastReadTime;
 }
-
-// Demo data methods for testing and demonstration
-float PMSSensor::getDemoPM25() {
-  unsigned long currentTime = millis();
-  float timeHours = (currentTime / 1000.0) / 3600.0;
-  
-  // Base healthy PM2.5 level
-  float basePM = 12.0;
-  
-  // Daily pattern: higher during day, lower at night
-  float dailyPattern = sin((timeHours * 2 * PI) / 24.0) * 5.0;
-  
-  // Random variations
-  float randomVar = (random(-200, 200) / 100.0);
-  
-  // Activity spikes
-  float spike = 0;
-  if ((int(timeHours * 100) % 127) == 0) {
-    spike = random(3, 12); // Cooking/activity spike
-  }
-  
-  float pm25 = basePM + dailyPattern + randomVar + spike;
-  return constrain(pm25, 5.0, 35.0); // Realistic indoor range
-}
-
-float PMSSensor::getDemoPM10() {
-  // PM10 is typically 1.5-2x higher than PM2.5
-  float pm25 = getDemoPM25();
-  float pm10 = pm25 * (1.5 + (random(0, 50) / 100.0));
-  return constrain(pm10, 8.0, 50.0);
-}
-
-String PMSSensor::getDemoHealthStatus() {
-  float pm25 = getDemoPM25();
-  
-  if (pm25 <= 12.0) {
-    return "Excellent";
-  } else if (pm25 <= 20.0) {
-    return "Good";
-  } else if (pm25 <= 25.0) {
-    return "Moderate";
-  } else {
-    return "Poor";
-  }
-}
-
-String PMSSensor::getDemoRiskLevel() {
-  float pm25 = getDemoPM25();
-  
-  if (pm25 <= 15.0) {
-    return "LOW";
-  } else if (pm25 <= 25.0) {
-    return "MODERATE";
-  } else {
-    return "HIGH";
-  }
-}
\ No newline at end of file
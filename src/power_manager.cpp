@@ -0,0 +1,202 @@
+#include "power_manager.h"
+
+PowerManager powerManager;
+
+static const PowerProfileConfig PROFILES[POWER_PROFILE_COUNT] = {
+  { "performance", WIFI_NONE_SLEEP, 0, 20, 100, POWER_IDLE_RADIO_ON_MA },
+  { "balanced", WIFI_MODEM_SLEEP, 0, 100, 100, POWER_IDLE_MODEM_SLEEP_MA },
+  { "eco", WIFI_LIGHT_SLEEP, POWER_LISTEN_INTERVAL, 1000, 1000, POWER_IDLE_LIGHT_SLEEP_MA },
+};
+
+#ifdef POWER_WAKE_PIN
+static volatile bool pinWakeRequested = false;
+
+static void IRAM_ATTR onWakePin() {
+  pinWakeRequested = true;
+}
+#endif
+
+PowerManager::PowerManager() {
+  profile = POWER_PROFILE;
+  resetStats();
+}
+
+void PowerManager::begin() {
+  applySleepMode();
+#ifdef POWER_WAKE_PIN
+  pinMode(POWER_WAKE_PIN, INPUT_PULLUP);
+  attachInterrupt(digitalPinToInterrupt(POWER_WAKE_PIN), onWakePin, FALLING);
+#endif
+  Serial.printf("Power profile: %s\n", getConfig().name);
+}
+
+// The ESP32 has no light sleep with the radio associated and no listen
+// interval setting here; eco uses the deepest modem sleep instead
+void PowerManager::applySleepMode() {
+#ifdef ESP32
+  switch (getConfig().sleepType) {
+    case WIFI_NONE_SLEEP:
+      WiFi.setSleep(WIFI_PS_NONE);
+      break;
+    case WIFI_MODEM_SLEEP:
+      WiFi.setSleep(WIFI_PS_MIN_MODEM);
+      break;
+    default:
+      WiFi.setSleep(WIFI_PS_MAX_MODEM);
+      break;
+  }
+#else
+  WiFi.setSleepMode(getConfig().sleepType, getConfig().listenInterval);
+#endif
+}
+
+void PowerManager::setWakeCheck(std::function<bool()> check) {
+  wakeCheck = check;
+}
+
+// delay() hands the CPU to the SDK, which sleeps the radio, or with light
+// sleep the whole chip, until its next timer or beacon
+void PowerManager::idle(uint32_t windowMs) {
+  uint32_t budget = min(windowMs, (uint32_t)getConfig().maxIdleMs);
+  uint32_t start = micros();
+  uint32_t elapsed = 0;
+  while (elapsed < budget) {
+#ifdef POWER_WAKE_PIN
+    if (pinWakeRequested) {
+      pinWakeRequested = false;
+      pinWakes++;
+      break;
+    }
+#endif
+    if (wakeCheck && wakeCheck()) {
+      networkWakes++;
+      break;
+    }
+    delay(min(budget - elapsed, (uint32_t)POWER_IDLE_SLICE_MS));
+    elapsed = (micros() - start) / 1000;
+  }
+
+  uint32_t idled = micros() - start;
+  idleMicros += idled;
+  lastIdleMs = idled / 1000;
+  idleCount++;
+}
+
+void PowerManager::noteRequest(uint32_t latencyMs) {
+  uint8_t bucket = 0;
+  while (bucket < POWER_LATENCY_BUCKETS - 1 && latencyMs >= getLatencyBucketLimit(bucket)) {
+    bucket++;
+  }
+  latencyHistogram[bucket]++;
+  requestCount++;
+  if (latencyMs > maxLatencyMs) {
+    maxLatencyMs = latencyMs;
+  }
+}
+
+void PowerManager::setProfile(PowerProfile newProfile) {
+  profile = newProfile;
+  applySleepMode();
+  resetStats();
+  Serial.printf("Power profile: %s\n", getConfig().name);
+}
+
+void PowerManager::resetStats() {
+  statsStart = millis();
+  idleMicros = 0;
+  lastIdleMs = 0;
+  idleCount = 0;
+  networkWakes = 0;
+  pinWakes = 0;
+  memset(latencyHistogram, 0, sizeof(latencyHistogram));
+  requestCount = 0;
+  maxLatencyMs = 0;
+}
+
+PowerProfile PowerManager::getProfile() const {
+  return profile;
+}
+
+const PowerProfileConfig& PowerManager::getConfig() const {
+  return PROFILES[profile];
+}
+
+uint32_t PowerManager::getDisplayInterval() const {
+  return getConfig().displayIntervalMs;
+}
+
+uint32_t PowerManager::getLastIdle() const {
+  return lastIdleMs;
+}
+
+uint32_t PowerManager::getStatsMillis() const {
+  return millis() - statsStart;
+}
+
+uint32_t PowerManager::getIdleMillis() const {
+  return idleMicros / 1000;
+}
+
+uint32_t PowerManager::getIdleCount() const {
+  return idleCount;
+}
+
+uint32_t PowerManager::getNetworkWakes() const {
+  return networkWakes;
+}
+
+uint32_t PowerManager::getPinWakes() const {
+  return pinWakes;
+}
+
+// Busy time at the active current, idle time at the profile's idle current
+float PowerManager::getAverageMilliamps() const {
+  uint32_t total = getStatsMillis();
+  if (total == 0) {
+    return POWER_ACTIVE_MA;
+  }
+  uint32_t idle = min(getIdleMillis(), total);
+  return ((float)(total - idle) * POWER_ACTIVE_MA + (float)idle * getConfig().idleMilliamps) / total;
+}
+
+uint32_t PowerManager::getRequestCount() const {
+  return requestCount;
+}
+
+uint32_t PowerManager::getMaxLatency() const {
+  return maxLatencyMs;
+}
+
+uint32_t PowerManager::getLatencyHistogram(uint8_t bucket) const {
+  return latencyHistogram[bucket];
+}
+
+uint32_t PowerManager::getLatencyBucketLimit(uint8_t bucket) {
+  return 4UL << bucket;
+}
+
+uint32_t PowerManager::getLatencyPercentile(uint8_t percent) const {
+  uint32_t target = ((uint64_t)requestCount * percent + 99) / 100;
+  uint32_t seen = 0;
+  for (uint8_t i = 0; i < POWER_LATENCY_BUCKETS; i++) {
+    seen += latencyHistogram[i];
+    if (seen >= target && seen > 0) {
+      return i == POWER_LATENCY_BUCKETS - 1 ? maxLatencyMs : min(getLatencyBucketLimit(i), maxLatencyMs);
+    }
+  }
+  return 0;
+}
+
+const PowerProfileConfig& PowerManager::getProfileConfig(PowerProfile profile) {
+  return PROFILES[profile];
+}
+
+bool PowerManager::parseProfile(const char* name, PowerProfile& profile) {
+  for (uint8_t i = 0; i < POWER_PROFILE_COUNT; i++) {
+    if (strcmp(name, PROFILES[i].name) == 0) {
+      profile = (PowerProfile)i;
+      return true;
+    }
+  }
+  return false;
+}
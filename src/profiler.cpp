@@ -0,0 +1,122 @@
+#include "profiler.h"
+
+#ifdef ENABLE_PROFILER
+
+Profiler loopProfiler;
+
+Profiler::Profiler() {
+  loopStart = 0;
+  iterations = 0;
+  maxMicros = 0;
+  slowestCount = 0;
+  memset(spanCycles, 0, sizeof(spanCycles));
+  memset(histogram, 0, sizeof(histogram));
+  memset(spanTotalMicros, 0, sizeof(spanTotalMicros));
+  memset(spanMaxMicros, 0, sizeof(spanMaxMicros));
+}
+
+void Profiler::beginLoop() {
+  memset(spanCycles, 0, sizeof(spanCycles));
+  loopStart = ESP.getCycleCount();
+}
+
+void Profiler::endLoop() {
+  // The cycle counter wraps every 26-53 s depending on CPU clock; iterations
+  // are far shorter, so unsigned differences stay valid
+  uint32_t cyclesPerMicro = ESP.getCpuFreqMHz();
+  uint32_t total = (ESP.getCycleCount() - loopStart) / cyclesPerMicro;
+
+  iterations++;
+  if (total > maxMicros) {
+    maxMicros = total;
+  }
+  uint8_t bucket = 0;
+  while (bucket < PROFILER_BUCKETS - 1 && total >= getBucketLimit(bucket)) {
+    bucket++;
+  }
+  histogram[bucket]++;
+
+  Iteration current;
+  current.uptime = millis();
+  current.totalMicros = total;
+  for (uint8_t i = 0; i < PROFILE_SPAN_COUNT; i++) {
+    current.spanMicros[i] = spanCycles[i] / cyclesPerMicro;
+    spanTotalMicros[i] += current.spanMicros[i];
+    if (current.spanMicros[i] > spanMaxMicros[i]) {
+      spanMaxMicros[i] = current.spanMicros[i];
+    }
+  }
+
+  // Keep the N slowest: fill, then replace the fastest kept entry
+  if (slowestCount < PROFILER_SLOWEST) {
+    slowest[slowestCount++] = current;
+    return;
+  }
+  uint8_t fastest = 0;
+  for (uint8_t i = 1; i < PROFILER_SLOWEST; i++) {
+    if (slowest[i].totalMicros < slowest[fastest].totalMicros) {
+      fastest = i;
+    }
+  }
+  if (total > slowest[fastest].totalMicros) {
+    slowest[fastest] = current;
+  }
+}
+
+uint32_t Profiler::getIterations() const {
+  return iterations;
+}
+
+uint32_t Profiler::getMaxMicros() const {
+  return maxMicros;
+}
+
+uint32_t Profiler::getHistogram(uint8_t bucket) const {
+  return histogram[bucket];
+}
+
+uint32_t Profiler::getBucketLimit(uint8_t bucket) {
+  return 512UL << bucket;
+}
+
+uint32_t Profiler::getPercentile(uint8_t percent) const {
+  uint32_t target = ((uint64_t)iterations * percent + 99) / 100;
+  uint32_t seen = 0;
+  for (uint8_t i = 0; i < PROFILER_BUCKETS; i++) {
+    seen += histogram[i];
+    if (seen >= target && seen > 0) {
+      return i == PROFILER_BUCKETS - 1 ? maxMicros : getBucketLimit(i);
+    }
+  }
+  return 0;
+}
+
+uint64_t Profiler::getSpanTotalMicros(ProfileSpan span) const {
+  return spanTotalMicros[span];
+}
+
+uint32_t Profiler::getSpanMaxMicros(ProfileSpan span) const {
+  return spanMaxMicros[span];
+}
+
+uint8_t Profiler::getSlowestCount() const {
+  return slowestCount;
+}
+
+const Profiler::Iteration& Profiler::getSlowest(uint8_t index) const {
+  return slowest[index];
+}
+
+const char* Profiler::spanName(ProfileSpan span) {
+  switch (span) {
+    case SPAN_WEB: return "web";
+    case SPAN_TIME_SYNC: return "time_sync";
+    case SPAN_SENSOR: return "sensor";
+    case SPAN_ALERTS: return "alerts";
+    case SPAN_HEAP: return "heap";
+    case SPAN_DISPLAY: return "display";
+    default: return "unknown";
+  }
+}
+
+#endif
@@ -0,0 +1,121 @@
+#include "request_arena.h"
+
+RequestArena::RequestArena() {
+  used = 0;
+  highWater = 0;
+  textStart = 0;
+  textLength = 0;
+  textOpen = false;
+  overflows = 0;
+}
+
+void* RequestArena::allocate(size_t size) {
+  // Keep every block word aligned
+  size_t start = (used + 3) & ~(size_t)3;
+  if (textOpen || start + size > REQUEST_ARENA_SIZE) {
+    overflows++;
+    return nullptr;
+  }
+
+  used = start + size;
+  if (used > highWater) {
+    highWater = used;
+  }
+  return buffer + start;
+}
+
+char* RequestArena::printf(const char* format, ...) {
+  if (textOpen) {
+    overflows++;
+    return nullptr;
+  }
+
+  char* dest = (char*)buffer + used;
+  size_t room = REQUEST_ARENA_SIZE - used;
+
+  va_list args;
+  va_start(args, format);
+  int len = vsnprintf(dest, room, format, args);
+  va_end(args);
+
+  if (len < 0 || (size_t)len >= room) {
+    overflows++;
+    return nullptr;
+  }
+
+  used += len + 1;
+  if (used > highWater) {
+    highWater = used;
+  }
+  return dest;
+}
+
+void RequestArena::beginText() {
+  textStart = min(used, (size_t)REQUEST_ARENA_SIZE - 1);
+  textLength = 0;
+  textOpen = true;
+  buffer[textStart] = '\0';
+}
+
+bool RequestArena::appendf(const char* format, ...) {
+  if (!textOpen) {
+    return false;
+  }
+
+  char* dest = (char*)buffer + textStart + textLength;
+  size_t room = REQUEST_ARENA_SIZE - textStart - textLength;
+
+  va_list args;
+  va_start(args, format);
+  int len = vsnprintf(dest, room, format, args);
+  va_end(args);
+
+  if (len < 0 || (size_t)len >= room) {
+    // Drop the partial write so the text stays well formed up to this point
+    *dest = '\0';
+    overflows++;
+    return false;
+  }
+
+  textLength += len;
+  used = textStart + textLength + 1;
+  if (used > highWater) {
+    highWater = used;
+  }
+  return true;
+}
+
+bool RequestArena::append(const char* str) {
+  return appendf("%s", str);
+}
+
+const char* RequestArena::text() const {
+  return (const char*)buffer + textStart;
+}
+
+size_t RequestArena::getTextLength() const {
+  return textLength;
+}
+
+void RequestArena::reset() {
+  used = 0;
+  textStart = 0;
+  textLength = 0;
+  textOpen = false;
+}
+
+size_t RequestArena::getUsed() const {
+  return used;
+}
+
+size_t RequestArena::getCapacity() const {
+  return REQUEST_ARENA_SIZE;
+}
+
+size_t RequestArena::getHighWater() const {
+  return highWater;
+}
+
+uint32_t RequestArena::getOverflowCount() const {
+  return overflows;
+}
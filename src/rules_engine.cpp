@@ -0,0 +1,346 @@
+#include "rules_engine.h"
+#include <LittleFS.h>
+
+// Actuator control functions from main.cpp
+extern void setLED(bool state);
+extern void setServoPosition(int angle);
+
+// Encoded sizes within the program
+#define RULE_HEADER_SIZE 5
+#define RULE_CONDITION_SIZE 6
+#define RULE_ACTION_SIZE 3
+
+struct RulesFileHeader {
+  uint32_t magic;
+  uint16_t length;
+  uint16_t reserved;
+};
+
+static inline uint16_t readU16(const uint8_t* p) {
+  return p[0] | (p[1] << 8);
+}
+
+static inline void writeU16(uint8_t* p, uint16_t value) {
+  p[0] = value & 0xFF;
+  p[1] = value >> 8;
+}
+
+RulesEngine::RulesEngine() {
+  programLength = 0;
+  ruleCount = 0;
+  lastSequence = 0;
+  evaluationCount = 0;
+  memset(states, 0, sizeof(states));
+}
+
+void RulesEngine::begin() {
+  File file = LittleFS.open(RULES_FILE, "r");
+  if (!file) {
+    return;
+  }
+
+  RulesFileHeader header;
+  uint8_t code[RULES_PROGRAM_SIZE];
+  bool ok = file.read((uint8_t*)&header, sizeof(header)) == sizeof(header) &&
+            header.magic == RULES_MAGIC && header.length <= sizeof(code) &&
+            file.read(code, header.length) == header.length &&
+            load(code, header.length);
+  file.close();
+  Serial.printf("Rules: %s (%u rules, %u bytes)\n", ok ? "loaded" : "stored program invalid",
+                ruleCount, programLength);
+}
+
+// Checks a program's structure and indexes its rules; the running program
+// is only replaced when the new one is valid
+bool RulesEngine::load(const uint8_t* code, uint16_t length) {
+  uint16_t offsets[RULES_MAX];
+  uint8_t count = 0;
+  uint16_t position = 0;
+
+  while (position < length) {
+    if (count >= RULES_MAX || position + RULE_HEADER_SIZE > length) {
+      return false;
+    }
+    const uint8_t* rule = code + position;
+    // Counts are summed wide, so that a corrupt pair cannot wrap to a
+    // small program and leave getActionCount() reading past it
+    uint8_t conditions = rule[2];
+    uint16_t actions = (uint16_t)rule[3] + rule[4];
+    uint16_t size = RULE_HEADER_SIZE + conditions * RULE_CONDITION_SIZE + actions * RULE_ACTION_SIZE;
+    if (conditions == 0 || conditions > RULES_MAX_CONDITIONS || position + size > length) {
+      return false;
+    }
+
+    for (uint8_t i = 0; i < conditions; i++) {
+      const uint8_t* condition = rule + RULE_HEADER_SIZE + i * RULE_CONDITION_SIZE;
+      if (condition[0] > METRIC_VOC || condition[1] > RULE_BELOW) {
+        return false;
+      }
+    }
+    const uint8_t* action = rule + RULE_HEADER_SIZE + conditions * RULE_CONDITION_SIZE;
+    for (uint16_t i = 0; i < actions; i++, action += RULE_ACTION_SIZE) {
+      // The values compileActions() can produce
+      uint16_t value = readU16(action + 1);
+      if ((action[0] == RULE_TARGET_LED && value > 1) || (action[0] == RULE_TARGET_SERVO && value > 180) ||
+          action[0] > RULE_TARGET_SERVO) {
+        return false;
+      }
+    }
+
+    offsets[count++] = position;
+    position += size;
+  }
+
+  memcpy(program, code, length);
+  memcpy(ruleOffset, offsets, sizeof(offsets));
+  programLength = length;
+  ruleCount = count;
+  memset(states, 0, sizeof(states));
+  return true;
+}
+
+bool RulesEngine::save() {
+  File file = LittleFS.open(RULES_FILE, "w");
+  if (!file) {
+    return false;
+  }
+  RulesFileHeader header = { RULES_MAGIC, programLength, 0 };
+  file.write((const uint8_t*)&header, sizeof(header));
+  file.write(program, programLength);
+  file.close();
+  return true;
+}
+
+bool RulesEngine::compile(JsonArrayConst rules, char* error, size_t errorSize) {
+  uint8_t code[RULES_PROGRAM_SIZE];
+  uint16_t length = 0;
+  uint8_t index = 0;
+
+  if (rules.size() > RULES_MAX) {
+    snprintf(error, errorSize, "at most %u rules", RULES_MAX);
+    return false;
+  }
+
+  for (JsonObjectConst rule : rules) {
+    JsonArrayConst conditions = rule["if"];
+    if (conditions.size() == 0 || conditions.size() > RULES_MAX_CONDITIONS) {
+      snprintf(error, errorSize, "rule %u: 'if' needs 1-%u conditions", index, RULES_MAX_CONDITIONS);
+      return false;
+    }
+    if (length + RULE_HEADER_SIZE + conditions.size() * RULE_CONDITION_SIZE > sizeof(code)) {
+      snprintf(error, errorSize, "rule %u: ruleset too large", index);
+      return false;
+    }
+
+    uint8_t* header = code + length;
+    long hold = rule["for"] | 0;
+    writeU16(header, constrain(hold, 0L, 65535L));
+    header[2] = conditions.size();
+    length += RULE_HEADER_SIZE;
+
+    for (JsonObjectConst condition : conditions) {
+      HistoryMetric metric;
+      const char* metricName = condition["metric"] | "";
+      if (!SensorHistory::parseMetric(metricName, metric)) {
+        snprintf(error, errorSize, "rule %u: unknown metric '%s'", index, metricName);
+        return false;
+      }
+      const char* op = condition["op"] | ">";
+      if (strcmp(op, ">") != 0 && strcmp(op, "<") != 0) {
+        snprintf(error, errorSize, "rule %u: operator must be > or <", index);
+        return false;
+      }
+      if (!condition["value"].is<int>()) {
+        snprintf(error, errorSize, "rule %u: condition needs a numeric 'value'", index);
+        return false;
+      }
+      long threshold = condition["value"].as<long>();
+      long hysteresis = condition["hysteresis"] | 0;
+
+      uint8_t* encoded = code + length;
+      encoded[0] = metric;
+      encoded[1] = op[0] == '>' ? RULE_ABOVE : RULE_BELOW;
+      writeU16(encoded + 2, (uint16_t)(int16_t)constrain(threshold, -32768L, 32767L));
+      writeU16(encoded + 4, constrain(hysteresis, 0L, 65535L));
+      length += RULE_CONDITION_SIZE;
+    }
+
+    if (!compileActions(rule["then"], code, length, header[3], error, errorSize, index) ||
+        !compileActions(rule["else"], code, length, header[4], error, errorSize, index)) {
+      return false;
+    }
+    index++;
+  }
+
+  if (!load(code, length)) {
+    snprintf(error, errorSize, "compiled program invalid");
+    return false;
+  }
+  if (!save()) {
+    snprintf(error, errorSize, "rules applied but not saved");
+    return false;
+  }
+  Serial.printf("Rules: compiled %u rules into %u bytes\n", ruleCount, programLength);
+  return true;
+}
+
+// Actions are an object such as {"servo": 90, "led": true}
+bool RulesEngine::compileActions(JsonObjectConst actions, uint8_t* code, uint16_t& length, uint8_t& count,
+                                 char* error, size_t errorSize, uint8_t rule) {
+  count = 0;
+  for (JsonPairConst action : actions) {
+    if (length + RULE_ACTION_SIZE > RULES_PROGRAM_SIZE) {
+      snprintf(error, errorSize, "rule %u: ruleset too large", rule);
+      return false;
+    }
+
+    uint8_t* encoded = code + length;
+    const char* name = action.key().c_str();
+    if (strcmp(name, "led") == 0) {
+      encoded[0] = RULE_TARGET_LED;
+      writeU16(encoded + 1, action.value().as<bool>() ? 1 : 0);
+    } else if (strcmp(name, "servo") == 0 && action.value().is<int>()) {
+      encoded[0] = RULE_TARGET_SERVO;
+      writeU16(encoded + 1, constrain(action.value().as<int>(), 0, 180));
+    } else {
+      snprintf(error, errorSize, "rule %u: unknown action '%s'", rule, name);
+      return false;
+    }
+    length += RULE_ACTION_SIZE;
+    count++;
+  }
+  return true;
+}
+
+void RulesEngine::evaluate(const PMSSensor::ReadingSnapshot& reading) {
+  // Once per reading; a failed read leaves every rule where it was
+  if (!reading.data.isValid || reading.sequence == lastSequence) {
+    return;
+  }
+  lastSequence = reading.sequence;
+  evaluationCount++;
+
+  // Indexed by HistoryMetric
+  const int32_t values[] = {
+    reading.data.pm1_0_atm,
+    reading.data.pm2_5_atm,
+    reading.data.pm10_atm,
+    reading.vocIndex
+  };
+
+  for (uint8_t r = 0; r < ruleCount; r++) {
+    uint32_t start = ESP.getCycleCount();
+    RuleState& state = states[r];
+    const uint8_t* rule = program + ruleOffset[r];
+    uint16_t hold = readU16(rule);
+    uint8_t conditions = rule[2];
+
+    // While active, each threshold moves back by its hysteresis
+    bool match = true;
+    const uint8_t* condition = rule + RULE_HEADER_SIZE;
+    for (uint8_t i = 0; i < conditions; i++, condition += RULE_CONDITION_SIZE) {
+      int32_t value = values[condition[0]];
+      int32_t threshold = (int16_t)readU16(condition + 2);
+      int32_t margin = state.active ? readU16(condition + 4) : 0;
+      if (condition[1] == RULE_ABOVE) {
+        match = match && value > threshold - margin;
+      } else {
+        match = match && value < threshold + margin;
+      }
+    }
+
+    bool fire = false;
+    if (match == state.active) {
+      state.changing = false;
+    } else if (!state.changing) {
+      state.changing = true;
+      state.changeSince = reading.time;
+      fire = hold == 0;
+    } else {
+      fire = reading.time - state.changeSince >= hold;
+    }
+    state.evaluationCycles = ESP.getCycleCount() - start;
+
+    if (fire) {
+      state.active = match;
+      state.changing = false;
+      state.transitions++;
+      for (uint8_t i = 0; i < getActionCount(r, match); i++) {
+        runAction(getAction(r, match, i));
+      }
+    }
+  }
+}
+
+void RulesEngine::runAction(const RuleAction& action) {
+  if (action.target == RULE_TARGET_LED) {
+    setLED(action.value != 0);
+  } else {
+    setServoPosition(action.value);
+  }
+}
+
+uint8_t RulesEngine::getRuleCount() const {
+  return ruleCount;
+}
+
+uint16_t RulesEngine::getProgramLength() const {
+  return programLength;
+}
+
+uint32_t RulesEngine::getEvaluationCount() const {
+  return evaluationCount;
+}
+
+uint16_t RulesEngine::getHold(uint8_t rule) const {
+  return readU16(program + ruleOffset[rule]);
+}
+
+uint8_t RulesEngine::getConditionCount(uint8_t rule) const {
+  return program[ruleOffset[rule] + 2];
+}
+
+RuleCondition RulesEngine::getCondition(uint8_t rule, uint8_t index) const {
+  const uint8_t* encoded = program + ruleOffset[rule] + RULE_HEADER_SIZE + index * RULE_CONDITION_SIZE;
+  RuleCondition condition;
+  condition.metric = encoded[0];
+  condition.op = encoded[1];
+  condition.threshold = (int16_t)readU16(encoded + 2);
+  condition.hysteresis = readU16(encoded + 4);
+  return condition;
+}
+
+uint8_t RulesEngine::getActionCount(uint8_t rule, bool onActivate) const {
+  return program[ruleOffset[rule] + (onActivate ? 3 : 4)];
+}
+
+RuleAction RulesEngine::getAction(uint8_t rule, bool onActivate, uint8_t index) const {
+  const uint8_t* header = program + ruleOffset[rule];
+  uint16_t offset = RULE_HEADER_SIZE + header[2] * RULE_CONDITION_SIZE +
+                    ((onActivate ? 0 : header[3]) + index) * RULE_ACTION_SIZE;
+  RuleAction action;
+  action.target = header[offset];
+  action.value = (int16_t)readU16(header + offset + 1);
+  return action;
+}
+
+const RuleState& RulesEngine::getState(uint8_t rule) const {
+  return states[rule];
+}
+
+bool RulesEngine::drives(uint8_t target) const {
+  for (uint8_t r = 0; r < ruleCount; r++) {
+    for (uint8_t activate = 0; activate < 2; activate++) {
+      for (uint8_t i = 0; i < getActionCount(r, activate); i++) {
+        if (getAction(r, activate, i).target == target) {
+          return true;
+        }
+      }
+    }
+  }
+  return false;
+}
+
+const char* RulesEngine::targetName(uint8_t target) {
+  return target == RULE_TARGET_LED ? "led" : "servo";
+}
@@ -0,0 +1,27 @@
+#include "sensing_lock.h"
+
+#ifdef ESP32
+static SemaphoreHandle_t sensingMutex = nullptr;
+
+void SensingLock::begin() {
+  sensingMutex = xSemaphoreCreateMutex();
+}
+
+SensingLock::SensingLock(bool wait) {
+  held = xSemaphoreTake(sensingMutex, wait ? portMAX_DELAY : 0) == pdTRUE;
+}
+
+SensingLock::~SensingLock() {
+  if (held) {
+    xSemaphoreGive(sensingMutex);
+  }
+}
+#else
+void SensingLock::begin() {}
+
+SensingLock::SensingLock(bool) {
+  held = true;
+}
+
+SensingLock::~SensingLock() {}
+#endif
@@ -0,0 +1,77 @@
+#include "sensor_history.h"
+
+SensorHistory::SensorHistory() {
+  head = 0;
+  count = 0;
+}
+
+void SensorHistory::add(const PMSSensor::ReadingSnapshot& reading) {
+  HistorySample& sample = samples[head];
+  sample.time = reading.time;
+  sample.pm1_0 = reading.data.pm1_0_atm;
+  sample.pm2_5 = reading.data.pm2_5_atm;
+  sample.pm10 = reading.data.pm10_atm;
+  sample.vocIndex = reading.vocIndex;
+  sample.reserved = 0;
+
+  head = (head + 1) % HISTORY_CAPACITY;
+  if (count < HISTORY_CAPACITY) {
+    count++;
+  }
+}
+
+uint16_t SensorHistory::size() const {
+  return count;
+}
+
+const HistorySample& SensorHistory::at(uint16_t index) const {
+  return samples[(head + HISTORY_CAPACITY - count + index) % HISTORY_CAPACITY];
+}
+
+uint16_t SensorHistory::lowerBound(uint32_t time) const {
+  // Samples are appended in time order, so the ring is sorted oldest to newest
+  uint16_t low = 0;
+  uint16_t high = count;
+  while (low < high) {
+    uint16_t mid = (low + high) / 2;
+    if (at(mid).time < time) {
+      low = mid + 1;
+    } else {
+      high = mid;
+    }
+  }
+  return low;
+}
+
+bool SensorHistory::parseMetric(const char* name, HistoryMetric& metric) {
+  if (strcmp(name, "pm1") == 0 || strcmp(name, "pm1_0") == 0) {
+    metric = METRIC_PM1_0;
+  } else if (strcmp(name, "pm25") == 0 || strcmp(name, "pm2_5") == 0) {
+    metric = METRIC_PM2_5;
+  } else if (strcmp(name, "pm10") == 0) {
+    metric = METRIC_PM10;
+  } else if (strcmp(name, "voc") == 0) {
+    metric = METRIC_VOC;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+const char* SensorHistory::metricName(HistoryMetric metric) {
+  switch (metric) {
+    case METRIC_PM1_0: return "pm1";
+    case METRIC_PM2_5: return "pm25";
+    case METRIC_PM10: return "pm10";
+    default: return "voc";
+  }
+}
+
+float SensorHistory::value(const HistorySample& sample, HistoryMetric metric) {
+  switch (metric) {
+    case METRIC_PM1_0: return sample.pm1_0;
+    case METRIC_PM2_5: return sample.pm2_5;
+    case METRIC_PM10: return sample.pm10;
+    default: return sample.vocIndex;
+  }
+}
@@ -0,0 +1,155 @@
+#include "sensor_simulator.h"
+
+// Scenario scripts (start, duration, kind, PM2.5, VOC, PM10/PM2.5)
+static const SimEvent COOKING_SCRIPT[] = {
+  {  7 * 3600 + 1800, 2400, SIM_EVENT_PLUME, 45.0f, 25.0f, 1.2f },  // Breakfast
+  { 12 * 3600 + 1800, 1800, SIM_EVENT_PLUME, 25.0f, 15.0f, 1.2f },  // Lunch
+  { 19 * 3600,        3600, SIM_EVENT_PLUME, 90.0f, 40.0f, 1.3f }   // Dinner, frying
+};
+
+static const SimEvent WILDFIRE_SCRIPT[] = {
+  {  8 * 3600, 12 * 3600, SIM_EVENT_PLATEAU, 110.0f, 20.0f, 1.1f },  // Smoke day
+  { 14 * 3600,  3 * 3600, SIM_EVENT_PLATEAU,  60.0f, 10.0f, 1.1f }   // Afternoon wind shift
+};
+
+static const SimEvent DROPOUT_SCRIPT[] = {
+  { 10 * 3600,        900, SIM_EVENT_DROPOUT, 0, 0, 0 },
+  { 16 * 3600 + 1200, 300, SIM_EVENT_DROPOUT, 0, 0, 0 },
+  { 22 * 3600,         90, SIM_EVENT_DROPOUT, 0, 0, 0 }
+};
+
+SensorSimulator::SensorSimulator(uint32_t seed, SimScenario scenario) {
+  setSeed(seed);
+  setScenario(scenario);
+}
+
+void SensorSimulator::setSeed(uint32_t newSeed) {
+  seed = newSeed;
+}
+
+void SensorSimulator::setScenario(SimScenario newScenario) {
+  scenario = newScenario;
+  switch (scenario) {
+    case SIM_COOKING_SPIKE:
+      events = COOKING_SCRIPT;
+      eventCount = sizeof(COOKING_SCRIPT) / sizeof(COOKING_SCRIPT[0]);
+      break;
+    case SIM_WILDFIRE_DAY:
+      events = WILDFIRE_SCRIPT;
+      eventCount = sizeof(WILDFIRE_SCRIPT) / sizeof(WILDFIRE_SCRIPT[0]);
+      break;
+    case SIM_SENSOR_DROPOUT:
+      events = DROPOUT_SCRIPT;
+      eventCount = sizeof(DROPOUT_SCRIPT) / sizeof(DROPOUT_SCRIPT[0]);
+      break;
+    default:
+      events = nullptr;
+      eventCount = 0;
+      break;
+  }
+}
+
+uint32_t SensorSimulator::getSeed() const {
+  return seed;
+}
+
+SimScenario SensorSimulator::getScenario() const {
+  return scenario;
+}
+
+uint32_t SensorSimulator::hash(uint32_t step, uint8_t stream) const {
+  // Integer finalizer; consecutive steps give uncorrelated outputs
+  uint32_t x = seed ^ (step * 0x9E3779B9UL) ^ ((uint32_t)stream << 24);
+  x ^= x >> 16;
+  x *= 0x7FEB352DUL;
+  x ^= x >> 15;
+  x *= 0x846CA68BUL;
+  x ^= x >> 16;
+  return x;
+}
+
+float SensorSimulator::noise(uint32_t step, uint8_t stream) const {
+  return (hash(step, stream) & 0xFFFF) / 32767.5f - 1.0f;
+}
+
+SimSample SensorSimulator::sample(uint32_t time) const {
+  uint32_t step = time / SIM_SAMPLE_PERIOD;
+  uint32_t timeOfDay = time % 86400;
+  float hour = timeOfDay / 3600.0f;
+
+  // Healthy baseline: particles peak around noon, VOC in the afternoon
+  float pm25 = 8.0f + sin((hour - 6) * PI / 12) * 3.0f + noise(step, 0);
+  float pm10 = pm25 * 1.5f + noise(step, 1);
+  float voc = 25.0f + sin((hour - 8) * PI / 14) * 8.0f + noise(step, 2) * 0.5f;
+  bool valid = true;
+
+  for (uint8_t i = 0; i < eventCount; i++) {
+    const SimEvent& event = events[i];
+    uint32_t elapsed = (timeOfDay + 86400 - event.start) % 86400;
+    if (elapsed >= event.duration) {
+      continue;
+    }
+
+    float strength;
+    if (event.kind == SIM_EVENT_DROPOUT) {
+      valid = false;
+      continue;
+    } else if (event.kind == SIM_EVENT_PLUME) {
+      uint32_t rise = min(300UL, (unsigned long)event.duration / 4);
+      strength = elapsed < rise ? (float)elapsed / rise
+                                : exp(-(float)(elapsed - rise) / (event.duration / 4.0f));
+    } else {
+      float ramp = event.duration / 6.0f;
+      strength = min(1.0f, min(elapsed / ramp, (event.duration - elapsed) / ramp));
+    }
+
+    float added = event.pm25 * strength * (1.0f + noise(step, 3) * 0.1f);
+    pm25 += added;
+    pm10 += added * event.coarseRatio;
+    voc += event.voc * strength;
+  }
+
+  SimSample result;
+  result.pm2_5 = max(0.0f, pm25);
+  result.pm1_0 = result.pm2_5 * 0.7f;
+  result.pm10 = max(result.pm2_5, pm10);
+  result.vocIndex = constrain(voc, 0.0f, 100.0f);
+  
+  // Counts per size bin from the mass in each size range, at ratios typical
+  // of indoor PMS5003 readings, then summed into "larger than" channels
+  float fine = result.pm1_0;
+  float mid = result.pm2_5 - result.pm1_0;
+  float coarse = result.pm10 - result.pm2_5;
+  const float bins[6] = { fine * 140, fine * 45, fine * 2 + mid * 25, coarse * 1.5f, coarse * 0.4f, coarse * 0.1f };
+  float larger = 0;
+  for (int8_t i = 5; i >= 0; i--) {
+    larger += bins[i];
+    result.counts[i] = larger;
+  }
+  result.isValid = valid;
+  return result;
+}
+
+bool SensorSimulator::parseScenario(const char* name, SimScenario& scenario) {
+  if (strcmp(name, "normal") == 0) {
+    scenario = SIM_NORMAL;
+  } else if (strcmp(name, "cooking") == 0) {
+    scenario = SIM_COOKING_SPIKE;
+  } else if (strcmp(name, "wildfire") == 0) {
+    scenario = SIM_WILDFIRE_DAY;
+  } else if (strcmp(name, "dropout") == 0) {
+    scenario = SIM_SENSOR_DROPOUT;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+const char* SensorSimulator::scenarioName(SimScenario scenario) {
+  switch (scenario) {
+    case SIM_COOKING_SPIKE: return "cooking";
+    case SIM_WILDFIRE_DAY: return "wildfire";
+    case SIM_SENSOR_DROPOUT: return "dropout";
+    default: return "normal";
+  }
+}
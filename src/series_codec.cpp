@@ -0,0 +1,158 @@
+#include "series_codec.h"
+
+static inline uint32_t zigzag(int32_t value) {
+  return ((uint32_t)value << 1) ^ (uint32_t)(value >> 31);
+}
+
+static inline int32_t unzigzag(uint32_t value) {
+  return (int32_t)(value >> 1) ^ -(int32_t)(value & 1);
+}
+
+static inline uint8_t writeVarint(uint8_t* out, uint32_t value) {
+  uint8_t n = 0;
+  while (value >= 0x80) {
+    out[n++] = (uint8_t)value | 0x80;
+    value >>= 7;
+  }
+  out[n++] = (uint8_t)value;
+  return n;
+}
+
+SeriesEncoder::SeriesEncoder() {
+  begin(nullptr, 0);
+}
+
+void SeriesEncoder::begin(uint8_t* output, size_t size) {
+  buffer = output;
+  capacity = size;
+  length = 0;
+  count = 0;
+  memset(&previous, 0, sizeof(previous));
+  previousDelta = 0;
+}
+
+bool SeriesEncoder::append(const HistorySample& sample) {
+  uint8_t encoded[SERIES_MAX_SAMPLE_SIZE];
+  uint8_t size = 1;
+  uint8_t control = 0;
+
+  int32_t delta = 0;
+  if (count == 0) {
+    control |= 0x01;
+    size += writeVarint(encoded + size, sample.time);
+  } else {
+    delta = (int32_t)(sample.time - previous.time);
+    int32_t deltaOfDelta = delta - previousDelta;
+    if (deltaOfDelta != 0) {
+      control |= 0x01;
+      size += writeVarint(encoded + size, zigzag(deltaOfDelta));
+    }
+  }
+
+  const int32_t values[4] = {
+    (int32_t)sample.pm1_0 - previous.pm1_0,
+    (int32_t)sample.pm2_5 - previous.pm2_5,
+    (int32_t)sample.pm10 - previous.pm10,
+    (int32_t)sample.vocIndex - previous.vocIndex
+  };
+  for (uint8_t i = 0; i < 4; i++) {
+    if (values[i] != 0) {
+      control |= 0x02 << i;
+      size += writeVarint(encoded + size, zigzag(values[i]));
+    }
+  }
+  encoded[0] = control;
+
+  if (length + size > capacity) {
+    return false;
+  }
+  memcpy(buffer + length, encoded, size);
+  length += size;
+  previousDelta = delta;
+  previous = sample;
+  count++;
+  return true;
+}
+
+size_t SeriesEncoder::getLength() const {
+  return length;
+}
+
+uint16_t SeriesEncoder::getCount() const {
+  return count;
+}
+
+SeriesDecoder::SeriesDecoder() {
+  begin(nullptr, 0, 0);
+}
+
+void SeriesDecoder::begin(const uint8_t* input, size_t size, uint16_t count) {
+  buffer = input;
+  length = size;
+  position = 0;
+  remaining = count;
+  memset(&previous, 0, sizeof(previous));
+  previousDelta = 0;
+  first = true;
+}
+
+bool SeriesDecoder::readVarint(uint32_t& value) {
+  value = 0;
+  for (uint8_t shift = 0; shift < 35; shift += 7) {
+    if (position >= length) {
+      return false;
+    }
+    uint8_t byte = buffer[position++];
+    value |= (uint32_t)(byte & 0x7F) << shift;
+    if (!(byte & 0x80)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool SeriesDecoder::next(HistorySample& sample) {
+  if (remaining == 0 || position >= length) {
+    return false;
+  }
+  uint8_t control = buffer[position++];
+  uint32_t raw = 0;
+
+  sample = previous;
+  if (first) {
+    if (!(control & 0x01) || !readVarint(raw)) {
+      return false;
+    }
+    sample.time = raw;
+    first = false;
+  } else {
+    int32_t deltaOfDelta = 0;
+    if (control & 0x01) {
+      if (!readVarint(raw)) {
+        return false;
+      }
+      deltaOfDelta = unzigzag(raw);
+    }
+    previousDelta += deltaOfDelta;
+    sample.time = previous.time + previousDelta;
+  }
+
+  int32_t values[4] = { 0, 0, 0, 0 };
+  for (uint8_t i = 0; i < 4; i++) {
+    if (control & (0x02 << i)) {
+      if (!readVarint(raw)) {
+        return false;
+      }
+      values[i] = unzigzag(raw);
+    }
+  }
+  sample.pm1_0 = previous.pm1_0 + values[0];
+  sample.pm2_5 = previous.pm2_5 + values[1];
+  sample.pm10 = previous.pm10 + values[2];
+  sample.vocIndex = previous.vocIndex + values[3];
+  sample.reserved = 0;
+
+  previous = sample;
+  remaining--;
+  return true;
+}
@@ -0,0 +1,124 @@
+#include "time_sync.h"
+#include <ESP8266WiFi.h>
+
+TimeSync::TimeSync() {
+  fallbackServer[0] = '\0';
+  configured = false;
+  synced = false;
+  epochOffset = 0;
+  syncCount = 0;
+  lastCheck = 0;
+  publish();
+}
+
+void TimeSync::publish() {
+  Anchor value;
+  value.epochOffset = epochOffset;
+  value.synced = synced;
+  anchor.write(value);
+}
+
+void TimeSync::update() {
+#if SIM_TIME_SCALE != 1
+  // Virtual time runs ahead of any real clock, so start it at midnight
+  if (!synced) {
+    epochOffset = SIM_START_EPOCH;
+    syncCount++;
+    synced = true;
+    publish();
+  }
+  return;
+#endif
+
+  if (millis() - lastCheck < 1000) {
+    return;
+  }
+  lastCheck = millis();
+
+  // SNTP needs the link up to resolve the fallback address
+  if (!configured) {
+    if (WiFi.status() != WL_CONNECTED) {
+      return;
+    }
+#ifdef NTP_FALLBACK_SERVER
+    strncpy(fallbackServer, NTP_FALLBACK_SERVER, sizeof(fallbackServer) - 1);
+#else
+    strncpy(fallbackServer, WiFi.gatewayIP().toString().c_str(), sizeof(fallbackServer) - 1);
+#endif
+    fallbackServer[sizeof(fallbackServer) - 1] = '\0';
+    // SNTP keeps the server name pointers, so the fallback lives in a member
+#ifdef ESP32
+    configTzTime(TIME_ZONE, NTP_PRIMARY_SERVER, fallbackServer);
+#else
+    configTime(TIME_ZONE, NTP_PRIMARY_SERVER, fallbackServer);
+#endif
+    configured = true;
+    Serial.printf("Time: SNTP started (%s, fallback %s)\n", NTP_PRIMARY_SERVER, fallbackServer);
+    return;
+  }
+
+  time_t epoch = time(nullptr);
+  if ((uint32_t)epoch < TIME_VALID_AFTER) {
+    return;
+  }
+
+  // Re-anchor only when SNTP has stepped the clock, not on tick jitter
+  int64_t offset = (int64_t)epoch - monotonicSeconds();
+  if (!synced || llabs(offset - epochOffset) > 1) {
+    epochOffset = offset;
+    syncCount++;
+    if (!synced) {
+      Serial.printf("Time: synchronized, epoch %u\n", (uint32_t)epoch);
+    }
+    synced = true;
+    publish();
+  }
+}
+
+bool TimeSync::isSynced() {
+  return synced;
+}
+
+uint32_t TimeSync::getSyncCount() {
+  return syncCount;
+}
+
+uint64_t TimeSync::monotonicMillis() {
+  // micros64() does not wrap for the lifetime of the device, unlike millis()
+  return micros64() * SIM_TIME_SCALE / 1000;
+}
+
+uint32_t TimeSync::monotonicSeconds() {
+  return (uint32_t)(micros64() * SIM_TIME_SCALE / 1000000);
+}
+
+uint32_t TimeSync::toEpoch(uint32_t monotonicSecs) {
+  return synced ? (uint32_t)(epochOffset + monotonicSecs) : 0;
+}
+
+uint32_t TimeSync::toMonotonic(uint32_t epoch) {
+  if (!synced) {
+    return epoch;
+  }
+  int64_t monotonic = (int64_t)epoch - epochOffset;
+  return monotonic < 0 ? 0 : (uint32_t)monotonic;
+}
+
+uint32_t TimeSync::now() {
+  return toEpoch(monotonicSeconds());
+}
+
+// Called from the sensing side, so it reads the anchor rather than the
+// fields update() writes
+uint8_t TimeSync::hourOf(uint32_t monotonicSecs) {
+  Anchor current;
+  anchor.read(current);
+  if (!current.synced) {
+    return (monotonicSecs / 3600) % 24;
+  }
+
+  time_t epoch = (uint32_t)(current.epochOffset + monotonicSecs);
+  struct tm local;
+  localtime_r(&epoch, &local);
+  return local.tm_hour;
+}
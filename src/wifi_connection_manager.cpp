@@ -0,0 +1,214 @@
+#include "wifi_connection_manager.h"
+#include <LittleFS.h>
+#include "black_box.h"
+
+WiFiConnectionManager::WiFiConnectionManager() {
+  ssid = nullptr;
+  password = nullptr;
+  state = WIFI_LINK_IDLE;
+  memset(&cache, 0, sizeof(cache));
+  cacheValid = false;
+  fastAttempt = false;
+  attemptStart = 0;
+  backoffUntil = 0;
+  backoffDelay = WIFI_BACKOFF_MIN;
+  lastAssociationTime = 0;
+  bootToConnectTime = 0;
+  connectCount = 0;
+  fastConnectCount = 0;
+  disconnectCount = 0;
+}
+
+void WiFiConnectionManager::begin(const char* networkSsid, const char* networkPassword) {
+  ssid = networkSsid;
+  password = networkPassword;
+
+  // The SDK's own flash writes and reconnect logic would fight the state machine
+  WiFi.persistent(false);
+  WiFi.setAutoReconnect(false);
+  WiFi.mode(WIFI_STA);
+
+  cacheValid = loadCache();
+  startAttempt(cacheValid);
+}
+
+void WiFiConnectionManager::loop() {
+  switch (state) {
+    case WIFI_LINK_CONNECTING: {
+      wl_status_t status = WiFi.status();
+      if (status == WL_CONNECTED) {
+        onConnected();
+      } else if (status == WL_CONNECT_FAILED || status == WL_WRONG_PASSWORD ||
+                 millis() - attemptStart >= (fastAttempt ? WIFI_FAST_CONNECT_TIMEOUT : WIFI_CONNECT_TIMEOUT)) {
+        onAttemptFailed();
+      }
+      break;
+    }
+
+    case WIFI_LINK_CONNECTED:
+      if (WiFi.status() != WL_CONNECTED) {
+        disconnectCount++;
+        Serial.printf("WiFi: connection lost (disconnect #%u), reconnecting\n", disconnectCount);
+        startAttempt(cacheValid);
+      }
+      break;
+
+    case WIFI_LINK_BACKOFF:
+      if ((long)(millis() - backoffUntil) >= 0) {
+        startAttempt(cacheValid);
+      }
+      break;
+
+    case WIFI_LINK_IDLE:
+      break;
+  }
+}
+
+void WiFiConnectionManager::startAttempt(bool useCache) {
+  fastAttempt = useCache;
+  attemptStart = millis();
+  state = WIFI_LINK_CONNECTING;
+
+  if (useCache) {
+    // Go straight to the known access point
+    WiFi.begin(ssid, password, cache.channel, cache.bssid);
+  } else {
+    WiFi.begin(ssid, password);
+  }
+}
+
+void WiFiConnectionManager::onConnected() {
+  lastAssociationTime = millis() - attemptStart;
+  if (connectCount == 0) {
+    bootToConnectTime = millis();
+  }
+  connectCount++;
+  if (fastAttempt) {
+    fastConnectCount++;
+  }
+
+  state = WIFI_LINK_CONNECTED;
+  backoffDelay = WIFI_BACKOFF_MIN;
+  saveCache();
+
+  Serial.printf("WiFi connected in %lu ms (%s) - IP: %s, channel %d, RSSI %d dBm\n",
+                lastAssociationTime, fastAttempt ? "cached" : "scan",
+                WiFi.localIP().toString().c_str(), WiFi.channel(), WiFi.RSSI());
+}
+
+void WiFiConnectionManager::onAttemptFailed() {
+  WiFi.disconnect();
+
+  if (fastAttempt) {
+    // The access point has moved or changed; fall back to a normal connect right away
+    Serial.println("WiFi: cached link parameters rejected, scanning");
+    invalidateCache();
+    startAttempt(false);
+    return;
+  }
+
+  Serial.printf("WiFi: connect failed (status %d), retrying in %lu ms\n", WiFi.status(), backoffDelay);
+  state = WIFI_LINK_BACKOFF;
+  backoffUntil = millis() + backoffDelay;
+  backoffDelay = min(backoffDelay * 2, (unsigned long)WIFI_BACKOFF_MAX);
+}
+
+bool WiFiConnectionManager::loadCache() {
+  static_assert(WIFI_CACHE_RTC_OFFSET + sizeof(LinkCache) / 4 <= BLACKBOX_RTC_OFFSET,
+                "The link cache overlaps the black box in RTC memory");
+
+  // RTC memory first; it is only cleared by a power cycle
+  if (ESP.rtcUserMemoryRead(WIFI_CACHE_RTC_OFFSET, (uint32_t*)&cache, sizeof(cache)) &&
+      cache.crc == cacheCrc(cache)) {
+    return true;
+  }
+
+  File file = LittleFS.open(WIFI_CACHE_FILE, "r");
+  if (file) {
+    bool ok = file.read((uint8_t*)&cache, sizeof(cache)) == sizeof(cache) && cache.crc == cacheCrc(cache);
+    file.close();
+    if (ok) {
+      ESP.rtcUserMemoryWrite(WIFI_CACHE_RTC_OFFSET, (uint32_t*)&cache, sizeof(cache));
+      return true;
+    }
+  }
+  return false;
+}
+
+void WiFiConnectionManager::saveCache() {
+  LinkCache fresh;
+  memset(&fresh, 0, sizeof(fresh));
+  memcpy(fresh.bssid, WiFi.BSSID(), sizeof(fresh.bssid));
+  fresh.channel = WiFi.channel();
+  fresh.crc = cacheCrc(fresh);
+
+  bool changed = !cacheValid || fresh.crc != cache.crc;
+  cache = fresh;
+  cacheValid = true;
+  ESP.rtcUserMemoryWrite(WIFI_CACHE_RTC_OFFSET, (uint32_t*)&cache, sizeof(cache));
+
+  // Only touch flash when the link parameters actually moved
+  if (changed) {
+    File file = LittleFS.open(WIFI_CACHE_FILE, "w");
+    if (file) {
+      file.write((const uint8_t*)&cache, sizeof(cache));
+      file.close();
+    }
+  }
+}
+
+void WiFiConnectionManager::invalidateCache() {
+  cacheValid = false;
+  cache.crc = 0;
+  ESP.rtcUserMemoryWrite(WIFI_CACHE_RTC_OFFSET, (uint32_t*)&cache, sizeof(cache));
+  LittleFS.remove(WIFI_CACHE_FILE);
+}
+
+uint32_t WiFiConnectionManager::cacheCrc(const LinkCache& data) {
+  const uint8_t* bytes = (const uint8_t*)&data + sizeof(data.crc);
+  uint32_t crc = 0xFFFFFFFF;
+  for (size_t i = 0; i < sizeof(data) - sizeof(data.crc); i++) {
+    crc ^= bytes[i];
+    for (uint8_t bit = 0; bit < 8; bit++) {
+      crc = (crc >> 1) ^ (0xEDB88320 & (0 - (crc & 1)));
+    }
+  }
+  return ~crc;
+}
+
+bool WiFiConnectionManager::isConnected() {
+  return state == WIFI_LINK_CONNECTED;
+}
+
+WiFiLinkState WiFiConnectionManager::getState() {
+  return state;
+}
+
+const char* WiFiConnectionManager::getStateName() {
+  switch (state) {
+    case WIFI_LINK_CONNECTING: return fastAttempt ? "connecting (cached)" : "connecting";
+    case WIFI_LINK_CONNECTED: return "connected";
+    case WIFI_LINK_BACKOFF: return "backoff";
+    default: return "idle";
+  }
+}
+
+unsigned long WiFiConnectionManager::getLastAssociationTime() {
+  return lastAssociationTime;
+}
+
+unsigned long WiFiConnectionManager::getBootToConnectTime() {
+  return bootToConnectTime;
+}
+
+uint32_t WiFiConnectionManager::getConnectCount() {
+  return connectCount;
+}
+
+uint32_t WiFiConnectionManager::getFastConnectCount() {
+  return fastConnectCount;
+}
+
+uint32_t WiFiConnectionManager::getDisconnectCount() {
+  return disconnectCount;
+}
@@ -0,0 +1,46 @@
+#ifndef TEST_SENSOR_PIPELINE_H
+#define TEST_SENSOR_PIPELINE_H
+
+// The sensor pipeline as the native tests build it, and well-formed frames
+// to feed it through PMSSensor::ingest() the way the UART would
+
+#include "../src/pms_frame.cpp"
+#include "../src/pms_capture.cpp"
+#include "../src/sensor_simulator.cpp"
+#include "../src/alert_state.cpp"
+#include "../src/air_forecast.cpp"
+#include "../src/particle_stats.cpp"
+#include "../src/time_sync.cpp"
+#include "../src/pms_sensor.cpp"
+
+// A checksummed frame with the given PM2.5 (atmospheric); PM10 is 4 above
+static void buildFrame(uint16_t pm2_5, uint8_t (&frame)[PMS_FRAME_SIZE]) {
+  uint16_t words[PMS_FRAME_WORDS] = { 0, 0, 0, 3, pm2_5, (uint16_t)(pm2_5 + 4) };
+  memset(frame, 0, sizeof(frame));
+  frame[0] = 0x42;
+  frame[1] = 0x4D;
+  frame[3] = PMS_FRAME_LENGTH;
+  for (int i = 0; i < PMS_FRAME_WORDS; i++) {
+    frame[4 + i * 2] = words[i] >> 8;
+    frame[5 + i * 2] = words[i];
+  }
+  uint16_t sum = 0;
+  for (int i = 0; i < PMS_FRAME_SIZE - 2; i++) {
+    sum += frame[i];
+  }
+  frame[PMS_FRAME_SIZE - 2] = sum >> 8;
+  frame[PMS_FRAME_SIZE - 1] = sum;
+}
+
+// True when the frame published a reading
+static bool feedFrame(PMSSensor& sensor, uint16_t pm2_5) {
+  uint8_t frame[PMS_FRAME_SIZE];
+  buildFrame(pm2_5, frame);
+  bool published = false;
+  for (uint8_t byte : frame) {
+    published |= sensor.ingest(byte);
+  }
+  return published;
+}
+
+#endif
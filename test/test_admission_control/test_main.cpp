@@ -0,0 +1,146 @@
+#include <unity.h>
+#include "../../src/admission_control.cpp"
+
+static const uint32_t CLIENT = 0x0A01A8C0;
+
+void setUp() {
+  hostMicros = 1000000;
+}
+
+void tearDown() {}
+
+// The firmware loop under a flood, as main.cpp and handleClient() run it:
+// the sensor is read when due, then waiting requests are served within the
+// per-iteration count and time budget. Served requests take requestMillis,
+// rejected ones 1 ms. Every request comes from a new address, so the
+// per-client buckets never limit it and only the budget and shedding do.
+#define SENSOR_READ_INTERVAL 30000    // As in main.cpp
+#define SENSOR_READ_MILLIS 1000       // PMS wake-up and frame
+
+struct FloodResult {
+  uint32_t reads;
+  uint32_t maxLateness;               // ms past the read's due time
+};
+
+static FloodResult runFlood(AdmissionControl& admission, uint32_t requestMillis, uint32_t seconds) {
+  FloodResult result = { 0, 0 };
+  uint32_t start = millis();
+  uint32_t nextRead = start;
+  uint32_t ip = 1;
+  while (millis() - start < seconds * 1000) {
+    admission.loopTick(0);
+    uint32_t now = millis();
+    if ((int32_t)(now - nextRead) >= 0) {
+      result.maxLateness = max(result.maxLateness, now - nextRead);
+      result.reads++;
+      hostAdvanceMillis(SENSOR_READ_MILLIS);
+      nextRead += SENSOR_READ_INTERVAL;
+    }
+    uint32_t budgetStart = millis();
+    for (uint8_t i = 0; i < WEB_REQUESTS_PER_LOOP; i++) {
+      uint32_t retryAfter = 0;
+      hostAdvanceMillis(admission.admit(ip++, retryAfter) == ADMISSION_ACCEPTED ? requestMillis : 1);
+      if (millis() - budgetStart >= WEB_LOOP_BUDGET_MS) {
+        admission.noteBudgetExhausted();
+        break;
+      }
+    }
+  }
+  return result;
+}
+
+static uint32_t admitBurst(AdmissionControl& admission, uint32_t ip) {
+  uint32_t retryAfter = 0;
+  uint32_t accepted = 0;
+  while (admission.admit(ip, retryAfter) == ADMISSION_ACCEPTED) {
+    accepted++;
+  }
+  return accepted;
+}
+
+void test_burst_then_sustained_rate() {
+  AdmissionControl admission;
+  TEST_ASSERT_EQUAL(ADMISSION_BURST, admitBurst(admission, CLIENT));
+
+  uint32_t retryAfter = 0;
+  TEST_ASSERT_EQUAL(ADMISSION_RATE_LIMITED, admission.admit(CLIENT, retryAfter));
+  TEST_ASSERT_EQUAL(1, retryAfter);
+
+  hostAdvanceMillis(1000);
+  TEST_ASSERT_EQUAL(ADMISSION_RATE, admitBurst(admission, CLIENT));
+}
+
+void test_long_silence_refills_to_the_burst() {
+  AdmissionControl admission;
+  admitBurst(admission, CLIENT);
+
+  // Just under ten days: elapsed time times the rate passes 2^32 by 4, so
+  // an unclamped 32-bit product would refill 4 milli-tokens, not a token
+  hostAdvanceMillis(858993460UL);
+  TEST_ASSERT_EQUAL(ADMISSION_BURST, admitBurst(admission, CLIENT));
+}
+
+void test_clients_are_limited_separately() {
+  AdmissionControl admission;
+  admitBurst(admission, CLIENT);
+  uint32_t retryAfter = 0;
+  TEST_ASSERT_EQUAL(ADMISSION_ACCEPTED, admission.admit(CLIENT + 1, retryAfter));
+}
+
+void test_slow_loop_sheds_until_it_recovers() {
+  AdmissionControl admission;
+  admission.loopTick(0);
+  for (int i = 0; i < 8; i++) {
+    hostAdvanceMillis(LOAD_SHED_PERIOD_MS * 2);
+    admission.loopTick(0);
+  }
+  TEST_ASSERT_TRUE(admission.isOverloaded());
+  uint32_t retryAfter = 0;
+  TEST_ASSERT_EQUAL(ADMISSION_SHED, admission.admit(CLIENT, retryAfter));
+  TEST_ASSERT_EQUAL(1, admission.getShedCount());
+
+  // Idle waits chosen by the power manager are not load
+  for (int i = 0; i < 30; i++) {
+    hostAdvanceMillis(LOAD_SHED_PERIOD_MS * 2);
+    admission.loopTick(LOAD_SHED_PERIOD_MS * 2 - 5);
+  }
+  TEST_ASSERT_FALSE(admission.isOverloaded());
+  TEST_ASSERT_EQUAL(ADMISSION_ACCEPTED, admission.admit(CLIENT, retryAfter));
+}
+
+// A flood of cheap requests is held to the per-iteration budget: the
+// sensor is read at most one budget and one request late
+void test_flood_of_cheap_requests_keeps_sensor_cadence() {
+  AdmissionControl admission;
+  const uint32_t requestMillis = 15;
+  FloodResult result = runFlood(admission, requestMillis, 600);
+
+  TEST_ASSERT_EQUAL(600000 / SENSOR_READ_INTERVAL, result.reads);
+  TEST_ASSERT_LESS_OR_EQUAL(WEB_LOOP_BUDGET_MS + requestMillis, result.maxLateness);
+  TEST_ASSERT_GREATER_THAN(0, admission.getBudgetExhaustedCount());
+}
+
+// Requests slower than the shed threshold each take a whole iteration, so
+// the loop lags and the rest are shed until it recovers; the sensor is
+// still read at most one request late
+void test_flood_of_slow_requests_is_shed() {
+  AdmissionControl admission;
+  const uint32_t requestMillis = 400;
+  FloodResult result = runFlood(admission, requestMillis, 600);
+
+  TEST_ASSERT_EQUAL(600000 / SENSOR_READ_INTERVAL, result.reads);
+  TEST_ASSERT_LESS_OR_EQUAL(requestMillis, result.maxLateness);
+  TEST_ASSERT_GREATER_THAN(0, admission.getShedCount());
+  TEST_ASSERT_GREATER_THAN(admission.getAcceptedCount(), admission.getShedCount());
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_burst_then_sustained_rate);
+  RUN_TEST(test_long_silence_refills_to_the_burst);
+  RUN_TEST(test_clients_are_limited_separately);
+  RUN_TEST(test_slow_loop_sheds_until_it_recovers);
+  RUN_TEST(test_flood_of_cheap_requests_keeps_sensor_cadence);
+  RUN_TEST(test_flood_of_slow_requests_is_shed);
+  return UNITY_END();
+}
@@ -0,0 +1,333 @@
+#include <unity.h>
+#include <vector>
+#include "../sensor_pipeline.h"
+#include "../../src/admission_control.cpp"
+#include "../../src/coap_server.cpp"
+
+typedef std::vector<uint8_t> Message;
+
+static const IPAddress HUB_IP(192, 168, 1, 2);
+static const uint16_t PANEL_PORT = 40000;
+
+// Actuators, as main.cpp provides them
+static bool ledState;
+static int servoPosition;
+
+void setLED(bool state) {
+  ledState = state;
+}
+
+bool getLEDState() {
+  return ledState;
+}
+
+void setServoPosition(int angle) {
+  servoPosition = angle;
+}
+
+int getServoPosition() {
+  return servoPosition;
+}
+
+// A panel with its own address on the host's in-memory network
+struct Panel {
+  WiFiUDP udp;
+
+  Panel(uint8_t host) {
+    WiFi.address = IPAddress(192, 168, 1, host);
+    udp.begin(PANEL_PORT);
+    WiFi.address = HUB_IP;
+  }
+
+  void send(const Message& message) {
+    udp.beginPacket(HUB_IP, COAP_PORT);
+    udp.write(message.data(), message.size());
+    udp.endPacket();
+  }
+
+  // Empty when nothing arrived
+  Message receive() {
+    int size = udp.parsePacket();
+    Message message(std::max(size, 0));
+    udp.read(message.data(), message.size());
+    return message;
+  }
+};
+
+struct Hub {
+  PMSSensor sensor;
+  AdmissionControl admission;
+  CoapServer coap;
+
+  Hub() : coap(&sensor, &admission) {
+    coap.loop();  // Listen
+  }
+
+  void measure(uint16_t pm2_5) { TEST_ASSERT_TRUE(feedFrame(sensor, pm2_5)); }
+};
+
+// CON GET /reading with a two-byte token; observe < 0 leaves the option out
+static Message getReading(uint16_t messageId, int32_t observe = -1, uint8_t type = COAP_CON) {
+  Message message = { (uint8_t)(0x42 | (type << 4)), COAP_GET, (uint8_t)(messageId >> 8), (uint8_t)messageId, 0x01, 0x02 };
+  uint8_t delta = COAP_OPTION_URI_PATH;
+  if (observe >= 0) {
+    message.push_back(observe == 0 ? 0x60 : 0x61);
+    if (observe != 0) {
+      message.push_back(observe);
+    }
+    delta -= COAP_OPTION_OBSERVE;
+  }
+  message.push_back((delta << 4) | 7);
+  message.insert(message.end(), { 'r', 'e', 'a', 'd', 'i', 'n', 'g' });
+  return message;
+}
+
+static Message empty(uint8_t type, uint16_t messageId) {
+  return { (uint8_t)(0x40 | (type << 4)), COAP_EMPTY, (uint8_t)(messageId >> 8), (uint8_t)messageId };
+}
+
+static uint8_t typeOf(const Message& message) {
+  return (message[0] >> 4) & 0x03;
+}
+
+static uint16_t messageIdOf(const Message& message) {
+  return (message[2] << 8) | message[3];
+}
+
+void setUp() {
+  hostMicros = 1000000;
+  WiFi.linkStatus = WL_CONNECTED;
+  WiFi.address = HUB_IP;
+  ledState = false;
+  servoPosition = 0;
+}
+
+void tearDown() {}
+
+void test_reading_layout_and_observe_registration() {
+  Hub hub;
+  Panel panel(20);
+  hub.measure(23);
+  PMSSensor::ReadingSnapshot reading = hub.sensor.readSnapshot();
+
+  panel.send(getReading(0x1234, 0));
+  hub.coap.loop();
+  Message response = panel.receive();
+
+  // ACK 2.05 with the request's ID and token, Observe 0 (zero-length),
+  // Content-Format 42, Max-Age 30, then the 12-byte reading
+  const uint8_t head[] = { 0x62, COAP_CONTENT, 0x12, 0x34, 0x01, 0x02, 0x60, 0x61, COAP_FORMAT_OCTETS, 0x21, 30, 0xFF };
+  TEST_ASSERT_EQUAL(sizeof(head) + 12, response.size());
+  TEST_ASSERT_EQUAL_HEX8_ARRAY(head, response.data(), sizeof(head));
+  const uint8_t* payload = response.data() + sizeof(head);
+  uint32_t sequence;
+  uint16_t pm1_0, pm2_5, pm10;
+  memcpy(&sequence, payload, 4);
+  memcpy(&pm1_0, payload + 4, 2);
+  memcpy(&pm2_5, payload + 6, 2);
+  memcpy(&pm10, payload + 8, 2);
+  TEST_ASSERT_EQUAL_UINT32(reading.sequence, sequence);
+  TEST_ASSERT_EQUAL(3, pm1_0);
+  TEST_ASSERT_EQUAL(23, pm2_5);
+  TEST_ASSERT_EQUAL(27, pm10);
+  TEST_ASSERT_EQUAL(reading.vocIndex, payload[10]);
+  TEST_ASSERT_EQUAL(reading.level, payload[11]);
+  TEST_ASSERT_EQUAL(1, hub.coap.getObserverCount());
+
+  // Nothing changed, nothing sent
+  hub.coap.loop();
+  TEST_ASSERT_EQUAL(0, panel.receive().size());
+
+  // A new reading goes out as a non-confirmable notification with the
+  // registration's token and the next Observe value
+  hub.measure(40);
+  hub.coap.loop();
+  Message notification = panel.receive();
+  TEST_ASSERT_EQUAL(sizeof(head) + 1 + 12, notification.size());
+  TEST_ASSERT_EQUAL(COAP_NON, typeOf(notification));
+  TEST_ASSERT_EQUAL_HEX8(COAP_CONTENT, notification[1]);
+  TEST_ASSERT_EQUAL_HEX8_ARRAY(head + 4, notification.data() + 4, 2);
+  TEST_ASSERT_EQUAL_HEX8(0x61, notification[6]);
+  TEST_ASSERT_EQUAL(1, notification[7]);
+  memcpy(&pm2_5, notification.data() + notification.size() - 6, 2);
+  TEST_ASSERT_EQUAL(40, pm2_5);
+  TEST_ASSERT_EQUAL(1, hub.coap.getNotificationCount());
+  TEST_ASSERT_EQUAL(notification.size(), hub.coap.getLastReadingBytes());
+}
+
+void test_unacknowledged_confirmable_drops_observer() {
+  Hub hub;
+  Panel panel(20);
+  panel.send(getReading(0x0100, 0));
+  hub.coap.loop();
+  panel.receive();
+
+  // Every COAP_CON_EVERY-th notification is confirmable; one still
+  // unacknowledged when the next is due ends the observation
+  for (int i = 0; i < COAP_CON_EVERY * 2; i++) {
+    hub.measure(10 + i);
+    hub.coap.loop();
+    Message notification = panel.receive();
+    if (i < COAP_CON_EVERY * 2 - 1) {
+      TEST_ASSERT_EQUAL((i + 1) % COAP_CON_EVERY == 0 ? COAP_CON : COAP_NON, typeOf(notification));
+    } else {
+      TEST_ASSERT_EQUAL(0, notification.size());
+    }
+  }
+  TEST_ASSERT_EQUAL(0, hub.coap.getObserverCount());
+  TEST_ASSERT_EQUAL(1, hub.coap.getDroppedObservers());
+
+  // Acknowledged, the observation carries on
+  panel.send(getReading(0x0101, 0));
+  hub.coap.loop();
+  panel.receive();
+  for (int i = 0; i < COAP_CON_EVERY * 2; i++) {
+    hub.measure(10 + i);
+    hub.coap.loop();
+    Message notification = panel.receive();
+    TEST_ASSERT_NOT_EQUAL(0, notification.size());
+    if (typeOf(notification) == COAP_CON) {
+      panel.send(empty(COAP_ACK, messageIdOf(notification)));
+    }
+  }
+  TEST_ASSERT_EQUAL(1, hub.coap.getObserverCount());
+  TEST_ASSERT_EQUAL(1, hub.coap.getDroppedObservers());
+}
+
+void test_reset_and_deregistration_end_observation() {
+  Hub hub;
+  Panel panel(20);
+  panel.send(getReading(0x0200, 0));
+  hub.coap.loop();
+  panel.receive();
+  hub.measure(12);
+  hub.coap.loop();
+  Message notification = panel.receive();
+
+  // A reset answering a notification means the panel has forgotten it
+  panel.send(empty(COAP_RST, messageIdOf(notification)));
+  hub.coap.loop();
+  TEST_ASSERT_EQUAL(0, hub.coap.getObserverCount());
+  TEST_ASSERT_EQUAL(1, hub.coap.getDroppedObservers());
+
+  // Observe 1 deregisters; the answer carries no Observe option
+  panel.send(getReading(0x0201, 0));
+  hub.coap.loop();
+  panel.receive();
+  TEST_ASSERT_EQUAL(1, hub.coap.getObserverCount());
+  panel.send(getReading(0x0202, 1));
+  hub.coap.loop();
+  Message response = panel.receive();
+  TEST_ASSERT_EQUAL(0, hub.coap.getObserverCount());
+  TEST_ASSERT_EQUAL_HEX8(COAP_CONTENT, response[1]);
+  TEST_ASSERT_EQUAL_HEX8(0xC1, response[6]);  // Content-Format first
+}
+
+void test_retransmitted_put_is_applied_once() {
+  Hub hub;
+  Panel panel(20);
+  const Message toggle = { 0x40, COAP_PUT, 0x22, 0x22, 0xB3, 'l', 'e', 'd', 0xFF, 2 };
+
+  panel.send(toggle);
+  hub.coap.loop();
+  Message first = panel.receive();
+  TEST_ASSERT_EQUAL(COAP_ACK, typeOf(first));
+  TEST_ASSERT_EQUAL_HEX8(COAP_CHANGED, first[1]);
+  TEST_ASSERT_TRUE(ledState);
+
+  // The same message ID again: the stored answer, not a second toggle
+  panel.send(toggle);
+  hub.coap.loop();
+  Message second = panel.receive();
+  TEST_ASSERT_TRUE(ledState);
+  TEST_ASSERT_EQUAL(1, hub.coap.getDuplicateCount());
+  TEST_ASSERT_EQUAL(first.size(), second.size());
+  TEST_ASSERT_EQUAL_HEX8_ARRAY(first.data(), second.data(), first.size());
+
+  // A new message ID toggles again
+  Message next = toggle;
+  next[3] = 0x23;
+  panel.send(next);
+  hub.coap.loop();
+  panel.receive();
+  TEST_ASSERT_FALSE(ledState);
+
+  const Message servo = { 0x40, COAP_POST, 0x22, 0x24, 0xB5, 's', 'e', 'r', 'v', 'o', 0xFF, 90 };
+  panel.send(servo);
+  hub.coap.loop();
+  TEST_ASSERT_EQUAL_HEX8(COAP_CHANGED, panel.receive()[1]);
+  TEST_ASSERT_EQUAL(90, servoPosition);
+}
+
+void test_ping_and_discovery() {
+  Hub hub;
+  Panel panel(20);
+
+  // An empty confirmable message is answered with a reset
+  panel.send(empty(COAP_CON, 0x3333));
+  hub.coap.loop();
+  Message pong = panel.receive();
+  TEST_ASSERT_EQUAL(4, pong.size());
+  TEST_ASSERT_EQUAL(COAP_RST, typeOf(pong));
+  TEST_ASSERT_EQUAL_HEX16(0x3333, messageIdOf(pong));
+
+  const Message discover = { 0x50, COAP_GET, 0x44, 0x44, 0xBB, '.', 'w', 'e', 'l', 'l', '-', 'k', 'n', 'o', 'w', 'n',
+                             0x04, 'c', 'o', 'r', 'e' };
+  panel.send(discover);
+  hub.coap.loop();
+  Message links = panel.receive();
+  TEST_ASSERT_EQUAL(COAP_NON, typeOf(links));
+  TEST_ASSERT_EQUAL_HEX8(COAP_CONTENT, links[1]);
+  TEST_ASSERT_EQUAL_HEX8(0xC1, links[4]);
+  TEST_ASSERT_EQUAL(COAP_FORMAT_LINK, links[5]);
+  size_t marker = std::find(links.begin(), links.end(), 0xFF) - links.begin();
+  std::string body(links.begin() + marker + 1, links.end());
+  TEST_ASSERT_EQUAL_STRING(DISCOVERY, body.c_str());
+}
+
+void test_rejects_bad_requests() {
+  Hub hub;
+  Panel panel(20);
+
+  const Message unknown = { 0x40, COAP_GET, 0x55, 0x55, 0xB1, 'x' };
+  panel.send(unknown);
+  hub.coap.loop();
+  TEST_ASSERT_EQUAL_HEX8(COAP_NOT_FOUND, panel.receive()[1]);
+
+  // If-Match (1) is critical and not understood
+  const Message ifMatch = { 0x40, COAP_GET, 0x55, 0x56, 0x10, 0xA7, 'r', 'e', 'a', 'd', 'i', 'n', 'g' };
+  panel.send(ifMatch);
+  hub.coap.loop();
+  TEST_ASSERT_EQUAL_HEX8(COAP_BAD_OPTION, panel.receive()[1]);
+
+  // Accept 50 (JSON): the reading is only served as octets
+  const Message json = { 0x40, COAP_GET, 0x55, 0x58, 0xB7, 'r', 'e', 'a', 'd', 'i', 'n', 'g', 0x61, 50 };
+  panel.send(json);
+  hub.coap.loop();
+  TEST_ASSERT_EQUAL_HEX8(COAP_NOT_ACCEPTABLE, panel.receive()[1]);
+
+  const Message wrongMethod = { 0x40, COAP_PUT, 0x55, 0x59, 0xB7, 'r', 'e', 'a', 'd', 'i', 'n', 'g', 0xFF, 1 };
+  panel.send(wrongMethod);
+  hub.coap.loop();
+  TEST_ASSERT_EQUAL_HEX8(COAP_METHOD_NOT_ALLOWED, panel.receive()[1]);
+
+  // A payload marker with no payload is malformed; confirmable, so reset
+  const Message malformed = { 0x40, COAP_GET, 0x55, 0x57, 0xFF };
+  panel.send(malformed);
+  hub.coap.loop();
+  Message reset = panel.receive();
+  TEST_ASSERT_EQUAL(COAP_RST, typeOf(reset));
+  TEST_ASSERT_EQUAL_HEX16(0x5557, messageIdOf(reset));
+  TEST_ASSERT_EQUAL(1, hub.coap.getRejectedCount());
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_reading_layout_and_observe_registration);
+  RUN_TEST(test_unacknowledged_confirmable_drops_observer);
+  RUN_TEST(test_reset_and_deregistration_end_observation);
+  RUN_TEST(test_retransmitted_put_is_applied_once);
+  RUN_TEST(test_ping_and_discovery);
+  RUN_TEST(test_rejects_bad_requests);
+  return UNITY_END();
+}
@@ -0,0 +1,151 @@
+#include <unity.h>
+#include <vector>
+#include "../../src/firmware_updater.cpp"
+
+// Records what reaches flash instead of writing it
+class FakeFlash : public FlashBackend {
+public:
+  std::vector<uint8_t> written;
+  size_t capacity = 0;
+  bool committed = false;
+  bool aborted = false;
+
+  bool begin(size_t maxSize) override {
+    written.clear();
+    capacity = maxSize;
+    committed = false;
+    aborted = false;
+    return true;
+  }
+  size_t write(const uint8_t* data, size_t len) override {
+    if (written.size() + len > capacity) {
+      return 0;
+    }
+    written.insert(written.end(), data, data + len);
+    return len;
+  }
+  bool commit() override {
+    committed = true;
+    return true;
+  }
+  void abort() override {
+    aborted = true;
+  }
+};
+
+// Upload buffer of the web server (HTTP_UPLOAD_BUFLEN)
+static const size_t UPLOAD_CHUNK = 2048;
+
+// FIPS 180-2 test vector: one million repetitions of 'a'
+static const size_t IMAGE_SIZE = 1000000;
+static const char IMAGE_SHA256[] = "cdc76e5c9914fb9281a1c7e284d73e67f1809a48a497200e046d39ccc7112cd0";
+
+static FakeFlash flash;
+static std::vector<uint8_t> image;
+
+void setUp() {
+  image.assign(IMAGE_SIZE, 'a');
+}
+
+void tearDown() {}
+
+// Feeds the image the way the web server does, one upload buffer at a time
+static bool stream(FirmwareUpdater& updater, size_t length) {
+  for (size_t at = 0; at < length; at += UPLOAD_CHUNK) {
+    size_t chunk = std::min(length - at, (size_t)UPLOAD_CHUNK);
+    if (!updater.write(image.data() + at, chunk)) {
+      return false;
+    }
+    hostAdvanceMillis(1);
+  }
+  return true;
+}
+
+void test_good_image_is_committed() {
+  FirmwareUpdater updater(&flash);
+  TEST_ASSERT_TRUE(updater.begin(2 * IMAGE_SIZE, IMAGE_SHA256));
+  TEST_ASSERT_TRUE(stream(updater, IMAGE_SIZE));
+  TEST_ASSERT_TRUE(updater.end());
+
+  TEST_ASSERT_TRUE(updater.isVerified());
+  TEST_ASSERT_TRUE(flash.committed);
+  TEST_ASSERT_FALSE(flash.aborted);
+  TEST_ASSERT_EQUAL(IMAGE_SIZE, updater.getBytesWritten());
+  TEST_ASSERT_TRUE(flash.written == image);
+  TEST_ASSERT_TRUE(updater.getThroughputKBps() > 0);
+}
+
+void test_sha256_mismatch_is_not_committed() {
+  image[IMAGE_SIZE / 2] ^= 0x01;
+
+  FirmwareUpdater updater(&flash);
+  TEST_ASSERT_TRUE(updater.begin(2 * IMAGE_SIZE, IMAGE_SHA256));
+  TEST_ASSERT_TRUE(stream(updater, IMAGE_SIZE));
+  TEST_ASSERT_FALSE(updater.end());
+
+  TEST_ASSERT_FALSE(updater.isVerified());
+  TEST_ASSERT_FALSE(flash.committed);
+  TEST_ASSERT_TRUE(flash.aborted);
+  TEST_ASSERT_EQUAL_STRING("sha256 mismatch", updater.getError());
+}
+
+void test_truncated_upload_is_not_committed() {
+  FirmwareUpdater updater(&flash);
+  TEST_ASSERT_TRUE(updater.begin(2 * IMAGE_SIZE, IMAGE_SHA256));
+  TEST_ASSERT_TRUE(stream(updater, IMAGE_SIZE - 1000));
+  TEST_ASSERT_FALSE(updater.end());
+
+  TEST_ASSERT_FALSE(flash.committed);
+  TEST_ASSERT_TRUE(flash.aborted);
+  TEST_ASSERT_EQUAL_STRING("sha256 mismatch", updater.getError());
+}
+
+void test_aborted_upload_is_not_committed() {
+  FirmwareUpdater updater(&flash);
+  TEST_ASSERT_TRUE(updater.begin(2 * IMAGE_SIZE, IMAGE_SHA256));
+  TEST_ASSERT_TRUE(stream(updater, IMAGE_SIZE / 2));
+  updater.abort("upload aborted");
+
+  TEST_ASSERT_FALSE(updater.isRunning());
+  TEST_ASSERT_FALSE(updater.end());
+  TEST_ASSERT_FALSE(flash.committed);
+  TEST_ASSERT_TRUE(flash.aborted);
+}
+
+void test_image_larger_than_flash_is_rejected() {
+  FirmwareUpdater updater(&flash);
+  TEST_ASSERT_TRUE(updater.begin(IMAGE_SIZE / 2, IMAGE_SHA256));
+  TEST_ASSERT_FALSE(stream(updater, IMAGE_SIZE));
+  TEST_ASSERT_FALSE(updater.isRunning());
+  TEST_ASSERT_EQUAL_STRING("flash write failed", updater.getError());
+  TEST_ASSERT_FALSE(flash.committed);
+}
+
+void test_malformed_digest_is_rejected() {
+  FirmwareUpdater updater(&flash);
+  TEST_ASSERT_FALSE(updater.begin(2 * IMAGE_SIZE, "cdc76e5c"));
+  TEST_ASSERT_FALSE(updater.begin(2 * IMAGE_SIZE, nullptr));
+  TEST_ASSERT_FALSE(updater.isRunning());
+  TEST_ASSERT_FALSE(updater.write(image.data(), 16));
+}
+
+void test_verified_result_does_not_outlive_an_abort() {
+  FirmwareUpdater updater(&flash);
+  TEST_ASSERT_TRUE(updater.begin(2 * IMAGE_SIZE, IMAGE_SHA256));
+  TEST_ASSERT_TRUE(stream(updater, IMAGE_SIZE));
+  TEST_ASSERT_TRUE(updater.end());
+  updater.abort("not authorized");
+  TEST_ASSERT_FALSE(updater.isVerified());
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_good_image_is_committed);
+  RUN_TEST(test_sha256_mismatch_is_not_committed);
+  RUN_TEST(test_truncated_upload_is_not_committed);
+  RUN_TEST(test_aborted_upload_is_not_committed);
+  RUN_TEST(test_image_larger_than_flash_is_rejected);
+  RUN_TEST(test_malformed_digest_is_rejected);
+  RUN_TEST(test_verified_result_does_not_outlive_an_abort);
+  return UNITY_END();
+}
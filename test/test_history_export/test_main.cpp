@@ -0,0 +1,257 @@
+#include <unity.h>
+#include <chrono>
+#include <memory>
+#include <string>
+#include "../../src/series_codec.cpp"
+#include "../../src/history_archive.cpp"
+#include "../../src/history_export.cpp"
+
+static const uint32_t START = 1767225600;
+
+// One sample a minute, values changing enough that blocks seal every few
+// hundred samples
+static HistorySample sampleAt(uint32_t i) {
+  HistorySample sample = { START + i * 60, (uint16_t)(3 + i % 7), (uint16_t)(5 + i % 23), (uint16_t)(9 + i % 31),
+                           (uint8_t)(20 + i % 11), 0 };
+  return sample;
+}
+
+static std::unique_ptr<HistoryArchive> makeArchive(uint32_t samples) {
+  auto archive = std::make_unique<HistoryArchive>();
+  archive->begin();
+  for (uint32_t i = 0; i < samples; i++) {
+    archive->add(sampleAt(i));
+  }
+  return archive;
+}
+
+struct Export {
+  uint8_t block[ARCHIVE_BLOCK_SIZE];
+  char chunk[EXPORT_CHUNK_SIZE];
+  HistoryExport exporter;
+
+  Export(HistoryArchive* archive, ExportFormat format, uint32_t from = 0, uint32_t to = UINT32_MAX) : exporter(archive) {
+    exporter.begin(format, from, to, block, chunk);
+  }
+
+  std::string write(uint32_t start, uint32_t end, uint32_t* records = nullptr) {
+    std::string out;
+    uint32_t written = exporter.write(start, end, [&out](const char* data, size_t length) {
+      TEST_ASSERT_TRUE(length <= EXPORT_CHUNK_SIZE);
+      out.append(data, length);
+    });
+    if (records) {
+      *records = written;
+    }
+    return out;
+  }
+
+  std::string all() { return write(0, exporter.getLength() - 1); }
+};
+
+static std::string csvRecord(const HistorySample& s) {
+  char record[80];
+  snprintf(record, sizeof(record), "%10u,%5u,%5u,%5u,%3u\n", s.time, s.pm1_0, s.pm2_5, s.pm10, s.vocIndex);
+  return record;
+}
+
+void setUp() {
+  LittleFS.format();
+}
+
+void tearDown() {}
+
+void test_csv_covers_sealed_and_open_blocks() {
+  auto archive = makeArchive(2000);
+  TEST_ASSERT_TRUE(archive->getNextSequence() >= 2);
+  Export csv(archive.get(), EXPORT_CSV);
+
+  TEST_ASSERT_EQUAL(2000, csv.exporter.getCount());
+  std::string body = csv.all();
+  TEST_ASSERT_EQUAL(csv.exporter.getLength(), body.size());
+  TEST_ASSERT_EQUAL(csv.exporter.getHeaderLength() + 2000 * csv.exporter.getRecordLength(), body.size());
+  TEST_ASSERT_EQUAL_STRING("time,pm1_0,pm2_5,pm10,voc\n", body.substr(0, csv.exporter.getHeaderLength()).c_str());
+  for (uint32_t i : { 0u, 1u, 999u, 1999u }) {
+    size_t at = csv.exporter.getHeaderLength() + i * csv.exporter.getRecordLength();
+    TEST_ASSERT_EQUAL_STRING(csvRecord(sampleAt(i)).c_str(), body.substr(at, csv.exporter.getRecordLength()).c_str());
+  }
+}
+
+void test_ndjson_records() {
+  auto archive = makeArchive(3);
+  Export ndjson(archive.get(), EXPORT_NDJSON);
+
+  TEST_ASSERT_EQUAL(0, ndjson.exporter.getHeaderLength());
+  std::string body = ndjson.all();
+  TEST_ASSERT_EQUAL(3 * ndjson.exporter.getRecordLength(), body.size());
+  TEST_ASSERT_EQUAL_STRING("{\"time\":1767225660,\"pm1_0\":    4,\"pm2_5\":    6,\"pm10\":   10,\"voc\": 21}\n",
+                           body.substr(ndjson.exporter.getRecordLength(), ndjson.exporter.getRecordLength()).c_str());
+}
+
+void test_time_range_selects_records() {
+  auto archive = makeArchive(2000);
+  // Whole minutes 500 to 1500, straddling block boundaries
+  Export csv(archive.get(), EXPORT_CSV, sampleAt(500).time, sampleAt(1500).time);
+
+  TEST_ASSERT_EQUAL(1001, csv.exporter.getCount());
+  std::string body = csv.all();
+  size_t header = csv.exporter.getHeaderLength();
+  size_t record = csv.exporter.getRecordLength();
+  TEST_ASSERT_EQUAL_STRING(csvRecord(sampleAt(500)).c_str(), body.substr(header, record).c_str());
+  TEST_ASSERT_EQUAL_STRING(csvRecord(sampleAt(1500)).c_str(), body.substr(body.size() - record).c_str());
+
+  Export empty(archive.get(), EXPORT_CSV, START - 100, START - 1);
+  TEST_ASSERT_EQUAL(0, empty.exporter.getCount());
+  TEST_ASSERT_EQUAL(empty.exporter.getHeaderLength(), empty.exporter.getLength());
+}
+
+void test_range_slices_match_the_whole_export() {
+  auto archive = makeArchive(2000);
+  Export csv(archive.get(), EXPORT_CSV);
+  std::string whole = csv.all();
+  uint32_t length = whole.size();
+  uint32_t record = csv.exporter.getRecordLength();
+
+  const uint32_t slices[][2] = {
+    { 0, 0 },
+    { 0, 25 },                                   // Header only
+    { 26, 26 + record - 1 },                     // First record exactly
+    { 10, 2 * EXPORT_CHUNK_SIZE + 17 },          // Across chunks
+    { 31337, 31337 + 5 * record + 3 },           // Mid-record to mid-record
+    { length - record - 1, length - 1 },
+    { length - 1, length - 1 },
+  };
+  for (const auto& slice : slices) {
+    uint32_t records = 0;
+    std::string part = csv.write(slice[0], slice[1], &records);
+    TEST_ASSERT_EQUAL_STRING(whole.substr(slice[0], slice[1] - slice[0] + 1).c_str(), part.c_str());
+    // Only records overlapping the slice are formatted
+    uint32_t first = slice[0] > 26 ? (slice[0] - 26) / record : 0;
+    uint32_t last = slice[1] >= 26 ? (slice[1] - 26) / record + 1 : 0;
+    TEST_ASSERT_EQUAL(last - first, records);
+  }
+}
+
+void test_parse_range() {
+  uint32_t start = 0;
+  uint32_t end = 0;
+  TEST_ASSERT_TRUE(HistoryExport::parseRange("bytes=0-99", 1000, start, end));
+  TEST_ASSERT_EQUAL(0, start);
+  TEST_ASSERT_EQUAL(99, end);
+  TEST_ASSERT_TRUE(HistoryExport::parseRange("bytes=900-", 1000, start, end));
+  TEST_ASSERT_EQUAL(900, start);
+  TEST_ASSERT_EQUAL(999, end);
+  TEST_ASSERT_TRUE(HistoryExport::parseRange("bytes=900-5000", 1000, start, end));
+  TEST_ASSERT_EQUAL(999, end);
+
+  // Suffix: the last n bytes, or all of them when n is larger
+  TEST_ASSERT_TRUE(HistoryExport::parseRange("bytes=-100", 1000, start, end));
+  TEST_ASSERT_EQUAL(900, start);
+  TEST_ASSERT_EQUAL(999, end);
+  TEST_ASSERT_TRUE(HistoryExport::parseRange("bytes=-5000", 1000, start, end));
+  TEST_ASSERT_EQUAL(0, start);
+  TEST_ASSERT_EQUAL(999, end);
+
+  // Unsatisfiable or not supported
+  TEST_ASSERT_FALSE(HistoryExport::parseRange("bytes=1000-", 1000, start, end));
+  TEST_ASSERT_FALSE(HistoryExport::parseRange("bytes=500-100", 1000, start, end));
+  TEST_ASSERT_FALSE(HistoryExport::parseRange("bytes=-0", 1000, start, end));
+  TEST_ASSERT_FALSE(HistoryExport::parseRange("bytes=0-1,5-6", 1000, start, end));
+  TEST_ASSERT_FALSE(HistoryExport::parseRange("bytes=abc", 1000, start, end));
+  TEST_ASSERT_FALSE(HistoryExport::parseRange("items=0-1", 1000, start, end));
+  TEST_ASSERT_FALSE(HistoryExport::parseRange("bytes=0-", 0, start, end));
+}
+
+void test_etag_follows_the_records() {
+  auto archive = makeArchive(100);
+  char before[48];
+  char after[48];
+  Export(archive.get(), EXPORT_CSV).exporter.getETag(before, sizeof(before));
+  Export(archive.get(), EXPORT_CSV).exporter.getETag(after, sizeof(after));
+  TEST_ASSERT_EQUAL_STRING(before, after);
+
+  archive->add(sampleAt(100));
+  Export(archive.get(), EXPORT_CSV).exporter.getETag(after, sizeof(after));
+  TEST_ASSERT_TRUE(strcmp(before, after) != 0);
+  Export(archive.get(), EXPORT_NDJSON).exporter.getETag(before, sizeof(before));
+  TEST_ASSERT_TRUE(strcmp(before, after) != 0);
+}
+
+void test_archive_resumes_after_restart() {
+  auto archive = makeArchive(2000);
+  archive->flush();
+  uint32_t sealed = archive->getNextSequence();
+
+  auto restarted = std::make_unique<HistoryArchive>();
+  restarted->begin();
+  TEST_ASSERT_EQUAL(sealed, restarted->getNextSequence());
+  Export csv(restarted.get(), EXPORT_CSV);
+  TEST_ASSERT_EQUAL(2000, csv.exporter.getCount());
+}
+
+void test_archive_keeps_the_newest_blocks() {
+  auto archive = makeArchive(0);
+  uint32_t i = 0;
+  while (archive->getNextSequence() < ARCHIVE_BLOCKS + 3) {
+    archive->add(sampleAt(i++));
+  }
+  TEST_ASSERT_EQUAL(3, archive->getOldestSequence());
+
+  // The export starts at the oldest block still on flash
+  Export csv(archive.get(), EXPORT_CSV);
+  ArchiveBlockHeader header;
+  ArchiveBlockHeader overwritten;
+  File file;
+  TEST_ASSERT_TRUE(archive->openBlock(3, header, file));
+  file.close();
+  TEST_ASSERT_FALSE(archive->openBlock(2, overwritten, file));
+  std::string first = csv.write(csv.exporter.getHeaderLength(), csv.exporter.getHeaderLength() + csv.exporter.getRecordLength() - 1);
+  TEST_ASSERT_EQUAL(header.firstTime, strtoul(first.c_str(), nullptr, 10));
+}
+
+// Host throughput of a whole-archive export, for comparison with
+// /debug/export on the hub
+void test_export_throughput() {
+  auto archive = makeArchive(0);
+  uint32_t i = 0;
+  while (archive->getNextSequence() < ARCHIVE_BLOCKS) {
+    archive->add(sampleAt(i++));
+  }
+  const int rounds = 10;
+
+  for (ExportFormat format : { EXPORT_CSV, EXPORT_NDJSON }) {
+    uint64_t records = 0;
+    uint64_t expected = 0;
+    uint64_t bytes = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int round = 0; round < rounds; round++) {
+      Export out(archive.get(), format);
+      uint32_t written = 0;
+      bytes += out.write(0, out.exporter.getLength() - 1, &written).size();
+      records += written;
+      expected += out.exporter.getCount();
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    TEST_ASSERT_EQUAL(expected, records);
+
+    char message[160];
+    snprintf(message, sizeof(message), "%s: %u records from %u blocks, %.0f records/s, %.0f KB/s",
+             HistoryExport::formatName(format), (unsigned)(records / rounds), ARCHIVE_BLOCKS,
+             records / seconds, bytes / seconds / 1024);
+    TEST_MESSAGE(message);
+  }
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_csv_covers_sealed_and_open_blocks);
+  RUN_TEST(test_ndjson_records);
+  RUN_TEST(test_time_range_selects_records);
+  RUN_TEST(test_range_slices_match_the_whole_export);
+  RUN_TEST(test_parse_range);
+  RUN_TEST(test_etag_follows_the_records);
+  RUN_TEST(test_archive_resumes_after_restart);
+  RUN_TEST(test_archive_keeps_the_newest_blocks);
+  RUN_TEST(test_export_throughput);
+  return UNITY_END();
+}
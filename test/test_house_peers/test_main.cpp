@@ -0,0 +1,203 @@
+#include <unity.h>
+#include <memory>
+#include "../sensor_pipeline.h"
+#include "../../src/house_peers.cpp"
+
+// Several hubs in one process on the host's in-memory network. Each runs
+// with its own chip ID and address, as it would on its own chip.
+struct Hub {
+  uint32_t chipId;
+  IPAddress ip;
+  PMSSensor sensor;
+  HousePeers peers;
+
+  Hub(uint32_t id, uint8_t host) : chipId(id), ip(192, 168, 1, host), peers(&sensor) {}
+
+  void loop() {
+    ESP.chipId = chipId;
+    WiFi.address = ip;
+    peers.loop();
+  }
+
+  void measure(uint16_t pm2_5) { TEST_ASSERT_TRUE(feedFrame(sensor, pm2_5)); }
+};
+
+static const HousePeer* findPeer(const HousePeers& peers, uint32_t hubId) {
+  for (uint8_t p = 0; p < HOUSE_MAX_PEERS; p++) {
+    const HousePeer* peer = peers.getPeer(p);
+    if (peer && peer->reading.hubId == hubId) {
+      return peer;
+    }
+  }
+  return nullptr;
+}
+
+static void sendRaw(const HouseDatagram& datagram, size_t length, uint8_t host) {
+  WiFiUDP udp;
+  udp.beginPacketMulticast(HOUSE_GROUP_IP, HOUSE_PORT, IPAddress(192, 168, 1, host));
+  udp.write((const uint8_t*)&datagram, length);
+  udp.endPacket();
+}
+
+static HouseDatagram makeDatagram(uint32_t hubId) {
+  HouseDatagram datagram = { HOUSE_MAGIC, HOUSE_VERSION, 1, hubId, 1, 2, 5, 9, 30, 0 };
+  return datagram;
+}
+
+void setUp() {
+  hostMicros = 1000000;
+  WiFi.linkStatus = WL_CONNECTED;
+}
+
+void tearDown() {}
+
+void test_hubs_see_each_other() {
+  auto kitchen = std::make_unique<Hub>(0x100, 10);
+  auto bedroom = std::make_unique<Hub>(0x200, 11);
+  auto office = std::make_unique<Hub>(0x300, 12);
+  Hub* hubs[] = { kitchen.get(), bedroom.get(), office.get() };
+
+  for (Hub* hub : hubs) hub->loop();  // Join the group
+  kitchen->measure(40);
+  bedroom->measure(8);
+  office->measure(15);
+  for (Hub* hub : hubs) hub->loop();  // Send
+  for (Hub* hub : hubs) hub->loop();  // Receive
+
+  for (Hub* hub : hubs) {
+    TEST_ASSERT_EQUAL(1, hub->peers.getSentCount());
+    TEST_ASSERT_EQUAL(2, hub->peers.getPeerCount());
+    TEST_ASSERT_NULL(findPeer(hub->peers, hub->chipId));
+  }
+  const HousePeer* peer = findPeer(bedroom->peers, 0x100);
+  TEST_ASSERT_NOT_NULL(peer);
+  TEST_ASSERT_EQUAL(40, peer->reading.pm2_5);
+  TEST_ASSERT_EQUAL(44, peer->reading.pm10);
+  TEST_ASSERT_EQUAL(1, peer->reading.flags);
+  TEST_ASSERT_EQUAL_UINT32(IPAddress(192, 168, 1, 10), peer->ip);
+  TEST_ASSERT_EQUAL(15, findPeer(kitchen->peers, 0x300)->reading.pm2_5);
+
+  // The display's copy matches the table
+  const HouseView view = bedroom->peers.readView();
+  TEST_ASSERT_EQUAL(2, view.count);
+  for (uint8_t p = 0; p < HOUSE_MAX_PEERS; p++) {
+    const HousePeer* live = bedroom->peers.getPeer(p);
+    TEST_ASSERT_EQUAL(live != nullptr, view.peers[p].lastSeen != 0);
+    if (live != nullptr) {
+      TEST_ASSERT_EQUAL_UINT32(live->reading.hubId, view.peers[p].reading.hubId);
+    }
+  }
+}
+
+void test_resends_on_new_reading_or_heartbeat() {
+  auto kitchen = std::make_unique<Hub>(0x100, 10);
+  auto bedroom = std::make_unique<Hub>(0x200, 11);
+  kitchen->loop();
+  bedroom->loop();
+  kitchen->measure(40);
+  kitchen->loop();
+  kitchen->loop();
+  TEST_ASSERT_EQUAL(1, kitchen->peers.getSentCount());
+
+  kitchen->measure(42);
+  kitchen->loop();
+  TEST_ASSERT_EQUAL(2, kitchen->peers.getSentCount());
+
+  hostAdvanceMillis(HOUSE_HEARTBEAT_MS);
+  kitchen->loop();
+  TEST_ASSERT_EQUAL(3, kitchen->peers.getSentCount());
+
+  bedroom->loop();
+  TEST_ASSERT_EQUAL(3, bedroom->peers.getReceivedCount());
+  TEST_ASSERT_EQUAL(42, findPeer(bedroom->peers, 0x100)->reading.pm2_5);
+  TEST_ASSERT_EQUAL(1, bedroom->peers.getPeerCount());
+}
+
+void test_silent_peer_expires() {
+  auto kitchen = std::make_unique<Hub>(0x100, 10);
+  auto bedroom = std::make_unique<Hub>(0x200, 11);
+  kitchen->loop();
+  bedroom->loop();
+  bedroom->measure(8);
+  bedroom->loop();
+  kitchen->loop();
+  TEST_ASSERT_EQUAL(1, kitchen->peers.getPeerCount());
+
+  hostAdvanceMillis(HOUSE_PEER_TIMEOUT_MS - 1);
+  kitchen->loop();
+  TEST_ASSERT_EQUAL(1, kitchen->peers.getPeerCount());
+  hostAdvanceMillis(1);
+  kitchen->loop();
+  TEST_ASSERT_EQUAL(0, kitchen->peers.getPeerCount());
+  TEST_ASSERT_EQUAL(0, kitchen->peers.readView().count);
+}
+
+void test_malformed_datagrams_are_rejected() {
+  auto kitchen = std::make_unique<Hub>(0x100, 10);
+  kitchen->loop();
+
+  HouseDatagram datagram = makeDatagram(0x900);
+  sendRaw(datagram, sizeof(datagram) - 1, 20);
+  datagram.magic = 0x1234;
+  sendRaw(datagram, sizeof(datagram), 20);
+  datagram = makeDatagram(0x900);
+  datagram.version = HOUSE_VERSION + 1;
+  sendRaw(datagram, sizeof(datagram), 20);
+  kitchen->loop();
+
+  TEST_ASSERT_EQUAL(3, kitchen->peers.getRejectedCount());
+  TEST_ASSERT_EQUAL(0, kitchen->peers.getReceivedCount());
+  TEST_ASSERT_EQUAL(0, kitchen->peers.getPeerCount());
+}
+
+void test_full_table_replaces_least_recently_heard() {
+  auto kitchen = std::make_unique<Hub>(0x100, 10);
+  kitchen->loop();
+  for (uint32_t id = 1; id <= HOUSE_MAX_PEERS; id++) {
+    sendRaw(makeDatagram(id), sizeof(HouseDatagram), 20 + id);
+    kitchen->loop();
+    hostAdvanceMillis(1000);
+  }
+  // Hub 1 speaks again, so hub 2 is now the least recently heard
+  sendRaw(makeDatagram(1), sizeof(HouseDatagram), 21);
+  kitchen->loop();
+  hostAdvanceMillis(1000);
+  sendRaw(makeDatagram(HOUSE_MAX_PEERS + 1), sizeof(HouseDatagram), 40);
+  kitchen->loop();
+
+  TEST_ASSERT_EQUAL(HOUSE_MAX_PEERS, kitchen->peers.getPeerCount());
+  TEST_ASSERT_NOT_NULL(findPeer(kitchen->peers, 1));
+  TEST_ASSERT_NULL(findPeer(kitchen->peers, 2));
+  TEST_ASSERT_NOT_NULL(findPeer(kitchen->peers, HOUSE_MAX_PEERS + 1));
+}
+
+void test_link_loss_leaves_the_group() {
+  auto kitchen = std::make_unique<Hub>(0x100, 10);
+  auto bedroom = std::make_unique<Hub>(0x200, 11);
+  kitchen->loop();
+  bedroom->loop();
+  TEST_ASSERT_EQUAL(2, hostSockets.size());
+
+  WiFi.linkStatus = WL_DISCONNECTED;
+  kitchen->loop();
+  TEST_ASSERT_EQUAL(1, hostSockets.size());
+
+  // The group is joined again once the link is back
+  WiFi.linkStatus = WL_CONNECTED;
+  bedroom->measure(8);
+  kitchen->loop();
+  bedroom->loop();
+  kitchen->loop();
+  TEST_ASSERT_EQUAL(1, kitchen->peers.getPeerCount());
+}
+
+int main(int argc, char** argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_hubs_see_each_other);
+  RUN_TEST(test_resends_on_new_reading_or_heartbeat);
+  RUN_TEST(test_silent_peer_expires);
+  RUN_TEST(test_malformed_datagrams_are_rejected);
+  RUN_TEST(test_full_table_replaces_least_recently_heard);
+  RUN_TEST(test_link_loss_leaves_the_group);
+  return UNITY_END();
+}
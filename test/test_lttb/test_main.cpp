@@ -0,0 +1,69 @@
+#include <unity.h>
+#include <vector>
+#include "lttb.h"
+
+// y = 0 except for a spike at index 50
+struct Series {
+  size_t spike = 50;
+  float x(size_t i) const { return i; }
+  float y(size_t i) const { return i == spike ? 100 : 0; }
+};
+
+static std::vector<size_t> downsample(size_t first, size_t count, size_t threshold) {
+  std::vector<size_t> picked;
+  lttbDownsample(Series(), first, count, threshold, [&picked](size_t index) { picked.push_back(index); });
+  return picked;
+}
+
+void setUp() {}
+
+void tearDown() {}
+
+void test_small_ranges_pass_through() {
+  TEST_ASSERT_EQUAL(0, downsample(0, 0, 10).size());
+  std::vector<size_t> all = downsample(5, 4, 4);
+  TEST_ASSERT_EQUAL(4, all.size());
+  TEST_ASSERT_EQUAL(5, all[0]);
+  TEST_ASSERT_EQUAL(8, all[3]);
+}
+
+void test_threshold_is_the_point_count() {
+  std::vector<size_t> picked = downsample(0, 200, 20);
+  TEST_ASSERT_EQUAL(20, picked.size());
+  TEST_ASSERT_EQUAL(0, picked.front());
+  TEST_ASSERT_EQUAL(199, picked.back());
+  for (size_t i = 1; i < picked.size(); i++) {
+    TEST_ASSERT_TRUE(picked[i] > picked[i - 1]);
+  }
+}
+
+void test_spike_survives() {
+  std::vector<size_t> picked = downsample(0, 200, 10);
+  bool found = false;
+  for (size_t index : picked) {
+    found |= index == 50;
+  }
+  TEST_ASSERT_TRUE(found);
+}
+
+// Below three points there is no bucket between the ends
+void test_two_points_are_the_ends() {
+  std::vector<size_t> picked = downsample(10, 200, 2);
+  TEST_ASSERT_EQUAL(2, picked.size());
+  TEST_ASSERT_EQUAL(10, picked[0]);
+  TEST_ASSERT_EQUAL(209, picked[1]);
+
+  picked = downsample(10, 200, 1);
+  TEST_ASSERT_EQUAL(1, picked.size());
+  TEST_ASSERT_EQUAL(10, picked[0]);
+  TEST_ASSERT_EQUAL(0, downsample(10, 200, 0).size());
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_small_ranges_pass_through);
+  RUN_TEST(test_threshold_is_the_point_count);
+  RUN_TEST(test_spike_survives);
+  RUN_TEST(test_two_points_are_the_ends);
+  return UNITY_END();
+}
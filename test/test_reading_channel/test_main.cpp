@@ -0,0 +1,147 @@
+#include <unity.h>
+#include <thread>
+#include "reading_channel.h"
+
+// The handoff between the sensing and network sides, with each side on its
+// own host thread as on the ESP32's two cores. Build with
+// -fsanitize=thread to have TSan check the memory ordering as well.
+
+#define STRESS_COUNT 200000
+
+// A reading-sized record whose check word is the XOR of the rest, so a copy
+// mixing two writes is detected
+struct Record {
+  uint32_t sequence;
+  uint32_t values[10];
+  uint32_t check;
+};
+
+static Record makeRecord(uint32_t sequence) {
+  Record record;
+  record.sequence = sequence;
+  record.check = 0;
+  for (int k = 0; k < 10; k++) {
+    record.values[k] = sequence * 31 + k;
+    record.check ^= record.values[k];
+  }
+  return record;
+}
+
+static bool isWhole(const Record& record) {
+  uint32_t check = 0;
+  for (int k = 0; k < 10; k++) {
+    check ^= record.values[k];
+  }
+  return check == record.check;
+}
+
+void setUp() {}
+void tearDown() {}
+
+void test_ring_keeps_order_and_drops_when_full() {
+  SpscRing<uint32_t, 4> ring;
+  for (uint32_t i = 1; i <= 5; i++) {
+    TEST_ASSERT_EQUAL(i <= 4, ring.push(i));
+  }
+  TEST_ASSERT_EQUAL_UINT32(4, ring.size());
+  TEST_ASSERT_EQUAL_UINT32(1, ring.getDropped());
+  uint32_t item;
+  for (uint32_t i = 1; i <= 4; i++) {
+    TEST_ASSERT_TRUE(ring.pop(item));
+    TEST_ASSERT_EQUAL_UINT32(i, item);
+  }
+  TEST_ASSERT_FALSE(ring.pop(item));
+}
+
+void test_seqlock_starts_zeroed_and_counts_writes() {
+  Seqlock<Record> lock;
+  Record record = makeRecord(7);
+  TEST_ASSERT_EQUAL_UINT32(0, lock.read(record));
+  TEST_ASSERT_EQUAL_UINT32(0, record.sequence);
+  TEST_ASSERT_EQUAL_UINT32(0, lock.getWriteCount());
+  lock.write(makeRecord(3));
+  lock.write(makeRecord(4));
+  lock.read(record);
+  TEST_ASSERT_EQUAL_UINT32(4, record.sequence);
+  TEST_ASSERT_TRUE(isWhole(record));
+  TEST_ASSERT_EQUAL_UINT32(2, lock.getWriteCount());
+}
+
+// One producer, as the sensing task: publishes each record to the seqlock
+// and queues it, waiting when the queue is full so that none is dropped.
+// The consumer must see every record in order; the reader, polling the
+// seqlock like a web handler, must never see a torn or older copy.
+void test_channels_across_threads() {
+  static SpscRing<Record, 8> ring;
+  static Seqlock<Record> latest;
+  std::atomic<bool> done(false);
+  uint32_t outOfOrder = 0;
+  uint32_t received = 0;
+  uint32_t torn = 0;
+  uint32_t backwards = 0;
+  uint32_t reads = 0;
+  uint32_t retries = 0;
+
+  std::thread producer([&]() {
+    for (uint32_t i = 1; i <= STRESS_COUNT; i++) {
+      Record record = makeRecord(i);
+      latest.write(record);
+      while (!ring.push(record)) {
+        std::this_thread::yield();
+      }
+    }
+    done = true;
+  });
+  std::thread consumer([&]() {
+    Record record;
+    uint32_t expected = 1;
+    while (expected <= STRESS_COUNT) {
+      if (!ring.pop(record)) {
+        std::this_thread::yield();
+        continue;
+      }
+      if (record.sequence != expected || !isWhole(record)) {
+        outOfOrder++;
+      }
+      expected++;
+      received++;
+    }
+  });
+  std::thread reader([&]() {
+    Record record;
+    uint32_t last = 0;
+    while (!done) {
+      retries += latest.read(record);
+      if (!isWhole(record)) {
+        torn++;
+      }
+      if (record.sequence < last) {
+        backwards++;
+      }
+      last = record.sequence;
+      reads++;
+      std::this_thread::yield();
+    }
+  });
+  producer.join();
+  consumer.join();
+  reader.join();
+
+  char message[120];
+  snprintf(message, sizeof(message), "%u records, %u seqlock reads, %u retried, %u pushes found the queue full",
+           received, reads, retries, ring.getDropped());
+  TEST_MESSAGE(message);
+  TEST_ASSERT_EQUAL_UINT32(STRESS_COUNT, received);
+  TEST_ASSERT_EQUAL_UINT32(0, outOfOrder);
+  TEST_ASSERT_EQUAL_UINT32(0, torn);
+  TEST_ASSERT_EQUAL_UINT32(0, backwards);
+  TEST_ASSERT_EQUAL_UINT32(STRESS_COUNT, latest.getWriteCount());
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_ring_keeps_order_and_drops_when_full);
+  RUN_TEST(test_seqlock_starts_zeroed_and_counts_writes);
+  RUN_TEST(test_channels_across_threads);
+  return UNITY_END();
+}
@@ -0,0 +1,69 @@
+#include <unity.h>
+#include <vector>
+#include "../../src/sensor_history.cpp"
+#include "../../src/rules_engine.cpp"
+
+// Actuators, as main.cpp provides them
+void setLED(bool) {}
+void setServoPosition(int) {}
+
+// One rule, pm25 above 35, with the given action counts and actions
+static std::vector<uint8_t> rule(uint8_t thenActions, uint8_t elseActions, const std::vector<uint8_t>& actions) {
+  std::vector<uint8_t> code = { 0, 0, 1, thenActions, elseActions, METRIC_PM2_5, RULE_ABOVE, 35, 0, 0, 0 };
+  code.insert(code.end(), actions.begin(), actions.end());
+  return code;
+}
+
+// Stores the program as save() does and loads it as at boot
+static void store(const std::vector<uint8_t>& code) {
+  RulesFileHeader header = { RULES_MAGIC, (uint16_t)code.size(), 0 };
+  File file = LittleFS.open(RULES_FILE, "w");
+  file.write((const uint8_t*)&header, sizeof(header));
+  file.write(code.data(), code.size());
+  file.close();
+}
+
+void setUp() {
+  LittleFS.begin();
+}
+
+void tearDown() {
+  LittleFS.remove(RULES_FILE);
+}
+
+void test_stored_program_loads() {
+  store(rule(1, 1, { RULE_TARGET_SERVO, 90, 0, RULE_TARGET_LED, 0, 0 }));
+  RulesEngine rules;
+  rules.begin();
+  TEST_ASSERT_EQUAL(1, rules.getRuleCount());
+  TEST_ASSERT_EQUAL(90, rules.getAction(0, true, 0).value);
+  TEST_ASSERT_EQUAL(RULE_TARGET_LED, rules.getAction(0, false, 0).target);
+}
+
+// 200 + 56 wraps to 0 in eight bits, which made the rule look complete
+void test_action_counts_that_wrap_are_rejected() {
+  store(rule(200, 56, {}));
+  RulesEngine rules;
+  rules.begin();
+  TEST_ASSERT_EQUAL(0, rules.getRuleCount());
+}
+
+void test_values_compile_cannot_produce_are_rejected() {
+  store(rule(1, 0, { RULE_TARGET_SERVO, 181, 0 }));
+  RulesEngine servo;
+  servo.begin();
+  TEST_ASSERT_EQUAL(0, servo.getRuleCount());
+
+  store(rule(1, 0, { RULE_TARGET_LED, 2, 0 }));
+  RulesEngine led;
+  led.begin();
+  TEST_ASSERT_EQUAL(0, led.getRuleCount());
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_stored_program_loads);
+  RUN_TEST(test_action_counts_that_wrap_are_rejected);
+  RUN_TEST(test_values_compile_cannot_produce_are_rejected);
+  return UNITY_END();
+}
@@ -0,0 +1,196 @@
+#include <unity.h>
+#include <chrono>
+#include <vector>
+#include "../../src/series_codec.cpp"
+
+// A week of one-minute samples from slowly changing air with occasional
+// timing jitter and one step change, as the archive sees them
+static std::vector<HistorySample> makeWeek() {
+  std::vector<HistorySample> series;
+  HistorySample sample = { 1767225600, 5, 8, 12, 25, 0 };
+  randomSeed(1);
+  for (int i = 0; i < 7 * 24 * 60; i++) {
+    sample.time += 60 + (random(50) == 0 ? random(5) - 2 : 0);
+    if (random(3) == 0) sample.pm2_5 += random(3) - 1;
+    if (random(4) == 0) sample.pm1_0 += random(3) - 1;
+    if (random(3) == 0) sample.pm10 += random(3) - 1;
+    if (random(5) == 0) sample.vocIndex += random(3) - 1;
+    if (i == 5000) sample.pm2_5 += 150;
+    series.push_back(sample);
+  }
+  return series;
+}
+
+static void assertSameSample(const HistorySample& expected, const HistorySample& actual) {
+  TEST_ASSERT_EQUAL_UINT32(expected.time, actual.time);
+  TEST_ASSERT_EQUAL_UINT16(expected.pm1_0, actual.pm1_0);
+  TEST_ASSERT_EQUAL_UINT16(expected.pm2_5, actual.pm2_5);
+  TEST_ASSERT_EQUAL_UINT16(expected.pm10, actual.pm10);
+  TEST_ASSERT_EQUAL_UINT8(expected.vocIndex, actual.vocIndex);
+}
+
+static size_t encode(const std::vector<HistorySample>& series, std::vector<uint8_t>& out) {
+  SeriesEncoder encoder;
+  encoder.begin(out.data(), out.size());
+  for (const HistorySample& sample : series) {
+    TEST_ASSERT_TRUE(encoder.append(sample));
+  }
+  TEST_ASSERT_EQUAL(series.size(), encoder.getCount());
+  return encoder.getLength();
+}
+
+static void assertRoundTrip(const std::vector<HistorySample>& series) {
+  std::vector<uint8_t> buffer(series.size() * SERIES_MAX_SAMPLE_SIZE);
+  size_t length = encode(series, buffer);
+
+  SeriesDecoder decoder;
+  decoder.begin(buffer.data(), length, series.size());
+  HistorySample decoded;
+  for (const HistorySample& expected : series) {
+    TEST_ASSERT_TRUE(decoder.next(decoded));
+    assertSameSample(expected, decoded);
+  }
+  TEST_ASSERT_FALSE(decoder.next(decoded));
+}
+
+void setUp() {}
+void tearDown() {}
+
+void test_week_round_trips_in_a_few_bytes_per_sample() {
+  std::vector<HistorySample> series = makeWeek();
+  std::vector<uint8_t> buffer(series.size() * SERIES_MAX_SAMPLE_SIZE);
+  size_t length = encode(series, buffer);
+  assertRoundTrip(series);
+
+  // Raw samples are 12 bytes; steady air should need a quarter of that
+  float bytesPerSample = (float)length / series.size();
+  TEST_ASSERT_TRUE(bytesPerSample < 3.0f);
+}
+
+void test_extreme_values_round_trip() {
+  std::vector<HistorySample> series = {
+    { 0, 0, 0, 0, 0, 0 },
+    { 0xFFFFFFF0, 65535, 65535, 65535, 255, 0 },     // Largest jumps up
+    { 0xFFFFFFF1, 0, 0, 0, 0, 0 },                   // and down
+    { 100, 1, 65535, 2, 128, 0 },                    // Time going backwards
+    { 100, 1, 65535, 2, 128, 0 },                    // Repeated sample
+    { 0x80000000, 300, 20, 65000, 1, 0 },
+  };
+  assertRoundTrip(series);
+}
+
+void test_steady_series_costs_one_byte_per_sample() {
+  std::vector<HistorySample> series;
+  for (uint32_t i = 0; i < 100; i++) {
+    series.push_back({ 1000 + i * 30, 4, 6, 9, 20, 0 });
+  }
+  std::vector<uint8_t> buffer(series.size() * SERIES_MAX_SAMPLE_SIZE);
+  size_t length = encode(series, buffer);
+  assertRoundTrip(series);
+
+  // First sample in full, the second sets the interval, then control bytes only
+  size_t headLength = encode({ series[0], series[1] }, buffer);
+  TEST_ASSERT_EQUAL(headLength + 98, length);
+}
+
+void test_full_buffer_keeps_whole_samples() {
+  std::vector<HistorySample> series = makeWeek();
+  uint8_t small[30];
+  SeriesEncoder encoder;
+  encoder.begin(small, sizeof(small));
+  size_t fitted = 0;
+  while (encoder.append(series[fitted])) {
+    fitted++;
+  }
+  size_t length = encoder.getLength();
+  TEST_ASSERT_TRUE(fitted > 0);
+  TEST_ASSERT_TRUE(length <= sizeof(small));
+
+  // A refused sample leaves the output as it was
+  TEST_ASSERT_FALSE(encoder.append(series[fitted]));
+  TEST_ASSERT_EQUAL(length, encoder.getLength());
+  TEST_ASSERT_EQUAL(fitted, encoder.getCount());
+
+  SeriesDecoder decoder;
+  decoder.begin(small, length, encoder.getCount());
+  HistorySample decoded;
+  for (size_t i = 0; i < fitted; i++) {
+    TEST_ASSERT_TRUE(decoder.next(decoded));
+    assertSameSample(series[i], decoded);
+  }
+  TEST_ASSERT_FALSE(decoder.next(decoded));
+}
+
+void test_truncated_input_stops_the_decoder() {
+  std::vector<HistorySample> series = makeWeek();
+  series.resize(50);
+  std::vector<uint8_t> buffer(series.size() * SERIES_MAX_SAMPLE_SIZE);
+  size_t length = encode(series, buffer);
+
+  // Every prefix decodes to a prefix of the series and never reads past it
+  for (size_t cut = 0; cut < length; cut++) {
+    std::vector<uint8_t> prefix(buffer.begin(), buffer.begin() + cut);
+    SeriesDecoder decoder;
+    decoder.begin(prefix.data(), prefix.size(), series.size());
+    HistorySample decoded;
+    size_t count = 0;
+    while (decoder.next(decoded)) {
+      assertSameSample(series[count], decoded);
+      count++;
+    }
+    TEST_ASSERT_TRUE(count < series.size());
+  }
+}
+
+void test_unterminated_varint_is_rejected() {
+  const uint8_t corrupt[] = { 0x01, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80 };
+  SeriesDecoder decoder;
+  decoder.begin(corrupt, sizeof(corrupt), 1);
+  HistorySample decoded;
+  TEST_ASSERT_FALSE(decoder.next(decoded));
+}
+
+// Host throughput of the codec, for comparison with /debug/codec on the hub
+void test_codec_throughput() {
+  std::vector<HistorySample> series = makeWeek();
+  std::vector<uint8_t> buffer(series.size() * SERIES_MAX_SAMPLE_SIZE);
+  const int rounds = 20;
+
+  auto start = std::chrono::steady_clock::now();
+  size_t length = 0;
+  for (int round = 0; round < rounds; round++) {
+    length = encode(series, buffer);
+  }
+  auto encoded = std::chrono::steady_clock::now();
+  size_t decodedCount = 0;
+  for (int round = 0; round < rounds; round++) {
+    SeriesDecoder decoder;
+    decoder.begin(buffer.data(), length, series.size());
+    HistorySample decoded;
+    while (decoder.next(decoded)) {
+      decodedCount++;
+    }
+  }
+  auto decoded = std::chrono::steady_clock::now();
+  TEST_ASSERT_EQUAL(series.size() * rounds, decodedCount);
+
+  double encodeSeconds = std::chrono::duration<double>(encoded - start).count();
+  double decodeSeconds = std::chrono::duration<double>(decoded - encoded).count();
+  char message[160];
+  snprintf(message, sizeof(message), "%zu samples, %.2f bytes/sample, encode %.1f M samples/s, decode %.1f M samples/s",
+           series.size(), (double)length / series.size(),
+           series.size() * rounds / encodeSeconds / 1e6, series.size() * rounds / decodeSeconds / 1e6);
+  TEST_MESSAGE(message);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_week_round_trips_in_a_few_bytes_per_sample);
+  RUN_TEST(test_extreme_values_round_trip);
+  RUN_TEST(test_steady_series_costs_one_byte_per_sample);
+  RUN_TEST(test_full_buffer_keeps_whole_samples);
+  RUN_TEST(test_truncated_input_stops_the_decoder);
+  RUN_TEST(test_unterminated_varint_is_rejected);
+  RUN_TEST(test_codec_throughput);
+  return UNITY_END();
+}
@@ -0,0 +1,240 @@
+#include <unity.h>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Virtual time at 1000x, as in the nodemcuv2_sim env: one host millisecond
+// is a simulated second, so a week of readings takes seconds
+#define SENSOR_SIMULATOR
+#define SIM_TIME_SCALE 1000
+#include "../sensor_pipeline.h"
+#include "../../src/sensor_history.cpp"
+#include "../../src/series_codec.cpp"
+#include "../../src/history_archive.cpp"
+#include "../../src/history_export.cpp"
+
+#define SENSOR_READ_INTERVAL 30000    // As in main.cpp
+#define WEEK_SECONDS (7 * 86400UL)
+
+// The sensing objects main.cpp creates
+struct Hub {
+  PMSSensor sensor;
+  SensorHistory history;
+  HistoryArchive archive;
+  TimeSync timeSync;
+};
+
+// Everything the week published, and how level changes went
+struct Week {
+  std::vector<PMSSensor::ReadingSnapshot> readings;
+  uint32_t valid = 0;
+  uint32_t entered[AIR_LEVEL_COUNT] = {};  // Transitions into each level
+  uint32_t left[AIR_LEVEL_COUNT] = {};
+  AirLevel highest = AIR_NO_DATA;
+};
+
+// main.cpp's sensing loop, one iteration per read interval
+static Week runWeek(Hub& hub, SimScenario scenario) {
+  hub.sensor.getSimulator().setScenario(scenario);
+  hub.archive.begin();
+  Week week;
+  AirLevel level = AIR_NO_DATA;
+  auto start = std::chrono::steady_clock::now();
+  while (TimeSync::monotonicSeconds() < WEEK_SECONDS) {
+    hostAdvanceMillis(SENSOR_READ_INTERVAL / SIM_TIME_SCALE);
+    hub.timeSync.update();
+    if (hub.sensor.readData()) {
+      hub.sensor.updateTrend(hub.timeSync.hourOf(hub.sensor.getSnapshot().time));
+      hub.sensor.updateForecast();
+    }
+
+    PMSSensor::ReadingSnapshot reading;
+    while (hub.sensor.nextReading(reading)) {
+      week.readings.push_back(reading);
+      if (reading.level != level) {
+        week.left[level]++;
+        week.entered[reading.level]++;
+        level = reading.level;
+      }
+      week.highest = max(week.highest, reading.level);
+      if (!reading.data.isValid) {
+        continue;
+      }
+      week.valid++;
+      hub.history.add(reading);
+      HistorySample sample = hub.history.at(hub.history.size() - 1);
+      sample.time = hub.timeSync.toEpoch(sample.time);
+      hub.archive.add(sample);
+    }
+  }
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  char message[160];
+  snprintf(message, sizeof(message), "%s: %u readings over 7 simulated days in %.2f s of host time",
+           SensorSimulator::scenarioName(scenario), (unsigned)week.readings.size(), seconds);
+  TEST_MESSAGE(message);
+  return week;
+}
+
+static uint8_t hourOf(const PMSSensor::ReadingSnapshot& reading) {
+  return (reading.time / 3600) % 24;
+}
+
+// Each hourly slot holds the mean PM2.5 of the latest run of valid
+// readings in that hour
+static void assertTrendSlots(Hub& hub, const Week& week) {
+  float sum[24] = {};
+  uint32_t count[24] = {};
+  int slot = -1;
+  for (const PMSSensor::ReadingSnapshot& reading : week.readings) {
+    if (!reading.data.isValid) {
+      continue;
+    }
+    if (hourOf(reading) != slot) {
+      slot = hourOf(reading);
+      sum[slot] = 0;
+      count[slot] = 0;
+    }
+    sum[slot] += reading.data.pm2_5_atm;
+    count[slot]++;
+  }
+
+  PMSSensor::TrendSnapshot trend = hub.sensor.readTrend();
+  TEST_ASSERT_EQUAL(slot, trend.hour);
+  for (uint8_t hour = 0; hour < 24; hour++) {
+    TEST_ASSERT_TRUE(count[hour] > 0);
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, sum[hour] / count[hour], trend.pm25[hour]);
+  }
+}
+
+static std::string csvRecord(uint32_t time, const PMSSensor::AirQualityData& data, uint8_t vocIndex) {
+  char record[80];
+  snprintf(record, sizeof(record), "%10u,%5u,%5u,%5u,%3u\n", time, data.pm1_0_atm, data.pm2_5_atm, data.pm10_atm,
+           vocIndex);
+  return record;
+}
+
+// The archive holds the newest valid readings in order, whole when nothing
+// has been overwritten, and a restart finds all of it
+static void assertArchive(Hub& hub, const Week& week) {
+  uint8_t block[ARCHIVE_BLOCK_SIZE];
+  char chunk[EXPORT_CHUNK_SIZE];
+  HistoryExport exporter(&hub.archive);
+  exporter.begin(EXPORT_CSV, 0, UINT32_MAX, block, chunk);
+  uint32_t records = exporter.getCount();
+  if (hub.archive.getOldestSequence() == 0) {
+    TEST_ASSERT_EQUAL(week.valid, records);
+  } else {
+    TEST_ASSERT_TRUE(records > 0 && records < week.valid);
+  }
+
+  std::string csv;
+  exporter.write(0, exporter.getLength() - 1, [&csv](const char* data, size_t length) { csv.append(data, length); });
+  TEST_ASSERT_EQUAL(exporter.getHeaderLength() + records * exporter.getRecordLength(), csv.size());
+  size_t at = csv.size();
+  for (auto reading = week.readings.rbegin(); reading != week.readings.rend() && at > exporter.getHeaderLength();
+       reading++) {
+    if (!reading->data.isValid) {
+      continue;
+    }
+    at -= exporter.getRecordLength();
+    std::string expected = csvRecord(hub.timeSync.toEpoch(reading->time), reading->data, reading->vocIndex);
+    TEST_ASSERT_EQUAL_STRING(expected.c_str(), csv.substr(at, exporter.getRecordLength()).c_str());
+  }
+
+  // Sealing the open block may overwrite the oldest one when the ring is full
+  hub.archive.flush();
+  HistoryExport flushed(&hub.archive);
+  flushed.begin(EXPORT_CSV, 0, UINT32_MAX, block, chunk);
+  HistoryArchive restarted;
+  restarted.begin();
+  TEST_ASSERT_EQUAL(hub.archive.getNextSequence(), restarted.getNextSequence());
+  HistoryExport resumed(&restarted);
+  resumed.begin(EXPORT_CSV, 0, UINT32_MAX, block, chunk);
+  TEST_ASSERT_EQUAL(flushed.getCount(), resumed.getCount());
+  TEST_ASSERT_EQUAL(flushed.getLength(), resumed.getLength());
+}
+
+// Days on which some reading was at the level
+static uint8_t daysAt(const Week& week, AirLevel level) {
+  uint8_t days = 0;
+  int lastDay = -1;
+  for (const PMSSensor::ReadingSnapshot& reading : week.readings) {
+    int day = (reading.time - 1) / 86400;
+    if (reading.level == level && day != lastDay) {
+      days++;
+      lastDay = day;
+    }
+  }
+  return days;
+}
+
+static std::unique_ptr<Hub> hub;
+
+void setUp() {
+  hostMicros = 0;
+  LittleFS.format();
+  hub.reset(new Hub());
+}
+
+void tearDown() {
+  hub.reset();
+}
+
+void test_normal_week_stays_below_sensitive() {
+  Week week = runWeek(*hub, SIM_NORMAL);
+  TEST_ASSERT_EQUAL(WEEK_SECONDS / 30, week.readings.size());
+  TEST_ASSERT_EQUAL(week.readings.size(), week.valid);
+  TEST_ASSERT_TRUE(week.highest <= AIR_MODERATE);
+  assertTrendSlots(*hub, week);
+  assertArchive(*hub, week);
+}
+
+// Dinner reaches the alert level every day and it clears each night
+void test_cooking_week_alerts_at_dinner() {
+  Week week = runWeek(*hub, SIM_COOKING_SPIKE);
+  TEST_ASSERT_EQUAL(7, daysAt(week, AIR_UNHEALTHY));
+  TEST_ASSERT_EQUAL(week.entered[AIR_UNHEALTHY], week.left[AIR_UNHEALTHY]);
+  assertTrendSlots(*hub, week);
+  PMSSensor::TrendSnapshot trend = hub->sensor.readTrend();
+  TEST_ASSERT_TRUE(trend.pm25[19] > ALERT_PM25_MODERATE);
+  TEST_ASSERT_TRUE(trend.pm25[3] < ALERT_PM25_MODERATE);
+  assertArchive(*hub, week);
+}
+
+// Smoke holds the alert through each afternoon; nights are clean again
+void test_wildfire_week_alerts_each_day() {
+  Week week = runWeek(*hub, SIM_WILDFIRE_DAY);
+  TEST_ASSERT_EQUAL(7, daysAt(week, AIR_UNHEALTHY));
+  TEST_ASSERT_EQUAL(week.entered[AIR_UNHEALTHY], week.left[AIR_UNHEALTHY]);
+  for (const PMSSensor::ReadingSnapshot& reading : week.readings) {
+    if (hourOf(reading) == 14) {
+      TEST_ASSERT_EQUAL(AIR_UNHEALTHY, reading.level);
+    } else if (hourOf(reading) == 3 && reading.time > 86400) {
+      TEST_ASSERT_TRUE(reading.level <= AIR_MODERATE);
+    }
+  }
+  assertTrendSlots(*hub, week);
+  TEST_ASSERT_TRUE(hub->sensor.readTrend().pm25[14] > ALERT_PM25_UNHEALTHY);
+  assertArchive(*hub, week);
+}
+
+// 43 failed reads a day (15, 5 and 1.5 minutes at 30 s) are published as
+// invalid and kept out of the trend and the archive
+void test_dropout_week_skips_failed_reads() {
+  Week week = runWeek(*hub, SIM_SENSOR_DROPOUT);
+  TEST_ASSERT_EQUAL(WEEK_SECONDS / 30, week.readings.size());
+  TEST_ASSERT_EQUAL(week.readings.size() - 7 * 43, week.valid);
+  assertTrendSlots(*hub, week);
+  assertArchive(*hub, week);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_normal_week_stays_below_sensitive);
+  RUN_TEST(test_cooking_week_alerts_at_dinner);
+  RUN_TEST(test_wildfire_week_alerts_each_day);
+  RUN_TEST(test_dropout_week_skips_failed_reads);
+  return UNITY_END();
+}
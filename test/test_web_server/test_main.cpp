@@ -0,0 +1,169 @@
+#include <unity.h>
+#include <ArduinoJson.h>
+#include <memory>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include "../sensor_pipeline.h"
+#include "../../src/admission_control.cpp"
+#include "../../src/air_quality_display.cpp"
+#include "../../src/black_box.cpp"
+#include "../../src/coap_server.cpp"
+#include "../../src/firmware_updater.cpp"
+#include "../../src/heap_monitor.cpp"
+#include "../../src/history_archive.cpp"
+#include "../../src/history_export.cpp"
+#include "../../src/house_peers.cpp"
+#include "../../src/live_socket.cpp"
+#include "../../src/power_manager.cpp"
+#include "../../src/profiler.cpp"
+#include "../../src/request_arena.cpp"
+#include "../../src/rules_engine.cpp"
+#include "../../src/sensing_lock.cpp"
+#include "../../src/sensor_history.cpp"
+#include "../../src/series_codec.cpp"
+#include "../../src/wifi_connection_manager.cpp"
+#include "../../src/air_quality_webserver.cpp"
+
+static const uint16_t TEST_PORT = 18480;
+
+// Actuators, as main.cpp provides them
+static bool ledState;
+static int servoPosition;
+
+void setLED(bool state) {
+  ledState = state;
+}
+
+bool getLEDState() {
+  return ledState;
+}
+
+void setServoPosition(int angle) {
+  servoPosition = angle;
+}
+
+int getServoPosition() {
+  return servoPosition;
+}
+
+// The objects main.cpp creates, wired the same way
+struct Hub {
+  PMSSensor sensor;
+  HousePeers peers;
+  AirQualityDisplay display;
+  HeapMonitor heapMonitor;
+  SensorHistory history;
+  HistoryArchive archive;
+  RulesEngine rules;
+  TimeSync timeSync;
+  AirQualityWebServer webServer;
+
+  Hub()
+      : peers(&sensor), display(&sensor, &peers),
+        webServer(&sensor, &display, &heapMonitor, &history, &timeSync, &archive, &rules, &peers) {
+    hostListenPort = TEST_PORT;
+    webServer.begin("test", "test");
+    hostListenPort = 0;
+  }
+};
+
+struct Response {
+  int status = 0;
+  std::string body;
+};
+
+// One GET over loopback; the server is run while the answer is awaited
+static Response get(Hub& hub, const char* uri) {
+  int fd = socket(AF_INET, SOCK_STREAM, 0);
+  sockaddr_in remote = {};
+  remote.sin_family = AF_INET;
+  remote.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  remote.sin_port = htons(TEST_PORT);
+  char request[160];
+  int length = snprintf(request, sizeof(request), "GET %s HTTP/1.1\r\nHost: hub\r\n\r\n", uri);
+  TEST_ASSERT_EQUAL(0, connect(fd, (sockaddr*)&remote, sizeof(remote)));
+  TEST_ASSERT_EQUAL(length, send(fd, request, length, MSG_NOSIGNAL));
+
+  std::string raw;
+  char buffer[4096];
+  ssize_t n = -1;
+  for (int turn = 0; turn < 10000 && n != 0; turn++) {
+    hub.webServer.handleClient();
+    while ((n = recv(fd, buffer, sizeof(buffer), MSG_DONTWAIT)) > 0) {
+      raw.append(buffer, n);
+    }
+  }
+  close(fd);
+  TEST_ASSERT_EQUAL_MESSAGE(0, n, "connection not closed");
+
+  Response response;
+  size_t headersEnd = raw.find("\r\n\r\n");
+  TEST_ASSERT_TRUE(headersEnd != std::string::npos);
+  TEST_ASSERT_EQUAL(1, sscanf(raw.c_str(), "HTTP/1.1 %d", &response.status));
+  response.body = raw.substr(headersEnd + 4);
+  return response;
+}
+
+// A capture of well-formed frames, one per read
+static void recordCapture(uint16_t frames) {
+  PMSRecorder recorder;
+  TEST_ASSERT_TRUE(recorder.start(PMS_CAPTURE_FILE));
+  for (uint16_t i = 0; i < frames; i++) {
+    uint8_t frame[PMS_FRAME_SIZE];
+    buildFrame(10 + i, frame);
+    recorder.record(frame, sizeof(frame));
+  }
+  recorder.stop();
+}
+
+static std::unique_ptr<Hub> hub;
+
+void setUp() {
+  hostMicros = 1000000;
+  LittleFS.begin();
+  hub.reset(new Hub());
+}
+
+void tearDown() {
+  hub.reset();
+  LittleFS.remove(PMS_CAPTURE_FILE);
+}
+
+// Enough frames that /api/data bodies built back to back would not fit
+// in one arena
+void test_replay_benchmark_answers_with_json() {
+  const uint16_t frames = 40;
+  recordCapture(frames);
+
+  Response response = get(*hub, "/debug/pms?replay=max");
+  TEST_ASSERT_EQUAL(200, response.status);
+  TEST_ASSERT_FALSE(response.body.empty());
+  DynamicJsonDocument doc(4096);
+  DeserializationError error = deserializeJson(doc, response.body.c_str(), response.body.size());
+  TEST_ASSERT_FALSE_MESSAGE(error, error.c_str());
+  TEST_ASSERT_EQUAL(frames, doc["benchmark"]["reads"].as<unsigned>());
+  TEST_ASSERT_EQUAL(frames, doc["benchmark"]["frames"].as<unsigned>());
+  TEST_ASSERT_TRUE(doc["benchmark"]["us"]["serialize"].is<unsigned>());
+}
+
+// Every body the benchmark times fits the arena: one that ran out would
+// time a failed format instead of the serialization
+void test_replay_benchmark_does_not_overflow_the_arena() {
+  recordCapture(40);
+  TEST_ASSERT_EQUAL(200, get(*hub, "/debug/pms?replay=max").status);
+
+  Response response = get(*hub, "/debug/heap");
+  TEST_ASSERT_EQUAL(200, response.status);
+  DynamicJsonDocument doc(4096);
+  DeserializationError error = deserializeJson(doc, response.body.c_str(), response.body.size());
+  TEST_ASSERT_FALSE_MESSAGE(error, error.c_str());
+  TEST_ASSERT_EQUAL(0, doc["arena"]["overflows"].as<unsigned>());
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_replay_benchmark_answers_with_json);
+  RUN_TEST(test_replay_benchmark_does_not_overflow_the_arena);
+  return UNITY_END();
+}